@@ -0,0 +1,203 @@
+#ifndef HCL_RING_BUFFER_H
+#define HCL_RING_BUFFER_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*This file contains a bounded multi-producer multi-consumer queue on a ring of cells (D. Vyukov's bounded MPMC queue). Each cell carries a sequence number that says whose turn it is: a producer may fill cell i at position p when its sequence is p, and a consumer may empty it when its sequence is p+1. Producers and consumers claim positions by advancing the head and the tail with a CAS, and never wait on each other; a full ring makes pushes fail instead of growing, so that the caller sees back-pressure. Batches claim several consecutive positions with one CAS.
+Cells are padded to a cache line so that threads filling or emptying adjacent cells do not share lines, and the head and the tail live on lines of their own. Values are constructed in the cells on push and destroyed on pop, so they need not be trivially copyable.*/
+
+namespace hcl
+{
+
+template <class ValueT>
+class RingBuffer
+{
+   private :
+	struct alignas(64) cell
+	{
+	    std::atomic<uint64_t> sequence;
+	    alignas(ValueT) unsigned char storage[sizeof(ValueT)];
+
+	    ValueT *value() { return reinterpret_cast<ValueT*>(storage); }
+	};
+
+	uint64_t capacity_;
+	uint64_t mask;
+	cell *cells;
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+
+	/*Claims up to n free cells from the head; returns the first position and sets n to the number claimed, 0 when the ring is full*/
+	uint64_t claim_push(uint64_t &n)
+	{
+	    uint64_t pos = head.load(std::memory_order_relaxed);
+	    while(true)
+	    {
+		uint64_t k = 0;
+		for(;k < n;k++)
+		{
+		   if(cells[(pos+k)&mask].sequence.load(std::memory_order_acquire) != pos+k) break;
+		}
+		if(k == 0)
+		{
+		   int64_t diff = static_cast<int64_t>(cells[pos&mask].sequence.load(std::memory_order_acquire) - pos);
+		   if(diff < 0) { n = 0; return pos; }
+		   pos = head.load(std::memory_order_relaxed);
+		   continue;
+		}
+		if(head.compare_exchange_weak(pos,pos+k,std::memory_order_relaxed))
+		{
+		   n = k;
+		   return pos;
+		}
+	    }
+	}
+
+	/*Claims up to n filled cells from the tail; as claim_push, n is 0 when the ring is empty*/
+	uint64_t claim_pop(uint64_t &n)
+	{
+	    uint64_t pos = tail.load(std::memory_order_relaxed);
+	    while(true)
+	    {
+		uint64_t k = 0;
+		for(;k < n;k++)
+		{
+		   if(cells[(pos+k)&mask].sequence.load(std::memory_order_acquire) != pos+k+1) break;
+		}
+		if(k == 0)
+		{
+		   int64_t diff = static_cast<int64_t>(cells[pos&mask].sequence.load(std::memory_order_acquire) - (pos+1));
+		   if(diff < 0) { n = 0; return pos; }
+		   pos = tail.load(std::memory_order_relaxed);
+		   continue;
+		}
+		if(tail.compare_exchange_weak(pos,pos+k,std::memory_order_relaxed))
+		{
+		   n = k;
+		   return pos;
+		}
+	    }
+	}
+
+	ValueT take(uint64_t pos)
+	{
+	    cell &c = cells[pos&mask];
+	    ValueT v(std::move(*c.value()));
+	    c.value()->~ValueT();
+	    c.sequence.store(pos+capacity_,std::memory_order_release);
+	    return v;
+	}
+
+   public :
+	/*The capacity is rounded up to a power of two*/
+	explicit RingBuffer(uint64_t c) : head(0), tail(0)
+	{
+	    capacity_ = 2;
+	    while(capacity_ < c) capacity_ <<= 1;
+	    mask = capacity_-1;
+	    cells = new cell[capacity_];
+	    for(uint64_t i=0;i<capacity_;i++) cells[i].sequence.store(i,std::memory_order_relaxed);
+	}
+
+	~RingBuffer()
+	{
+	    uint64_t t = tail.load(std::memory_order_relaxed);
+	    uint64_t h = head.load(std::memory_order_relaxed);
+	    for(;t != h;t++) cells[t&mask].value()->~ValueT();
+	    delete [] cells;
+	}
+
+	RingBuffer(const RingBuffer&) = delete;
+	RingBuffer &operator=(const RingBuffer&) = delete;
+
+	uint64_t capacity() const
+	{
+	    return capacity_;
+	}
+
+	/*Approximate while other threads push or pop*/
+	uint64_t size() const
+	{
+	    uint64_t t = tail.load(std::memory_order_relaxed);
+	    uint64_t h = head.load(std::memory_order_relaxed);
+	    return h > t ? h-t : 0;
+	}
+
+	bool empty() const
+	{
+	    return size() == 0;
+	}
+
+	/*False when the ring is full*/
+	bool push(const ValueT &v)
+	{
+	    uint64_t n = 1;
+	    uint64_t pos = claim_push(n);
+	    if(n == 0) return false;
+	    cell &c = cells[pos&mask];
+	    new (c.value()) ValueT(v);
+	    c.sequence.store(pos+1,std::memory_order_release);
+	    return true;
+	}
+
+	/*False when the ring is empty*/
+	bool pop(ValueT &v)
+	{
+	    uint64_t n = 1;
+	    uint64_t pos = claim_pop(n);
+	    if(n == 0) return false;
+	    v = take(pos);
+	    return true;
+	}
+
+	/*Pushes a prefix of values[0..n) and returns its length, which is less than n only when the ring filled up*/
+	uint64_t push_bulk(const ValueT *values,uint64_t n)
+	{
+	    uint64_t pushed = 0;
+	    while(pushed < n)
+	    {
+		uint64_t k = n-pushed;
+		uint64_t pos = claim_push(k);
+		if(k == 0) break;
+		for(uint64_t i=0;i<k;i++)
+		{
+		   cell &c = cells[(pos+i)&mask];
+		   new (c.value()) ValueT(values[pushed+i]);
+		   c.sequence.store(pos+i+1,std::memory_order_release);
+		}
+		pushed += k;
+	    }
+	    return pushed;
+	}
+
+	/*Appends up to max_n values to out, in queue order; returns how many*/
+	uint64_t pop_bulk(std::vector<ValueT> &out,uint64_t max_n)
+	{
+	    uint64_t popped = 0;
+	    while(popped < max_n)
+	    {
+		uint64_t k = max_n-popped;
+		uint64_t pos = claim_pop(k);
+		if(k == 0) break;
+		for(uint64_t i=0;i<k;i++) out.push_back(take(pos+i));
+		popped += k;
+	    }
+	    return popped;
+	}
+};
+
+template <class QueueT>
+struct is_ring_buffer : std::false_type {};
+
+template <class ValueT>
+struct is_ring_buffer<RingBuffer<ValueT>> : std::true_type {};
+
+}
+
+#endif
@@ -3,7 +3,7 @@
 
 #include "skip_list_inl.h"
 
-/*This file contains the class that implements a concurrent randomized skiplist. It is based on folly's skiplist implementation. But we diverged a bit from folly. We have used a custom memory management module based on lockfree queues to recycle used nodes. We have also used locks from boost, instead of microlocks in folly. Folly's implementation is based on the skiplist algorithm with optimistic locks which uses linked and mark bits to indicate linked/deleted nodes. This algorithm avoids locks during search/find operations, but acquires locks for insertion/deletion*/ 
+/*This file contains the class that implements a concurrent randomized skiplist. It is based on folly's skiplist implementation. But we diverged a bit from folly. We have used a custom memory management module based on lockfree queues to recycle used nodes, with an epoch based reclaimer so that a removed node is not reused while a reader may still reach it. Operations hold a Guard of the reclaimer while they traverse the skiplist; callers that keep iterators or pointers into it hold one for as long as they use them. We have also used locks from boost, instead of microlocks in folly. Folly's implementation is based on the skiplist algorithm with optimistic locks which uses linked and mark bits to indicate linked/deleted nodes. This algorithm avoids locks during search/find operations, but acquires locks for insertion/deletion*/ 
 
 template <typename T,typename Comp = std::less<T>,typename NodeAlloc = std::allocator<char>,int MAX_HEIGHT = 24>
 class ConcurrentSkipList 
@@ -17,6 +17,7 @@ class ConcurrentSkipList
 
   typedef csl_iterator<value_type, NodeType> iterator;
   typedef csl_iterator<const value_type, NodeType> const_iterator;
+  typedef typename NodeRecycler<NodeType, NodeAlloc>::Guard Guard;
 
   class Accessor;
   class Skipper;
@@ -54,8 +55,21 @@ class ConcurrentSkipList
   }
 
   size_t size() const { return size_.load(std::memory_order_relaxed); }
+  Guard guard() const { return Guard(recycler_.reclaimer()); }
+  uint64_t retired() const { return recycler_.retired(); }
+  uint64_t reclaimed() const { return recycler_.reclaimed(); }
   bool empty() const { return size() == 0; }
 
+  /*Calls fn with the data of the node equal to data under the lock of the node, unless it is being removed, so that fn can read or change the parts of the data the comparator ignores. Returns whether fn was called*/
+  template <typename Fn>
+  bool apply(const value_type& data, Fn fn)
+  {
+    Guard g = guard();
+    auto ret = findNode(data);
+    if (!ret.second) return false;
+    return applyLocked(ret.first, fn);
+  }
+
   ~ConcurrentSkipList() 
   {
     /*if (NodeType::template DestroyIsNoOp<NodeAlloc>::value) 
@@ -71,6 +85,19 @@ class ConcurrentSkipList
   }
 
  private:
+  template <typename Fn>
+  static bool applyLocked(NodeType* node, Fn fn)
+  {
+    while (!node->fullyLinked())
+    {
+    }
+    node->acquireGuard();
+    bool live = !node->markedForRemoval();
+    if (live) fn(node->data());
+    node->releaseGuard();
+    return live;
+  }
+
   static bool greater(const value_type& data, const NodeType* node) 
   {
     return node && Comp()(node->data(), data);
@@ -117,6 +144,7 @@ class ConcurrentSkipList
 
   NodeType* find(const value_type& data) 
   {
+    Guard g = guard();
     auto ret = findNode(data);
     if (ret.second && !ret.first->markedForRemoval()) 
     {
@@ -156,6 +184,7 @@ class ConcurrentSkipList
     NodeType *preds[MAX_HEIGHT], *succs[MAX_HEIGHT];
     NodeType* newNode;
     size_t newSize;
+    Guard g = guard();
     while (true) 
     {
       int max_layer = 0;
@@ -218,6 +247,7 @@ class ConcurrentSkipList
     bool isMarked = false;
     int nodeHeight = 0;
     NodeType *preds[MAX_HEIGHT], *succs[MAX_HEIGHT];
+    Guard g = guard();
 
     while (true) 
     {
@@ -268,12 +298,14 @@ class ConcurrentSkipList
 
   const value_type* first() const 
   {
+    Guard g = guard();
     auto node = head_.load(std::memory_order_acquire)->skip(0);
     return node ? &node->data() : nullptr;
   }
 
   const value_type* last() const 
   {
+    Guard g = guard();
     NodeType* pred = head_.load(std::memory_order_acquire);
     NodeType* node = nullptr;
     for (int layer = maxLayer(); layer >= 0; --layer) 
@@ -356,6 +388,7 @@ class ConcurrentSkipList
 
   NodeType* lower_bound(const value_type& data) const 
   {
+    Guard g = guard();
     auto node = findNode(data).first;
     while (node != nullptr && node->markedForRemoval()) 
     {
@@ -395,7 +428,7 @@ class ConcurrentSkipList
 
   void recycle(NodeType* node) { recycler_.add(node); }
 
-  NodeRecycler<NodeType, NodeAlloc> recycler_;
+  mutable NodeRecycler<NodeType, NodeAlloc> recycler_;
   std::atomic<NodeType*> head_;
   std::atomic<size_t> size_{0};
 };
@@ -112,6 +112,12 @@ class ConcurrentSkipList<T, Comp, NodeAlloc, MAX_HEIGHT>::Accessor
 
   SkipListType* skiplist() const { return sl_; }
 
+  /*Keeps the nodes that iterators and pointers returned by the accessor point to from being reused while it lives*/
+  typename SkipListType::Guard guard() const { return sl_->guard(); }
+
+  template <typename Fn>
+  bool apply(const key_type& data, Fn fn) { return sl_->apply(data, fn); }
+
   bool contains(const key_type& data) const { return sl_->find(data); }
   bool add(const key_type& data) { return sl_->addOrGetData(data).second; }
   bool remove(const key_type& data) { return sl_->remove(data); }
@@ -257,6 +263,21 @@ class ConcurrentSkipList<T, Comp, NodeAlloc, MAX_HEIGHT>::Skipper {
 
   bool good() const { return succs_[0] != nullptr; }
 
+  /*The current node has been removed but not yet unlinked; callers step past it*/
+  bool removed() const
+  {
+    assert(succs_[0] != nullptr);
+    return succs_[0]->markedForRemoval();
+  }
+
+  /*Calls fn with the data of the current node under the lock of the node, unless it is being removed*/
+  template <typename Fn>
+  bool apply(Fn fn)
+  {
+    assert(succs_[0] != nullptr);
+    return SkipListType::applyLocked(succs_[0], fn);
+  }
+
   int maxLayer() const { return headHeight_ - 1; }
 
   int curHeight() const 
@@ -17,6 +17,8 @@
 #include<boost/thread/shared_mutex.hpp>
 #include <boost/random.hpp>
 
+#include "../../memory/epoch_reclaimer.h"
+
 template <typename ValT, typename NodeT>
 class csl_iterator;
 
@@ -122,13 +124,14 @@ class SkipListNode
     setFlags(uint16_t(getFlags() | MARKED_FOR_REMOVAL));
   }
   
+  /*Recycled nodes keep the data they held, so it is assigned rather than constructed over*/
   void storeData(value_type& data)
   {
-      new (&data_) value_type(std::forward<value_type>(data));
+      data_ = data;
   }
   void storeData(const value_type& data)
   {
-     new (&data_) value_type(data);
+     data_ = data;
   }
  private:
   template <typename U>
@@ -242,12 +245,16 @@ class SkipListRandomHeight
 template <typename NodeType, typename NodeAlloc, typename = void>
 class NodeRecycler;
 
+/*Nodes removed from the skiplist are retired to an epoch_reclaimer, with their height as size class, and reused from the free list of the thread that removed them once no reader of the skiplist can reach them. Readers hold a Guard while they traverse nodes. The per height queues hold the nodes created in chunks and those that do not fit in a free list*/
 template <typename NodeType, typename NodeAlloc>
 class NodeRecycler<NodeType,NodeAlloc>//,typename std::enable_if<!NodeType::template DestroyIsNoOp<NodeAlloc>::value>::type> 
 {
  public:
+  typedef hcl::epoch_reclaimer<NodeType,64> reclaimer_type;
+  typedef typename reclaimer_type::guard Guard;
+
   explicit NodeRecycler(const NodeAlloc& alloc)
-      : refs_(0), dirty_(false), alloc_(alloc) 
+      : refs_(0), alloc_(alloc), reclaimer_([this](NodeType *node,int h) { release(node,h); }, 16)
   {
     chunk_size = 100;
     node_queues.resize(64);
@@ -255,7 +262,7 @@ class NodeRecycler<NodeType,NodeAlloc>//,typename std::enable_if<!NodeType::temp
         node_queues[i] = new boost::lockfree::queue<NodeType*> (128);
   }
 
-  explicit NodeRecycler() : refs_(0), dirty_(false) 
+  explicit NodeRecycler() : refs_(0), reclaimer_([this](NodeType *node,int h) { release(node,h); }, 16)
   {
     chunk_size = 100; 
     node_queues.resize(64);
@@ -266,33 +273,27 @@ class NodeRecycler<NodeType,NodeAlloc>//,typename std::enable_if<!NodeType::temp
   ~NodeRecycler() 
   {
     assert(refs()==0);
-    if (nodes_) 
+    reclaimer_.drain([this](NodeType *node,int) { NodeType::destroy(alloc_, node); });
+    for(int i=0;i<node_queues.size();i++)
     {
-      for (auto& node : *nodes_) 
-      {
-        NodeType::destroy(alloc_, node);
-      }
+	NodeType *node;
+	while(node_queues[i]->pop(node)) NodeType::destroy(alloc_, node);
+	delete node_queues[i];
     }
-    for(int i=0;i<node_queues.size();i++)
-	    delete node_queues[i];
   }
 
+  /*Retires node, which is no longer reachable from the head of the skiplist*/
   void push(int h,NodeType *node)
   {
       assert (h >= 0 && h < 64);
-      node_queues[h]->push(node);
-      bool b = false;
-      bool p = false;
-      bool n = true;
-      assert(refs() > 0);
-      b = dirty_.compare_exchange_strong(p,n,std::memory_order_relaxed);
+      reclaimer_.retire(node,h);
   }
   NodeType *pop(int h,bool ishead)
   {
-     NodeType *n = nullptr;
      assert (h >= 0 && h < 64);
+     NodeType *n = reclaimer_.allocate(h);
      typedef typename NodeType::value_type v;
-     while(!node_queues[h]->pop(n))
+     while(n == nullptr && !node_queues[h]->pop(n))
      {     
 	for(int i=0;i<chunk_size;i++)
 	{	  
@@ -303,10 +304,6 @@ class NodeRecycler<NodeType,NodeAlloc>//,typename std::enable_if<!NodeType::temp
      }
 
      assert (refs() >= 0);
-     bool b = false;
-     bool p = false; 
-     bool p_n = true;
-     b = dirty_.compare_exchange_strong(p,p_n,std::memory_order_relaxed);
      n->setFlags(0);
      if(ishead) n->setIsHeadNode();
      return n;
@@ -314,68 +311,32 @@ class NodeRecycler<NodeType,NodeAlloc>//,typename std::enable_if<!NodeType::temp
 
   void add(NodeType* node) 
   {
-    boost::unique_lock<boost::mutex> g(lock_);
-    if (nodes_.get() == nullptr) 
-    {
-      nodes_ = std::make_unique<std::vector<NodeType*>>(1, node);
-    } else 
-    {
-      nodes_->push_back(node);
-    }
-    assert(refs() > 0);
-    dirty_.store(true, std::memory_order_relaxed);
+    push(node->height(),node);
   }
 
   int addRef() { return refs_.fetch_add(1, std::memory_order_acq_rel); }
 
   int releaseRef() 
   {
-    if (!dirty_.load(std::memory_order_relaxed) || refs() > 1) 
-    {
-      return refs_.fetch_add(-1, std::memory_order_acq_rel);
-    }
-
-    std::unique_ptr<std::vector<NodeType*>> newNodes;
-    int ret;
-    {
-      boost::unique_lock<boost::mutex> g(lock_);
-      ret = refs_.fetch_add(-1, std::memory_order_acq_rel);
-      if (ret == 1) 
-      {
-	for(int i=0;i<64;i++)
-	{
-	   while(!node_queues[i]->empty())
-	   {
-		NodeType *n;
-		if(node_queues[i]->pop(n))
-		  NodeType::destroy(alloc_,n);
-	   }
-	}
-        newNodes.swap(nodes_);
-        dirty_.store(false, std::memory_order_relaxed);
-      }
-    }
-    if (newNodes) 
-    {
-      for (auto& node : *newNodes) 
-      {
-        NodeType::destroy(alloc_, node);
-      }
-    }
-    return ret;
+    return refs_.fetch_add(-1, std::memory_order_acq_rel);
   }
 
   NodeAlloc& alloc() { return alloc_; }
 
+  reclaimer_type& reclaimer() { return reclaimer_; }
+
+  uint64_t retired() { return reclaimer_.retired(); }
+  uint64_t reclaimed() { return reclaimer_.reclaimed(); }
+
  private:
   int refs() const { return refs_.load(std::memory_order_relaxed); }
 
+  void release(NodeType *node,int h) { node_queues[h]->push(node); }
+
   std::vector<boost::lockfree::queue<NodeType*> *> node_queues; 
-  std::unique_ptr<std::vector<NodeType*>> nodes_;
   std::atomic<int32_t> refs_; 
-  std::atomic<bool> dirty_; 
-  boost::mutex lock_; 
   NodeAlloc alloc_;
+  reclaimer_type reclaimer_;
   int chunk_size;
 };
 
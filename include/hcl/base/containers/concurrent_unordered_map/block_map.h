@@ -12,13 +12,18 @@
 #include <memory>
 #include <type_traits>
 #include <string>
+#include <thread>
 #include "memory_allocation.h"
 
 #define NOT_IN_TABLE UINT64_MAX
 #define EXISTS 1
 #define INSERTED 0
 
-/*This file contains the shared memory implementation of the concurrent unordered map, which is distributed using HCL RPC wrappers. It is a static unordered map of fixed size - which removes the complexities of rehashing. The nodes of the unordered map are allocated and reused using a memory allocator*/ 
+/*Number of buckets an operation migrates when it finds a resize in progress*/
+#define MIGRATE_STEP 4
+
+/*This file contains the shared memory implementation of the concurrent unordered map, which is distributed using HCL RPC wrappers. Each bucket keeps a chain of nodes sorted by hash value under its own lock. When the number of entries goes over max_load entries per bucket the map doubles its table incrementally: the new table is published next to the current one, every operation then moves a few buckets to it, and an operation whose bucket has moved follows it to the new table. No operation waits for the whole resize. The nodes of the unordered map are allocated and reused using a memory allocator.
+Only writers lock buckets. A writer makes the version of its bucket odd while it changes the chain, and readers search the chain without the lock and search again if the version changed meanwhile. Readers hold a guard of the pool's epoch reclaimer, so the nodes that writers unlink and push back to the pool are not reused while a reader may still be passing them*/
 
 namespace hcl
 {
@@ -33,11 +38,31 @@ struct f_node
     uint64_t num_nodes;
     std::mutex mutex_t;
     struct node<KeyT,ValueT,HashFcn,EqualFcn> *head;
+    /*Odd while a writer changes the chain*/
+    std::atomic<uint32_t> version;
+    /*Set once the nodes of the bucket are in the next table*/
+    std::atomic<bool> moved;
+};
+
+template <
+	class KeyT,
+	class ValueT,
+	class HashFcn=std::hash<KeyT>,
+	class EqualFcn=std::equal_to<KeyT>>
+struct block_table
+{
+    f_node<KeyT,ValueT,HashFcn,EqualFcn> *buckets;
+    uint64_t size;
+    /*The table being filled from this one during a resize*/
+    std::atomic<block_table *> next;
+    /*Next bucket to migrate and number of buckets migrated*/
+    std::atomic<uint64_t> next_bucket;
+    std::atomic<uint64_t> migrated;
 };
 
 template <
     class KeyT,
-    class ValueT, 
+    class ValueT,
     class HashFcn = std::hash<KeyT>,
     class EqualFcn = std::equal_to<KeyT>>
 class BlockMap
@@ -46,57 +71,284 @@ class BlockMap
    public :
 	typedef struct node<KeyT,ValueT,HashFcn,EqualFcn> node_type;
 	typedef struct f_node<KeyT,ValueT,HashFcn,EqualFcn> fnode_type;
+	typedef struct block_table<KeyT,ValueT,HashFcn,EqualFcn> table_type;
    private :
-	fnode_type *table;
-	uint64_t maxSize;
+	/*Trivially copyable values are changed in place; readers drop what they copied when the version changes*/
+	static constexpr bool in_place = std::is_trivially_copyable<ValueT>::value;
+
+	std::atomic<table_type *> table;
+	double max_load;
+	std::atomic<bool> resizing;
+	/*Tables that were replaced. Operations that read table before the swap may still lock their buckets, so they are freed with the map*/
+	std::vector<table_type *> retired;
+	std::mutex retired_mutex;
 	std::atomic<uint64_t> allocated;
 	std::atomic<uint64_t> removed;
 	memory_pool<KeyT,ValueT,HashFcn,EqualFcn> *pl;
 	KeyT emptyKey;
 
-	uint64_t KeyToIndex(KeyT &k)
+	static node_type *next_of(node_type *n)
 	{
-	    uint64_t hashval = HashFcn()(k);
-	    return hashval % maxSize;
+	    return __atomic_load_n(&(n->next),__ATOMIC_ACQUIRE);
+	}
+
+	static void set_next(node_type *n,node_type *x)
+	{
+	    __atomic_store_n(&(n->next),x,__ATOMIC_RELEASE);
+	}
+
+	/*Makes the version of b odd before a writer changes its chain, and even again after*/
+	static void begin_write(fnode_type &b)
+	{
+	    b.version.store(b.version.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+	    std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	static void end_write(fnode_type &b)
+	{
+	    b.version.store(b.version.load(std::memory_order_relaxed)+1,std::memory_order_release);
+	}
+
+	void unlock_bucket(fnode_type *b)
+	{
+	    end_write(*b);
+	    b->mutex_t.unlock();
 	}
-  public:
 
-	BlockMap(uint64_t n,memory_pool<KeyT,ValueT,HashFcn,EqualFcn> *m,KeyT maxKey) : maxSize(n), pl(m), emptyKey(maxKey)
+	table_type *create_table(uint64_t n)
 	{
-  	   assert (maxSize > 0);
-	   table = (fnode_type *)std::malloc(maxSize*sizeof(fnode_type));
-	   assert (table != nullptr);
-	   for(size_t i=0;i<maxSize;i++)
+	   table_type *t = new table_type();
+	   t->size = n;
+	   t->next.store(nullptr);
+	   t->next_bucket.store(0);
+	   t->migrated.store(0);
+	   t->buckets = (fnode_type *)std::malloc(n*sizeof(fnode_type));
+	   assert (t->buckets != nullptr);
+	   for(size_t i=0;i<n;i++)
 	   {
-	      table[i].num_nodes = 0;
-	      table[i].head = pl->memory_pool_pop();
-	      new (&(table[i].head->key)) KeyT(emptyKey);
-	      table[i].head->next = nullptr; 
+	      new (&(t->buckets[i])) fnode_type();
+	      t->buckets[i].num_nodes = 0;
+	      t->buckets[i].version.store(0);
+	      t->buckets[i].moved.store(false);
+	      t->buckets[i].head = pl->memory_pool_pop();
+	      new (&(t->buckets[i].head->key)) KeyT(emptyKey);
+	      t->buckets[i].head->next = nullptr;
 	   }
+	   return t;
+	}
+
+	void destroy_table(table_type *t)
+	{
+	   for(size_t i=0;i<t->size;i++) t->buckets[i].~fnode_type();
+	   std::free(t->buckets);
+	   delete t;
+	}
+
+	/*Locks and returns the bucket that holds k for a writer, following moved buckets to the tables that replaced them. pos is set to the bucket's index in its table*/
+	fnode_type *lock_bucket(KeyT &k,uint64_t &pos)
+	{
+	    uint64_t hashval = HashFcn()(k);
+	    table_type *t = table.load(std::memory_order_acquire);
+	    while(true)
+	    {
+		pos = hashval % t->size;
+		t->buckets[pos].mutex_t.lock();
+		if(!t->buckets[pos].moved.load(std::memory_order_relaxed))
+		{
+		   begin_write(t->buckets[pos]);
+		   return &(t->buckets[pos]);
+		}
+		t->buckets[pos].mutex_t.unlock();
+		t = t->next.load(std::memory_order_acquire);
+	    }
+	}
+
+	/*Moves the nodes of bucket i of t to the two buckets of n they split into. The chains stay sorted since a split keeps the order of the nodes*/
+	void migrate_bucket(table_type *t,table_type *n,uint64_t i)
+	{
+	    fnode_type &from = t->buckets[i];
+	    fnode_type &low = n->buckets[i];
+	    fnode_type &high = n->buckets[i+t->size];
+
+	    std::lock_guard<std::mutex> from_lock(from.mutex_t);
+	    std::lock_guard<std::mutex> low_lock(low.mutex_t);
+	    std::lock_guard<std::mutex> high_lock(high.mutex_t);
+	    begin_write(from);
+	    begin_write(low);
+	    begin_write(high);
+
+	    node_type *low_tail = low.head;
+	    node_type *high_tail = high.head;
+	    node_type *x = from.head->next;
+	    while(x != nullptr)
+	    {
+		node_type *next = x->next;
+		set_next(x,nullptr);
+		if(HashFcn()(x->key) % n->size == i)
+		{
+		   set_next(low_tail,x);
+		   low_tail = x;
+		   low.num_nodes++;
+		}
+		else
+		{
+		   set_next(high_tail,x);
+		   high_tail = x;
+		   high.num_nodes++;
+		}
+		x = next;
+	    }
+	    /*The head stays in place for readers that already hold the bucket*/
+	    set_next(from.head,nullptr);
+	    pl->memory_pool_push(from.head);
+	    from.num_nodes = 0;
+	    from.moved.store(true,std::memory_order_release);
+	    end_write(high);
+	    end_write(low);
+	    end_write(from);
+	}
+
+	/*Searches the chain of k without the bucket lock and copies its value into v unless v is null. The search starts over if a writer changed the bucket meanwhile. Nodes it passes are not returned to the pool before it leaves. pos is set to the bucket's index in its table*/
+	bool read(KeyT &k,ValueT *v,uint64_t &pos)
+	{
+	    uint64_t hashval = HashFcn()(k);
+	    typename memory_pool<KeyT,ValueT,HashFcn,EqualFcn>::reclaimer_type::guard g(pl->reclaimer());
+	    table_type *t = table.load(std::memory_order_acquire);
+	    bool found = false;
+	    int spins = 0;
+	    while(true)
+	    {
+		pos = hashval % t->size;
+		fnode_type &b = t->buckets[pos];
+		uint32_t version = b.version.load(std::memory_order_acquire);
+		if(version & 1)
+		{
+		   if(++spins > 64) std::this_thread::yield();
+		   continue;
+		}
+		if(b.moved.load(std::memory_order_acquire))
+		{
+		   t = t->next.load(std::memory_order_acquire);
+		   continue;
+		}
+		found = false;
+		ValueT value;
+		node_type *n = next_of(b.head);
+		while(n != nullptr)
+		{
+		   if(EqualFcn()(n->key,k))
+		   {
+			found = true;
+			if(v != nullptr) value = n->value;
+			break;
+		   }
+		   if(HashFcn()(n->key) > hashval) break;
+		   n = next_of(n);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(b.version.load(std::memory_order_relaxed) == version)
+		{
+		   if(found && v != nullptr) *v = std::move(value);
+		   break;
+		}
+	    }
+	    return found;
+	}
+
+	/*Changes the value of n, which follows p in b, with fn. Values that are not trivially copyable may be being copied by a reader, so fn changes a copy of n that then replaces it in the chain*/
+	template<typename Fn>
+	void change_value(node_type *p,node_type *n,Fn &&fn)
+	{
+	    if(in_place)
+	    {
+		fn(&(n->value));
+		return;
+	    }
+	    node_type *copy = pl->memory_pool_pop();
+	    copy->key = n->key;
+	    copy->value = n->value;
+	    fn(&(copy->value));
+	    copy->next = n->next;
+	    set_next(p,copy);
+	    pl->memory_pool_push(n);
+	}
+
+	/*Starts a resize when the entries per bucket exceed max_load. One thread allocates the new table while the others carry on with the current one*/
+	void maybe_grow()
+	{
+	    if(max_load <= 0) return;
+	    table_type *t = table.load(std::memory_order_acquire);
+	    uint64_t entries = allocated.load() - removed.load();
+	    if((double)entries <= max_load*(double)t->size) return;
+	    if(t->next.load(std::memory_order_acquire) != nullptr) return;
+	    bool expected = false;
+	    if(!resizing.compare_exchange_strong(expected,true)) return;
+	    if(table.load(std::memory_order_acquire) != t)
+	    {
+		resizing.store(false);
+		return;
+	    }
+	    t->next.store(create_table(2*t->size),std::memory_order_release);
+	}
+
+	/*Migrates up to MIGRATE_STEP buckets of a resize in progress. The thread that migrates the last bucket makes the new table current*/
+	void help_resize()
+	{
+	    table_type *t = table.load(std::memory_order_acquire);
+	    table_type *n = t->next.load(std::memory_order_acquire);
+	    if(n == nullptr) return;
+	    for(int step=0;step<MIGRATE_STEP;step++)
+	    {
+		uint64_t i = t->next_bucket.fetch_add(1);
+		if(i >= t->size) return;
+		migrate_bucket(t,n,i);
+		if(t->migrated.fetch_add(1)+1 == t->size)
+		{
+		   table.store(n,std::memory_order_release);
+		   {
+			std::lock_guard<std::mutex> lock(retired_mutex);
+			retired.push_back(t);
+		   }
+		   resizing.store(false);
+		   return;
+		}
+	    }
+	}
+
+  public:
+
+	/*n is the initial number of buckets. A max_load of 0 keeps the table at n buckets*/
+	BlockMap(uint64_t n,memory_pool<KeyT,ValueT,HashFcn,EqualFcn> *m,KeyT maxKey,double max_load_=0) : max_load(max_load_), pl(m), emptyKey(maxKey)
+	{
+  	   assert (n > 0);
+	   assert(n < UINT64_MAX);
+	   table.store(create_table(n));
+	   resizing.store(false);
 	   allocated.store(0);
 	   removed.store(0);
-	   assert(maxSize < UINT64_MAX);
 	}
 
   	~BlockMap()
 	{
-	    std::free(table);
+	    table_type *t = table.load();
+	    if(t->next.load() != nullptr) destroy_table(t->next.load());
+	    destroy_table(t);
+	    for(auto r : retired) destroy_table(r);
 	}
 
 	uint32_t insert(KeyT &k,ValueT &v)
 	{
-	    uint64_t pos = KeyToIndex(k);
-
-	    table[pos].mutex_t.lock();
+	    uint64_t pos;
+	    fnode_type *b = lock_bucket(k,pos);
 
-	    node_type *p = table[pos].head;
-	    node_type *n = table[pos].head->next;
+	    node_type *p = b->head;
+	    node_type *n = b->head->next;
 
 	    bool found = false;
 	    while(n != nullptr)
 	    {
 		if(EqualFcn()(n->key,k)) found = true;
-		if(HashFcn()(n->key)>HashFcn()(k)) 
+		if(HashFcn()(n->key)>HashFcn()(k))
 		{
 		   break;
 		}
@@ -112,123 +364,84 @@ class BlockMap
 		new (&(new_node->key)) KeyT(k);
 		new (&(new_node->value)) ValueT(v);
 		new_node->next = n;
-		p->next = new_node;
-		table[pos].num_nodes++;
+		set_next(p,new_node);
+		b->num_nodes++;
 		found = true;
 		ret = INSERTED;
 	    }
 
-	   table[pos].mutex_t.unlock();
+	   unlock_bucket(b);
+	   if(ret == INSERTED) maybe_grow();
+	   help_resize();
 	   return ret;
 	}
 
 	uint64_t find(KeyT &k)
 	{
-	    uint64_t pos = KeyToIndex(k);
-
-	    table[pos].mutex_t.lock();
-
-	    node_type *n = table[pos].head->next;
-	    bool found = false;
-	    while(n != nullptr)
-	    {
-		if(EqualFcn()(n->key,k))
-		{
-		   found = true;
-		}
-		if(HashFcn()(n->key) > HashFcn()(k)) break;
-		n = n->next;
-	    }
-
-	    table[pos].mutex_t.unlock();
+	    uint64_t pos;
+	    bool found = read(k,nullptr,pos);
+	    help_resize();
 
 	    return (found ? pos : NOT_IN_TABLE);
 	}
 
 	bool update(KeyT &k,ValueT &v)
 	{
-	   uint64_t pos = KeyToIndex(k);
-
-	   table[pos].mutex_t.lock();
-
-	   node_type *n = table[pos].head->next;
-
-	   bool found = false;
-	   while(n != nullptr)
-	   {
-		if(EqualFcn()(n->key,k))
-		{
-		   found = true;
-		   n->value = v;
-		}
-		if(HashFcn()(n->key) > HashFcn()(k)) break;
-		n = n->next;
-	   }
-
-	   table[pos].mutex_t.unlock();
-	   return found;
+	   return modify(k,[&v](ValueT *value) { *value = v; });
 	}
 
 	bool get(KeyT &k,ValueT *v)
 	{
-	    bool found = false;
-
-	    uint64_t pos = KeyToIndex(k);
-
-	    table[pos].mutex_t.lock();
-
-	    node_type *n = table[pos].head;
-
-	    while(n != nullptr)
-	    {
-		if(EqualFcn()(n->key,k))
-		{
-		   found = true;
-		   *v = n->value;
-		}
-		if(HashFcn()(n->key) > HashFcn()(k)) break;
-		n = n->next;
-	    }
+	    uint64_t pos;
+	    bool found = read(k,v,pos);
+	    help_resize();
 
-	   table[pos].mutex_t.unlock();
-
-	   return found;
+	    return found;
 	}
-	
+
 	template<typename... Args>
 	bool update_field(KeyT &k,void(*fn)(ValueT *,Args&&... args),Args&&... args_)
 	{
-	    bool found = false;
-	    uint64_t pos = KeyToIndex(k);
+	    return modify(k,[&](ValueT *value) { fn(value,std::forward<Args>(args_)...); });
+	}
 
-	    table[pos].mutex_t.lock();
+	/*Applies fn to the value of k under the bucket lock, so that no other operation on the bucket sees a partial update*/
+	template<typename Fn>
+	bool modify(KeyT &k,Fn &&fn)
+	{
+	    bool found = false;
+	    uint64_t pos;
+	    fnode_type *b = lock_bucket(k,pos);
 
-	    node_type *n = table[pos].head->next;
+	    node_type *p = b->head;
+	    node_type *n = b->head->next;
 
 	    while(n != nullptr)
 	    {
 		if(EqualFcn()(n->key,k))
 		{
 		    found = true;
-		    fn(&(n->value),std::forward<Args>(args_)...);
+		    change_value(p,n,fn);
+		    break;
 		}
 		if(HashFcn()(n->key) > HashFcn()(k)) break;
-		n = n->next; 
+		p = n;
+		n = n->next;
 	    }
 
-	    table[pos].mutex_t.unlock();
+	    unlock_bucket(b);
+	    help_resize();
 
 	    return found;
 	}
 
 	bool erase(KeyT &k)
 	{
-	   uint64_t pos = KeyToIndex(k);
-
-	   table[pos].mutex_t.lock();
+	   uint64_t pos;
+	   fnode_type *b = lock_bucket(k,pos);
 
-	   node_type *p = table[pos].head;
-	   node_type *n = table[pos].head->next;
+	   node_type *p = b->head;
+	   node_type *n = b->head->next;
 
 	   bool found = false;
 
@@ -240,18 +453,19 @@ class BlockMap
 		p = n;
 		n = n->next;
 	  }
-         
+
 	  if(n != nullptr)
 	  if(EqualFcn()(n->key,k))
 	  {
 		found = true;
-		p->next = n->next;
+		set_next(p,n->next);
 		pl->memory_pool_push(n);
-		table[pos].num_nodes--;
+		b->num_nodes--;
 		removed.fetch_add(1);
 	  }
-	 
-	   table[pos].mutex_t.unlock();
+
+	   unlock_bucket(b);
+	   help_resize();
 	   return found;
 	}
 
@@ -265,16 +479,34 @@ class BlockMap
 		return removed.load();
 	}
 
+	/*Number of buckets of the current table; it doubles with each resize*/
+	uint64_t bucket_count()
+	{
+		return table.load()->size;
+	}
+
+	/*True while a resize is moving buckets to a new table*/
+	bool is_resizing()
+	{
+		return resizing.load();
+	}
+
 	uint64_t count_block_entries()
 	{
 	   uint64_t num_entries = 0;
-	   for(size_t i=0;i<maxSize;i++)
+	   table_type *t = table.load();
+	   for(size_t i=0;i<t->size;i++)
+	   {
+		if(!t->buckets[i].moved) num_entries += t->buckets[i].num_nodes;
+	   }
+	   table_type *n = t->next.load();
+	   if(n != nullptr)
 	   {
-		num_entries += table[i].num_nodes;
+		for(size_t i=0;i<n->size;i++) num_entries += n->buckets[i].num_nodes;
 	   }
 	   return num_entries;
 	}
-	
+
 };
 
 }
@@ -0,0 +1,486 @@
+#ifndef HCL_FLAT_BLOCK_MAP_H
+#define HCL_FLAT_BLOCK_MAP_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "memory_allocation.h"
+#include "block_map.h"
+
+/*This file contains an open addressing layout for the concurrent unordered map, a drop-in alternative to the chained BlockMap. Each bucket is one 64 byte cache line holding a version counter, a tag byte per slot and the keys and values of a few slots, so a lookup reads one line instead of chasing pool nodes. A tag holds 7 bits of the key's hash; the tags of a bucket are matched all at once as one 64 bit word. An entry whose home bucket is full goes to one of the next PROBE_BUCKETS buckets, and those it passes are marked as overflowed so that lookups know to look further.
+Writers lock buckets by making their version odd, always in increasing order. Readers of trivially copyable keys and values take no lock: they copy the slot and retry if the version changed meanwhile. Other types are read under the lock. When an insert finds no free slot in reach, or 3/4 of the slots are full, the table is rebuilt twice as large with every bucket locked; replaced tables are kept until the map is destroyed since readers may still be reading them*/
+
+namespace hcl
+{
+
+#define PROBE_BUCKETS 8
+
+/*Slots of a flat bucket: as many entries as fit next to its 16 byte header, from 1 to 8*/
+template <class KeyT,class ValueT>
+struct flat_slots
+{
+    static constexpr uint32_t fit = 48/(sizeof(KeyT)+sizeof(ValueT));
+    static constexpr uint32_t value = fit > 8 ? 8 : (fit == 0 ? 1 : fit);
+};
+
+template <class KeyT,class ValueT>
+struct alignas(64) flat_bucket
+{
+    static constexpr uint32_t SLOTS = flat_slots<KeyT,ValueT>::value;
+    /*Odd while a writer holds the bucket*/
+    std::atomic<uint32_t> version;
+    /*Set once an insert went past the bucket because it was full*/
+    std::atomic<uint8_t> overflow;
+    /*Set once the entries are in the next table*/
+    std::atomic<uint8_t> moved;
+    /*Byte i is the tag of slot i, 0 when the slot is free*/
+    std::atomic<uint64_t> tags;
+    KeyT keys[SLOTS];
+    ValueT values[SLOTS];
+
+    flat_bucket() : version(0), overflow(0), moved(0), tags(0) {}
+};
+
+template <class KeyT,class ValueT>
+struct flat_table
+{
+    uint64_t size;
+    /*size + PROBE_BUCKETS buckets, so that probing never wraps around*/
+    flat_bucket<KeyT,ValueT> *buckets;
+};
+
+template <
+    class KeyT,
+    class ValueT,
+    class HashFcn = std::hash<KeyT>,
+    class EqualFcn = std::equal_to<KeyT>>
+class FlatBlockMap
+{
+   public :
+	typedef flat_bucket<KeyT,ValueT> bucket_type;
+	typedef flat_table<KeyT,ValueT> table_type;
+	static constexpr uint32_t SLOTS = bucket_type::SLOTS;
+	/*Readers copy slots without the lock only when a torn copy is harmless*/
+	static constexpr bool optimistic = std::is_trivially_copyable<KeyT>::value && std::is_trivially_copyable<ValueT>::value;
+   private :
+	/*A locked probe: buckets home to home+held-1 of t are held. slot is the slot of the key in bucket, and free_slot the first free slot seen in free_bucket, or -1*/
+	struct position
+	{
+	   table_type *t;
+	   uint64_t home;
+	   uint32_t held;
+	   uint64_t bucket;
+	   int slot;
+	   uint64_t free_bucket;
+	   int free_slot;
+	};
+
+	std::atomic<table_type *> table;
+	std::vector<table_type *> retired;
+	std::mutex grow_mutex;
+	std::atomic<uint64_t> allocated;
+	std::atomic<uint64_t> removed;
+	KeyT emptyKey;
+
+	static inline void backoff(uint32_t &spins)
+	{
+	    if(++spins > 64)
+	    {
+		std::this_thread::yield();
+		spins = 0;
+	    }
+	}
+
+	static inline void lock_bucket(bucket_type &b)
+	{
+	    uint32_t spins = 0;
+	    while(true)
+	    {
+		uint32_t v = b.version.load(std::memory_order_relaxed);
+		if(!(v & 1) && b.version.compare_exchange_weak(v,v+1,std::memory_order_acquire)) return;
+		backoff(spins);
+	    }
+	}
+
+	static inline void unlock_bucket(bucket_type &b)
+	{
+	    b.version.fetch_add(1,std::memory_order_release);
+	}
+
+	/*7 bits of the mixed hash with the top bit set, so that no tag is 0*/
+	static inline uint8_t make_tag(uint64_t hashval)
+	{
+	    return (uint8_t)(((hashval*0x9E3779B97F4A7C15ULL) >> 57) | 0x80);
+	}
+
+	/*The slots whose tag byte may equal tag, as bit 8*i+7 for slot i. A byte after a match can show up falsely, so callers check the tag and the key*/
+	static inline uint64_t match_tags(uint64_t tags,uint8_t tag)
+	{
+	    uint64_t x = tags ^ (0x0101010101010101ULL*tag);
+	    return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+	}
+
+	static inline uint8_t tag_of(uint64_t tags,int slot)
+	{
+	    return (uint8_t)(tags >> (8*slot));
+	}
+
+	static inline int first_free(uint64_t tags)
+	{
+	    for(uint32_t s=0;s<SLOTS;s++) if(tag_of(tags,s) == 0) return s;
+	    return -1;
+	}
+
+	static inline int find_slot(bucket_type &b,uint64_t tags,uint8_t tag,KeyT &k)
+	{
+	    uint64_t m = match_tags(tags,tag);
+	    while(m != 0)
+	    {
+		int s = __builtin_ctzll(m)/8;
+		m &= m-1;
+		if(s < (int)SLOTS && tag_of(tags,s) == tag && EqualFcn()(b.keys[s],k)) return s;
+	    }
+	    return -1;
+	}
+
+	table_type *create_table(uint64_t n)
+	{
+	    table_type *t = new table_type();
+	    t->size = n;
+	    t->buckets = new bucket_type[n+PROBE_BUCKETS];
+	    return t;
+	}
+
+	void destroy_table(table_type *t)
+	{
+	    delete[] t->buckets;
+	    delete t;
+	}
+
+	/*Locks the home bucket of k in the current table and the buckets after it that k may have overflowed into*/
+	void lock_probe(KeyT &k,uint64_t hashval,position &p)
+	{
+	    while(true)
+	    {
+		p.t = table.load(std::memory_order_acquire);
+		p.home = hashval % p.t->size;
+		lock_bucket(p.t->buckets[p.home]);
+		if(!p.t->buckets[p.home].moved.load(std::memory_order_relaxed)) break;
+		unlock_bucket(p.t->buckets[p.home]);
+	    }
+	    p.held = 1;
+	    p.slot = -1;
+	    p.free_slot = -1;
+	    uint8_t tag = make_tag(hashval);
+	    for(uint64_t i=p.home;;)
+	    {
+		bucket_type &b = p.t->buckets[i];
+		uint64_t tags = b.tags.load(std::memory_order_relaxed);
+		int s = find_slot(b,tags,tag,k);
+		if(s >= 0)
+		{
+		   p.bucket = i;
+		   p.slot = s;
+		   return;
+		}
+		if(p.free_slot < 0 && (s = first_free(tags)) >= 0)
+		{
+		   p.free_bucket = i;
+		   p.free_slot = s;
+		}
+		if(!b.overflow.load(std::memory_order_relaxed) || p.held == PROBE_BUCKETS) return;
+		i++;
+		lock_bucket(p.t->buckets[i]);
+		p.held++;
+	    }
+	}
+
+	void unlock_probe(position &p)
+	{
+	    for(uint32_t i=0;i<p.held;i++) unlock_bucket(p.t->buckets[p.home+i]);
+	}
+
+	/*Puts k into t without locks, for a table that is not yet published. Returns false if every bucket in reach is full*/
+	bool place(table_type *t,KeyT &k,ValueT &v)
+	{
+	    uint64_t hashval = HashFcn()(k);
+	    uint64_t home = hashval % t->size;
+	    for(uint64_t i=home;i<home+PROBE_BUCKETS;i++)
+	    {
+		bucket_type &b = t->buckets[i];
+		uint64_t tags = b.tags.load(std::memory_order_relaxed);
+		int s = first_free(tags);
+		if(s >= 0)
+		{
+		   b.keys[s] = k;
+		   b.values[s] = v;
+		   b.tags.store(tags | ((uint64_t)make_tag(hashval) << (8*s)),std::memory_order_relaxed);
+		   return true;
+		}
+		b.overflow.store(1,std::memory_order_relaxed);
+	    }
+	    return false;
+	}
+
+	/*Rebuilds t twice as large, unless another thread already replaced it. Every bucket of t is locked, in order, until the new table is published*/
+	void grow(table_type *t)
+	{
+	    std::lock_guard<std::mutex> guard(grow_mutex);
+	    if(table.load(std::memory_order_acquire) != t) return;
+	    uint64_t count = t->size+PROBE_BUCKETS;
+	    for(uint64_t i=0;i<count;i++) lock_bucket(t->buckets[i]);
+	    uint64_t n = 2*t->size;
+	    table_type *nt = nullptr;
+	    bool placed = false;
+	    while(!placed)
+	    {
+		nt = create_table(n);
+		placed = true;
+		for(uint64_t i=0;i<count && placed;i++)
+		{
+		   bucket_type &b = t->buckets[i];
+		   uint64_t tags = b.tags.load(std::memory_order_relaxed);
+		   for(uint32_t s=0;s<SLOTS && placed;s++)
+		   {
+			if(tag_of(tags,s) != 0) placed = place(nt,b.keys[s],b.values[s]);
+		   }
+		}
+		if(!placed)
+		{
+		   destroy_table(nt);
+		   n *= 2;
+		}
+	    }
+	    for(uint64_t i=0;i<count;i++) t->buckets[i].moved.store(1,std::memory_order_relaxed);
+	    table.store(nt,std::memory_order_release);
+	    for(uint64_t i=0;i<count;i++) unlock_bucket(t->buckets[i]);
+	    retired.push_back(t);
+	}
+
+	/*Runs fn on a consistent copy of the value of k without locking. Returns false if k is not in the map*/
+	template<typename Fn>
+	bool read_optimistic(KeyT &k,Fn &&fn)
+	{
+	    uint64_t hashval = HashFcn()(k);
+	    uint8_t tag = make_tag(hashval);
+	    while(true)
+	    {
+		table_type *t = table.load(std::memory_order_acquire);
+		uint64_t i = hashval % t->size;
+		uint64_t last = i+PROBE_BUCKETS;
+		uint32_t spins = 0;
+		bool moved = false;
+		while(i < last)
+		{
+		   bucket_type &b = t->buckets[i];
+		   uint32_t v1 = b.version.load(std::memory_order_acquire);
+		   if(v1 & 1)
+		   {
+			backoff(spins);
+			continue;
+		   }
+		   if(b.moved.load(std::memory_order_relaxed))
+		   {
+			moved = true;
+			break;
+		   }
+		   uint64_t tags = b.tags.load(std::memory_order_relaxed);
+		   bool found = false;
+		   alignas(ValueT) unsigned char value[sizeof(ValueT)];
+		   uint64_t m = match_tags(tags,tag);
+		   while(m != 0 && !found)
+		   {
+			int s = __builtin_ctzll(m)/8;
+			m &= m-1;
+			if(s >= (int)SLOTS || tag_of(tags,s) != tag) continue;
+			alignas(KeyT) unsigned char key[sizeof(KeyT)];
+			std::memcpy(key,(const void *)&(b.keys[s]),sizeof(KeyT));
+			if(EqualFcn()(*reinterpret_cast<KeyT *>(key),k))
+			{
+			   std::memcpy(value,(const void *)&(b.values[s]),sizeof(ValueT));
+			   found = true;
+			}
+		   }
+		   bool overflow = b.overflow.load(std::memory_order_relaxed);
+		   std::atomic_thread_fence(std::memory_order_acquire);
+		   if(b.version.load(std::memory_order_relaxed) != v1) continue;
+		   if(found)
+		   {
+			fn(*reinterpret_cast<ValueT *>(value));
+			return true;
+		   }
+		   if(!overflow) return false;
+		   i++;
+		}
+		if(!moved) return false;
+	    }
+	}
+
+	template<typename Fn>
+	bool read(KeyT &k,Fn &&fn)
+	{
+	    if constexpr (optimistic)
+	    {
+		return read_optimistic(k,std::forward<Fn>(fn));
+	    }
+	    else
+	    {
+		position p;
+		lock_probe(k,HashFcn()(k),p);
+		bool found = p.slot >= 0;
+		if(found) fn(p.t->buckets[p.bucket].values[p.slot]);
+		unlock_probe(p);
+		return found;
+	    }
+	}
+
+	/*Runs fn on the value of k under the locks of its probe. Returns false if k is not in the map*/
+	template<typename Fn>
+	bool write(KeyT &k,Fn &&fn)
+	{
+	    position p;
+	    lock_probe(k,HashFcn()(k),p);
+	    bool found = p.slot >= 0;
+	    if(found) fn(p.t->buckets[p.bucket],p.slot);
+	    unlock_probe(p);
+	    return found;
+	}
+
+   public:
+
+	/*n is the initial number of buckets. The pool and load factor are those of the chained BlockMap and are not used: entries live in the buckets, and the table doubles when 3/4 of its slots are full or an insert finds no free slot in reach*/
+	FlatBlockMap(uint64_t n,memory_pool<KeyT,ValueT,HashFcn,EqualFcn> *,KeyT maxKey,double =0) : emptyKey(maxKey)
+	{
+	    assert (n > 0 && n < UINT64_MAX);
+	    table.store(create_table(n));
+	    allocated.store(0);
+	    removed.store(0);
+	}
+
+	~FlatBlockMap()
+	{
+	    destroy_table(table.load());
+	    for(auto t : retired) destroy_table(t);
+	}
+
+	uint32_t insert(KeyT &k,ValueT &v)
+	{
+	    uint64_t hashval = HashFcn()(k);
+	    while(true)
+	    {
+		position p;
+		lock_probe(k,hashval,p);
+		if(p.slot >= 0)
+		{
+		   unlock_probe(p);
+		   return EXISTS;
+		}
+		while(p.free_slot < 0 && p.held < PROBE_BUCKETS)
+		{
+		   bucket_type &b = p.t->buckets[p.home+p.held];
+		   lock_bucket(b);
+		   p.held++;
+		   int s = first_free(b.tags.load(std::memory_order_relaxed));
+		   if(s >= 0)
+		   {
+			p.free_bucket = p.home+p.held-1;
+			p.free_slot = s;
+		   }
+		}
+		table_type *t = p.t;
+		if(p.free_slot >= 0)
+		{
+		   for(uint64_t i=p.home;i<p.free_bucket;i++) p.t->buckets[i].overflow.store(1,std::memory_order_relaxed);
+		   bucket_type &b = p.t->buckets[p.free_bucket];
+		   b.keys[p.free_slot] = k;
+		   b.values[p.free_slot] = v;
+		   uint64_t tags = b.tags.load(std::memory_order_relaxed);
+		   b.tags.store(tags | ((uint64_t)make_tag(hashval) << (8*p.free_slot)),std::memory_order_relaxed);
+		   unlock_probe(p);
+		   uint64_t entries = allocated.fetch_add(1)+1-removed.load();
+		   if(4*entries > 3*SLOTS*t->size) grow(t);
+		   return INSERTED;
+		}
+		unlock_probe(p);
+		grow(t);
+	    }
+	}
+
+	uint64_t find(KeyT &k)
+	{
+	    bool found = read(k,[](const ValueT &) {});
+	    return found ? HashFcn()(k) % table.load()->size : NOT_IN_TABLE;
+	}
+
+	bool update(KeyT &k,ValueT &v)
+	{
+	    return write(k,[&](bucket_type &b,int s) { b.values[s] = v; });
+	}
+
+	bool get(KeyT &k,ValueT *v)
+	{
+	    return read(k,[&](const ValueT &value) { *v = value; });
+	}
+
+	template<typename... Args>
+	bool update_field(KeyT &k,void(*fn)(ValueT *,Args&&... args),Args&&... args_)
+	{
+	    return write(k,[&](bucket_type &b,int s) { fn(&(b.values[s]),std::forward<Args>(args_)...); });
+	}
+
+	/*Applies fn to the value of k in place under the bucket lock, so that no reader sees a partial update*/
+	template<typename Fn>
+	bool modify(KeyT &k,Fn &&fn)
+	{
+	    return write(k,[&](bucket_type &b,int s) { fn(&(b.values[s])); });
+	}
+
+	bool erase(KeyT &k)
+	{
+	    bool found = write(k,[&](bucket_type &b,int s) {
+		uint64_t tags = b.tags.load(std::memory_order_relaxed);
+		b.tags.store(tags & ~((uint64_t)0xff << (8*s)),std::memory_order_relaxed);
+		b.keys[s] = emptyKey;
+		b.values[s] = ValueT();
+	    });
+	    if(found) removed.fetch_add(1);
+	    return found;
+	}
+
+	uint64_t allocated_nodes()
+	{
+		return allocated.load();
+	}
+
+	uint64_t removed_nodes()
+	{
+		return removed.load();
+	}
+
+	uint64_t bucket_count()
+	{
+		return table.load()->size;
+	}
+
+	uint64_t count_block_entries()
+	{
+	   uint64_t num_entries = 0;
+	   table_type *t = table.load();
+	   for(uint64_t i=0;i<t->size+PROBE_BUCKETS;i++)
+	   {
+		num_entries += __builtin_popcountll(t->buckets[i].tags.load() & 0x8080808080808080ULL);
+	   }
+	   return num_entries;
+	}
+};
+
+}
+
+#endif
@@ -1,20 +1,26 @@
 #ifndef HCL_MEMORY_H
 #define HCL_MEMORY_H
 
-#include <boost/lockfree/queue.hpp>
 #include <mutex>
+#include <thread>
 #include <vector>
 #include <iostream>
 #include <algorithm>
 #include <cstdarg>
 #include <functional>
+#include <utility>
+#include "../../memory/epoch_reclaimer.h"
 
-#define MIN_FREE_NODES 100
+/*Nodes moved between a thread's magazine and the depot at once, number of magazine slots, and default limit of the nodes of a chunk*/
+#define MAGAZINE_SIZE 64
+#define MAGAZINE_SLOTS 64
+#define MAX_CHUNK_NODES (1 << 16)
 
 /* This module is used by the concurrent unordered map container for memory management. 
  * It allocates nodes and reuses them to keep the total memory allocation the program under check.
- * Since the container is concurrent, the allocated nodes are kept in two concurrent queues : active and free
- * The active queue contains nodes available for the unordered map and the free queue contains nodes that have been deleted by the map. Nodes are moved from the free queue to the active queue when the number of available nodes goes to zero*/
+ * Since the container is concurrent, the nodes are cached per thread in magazines of up to 2*MAGAZINE_SIZE nodes, spread over slots by thread id like the slots of the epoch_reclaimer. A thread allocates from its own magazine and exchanges whole magazines of MAGAZINE_SIZE nodes with a shared depot, so the depot's lock is taken once per MAGAZINE_SIZE allocations or frees.
+ * When the depot is empty a thread takes the nodes of another magazine, and only if all are empty the pool allocates a chunk. Chunks start at the size given to the constructor and double up to max_chunk_size nodes, so a growing map needs few of them. The thread that ran out constructs the nodes of the chunk, which places its pages on that thread's NUMA node on first touch, and keeps the first magazine of it.
+ * Readers of the map do not lock, so a deleted node is retired to an epoch_reclaimer rather than pushed to a magazine. It is reused from the free list of the thread that deleted it once no reader can reach it; only the nodes that do not fit in that list go back to the magazines*/
 
 namespace hcl
 {
@@ -42,85 +48,177 @@ class memory_pool
 
   public :
 	 typedef struct node<KeyT,ValueT,HashFcn,EqualFcn> node_type;
+	 typedef epoch_reclaimer<node_type> reclaimer_type;
   private :
+	  struct alignas(64) magazine
+	  {
+	     std::mutex mutex_t;
+	     std::vector<node_type *> nodes;
+	  };
+
 	  uint32_t chunk_size;
-	  std::atomic<uint64_t> free_nodes;
+	  uint32_t max_chunk_size;
 	  std::atomic<uint64_t> num_chunks;
-	  boost::lockfree::queue<node_type *> *memory_chunks;
-	  boost::lockfree::queue<node_type *> *active_queue;
-	  boost::lockfree::queue<node_type *> *free_queue;
+	  std::atomic<uint64_t> num_nodes;
+	  magazine *magazines;
+	  std::mutex chunk_mutex;
+	  std::vector<std::pair<node_type *,uint32_t>> chunks;
+	  std::mutex depot_mutex;
+	  std::vector<std::vector<node_type *>> depot;
+	  reclaimer_type *reclaimer_;
+
+	  magazine &my_magazine()
+	  {
+		static thread_local uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+		return magazines[id % MAGAZINE_SLOTS];
+	  }
+
+	  /*Takes a full magazine from the depot into m. Called with m locked*/
+	  bool refill(magazine &m)
+	  {
+		std::lock_guard<std::mutex> lock(depot_mutex);
+		if(depot.empty()) return false;
+		m.nodes.swap(depot.back());
+		depot.pop_back();
+		return true;
+	  }
+
+	  /*Takes the nodes of another magazine into m. Magazines in use are skipped. Called with m locked*/
+	  bool steal(magazine &m)
+	  {
+		for(uint32_t i=0;i<MAGAZINE_SLOTS;i++)
+		{
+		    if(&(magazines[i]) == &m || !magazines[i].mutex_t.try_lock()) continue;
+		    m.nodes.swap(magazines[i].nodes);
+		    magazines[i].mutex_t.unlock();
+		    if(!m.nodes.empty()) return true;
+		}
+		return false;
+	  }
+
+	  /*Allocates the next chunk, keeps its first magazine in m and hands the rest to the depot. Called with m locked*/
+	  void grow(magazine &m)
+	  {
+		std::lock_guard<std::mutex> lock(chunk_mutex);
+		/*Another thread may have filled the depot while this one waited, and the magazines of threads that have exited keep their nodes*/
+		if(refill(m) || steal(m)) return;
+		uint32_t size = chunk_size;
+		node_type *chunk = (node_type*)std::malloc(size*sizeof(node_type));
+		assert (chunk != nullptr);
+		chunks.push_back(std::make_pair(chunk,size));
+		num_chunks.fetch_add(1);
+		num_nodes.fetch_add(size);
+		chunk_size = (uint32_t)std::min<uint64_t>(2*(uint64_t)chunk_size,max_chunk_size);
+		std::vector<std::vector<node_type *>> full;
+		std::vector<node_type *> current;
+		current.reserve(2*MAGAZINE_SIZE);
+		for(uint32_t i=0;i<size;i++)
+		{
+		    new (&(chunk[i].key)) KeyT();
+		    new (&(chunk[i].value)) ValueT();
+		    chunk[i].next = nullptr;
+		    current.push_back(&(chunk[i]));
+		    if(current.size() == MAGAZINE_SIZE)
+		    {
+			full.push_back(std::move(current));
+			current = std::vector<node_type *>();
+			current.reserve(2*MAGAZINE_SIZE);
+		    }
+		}
+		if(!current.empty()) full.push_back(std::move(current));
+		m.nodes.swap(full.front());
+		std::lock_guard<std::mutex> depot_lock(depot_mutex);
+		for(size_t i=1;i<full.size();i++) depot.push_back(std::move(full[i]));
+	  }
+
+	  /*Takes back a reclaimed node that does not fit in a free list of the reclaimer. A magazine that fills up hands half of its nodes to the depot*/
+	  void release(node_type *n)
+	  {
+		magazine &m = my_magazine();
+		std::lock_guard<std::mutex> lock(m.mutex_t);
+		n->next = nullptr;
+		m.nodes.push_back(n);
+		if(m.nodes.size() < 2*MAGAZINE_SIZE) return;
+		std::vector<node_type *> half(m.nodes.end()-MAGAZINE_SIZE,m.nodes.end());
+		half.reserve(2*MAGAZINE_SIZE);
+		m.nodes.resize(m.nodes.size()-MAGAZINE_SIZE);
+		std::lock_guard<std::mutex> depot_lock(depot_mutex);
+		depot.push_back(std::move(half));
+	  }
 
   public :
-	  memory_pool(uint32_t csize) : chunk_size(csize)
+
+	  /*csize is the number of nodes of the first chunk; each chunk after it is twice as large, up to max_csize nodes*/
+	  memory_pool(uint32_t csize,uint32_t max_csize=MAX_CHUNK_NODES) : chunk_size(std::max<uint32_t>(csize,1)), max_chunk_size(std::max(csize,max_csize))
 	 {
-	     memory_chunks = new boost::lockfree::queue<node_type*> (1024);
-	     active_queue = new boost::lockfree::queue<node_type*> (1024);
-	     free_queue = new boost::lockfree::queue<node_type*> (1024);
-	     assert (memory_chunks != nullptr && active_queue != nullptr && free_queue != nullptr);
-	     node_type *chunk = (node_type *)std::malloc(chunk_size*sizeof(node_type));
-	     assert (chunk != nullptr);
-	     for(uint32_t i=0;i<chunk_size;i++)
-	     {
-		new (&(chunk[i].key)) KeyT();
-		new (&(chunk[i].value)) ValueT();
-		chunk[i].next = nullptr;
-		active_queue->push(&(chunk[i]));
-	     }
-	     memory_chunks->push(chunk);
-	     free_nodes.store(0);
-	     num_chunks.store(1);
+	     num_chunks.store(0);
+	     num_nodes.store(0);
+	     magazines = new magazine[MAGAZINE_SLOTS];
+	     reclaimer_ = new reclaimer_type([this](node_type *n,int) {
+		release(n);
+	     });
+	     magazine &m = my_magazine();
+	     std::lock_guard<std::mutex> lock(m.mutex_t);
+	     grow(m);
 	 }
 
 	 ~memory_pool()
 	 {
-		int n = 0;
-		node_type *chunk = nullptr;
-		while(memory_chunks->pop(chunk))
+		delete reclaimer_;
+		delete [] magazines;
+		for(auto &c : chunks)
 		{
-		   n++;
-		   std::free(chunk);
+		   for(uint32_t i=0;i<c.second;i++)
+		   {
+			c.first[i].key.~KeyT();
+			c.first[i].value.~ValueT();
+		   }
+		   std::free(c.first);
 		}
-		delete memory_chunks;
-		delete active_queue;
-		delete free_queue;
 	 }
 
 	 node_type* memory_pool_pop()
 	 {
-		node_type *n = nullptr;
-		while(!active_queue->pop(n))
-		{
-		    node_type *t = nullptr;
-		    while(free_queue->pop(t))
-		    {
-			t->next = nullptr;
-			active_queue->push(t);
-			t = nullptr;
-		    }
-		    free_nodes.store(0);
-		  
-		    if(active_queue->pop(n)) break;  
-
-		    node_type *chunk = (node_type*)std::malloc(chunk_size*sizeof(node_type));
-		    assert (chunk != nullptr);
-		    num_chunks.fetch_add(1);
-		    for(uint32_t i=0;i<chunk_size;i++)
-		    {
-			new (&(chunk[i].key)) KeyT();
-			new (&(chunk[i].value)) ValueT();
-			chunk[i].next = nullptr;
-			active_queue->push(&(chunk[i]));
-		    }
-		    memory_chunks->push(chunk);
-		    if(free_queue->empty()) free_nodes.store(0);
-		}
-
+		node_type *n = reclaimer_->allocate();
+		if(n != nullptr) return n;
+		magazine &m = my_magazine();
+		std::lock_guard<std::mutex> lock(m.mutex_t);
+		if(m.nodes.empty() && !refill(m)) grow(m);
+		n = m.nodes.back();
+		m.nodes.pop_back();
 		return n;
 	 }
+	 /*Retires n, which the caller has unlinked from every structure readers traverse. It is not reused before the readers inside at this time have left*/
 	 void memory_pool_push(node_type *n)
 	 {
-		free_queue->push(n);
-		free_nodes.fetch_add(1);
+		reclaimer_->retire(n);
+	 }
+
+	 /*Readers hold a guard of the reclaimer while they traverse nodes of the pool*/
+	 reclaimer_type &reclaimer()
+	 {
+		return *reclaimer_;
+	 }
+
+	 uint64_t retired_nodes()
+	 {
+		return reclaimer_->retired();
+	 }
+
+	 uint64_t reclaimed_nodes()
+	 {
+		return reclaimer_->reclaimed();
+	 }
+
+	 uint64_t allocated_chunks()
+	 {
+		return num_chunks.load();
+	 }
+
+	 /*Nodes in all chunks, whether in use or not*/
+	 uint64_t allocated_nodes()
+	 {
+		return num_nodes.load();
 	 }
 
 };
@@ -0,0 +1,378 @@
+#ifndef HCL_SHARED_BLOCK_MAP_H
+#define HCL_SHARED_BLOCK_MAP_H
+
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include "block_map.h"
+
+/*This file contains a variant of the BlockMap that lives inside a managed mapped file segment, so that every process which maps the segment can use it directly. Nodes and the bucket table are allocated from the segment, linked with offset pointers and guarded by process-shared bucket locks. Keys and values are copied into the segment as they are, so they must not own process-local memory*/
+
+namespace hcl
+{
+
+template <class KeyT, class ValueT>
+struct shared_node
+{
+   KeyT key;
+   ValueT value;
+   boost::interprocess::offset_ptr<shared_node> next;
+};
+
+template <class KeyT, class ValueT>
+struct shared_f_node
+{
+    uint64_t num_nodes;
+    boost::interprocess::interprocess_mutex mutex_t;
+    boost::interprocess::offset_ptr<shared_node<KeyT,ValueT>> head;
+};
+
+/*Node allocator for the SharedBlockMap. Chunks of nodes are taken from the segment manager and freed nodes are kept in a list in the segment, guarded by a process-shared lock. The first node of every chunk links the chunks together so that they can be returned to the segment*/
+template <class KeyT, class ValueT>
+class shared_memory_pool
+{
+  public :
+	typedef shared_node<KeyT,ValueT> node_type;
+	typedef boost::interprocess::managed_mapped_file::segment_manager segment_manager;
+  private :
+	uint32_t chunk_size;
+	std::atomic<uint64_t> num_chunks;
+	boost::interprocess::offset_ptr<segment_manager> manager;
+	boost::interprocess::interprocess_mutex mutex_t;
+	boost::interprocess::offset_ptr<node_type> free_list;
+	boost::interprocess::offset_ptr<node_type> chunks;
+
+	void add_chunk()
+	{
+	   node_type *chunk = static_cast<node_type *>(manager->allocate((chunk_size+1)*sizeof(node_type)));
+	   new (&(chunk[0].next)) boost::interprocess::offset_ptr<node_type>(chunks);
+	   chunks = chunk;
+	   for(uint32_t i=1;i<=chunk_size;i++)
+	   {
+		new (&(chunk[i].key)) KeyT();
+		new (&(chunk[i].value)) ValueT();
+		new (&(chunk[i].next)) boost::interprocess::offset_ptr<node_type>(free_list);
+		free_list = &(chunk[i]);
+	   }
+	   num_chunks.fetch_add(1);
+	}
+
+  public :
+	shared_memory_pool(uint32_t csize,segment_manager *m) : chunk_size(csize), manager(m), free_list(nullptr), chunks(nullptr)
+	{
+	   assert (chunk_size > 0 && manager != nullptr);
+	   num_chunks.store(0);
+	   add_chunk();
+	}
+
+	~shared_memory_pool()
+	{
+	   while(chunks != nullptr)
+	   {
+		node_type *chunk = chunks.get();
+		chunks = chunk[0].next;
+		manager->deallocate(chunk);
+	   }
+	}
+
+	segment_manager *get_segment_manager()
+	{
+	   return manager.get();
+	}
+
+	node_type* memory_pool_pop()
+	{
+	   boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_t);
+	   if(free_list == nullptr) add_chunk();
+	   node_type *n = free_list.get();
+	   free_list = n->next;
+	   n->next = nullptr;
+	   return n;
+	}
+
+	void memory_pool_push(node_type *n)
+	{
+	   boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_t);
+	   n->next = free_list;
+	   free_list = n;
+	}
+
+	uint64_t chunks_allocated()
+	{
+	   return num_chunks.load();
+	}
+};
+
+template <
+    class KeyT,
+    class ValueT,
+    class HashFcn = std::hash<KeyT>,
+    class EqualFcn = std::equal_to<KeyT>>
+class SharedBlockMap
+{
+	static_assert(std::is_trivially_copyable<KeyT>::value && std::is_trivially_copyable<ValueT>::value,
+		      "SharedBlockMap keeps keys and values in a mapped file, where only trivially copyable types stay valid across processes");
+
+   public :
+	typedef shared_node<KeyT,ValueT> node_type;
+	typedef shared_f_node<KeyT,ValueT> fnode_type;
+	typedef shared_memory_pool<KeyT,ValueT> pool_type;
+	typedef typename pool_type::segment_manager segment_manager;
+   private :
+	boost::interprocess::offset_ptr<fnode_type> table;
+	uint64_t maxSize;
+	std::atomic<uint64_t> allocated;
+	std::atomic<uint64_t> removed;
+	pool_type pl;
+	KeyT emptyKey;
+
+	uint64_t KeyToIndex(KeyT &k)
+	{
+	    uint64_t hashval = HashFcn()(k);
+	    return hashval % maxSize;
+	}
+  public:
+
+	/*Must itself be constructed in the segment that m manages, e.g. with segment.construct*/
+	SharedBlockMap(uint64_t n,KeyT maxKey,segment_manager *m,uint32_t chunk_size=100) : maxSize(n), pl(chunk_size,m), emptyKey(maxKey)
+	{
+	   assert (maxSize > 0 && maxSize < UINT64_MAX);
+	   table = static_cast<fnode_type *>(m->allocate(maxSize*sizeof(fnode_type)));
+	   for(size_t i=0;i<maxSize;i++)
+	   {
+	      new (&(table[i])) fnode_type();
+	      table[i].num_nodes = 0;
+	      table[i].head = pl.memory_pool_pop();
+	      new (&(table[i].head->key)) KeyT(emptyKey);
+	      table[i].head->next = nullptr;
+	   }
+	   allocated.store(0);
+	   removed.store(0);
+	}
+
+	~SharedBlockMap()
+	{
+	    for(size_t i=0;i<maxSize;i++) table[i].~fnode_type();
+	    pl.get_segment_manager()->deallocate(table.get());
+	}
+
+	uint32_t insert(KeyT &k,ValueT &v)
+	{
+	    uint64_t pos = KeyToIndex(k);
+
+	    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(table[pos].mutex_t);
+
+	    node_type *p = table[pos].head.get();
+	    node_type *n = table[pos].head->next.get();
+
+	    bool found = false;
+	    while(n != nullptr)
+	    {
+		if(EqualFcn()(n->key,k)) found = true;
+		if(HashFcn()(n->key)>HashFcn()(k))
+		{
+		   break;
+		}
+		p = n;
+		n = n->next.get();
+	    }
+
+	    uint32_t ret = (found) ? EXISTS : 0;
+	    if(!found)
+	    {
+		allocated.fetch_add(1);
+		node_type *new_node=pl.memory_pool_pop();
+		new (&(new_node->key)) KeyT(k);
+		new (&(new_node->value)) ValueT(v);
+		new_node->next = n;
+		p->next = new_node;
+		table[pos].num_nodes++;
+		ret = INSERTED;
+	    }
+	    return ret;
+	}
+
+	uint64_t find(KeyT &k)
+	{
+	    uint64_t pos = KeyToIndex(k);
+
+	    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(table[pos].mutex_t);
+
+	    node_type *n = table[pos].head->next.get();
+	    bool found = false;
+	    while(n != nullptr)
+	    {
+		if(EqualFcn()(n->key,k))
+		{
+		   found = true;
+		}
+		if(HashFcn()(n->key) > HashFcn()(k)) break;
+		n = n->next.get();
+	    }
+
+	    return (found ? pos : NOT_IN_TABLE);
+	}
+
+	bool update(KeyT &k,ValueT &v)
+	{
+	   uint64_t pos = KeyToIndex(k);
+
+	   boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(table[pos].mutex_t);
+
+	   node_type *n = table[pos].head->next.get();
+
+	   bool found = false;
+	   while(n != nullptr)
+	   {
+		if(EqualFcn()(n->key,k))
+		{
+		   found = true;
+		   n->value = v;
+		}
+		if(HashFcn()(n->key) > HashFcn()(k)) break;
+		n = n->next.get();
+	   }
+	   return found;
+	}
+
+	bool get(KeyT &k,ValueT *v)
+	{
+	    bool found = false;
+
+	    uint64_t pos = KeyToIndex(k);
+
+	    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(table[pos].mutex_t);
+
+	    node_type *n = table[pos].head->next.get();
+
+	    while(n != nullptr)
+	    {
+		if(EqualFcn()(n->key,k))
+		{
+		   found = true;
+		   *v = n->value;
+		}
+		if(HashFcn()(n->key) > HashFcn()(k)) break;
+		n = n->next.get();
+	    }
+	    return found;
+	}
+
+	template<typename... Args>
+	bool update_field(KeyT &k,void(*fn)(ValueT *,Args&&... args),Args&&... args_)
+	{
+	    bool found = false;
+	    uint64_t pos = KeyToIndex(k);
+
+	    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(table[pos].mutex_t);
+
+	    node_type *n = table[pos].head->next.get();
+
+	    while(n != nullptr)
+	    {
+		if(EqualFcn()(n->key,k))
+		{
+		    found = true;
+		    fn(&(n->value),std::forward<Args>(args_)...);
+		}
+		if(HashFcn()(n->key) > HashFcn()(k)) break;
+		n = n->next.get();
+	    }
+	    return found;
+	}
+
+	/*Applies fn to the value of k in place under the bucket lock, so that no other operation on the bucket sees a partial update*/
+	template<typename Fn>
+	bool modify(KeyT &k,Fn &&fn)
+	{
+	    bool found = false;
+	    uint64_t pos = KeyToIndex(k);
+
+	    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(table[pos].mutex_t);
+
+	    node_type *n = table[pos].head->next.get();
+
+	    while(n != nullptr)
+	    {
+		if(EqualFcn()(n->key,k))
+		{
+		    found = true;
+		    fn(&(n->value));
+		    break;
+		}
+		if(HashFcn()(n->key) > HashFcn()(k)) break;
+		n = n->next.get();
+	    }
+
+	    return found;
+	}
+
+	bool erase(KeyT &k)
+	{
+	   uint64_t pos = KeyToIndex(k);
+
+	   boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(table[pos].mutex_t);
+
+	   node_type *p = table[pos].head.get();
+	   node_type *n = table[pos].head->next.get();
+
+	   bool found = false;
+
+	   while(n != nullptr)
+	   {
+		if(EqualFcn()(n->key,k)) break;
+
+		if(HashFcn()(n->key) > HashFcn()(k)) break;
+		p = n;
+		n = n->next.get();
+	   }
+
+	   if(n != nullptr && EqualFcn()(n->key,k))
+	   {
+		found = true;
+		p->next = n->next;
+		pl.memory_pool_push(n);
+		table[pos].num_nodes--;
+		removed.fetch_add(1);
+	   }
+	   return found;
+	}
+
+	uint64_t allocated_nodes()
+	{
+		return allocated.load();
+	}
+
+	uint64_t removed_nodes()
+	{
+		return removed.load();
+	}
+
+	uint64_t count_block_entries()
+	{
+	   uint64_t num_entries = 0;
+	   for(size_t i=0;i<maxSize;i++)
+	   {
+		num_entries += table[i].num_nodes;
+	   }
+	   return num_entries;
+	}
+
+};
+
+/*True for maps that live in the container's segment and can be opened by the clients on the server's node*/
+template <typename Map>
+struct is_shared_block_map : std::false_type {};
+
+template <class KeyT, class ValueT, class HashFcn, class EqualFcn>
+struct is_shared_block_map<SharedBlockMap<KeyT,ValueT,HashFcn,EqualFcn>> : std::true_type {};
+
+}
+
+#endif
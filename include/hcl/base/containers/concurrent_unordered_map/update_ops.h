@@ -0,0 +1,91 @@
+#ifndef HCL_UPDATE_OPS_H
+#define HCL_UPDATE_OPS_H
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+/*This file contains the registry of the update operations that the concurrent unordered map applies to a value in place on the server, so that a client can read, modify and write a value in one RPC without racing other writers. An operation combines the stored value with an operand of the value type. It is named by an id which must mean the same operation in every process: the server applies it and clients on the server's node apply it to a map in the segment*/
+
+namespace hcl
+{
+
+/*Ids of the built in operations. Ids from UPDATE_USER up are free for user operations.*/
+enum UpdateOpId : uint32_t
+{
+    UPDATE_INCREMENT = 0, /*value += operand*/
+    UPDATE_APPEND = 1,    /*appends the elements of operand to value*/
+    UPDATE_MIN = 2,       /*value = min(value, operand)*/
+    UPDATE_MAX = 3,       /*value = max(value, operand)*/
+    UPDATE_USER = 16
+};
+
+template <typename T, typename = void>
+struct has_plus_assign : std::false_type {};
+
+template <typename T>
+struct has_plus_assign<T, std::void_t<decltype(std::declval<T &>() += std::declval<T &>())>> : std::true_type {};
+
+template <typename T, typename = void>
+struct has_less : std::false_type {};
+
+template <typename T>
+struct has_less<T, std::void_t<decltype(std::declval<T &>() < std::declval<T &>())>> : std::true_type {};
+
+template <typename T, typename = void>
+struct has_range_insert : std::false_type {};
+
+template <typename T>
+struct has_range_insert<T, std::void_t<decltype(std::declval<T &>().insert(std::declval<T &>().end(), std::declval<T &>().begin(), std::declval<T &>().end()))>> : std::true_type {};
+
+template <class ValueT>
+class update_registry
+{
+  public :
+	typedef std::function<void(ValueT *,ValueT &)> op_type;
+  private :
+	std::unordered_map<uint32_t,op_type> ops;
+	std::shared_mutex mutex_t;
+
+  public :
+	/*Registers the built in operations that ValueT supports*/
+	update_registry()
+	{
+	   if constexpr (has_plus_assign<ValueT>::value)
+	     ops[UPDATE_INCREMENT] = [](ValueT *v,ValueT &operand) { *v += operand; };
+	   if constexpr (has_range_insert<ValueT>::value)
+	     ops[UPDATE_APPEND] = [](ValueT *v,ValueT &operand) { v->insert(v->end(),operand.begin(),operand.end()); };
+	   if constexpr (has_less<ValueT>::value)
+	   {
+	     ops[UPDATE_MIN] = [](ValueT *v,ValueT &operand) { if(operand < *v) *v = operand; };
+	     ops[UPDATE_MAX] = [](ValueT *v,ValueT &operand) { if(*v < operand) *v = operand; };
+	   }
+	}
+
+	/*Registers op under op_id, replacing any operation with that id. Returns false for the ids of the built in operations*/
+	bool add(uint32_t op_id,op_type op)
+	{
+	   if(op_id < UPDATE_USER) return false;
+	   std::unique_lock<std::shared_mutex> lock(mutex_t);
+	   ops[op_id] = std::move(op);
+	   return true;
+	}
+
+	/*Returns the operation registered under op_id, or an empty function*/
+	op_type get(uint32_t op_id)
+	{
+	   std::shared_lock<std::shared_mutex> lock(mutex_t);
+	   auto iter = ops.find(op_id);
+	   if(iter == ops.end()) return op_type();
+	   return iter->second;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef HCL_EPOCH_RECLAIMER_H
+#define HCL_EPOCH_RECLAIMER_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*Default number of slots of a reclaimer, number of retired nodes after which a slot tries to advance the epoch, and number of reclaimed nodes a slot keeps per size class*/
+#define EPOCH_SLOTS 64
+#define EPOCH_BATCH 64
+#define EPOCH_FREE_NODES 256
+
+/*This module is used by the node pools of the concurrent containers for memory reclamation. Readers traverse the containers without locks, so a node that a writer unlinks may still be read by them and cannot be reused at once. Readers announce themselves with enter and leave, or a guard, and writers retire unlinked nodes instead of recycling them.
+Reclamation is epoch based. Each reader is counted in a slot under the parity of the global epoch it entered in, and a retired node is stamped with the epoch it was retired in. The epoch only advances from e to e+1 once no reader of epoch e-1 is left, so a node retired in epoch e is unreachable once the epoch is e+2 and goes to the free list of its slot. Threads are spread over the slots by id, which keeps readers off each other's cache lines and makes the free lists per thread in effect: a writer allocates from the nodes it reclaimed without touching the pool's shared queues. Nodes past EPOCH_FREE_NODES in a free list are handed back to the owner with the release function. Nodes can have up to CLASSES size classes, such as the heights of skiplist nodes, each with its own free lists. The reclaimer does not own the nodes; drain hands every node it holds back to the owner*/
+
+namespace hcl
+{
+
+template <typename T,int CLASSES=1>
+class epoch_reclaimer
+{
+  public :
+	typedef std::function<void(T *,int)> release_fn;
+
+	/*Counts its thread as a reader for as long as it lives*/
+	class guard
+	{
+	   private :
+		epoch_reclaimer *r;
+		std::atomic<uint64_t> *counter;
+	   public :
+		explicit guard(epoch_reclaimer &r_) : r(&r_), counter(r_.enter())
+		{
+		}
+		guard(guard &&other) : r(other.r), counter(other.counter)
+		{
+		    other.counter = nullptr;
+		}
+		guard(const guard &) = delete;
+		guard &operator=(const guard &) = delete;
+		~guard()
+		{
+		    if(counter != nullptr) r->leave(counter);
+		}
+	};
+
+  private :
+	struct alignas(64) slot
+	{
+	    /*Readers by parity of the epoch they entered in*/
+	    std::atomic<uint64_t> active[2];
+	    std::mutex mutex_t;
+	    /*Retired nodes and their classes by epoch modulo 3, and the epoch of each*/
+	    std::vector<std::pair<T *,int>> limbo[3];
+	    uint64_t limbo_epoch[3];
+	    uint64_t batch;
+	    std::vector<T *> free_list[CLASSES];
+	};
+
+	slot *slots;
+	uint32_t num_slots;
+	std::atomic<uint64_t> epoch;
+	std::atomic<uint64_t> retired_count;
+	std::atomic<uint64_t> reclaimed_count;
+	release_fn release;
+
+	slot &my_slot()
+	{
+	    static thread_local uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+	    return slots[id % num_slots];
+	}
+
+	void put_free(slot &s,T *n,int c)
+	{
+	    if(s.free_list[c].size() < EPOCH_FREE_NODES) s.free_list[c].push_back(n);
+	    else release(n,c);
+	}
+
+	/*Moves the nodes of s retired two or more epochs before e to the free lists of to. Called with both slots locked*/
+	void collect(slot &s,uint64_t e,slot &to)
+	{
+	    for(int j=0;j<3;j++)
+	    {
+		if(s.limbo[j].empty() || s.limbo_epoch[j]+2 > e) continue;
+		for(auto &p : s.limbo[j]) put_free(to,p.first,p.second);
+		reclaimed_count.fetch_add(s.limbo[j].size(),std::memory_order_relaxed);
+		s.limbo[j].clear();
+	    }
+	}
+
+	/*Collects the slots of other threads into s, as a thread that has exited leaves its retired nodes behind. Slots in use are skipped*/
+	void collect_others(slot &s)
+	{
+	    std::lock_guard<std::mutex> lock(s.mutex_t);
+	    uint64_t e = epoch.load();
+	    for(uint32_t i=0;i<num_slots;i++)
+	    {
+		if(&(slots[i]) == &s || !slots[i].mutex_t.try_lock()) continue;
+		collect(slots[i],e,s);
+		slots[i].mutex_t.unlock();
+	    }
+	}
+
+	/*Advances the epoch unless a reader of the previous epoch is still inside*/
+	bool try_advance()
+	{
+	    uint64_t e = epoch.load();
+	    std::atomic_thread_fence(std::memory_order_seq_cst);
+	    for(uint32_t i=0;i<num_slots;i++)
+	    {
+		if(slots[i].active[(e+1) & 1].load() != 0) return false;
+	    }
+	    return epoch.compare_exchange_strong(e,e+1);
+	}
+
+  public :
+	/*release takes back the reclaimed nodes that do not fit in a free list*/
+	explicit epoch_reclaimer(release_fn release_,uint32_t n=EPOCH_SLOTS) : num_slots(n), release(std::move(release_))
+	{
+	    assert(num_slots > 0);
+	    slots = new slot[num_slots];
+	    for(uint32_t i=0;i<num_slots;i++)
+	    {
+		slots[i].active[0].store(0);
+		slots[i].active[1].store(0);
+		for(int j=0;j<3;j++) slots[i].limbo_epoch[j] = 0;
+		slots[i].batch = 0;
+	    }
+	    epoch.store(0);
+	    retired_count.store(0);
+	    reclaimed_count.store(0);
+	}
+
+	~epoch_reclaimer()
+	{
+	    delete [] slots;
+	}
+
+	/*Counts the calling thread as a reader of the current epoch and returns its counter for leave. The epoch is read again after counting, so that a reader counted in an epoch that has already ended starts over*/
+	std::atomic<uint64_t> *enter()
+	{
+	    std::atomic<uint64_t> *active = my_slot().active;
+	    while(true)
+	    {
+		uint64_t e = epoch.load();
+		active[e & 1].fetch_add(1);
+		if(epoch.load() == e) return &(active[e & 1]);
+		active[e & 1].fetch_sub(1);
+	    }
+	}
+
+	void leave(std::atomic<uint64_t> *counter)
+	{
+	    counter->fetch_sub(1,std::memory_order_release);
+	}
+
+	/*Retires n, which the caller has already unlinked, in size class c. It is reused once no reader can reach it*/
+	void retire(T *n,int c=0)
+	{
+	    assert(c >= 0 && c < CLASSES);
+	    slot &s = my_slot();
+	    bool advance = false;
+	    std::atomic_thread_fence(std::memory_order_seq_cst);
+	    {
+		std::lock_guard<std::mutex> lock(s.mutex_t);
+		uint64_t e = epoch.load();
+		collect(s,e,s);
+		s.limbo[e % 3].push_back(std::make_pair(n,c));
+		s.limbo_epoch[e % 3] = e;
+		if(++s.batch >= EPOCH_BATCH)
+		{
+		   s.batch = 0;
+		   advance = true;
+		}
+	    }
+	    retired_count.fetch_add(1,std::memory_order_relaxed);
+	    if(advance && try_advance()) collect_others(s);
+	}
+
+	/*Returns a reclaimed node of size class c from the caller's slot, or nullptr if it has none. A slot whose retired nodes wait for the epoch tries to advance it first*/
+	T *allocate(int c=0)
+	{
+	    assert(c >= 0 && c < CLASSES);
+	    slot &s = my_slot();
+	    std::unique_lock<std::mutex> lock(s.mutex_t);
+	    if(s.free_list[c].empty())
+	    {
+		collect(s,epoch.load(),s);
+		bool waiting = !s.limbo[0].empty() || !s.limbo[1].empty() || !s.limbo[2].empty();
+		if(s.free_list[c].empty() && waiting)
+		{
+		   lock.unlock();
+		   try_advance();
+		   lock.lock();
+		   collect(s,epoch.load(),s);
+		}
+		if(s.free_list[c].empty()) return nullptr;
+	    }
+	    T *n = s.free_list[c].back();
+	    s.free_list[c].pop_back();
+	    return n;
+	}
+
+	/*Hands every retired and reclaimed node to fn. No reader or writer may be inside*/
+	template<typename Fn>
+	void drain(Fn fn)
+	{
+	    for(uint32_t i=0;i<num_slots;i++)
+	    {
+		std::lock_guard<std::mutex> lock(slots[i].mutex_t);
+		for(int j=0;j<3;j++)
+		{
+		   for(auto &p : slots[i].limbo[j]) fn(p.first,p.second);
+		   slots[i].limbo[j].clear();
+		}
+		for(int c=0;c<CLASSES;c++)
+		{
+		   for(auto n : slots[i].free_list[c]) fn(n,c);
+		   slots[i].free_list[c].clear();
+		}
+	    }
+	}
+
+	uint64_t retired()
+	{
+		return retired_count.load();
+	}
+
+	uint64_t reclaimed()
+	{
+		return reclaimed_count.load();
+	}
+
+	/*Nodes retired and not yet reclaimed*/
+	uint64_t pending()
+	{
+		return retired_count.load()-reclaimed_count.load();
+	}
+
+	uint64_t current_epoch()
+	{
+		return epoch.load();
+	}
+
+};
+
+}
+
+#endif
@@ -26,17 +26,118 @@
 #include <boost/interprocess/managed_mapped_file.hpp>
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace bip = boost::interprocess;
 
 namespace hcl {
+/*
+ * A hybrid logical clock timestamp: microseconds since the Unix epoch in the
+ * upper 52 bits and a logical counter in the lower HLC_LOGICAL_BITS. Two
+ * timestamps compare as integers. A logical counter that overflows carries
+ * into the physical part, which only moves the timestamp ahead.
+ */
+typedef uint64_t HLCTime;
+#define HLC_LOGICAL_BITS 12
+/* Round trips per sync; the one with the shortest round trip is kept */
+#define HLC_SYNC_SAMPLES 4
+/* Largest drift of a client's clock against its server that is believed */
+#define HLC_MAX_DRIFT 500e-6
+/* The error of an offset that was never measured */
+#define CLOCK_UNBOUNDED UINT64_MAX
+
+/*
+ * [earliest, latest] in microseconds since the global epoch: the true global
+ * time was within the interval at some moment during the call.
+ */
+typedef std::pair<uint64_t, uint64_t> TimeInterval;
+
+inline uint64_t hlc_physical(HLCTime t) { return t >> HLC_LOGICAL_BITS; }
+inline uint64_t hlc_logical(HLCTime t) {
+  return t & ((1ULL << HLC_LOGICAL_BITS) - 1);
+}
+
+/*
+ * GetTime returns the microseconds since the server started, asking the
+ * server unless it is on the node, so the times of different servers are not
+ * comparable. GetGlobalTime returns intervals of a time shared by all
+ * servers, like TrueTime: the global clock is the wall clock of server 0 and
+ * its epoch the moment server 0 started. Every server runs a thread that
+ * measures its offset to each other server every
+ * HCL_CONF->CLOCK_SYNC_INTERVAL milliseconds, from the shortest of
+ * HLC_SYNC_SAMPLES round trips, and keeps the offset to server 0 with an
+ * error of half that round trip. The uncertainty of a timestamp is that error
+ * plus HLC_MAX_DRIFT times the age of the measurement, and clients on other
+ * nodes add the error of their own sync. Until a server has reached server 0
+ * its intervals are unbounded. GetHLCTime returns hybrid logical clock
+ * timestamps without locks or RPCs: the server and the clients on its node
+ * share one clock word in the segment and read the wall clock of the node,
+ * while other clients keep their own word and estimate the server's wall
+ * clock from steady_clock with an offset and drift measured by SyncHLC. A
+ * client syncs again once HCL_CONF->CLOCK_SYNC_INTERVAL milliseconds have
+ * passed, on whichever GetHLCTime call notices first. The timestamps of a
+ * clock increase. Causality across servers holds as far as timestamps travel
+ * with the messages: a process that receives a timestamp passes it to
+ * UpdateHLC, after which its timestamps are larger, and SyncHLC does so both
+ * ways between a client and its server.
+ */
 class global_clock {
  private:
   typedef std::chrono::high_resolution_clock::time_point chrono_time;
+  /* Maps the local clock, the steady_clock of a client or the wall clock of
+   * a server, to the wall clock of the server (offset and drift) and that to
+   * the global clock (global_offset), with the error of the latter at the
+   * local time base */
+  struct calibration_values {
+    int64_t base;
+    int64_t offset;
+    double drift;
+    int64_t global_offset;
+    uint64_t error;
+  };
+  struct calibration {
+    /* Odd while the fields are rewritten */
+    std::atomic<uint32_t> version;
+    std::atomic<int64_t> base;
+    std::atomic<int64_t> offset;
+    std::atomic<double> drift;
+    std::atomic<int64_t> global_offset;
+    std::atomic<uint64_t> error;
+    calibration()
+        : version(0),
+          base(0),
+          offset(0),
+          drift(0),
+          global_offset(0),
+          error(CLOCK_UNBOUNDED) {}
+  };
   chrono_time *start;
+  std::atomic<HLCTime> *hlc;
+  std::atomic<HLCTime> client_hlc;
+  /* In the segment for the server and the clients on its node */
+  calibration *calib;
+  calibration client_calib;
+  std::atomic<int64_t> last_sync;
+  std::atomic_flag syncing = ATOMIC_FLAG_INIT;
+  /* The offset and error of the wall clock of each server from this
+   * server's, as last measured by the calibration thread */
+  std::vector<std::pair<int64_t, uint64_t>> skew;
+  std::mutex skew_mutex;
+  std::thread calibrator;
+  std::mutex stop_mutex;
+  std::condition_variable stop_cv;
+  bool stop;
   bool is_server;
   bip::interprocess_mutex *mutex;
   really_long memory_allocated;
@@ -47,6 +148,187 @@ class global_clock {
   std::shared_ptr<RPC> rpc;
   bool server_on_node;
   CharStruct backed_file;
+  /* Handles of the remote operations, resolved by the constructor */
+  struct {
+    RPC::Procedure get_time, sync_hlc, get_calibration;
+  } remote;
+
+  static int64_t steady_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  static uint64_t wall_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /* True when the wall clock of the node is the server's */
+  bool shares_clock() { return is_server || server_on_node; }
+
+  int64_t local_us() {
+    return shares_clock() ? static_cast<int64_t>(wall_us()) : steady_us();
+  }
+
+  /* Seqlock read of the calibration */
+  calibration_values load_calibration() {
+    calibration_values v;
+    while (true) {
+      uint32_t v1 = calib->version.load(std::memory_order_acquire);
+      if (v1 & 1) continue;
+      v.base = calib->base.load(std::memory_order_relaxed);
+      v.offset = calib->offset.load(std::memory_order_relaxed);
+      v.drift = calib->drift.load(std::memory_order_relaxed);
+      v.global_offset = calib->global_offset.load(std::memory_order_relaxed);
+      v.error = calib->error.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (calib->version.load(std::memory_order_relaxed) == v1) return v;
+    }
+  }
+
+  /* Only one thread stores at a time: the calibration thread of a server or
+   * the client thread that won syncing */
+  void store_calibration(const calibration_values &v) {
+    uint32_t version = calib->version.load(std::memory_order_relaxed);
+    calib->version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    calib->base.store(v.base, std::memory_order_relaxed);
+    calib->offset.store(v.offset, std::memory_order_relaxed);
+    calib->drift.store(v.drift, std::memory_order_relaxed);
+    calib->global_offset.store(v.global_offset, std::memory_order_relaxed);
+    calib->error.store(v.error, std::memory_order_relaxed);
+    calib->version.store(version + 2, std::memory_order_release);
+  }
+
+  /* The server's wall clock at local time now */
+  static int64_t server_us(const calibration_values &v, int64_t now) {
+    return now + v.offset + static_cast<int64_t>(v.drift * (now - v.base));
+  }
+
+  /* The error of the global time at local time now */
+  static uint64_t error_at(const calibration_values &v, int64_t now) {
+    if (v.error == CLOCK_UNBOUNDED) return CLOCK_UNBOUNDED;
+    int64_t age = std::max<int64_t>(0, now - v.base);
+    return v.error + static_cast<uint64_t>(HLC_MAX_DRIFT * age) + 1;
+  }
+
+  /* The server's wall clock in microseconds, estimated on other nodes */
+  uint64_t physical_us() {
+    if (shares_clock()) return wall_us();
+    return server_us(load_calibration(), steady_us());
+  }
+
+  /* Syncs a client on another node once the sync interval has passed */
+  void sync_if_due() {
+    if (shares_clock()) return;
+    int64_t interval =
+        static_cast<int64_t>(HCL_CONF->CLOCK_SYNC_INTERVAL) * 1000;
+    int64_t since = last_sync.load(std::memory_order_relaxed);
+    if (since != std::numeric_limits<int64_t>::min() &&
+        steady_us() - since <= interval)
+      return;
+    if (!syncing.test_and_set(std::memory_order_acquire)) {
+      SyncHLC();
+      syncing.clear(std::memory_order_release);
+    }
+  }
+
+  /* The offset of server's wall clock from this process' local clock and
+   * its error, from the shortest of HLC_SYNC_SAMPLES round trips, and the
+   * local time of that round trip's middle. Round trips whose RPC failed are
+   * skipped; the error is CLOCK_UNBOUNDED when none succeeded */
+  std::pair<int64_t, uint64_t> measure(uint16_t server, int64_t &middle) {
+    int64_t best_rtt = std::numeric_limits<int64_t>::max(), best_offset = 0;
+    for (int i = 0; i < HLC_SYNC_SAMPLES; i++) {
+      HLCTime sent = hlc->load(std::memory_order_relaxed);
+      int64_t t0 = local_us();
+      std::pair<uint64_t, HLCTime> reply;
+      try {
+        reply = SyncHLCServer(server, sent);
+      } catch (const std::exception &e) {
+        continue;
+      }
+      int64_t t1 = local_us();
+      advance(reply.second);
+      if (t1 - t0 >= best_rtt) continue;
+      best_rtt = t1 - t0;
+      middle = t0 + best_rtt / 2;
+      best_offset = static_cast<int64_t>(reply.first) - middle;
+    }
+    if (best_rtt == std::numeric_limits<int64_t>::max())
+      return std::pair<int64_t, uint64_t>(0, CLOCK_UNBOUNDED);
+    return std::pair<int64_t, uint64_t>(best_offset, (best_rtt + 1) / 2);
+  }
+
+  /* Measures the offset to every other server; the one to server 0 becomes
+   * the calibration of this server */
+  void calibrate() {
+    for (uint16_t server = 0; server < num_servers; server++) {
+      if (server == my_server) continue;
+      int64_t middle = 0;
+      std::pair<int64_t, uint64_t> offset = measure(server, middle);
+      {
+        std::lock_guard<std::mutex> lock(skew_mutex);
+        skew[server] = offset;
+      }
+      if (server != 0 || offset.second == CLOCK_UNBOUNDED) continue;
+      uint16_t reference = 0;
+      std::pair<int64_t, uint64_t> global;
+      try {
+        global = GetCalibrationServer(reference);
+      } catch (const std::exception &e) {
+        continue;
+      }
+      if (global.second == CLOCK_UNBOUNDED) continue;
+      calibration_values v;
+      v.base = middle;
+      v.offset = 0;
+      v.drift = 0;
+      v.global_offset = offset.first + global.first;
+      v.error = offset.second + global.second;
+      store_calibration(v);
+    }
+  }
+
+  /* Waits an interval before each round, the first too, so that the other
+   * servers have bound their functions */
+  void calibration_loop() {
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    while (!stop_cv.wait_for(
+        lock, std::chrono::milliseconds(HCL_CONF->CLOCK_SYNC_INTERVAL),
+        [this]() { return stop; })) {
+      lock.unlock();
+      calibrate();
+      lock.lock();
+    }
+  }
+
+  /* Advances the clock past its last timestamp, remote and the physical
+   * time, and returns the new timestamp */
+  HLCTime advance(HLCTime remote) {
+    HLCTime candidate = std::max<HLCTime>(
+        physical_us() << HLC_LOGICAL_BITS, remote == 0 ? 0 : remote + 1);
+    HLCTime last = hlc->load(std::memory_order_relaxed);
+    while (true) {
+      HLCTime next = std::max(candidate, last + 1);
+      if (hlc->compare_exchange_weak(last, next, std::memory_order_acq_rel,
+                                     std::memory_order_relaxed))
+        return next;
+    }
+  }
+
+  /* Ends the calibration thread of this process, if it runs */
+  void stop_calibration() {
+    if (!calibrator.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(stop_mutex);
+      stop = true;
+    }
+    stop_cv.notify_all();
+    calibrator.join();
+  }
 
  public:
   /*
@@ -54,12 +336,32 @@ class global_clock {
    */
   ~global_clock() {
     AutoTrace trace = AutoTrace("hcl::~global_clock", NULL);
+    stop_calibration();
     if (is_server) bip::file_mapping::remove(backed_file.c_str());
   }
 
+  /*
+   * Stop() ends the calibration of this process and returns once every rank
+   * has, so that no calibration RPC reaches a clock being destroyed. The
+   * handlers of the server are bound to this object: call Stop() on every
+   * rank of MPI_COMM_WORLD before deleting the clock.
+   */
+  void Stop() {
+    AutoTrace trace = AutoTrace("hcl::global_clock::Stop", NULL);
+    stop_calibration();
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+
   global_clock(std::string name_ = "TEST_GLOBAL_CLOCK",
                uint16_t port = HCL_CONF->RPC_PORT)
-      : is_server(HCL_CONF->IS_SERVER),
+      : hlc(&client_hlc),
+        client_hlc(0),
+        calib(&client_calib),
+        client_calib(),
+        last_sync(std::numeric_limits<int64_t>::min()),
+        skew(),
+        stop(false),
+        is_server(HCL_CONF->IS_SERVER),
         my_server(HCL_CONF->MY_SERVER),
         num_servers(HCL_CONF->NUM_SERVERS),
         comm_size(1),
@@ -68,20 +370,32 @@ class global_clock {
         name(name_),
         segment(),
         func_prefix(name_),
-        backed_file(HCL_CONF->BACKED_FILE_DIR + PATH_SEPARATOR + name_),
+        backed_file(HCL_CONF->BACKED_FILE_DIR + PATH_SEPARATOR + name_ + "_" +
+                    std::to_string(HCL_CONF->MY_SERVER)),
         server_on_node(HCL_CONF->SERVER_ON_NODE) {
     AutoTrace trace = AutoTrace("hcl::global_clock");
     MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
     MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
     name = name + "_" + std::to_string(my_server);
     rpc = Singleton<RPCFactory>::GetInstance()->GetRPC(port);
+    remote.get_time = *rpc->resolve(func_prefix + "_GetTime");
+    remote.sync_hlc = *rpc->resolve(func_prefix + "_SyncHLC");
+    remote.get_calibration = *rpc->resolve(func_prefix + "_GetCalibration");
     if (is_server) {
       switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_ENABLE_RPCLIB
         case RPCLIB: {
           std::function<HTime(void)> getTimeFunction(
               std::bind(&global_clock::LocalGetTime, this));
+          std::function<std::pair<uint64_t, HLCTime>(HLCTime)> syncFunction(
+              std::bind(&global_clock::LocalSyncHLC, this,
+                        std::placeholders::_1));
+          std::function<std::pair<int64_t, uint64_t>(void)>
+              calibrationFunction(
+                  std::bind(&global_clock::LocalGetCalibration, this));
           rpc->bind(func_prefix + "_GetTime", getTimeFunction);
+          rpc->bind(func_prefix + "_SyncHLC", syncFunction);
+          rpc->bind(func_prefix + "_GetCalibration", calibrationFunction);
           break;
         }
 #endif
@@ -96,7 +410,15 @@ class global_clock {
           std::function<void(const tl::request &)> getTimeFunction(
               std::bind(&global_clock::ThalliumLocalGetTime, this,
                         std::placeholders::_1));
+          std::function<void(const tl::request &, HLCTime)> syncFunction(
+              std::bind(&global_clock::ThalliumLocalSyncHLC, this,
+                        std::placeholders::_1, std::placeholders::_2));
+          std::function<void(const tl::request &)> calibrationFunction(
+              std::bind(&global_clock::ThalliumLocalGetCalibration, this,
+                        std::placeholders::_1));
           rpc->bind(func_prefix + "_GetTime", getTimeFunction);
+          rpc->bind(func_prefix + "_SyncHLC", syncFunction);
+          rpc->bind(func_prefix + "_GetCalibration", calibrationFunction);
           break;
         }
 #endif
@@ -109,6 +431,24 @@ class global_clock {
           std::chrono::high_resolution_clock::now());
       mutex =
           segment.construct<boost::interprocess::interprocess_mutex>("mtx")();
+      hlc = segment.construct<std::atomic<HLCTime>>("HLC")(0);
+      calib = segment.construct<calibration>("Calibration")();
+      skew.assign(num_servers,
+                  std::pair<int64_t, uint64_t>(0, CLOCK_UNBOUNDED));
+      skew[my_server] = std::pair<int64_t, uint64_t>(0, 0);
+      if (my_server == 0) {
+        /* Server 0 defines the global clock; its epoch is now */
+        calibration_values v;
+        v.base = wall_us();
+        v.offset = 0;
+        v.drift = 0;
+        v.global_offset = -v.base;
+        v.error = 0;
+        store_calibration(v);
+      }
+      if (num_servers > 1) {
+        calibrator = std::thread(&global_clock::calibration_loop, this);
+      }
     } else if (!is_server && server_on_node) {
       segment = bip::managed_mapped_file(bip::open_only, backed_file.c_str());
       std::pair<chrono_time *, bip::managed_mapped_file::size_type> res;
@@ -118,6 +458,8 @@ class global_clock {
           res2;
       res2 = segment.find<bip::interprocess_mutex>("mtx");
       mutex = res2.first;
+      hlc = segment.find<std::atomic<HLCTime>>("HLC").first;
+      calib = segment.find<calibration>("Calibration").first;
     }
   }
   chrono_time *data() {
@@ -141,7 +483,7 @@ class global_clock {
       return LocalGetTime();
     } else {
       auto my_server_i = my_server;
-      return RPC_CALL_WRAPPER1("_GetTime", my_server_i, HTime);
+      return RPC_CALL_WRAPPER1(remote.get_time, my_server_i, HTime);
     }
   }
 
@@ -154,26 +496,152 @@ class global_clock {
     if (my_server == server && server_on_node) {
       return LocalGetTime();
     } else {
-      return RPC_CALL_WRAPPER1("_GetTime", server, HTime);
+      return RPC_CALL_WRAPPER1(remote.get_time, server, HTime);
     }
   }
 
   /*
    * GetTime() returns the time locally within a node using chrono
-   * high_resolution_clock
+   * high_resolution_clock. The start time never changes once the server
+   * wrote it, so it is read without the mutex.
    */
   HTime LocalGetTime() {
     AutoTrace trace = AutoTrace("hcl::global_clock::GetTime", NULL);
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
     auto t2 = std::chrono::high_resolution_clock::now();
     auto t = std::chrono::duration_cast<std::chrono::microseconds>(t2 - *start)
                  .count();
     return t;
   }
 
+  /*
+   * GetHLCTime() returns a new timestamp of the clock of this process
+   */
+  HLCTime GetHLCTime() {
+    sync_if_due();
+    return advance(0);
+  }
+
+  /*
+   * GetGlobalTime() returns an interval of the global clock without locks or
+   * RPCs; (0, UINT64_MAX) while the offset to server 0 is unknown
+   */
+  TimeInterval GetGlobalTime() {
+    sync_if_due();
+    calibration_values v = load_calibration();
+    int64_t now = local_us();
+    uint64_t error = error_at(v, now);
+    if (error == CLOCK_UNBOUNDED) return TimeInterval(0, UINT64_MAX);
+    int64_t global = server_us(v, now) + v.global_offset;
+    int64_t earliest = std::max<int64_t>(0, global - (int64_t)error);
+    return TimeInterval(earliest, global + error);
+  }
+
+  /*
+   * True once GetGlobalTime() returns bounded intervals
+   */
+  bool IsCalibrated() {
+    return load_calibration().error != CLOCK_UNBOUNDED;
+  }
+
+  /*
+   * The offset of the wall clock of every server from this server's and its
+   * error, as last measured; (0, CLOCK_UNBOUNDED) for servers not reached.
+   * Empty on clients.
+   */
+  std::vector<std::pair<int64_t, uint64_t>> GetSkew() {
+    std::lock_guard<std::mutex> lock(skew_mutex);
+    return skew;
+  }
+
+  /*
+   * UpdateHLC() merges a timestamp received from another process and returns
+   * a new timestamp larger than both
+   */
+  HLCTime UpdateHLC(HLCTime remote) { return advance(remote); }
+
+  /*
+   * SyncHLC() measures the offset of the server's wall clock from the
+   * steady_clock of this client, NTP style: of HLC_SYNC_SAMPLES round trips
+   * the shortest is kept and the server's reply is taken to be from its
+   * middle. The drift comes from the change of the offset since the last
+   * sync. The clocks of the client and the server are merged both ways. When
+   * the RPCs fail the last calibration is kept.
+   */
+  void SyncHLC() {
+    if (shares_clock()) return;
+    int64_t middle = 0;
+    std::pair<int64_t, uint64_t> offset = measure(my_server, middle);
+    if (offset.second == CLOCK_UNBOUNDED) return;
+    calibration_values prev = load_calibration();
+    calibration_values v;
+    v.base = middle;
+    v.offset = offset.first;
+    v.drift = prev.drift;
+    if (last_sync.load(std::memory_order_relaxed) !=
+            std::numeric_limits<int64_t>::min() &&
+        middle > prev.base) {
+      double measured = static_cast<double>(offset.first - prev.offset) /
+                        (middle - prev.base);
+      v.drift = std::max(-HLC_MAX_DRIFT, std::min(HLC_MAX_DRIFT, measured));
+    }
+    auto my_server_i = my_server;
+    std::pair<int64_t, uint64_t> global;
+    try {
+      global = GetCalibrationServer(my_server_i);
+    } catch (const std::exception &e) {
+      return;
+    }
+    v.global_offset = global.first;
+    v.error = global.second == CLOCK_UNBOUNDED ? CLOCK_UNBOUNDED
+                                               : global.second + offset.second;
+    store_calibration(v);
+    last_sync.store(steady_us(), std::memory_order_relaxed);
+  }
+
+  /*
+   * The wall clock of a server and a timestamp of its clock after merging
+   * observed. Throws when the RPC fails.
+   */
+  std::pair<uint64_t, HLCTime> SyncHLCServer(uint16_t &server,
+                                             HLCTime observed) {
+    if (my_server == server && shares_clock()) {
+      return LocalSyncHLC(observed);
+    } else {
+      typedef std::pair<uint64_t, HLCTime> ret_type;
+      return RPC_CALL_WRAPPER(remote.sync_hlc, server, ret_type, observed);
+    }
+  }
+
+  std::pair<uint64_t, HLCTime> LocalSyncHLC(HLCTime remote) {
+    HLCTime t = advance(remote);
+    return std::pair<uint64_t, HLCTime>(wall_us(), t);
+  }
+
+  /*
+   * The offset of a server's global clock from its wall clock and its error
+   * now; (0, CLOCK_UNBOUNDED) when unknown. Throws when the RPC fails.
+   */
+  std::pair<int64_t, uint64_t> GetCalibrationServer(uint16_t &server) {
+    if (my_server == server && shares_clock()) {
+      return LocalGetCalibration();
+    } else {
+      typedef std::pair<int64_t, uint64_t> ret_type;
+      ret_type reply =
+          RPC_CALL_WRAPPER1(remote.get_calibration, server, ret_type);
+      return reply;
+    }
+  }
+
+  std::pair<int64_t, uint64_t> LocalGetCalibration() {
+    calibration_values v = load_calibration();
+    return std::pair<int64_t, uint64_t>(v.global_offset,
+                                        error_at(v, wall_us()));
+  }
+
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
   THALLIUM_DEFINE1(LocalGetTime)
+  THALLIUM_DEFINE(LocalSyncHLC, (remote), HLCTime remote)
+  THALLIUM_DEFINE1(LocalGetCalibration)
 #endif
 };
 
@@ -38,6 +38,23 @@ class ConfigurationManager {
   CharStruct VERBS_CONF;
   CharStruct VERBS_DOMAIN;
   really_long MEMORY_ALLOCATED;
+  /* Values of at least this many bytes move by RDMA bulk on THALLIUM_ROCE */
+  really_long RDMA_THRESHOLD;
+  /* Each unordered_map server splits its data into this many maps, each with
+   * its own lock, so that operations on different keys do not contend */
+  uint16_t LOCK_STRIPES;
+  /* The table of a concurrent_unordered_map server doubles when it holds more
+   * than this many entries per bucket; 0 keeps it at its initial size */
+  double MAX_LOAD_FACTOR;
+  /* Nodes in the first chunk of the node pool of a concurrent_unordered_map
+   * server; each chunk after it is twice as large, up to MAX_CHUNK_NODES */
+  uint32_t NODE_CHUNK_SIZE;
+  /* Cells of the ring of a concurrent_queue server with a RingBuffer, rounded
+   * up to a power of two; pushes fail while it is full */
+  uint32_t QUEUE_CAPACITY;
+  /* Milliseconds between the syncs of the hybrid logical clock of a
+   * global_clock client with its server */
+  uint32_t CLOCK_SYNC_INTERVAL;
 
   bool IS_SERVER;
   uint16_t MY_SERVER;
@@ -53,6 +70,12 @@ class ConfigurationManager {
       : SERVER_LIST(),
         BACKED_FILE_DIR("/dev/shm"),
         MEMORY_ALLOCATED(1024ULL * 1024ULL * 128ULL),
+        RDMA_THRESHOLD(1024ULL * 64ULL),
+        LOCK_STRIPES(1),
+        MAX_LOAD_FACTOR(2.0),
+        NODE_CHUNK_SIZE(1024),
+        QUEUE_CAPACITY(1 << 16),
+        CLOCK_SYNC_INTERVAL(1000),
         RPC_PORT(9000),
         RPC_THREADS(1),
 #if defined(HCL_ENABLE_RPCLIB)
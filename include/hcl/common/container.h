@@ -16,12 +16,41 @@
 #include <hcl/communication/rpc_factory.h>
 #include <hcl/communication/rpc_lib.h>
 
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <memory>
+#include <queue>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "typedefs.h"
 
 namespace hcl {
+/**
+ * Position of a scan that has read everything on a server.
+ */
+const uint64_t SCAN_END = UINT64_MAX;
+
+/**
+ * Client side state of a paginated scan: the server being read and where its
+ * next page starts. The position travels with every NextBatch request, so
+ * servers keep no state for a scan and an abandoned scan holds nothing.
+ */
+template <typename Position>
+struct ScanCursor {
+  uint16_t server;
+  Position position;
+  bool done;
+  ScanCursor() : server(0), position(), done(false) {}
+};
+
 class container {
  protected:
   int comm_size, my_rank, num_servers;
@@ -31,8 +60,79 @@ class container {
   bool is_server;
   boost::interprocess::managed_mapped_file segment;
   CharStruct name, func_prefix;
-  boost::interprocess::interprocess_mutex *mutex;
+  /* Held exclusively by writes and shared by reads of the local data */
+  boost::interprocess::interprocess_sharable_mutex *mutex;
   CharStruct backed_file;
+  ProcedureCache procedures;
+  /* Server side callbacks by name, each with the type of its std::function */
+  std::unordered_map<std::string,
+                     std::pair<std::type_index, std::shared_ptr<void>>>
+      callbacks;
+  std::shared_mutex callback_mutex;
+
+  /**
+   * Registers function under name in this process, replacing any callback
+   * with that name.
+   */
+  template <typename Function>
+  void add_callback(const std::string &name, Function function) {
+    std::unique_lock<std::shared_mutex> lock(callback_mutex);
+    callbacks.insert_or_assign(
+        name, std::make_pair(std::type_index(typeid(Function)),
+                             std::static_pointer_cast<void>(
+                                 std::make_shared<Function>(function))));
+  }
+
+  /**
+   * The callback registered under name. Throws std::invalid_argument if there
+   * is none or if it was registered with another type.
+   */
+  template <typename Function>
+  std::shared_ptr<Function> find_callback(const std::string &name) {
+    std::shared_lock<std::shared_mutex> lock(callback_mutex);
+    auto iter = callbacks.find(name);
+    if (iter == callbacks.end() ||
+        iter->second.first != std::type_index(typeid(Function))) {
+      throw std::invalid_argument("hcl: no callback " + name + " of " +
+                                  std::string(func_prefix.c_str()) +
+                                  " with these types");
+    }
+    return std::static_pointer_cast<Function>(iter->second.second);
+  }
+
+  /**
+   * Binds function as the remote operation func_prefix + funcname on either
+   * backend, for operations that are only known once a callback is bound.
+   */
+  template <typename Ret, typename... Args>
+  void bind_handler(const std::string &funcname,
+                    std::function<Ret(Args &...)> function) {
+    CharStruct rpc_name(std::string(func_prefix.c_str()) + funcname);
+    switch (HCL_CONF->RPC_IMPLEMENTATION) {
+#ifdef HCL_ENABLE_RPCLIB
+      case RPCLIB: {
+        rpc->bind(rpc_name, function);
+        break;
+      }
+#endif
+#ifdef HCL_ENABLE_THALLIUM_TCP
+      case THALLIUM_TCP:
+#endif
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+      case THALLIUM_ROCE:
+#endif
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+      {
+        std::function<void(const tl::request &, Args &...)> handler(
+            [function](const tl::request &thallium_req, Args &... args) {
+              thallium_req.respond(function(args...));
+            });
+        rpc->bind(rpc_name, handler);
+        break;
+      }
+#endif
+    }
+  }
 
  public:
   bool server_on_node;
@@ -45,6 +145,87 @@ class container {
   }
   inline bool is_local() { return server_on_node; }
 
+  /**
+   * Resolves the remote operation func_prefix + funcname. Containers keep the
+   * handle of each of their operations from construction on.
+   */
+  inline RPC::Procedure resolve(const char *funcname) {
+    return *rpc->resolve(func_prefix + funcname);
+  }
+
+  /**
+   * Returns the handle of an operation whose name is only known at call time,
+   * such as the operations of a bound callback.
+   */
+  inline RPC::Procedure const &procedure(const char *funcname) {
+    return procedures.get(*rpc, func_prefix, funcname);
+  }
+
+  /**
+   * Wraps a result computed locally into a satisfied future so that local and
+   * remote asynchronous operations share a return type.
+   */
+  template <typename T>
+  std::future<T> ready_future(T value) {
+    std::promise<T> promise;
+    promise.set_value(std::move(value));
+    return promise.get_future();
+  }
+
+  /**
+   * Merges per-server results that are each sorted by less into one sorted
+   * vector with a k-way merge.
+   */
+  template <typename T, typename Less>
+  std::vector<T> merge_runs(std::vector<std::vector<T>> &runs, Less less) {
+    typedef std::pair<size_t, size_t> cursor;  // (run, position in run)
+    auto greater = [&runs, &less](const cursor &a, const cursor &b) {
+      return less(runs[b.first][b.second], runs[a.first][a.second]);
+    };
+    std::priority_queue<cursor, std::vector<cursor>, decltype(greater)> heads(
+        greater);
+    size_t total = 0;
+    for (size_t run = 0; run < runs.size(); ++run) {
+      total += runs[run].size();
+      if (!runs[run].empty()) heads.emplace(run, 0);
+    }
+    std::vector<T> merged;
+    merged.reserve(total);
+    while (!heads.empty()) {
+      cursor head = heads.top();
+      heads.pop();
+      merged.push_back(std::move(runs[head.first][head.second]));
+      if (++head.second < runs[head.first].size()) heads.push(head);
+    }
+    return merged;
+  }
+
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+  /**
+   * True when value is large enough to move by RDMA bulk instead of being
+   * serialized as an RPC argument.
+   */
+  template <typename T>
+  inline bool use_rdma(T &value) {
+    size_t size = RDMABuffer<T>::size(value);
+    return HCL_CONF->RPC_IMPLEMENTATION == THALLIUM_ROCE &&
+           RDMABuffer<T>::eligible && size > 0 &&
+           size >= HCL_CONF->RDMA_THRESHOLD;
+  }
+
+  /**
+   * True when a value of type T fetched from a server might be large enough
+   * for RDMA bulk. Variable sized types must ask the server for the size.
+   */
+  template <typename T>
+  inline bool may_use_rdma() {
+    return HCL_CONF->RPC_IMPLEMENTATION == THALLIUM_ROCE &&
+           RDMABuffer<T>::eligible &&
+           (!RDMABuffer<T>::fixed_size ||
+            sizeof(T) >= HCL_CONF->RDMA_THRESHOLD);
+  }
+#endif
+
   template <typename Allocator, typename MappedType, typename SharedType>
   typename std::enable_if_t<std::is_same<Allocator, nullptr_t>::value,
                             MappedType>
@@ -95,16 +276,17 @@ class container {
       segment = boost::interprocess::managed_mapped_file(
           boost::interprocess::create_only, backed_file.c_str(),
           memory_allocated);
-      mutex =
-          segment.construct<boost::interprocess::interprocess_mutex>("mtx")();
+      mutex = segment.construct<
+          boost::interprocess::interprocess_sharable_mutex>("mtx")();
     } else if (!is_server && server_on_node) {
       /* Map the clients to their respective memory pools */
       segment = boost::interprocess::managed_mapped_file(
           boost::interprocess::open_only, backed_file.c_str());
-      std::pair<boost::interprocess::interprocess_mutex *,
+      std::pair<boost::interprocess::interprocess_sharable_mutex *,
                 boost::interprocess::managed_mapped_file::size_type>
           res2;
-      res2 = segment.find<boost::interprocess::interprocess_mutex>("mtx");
+      res2 = segment.find<boost::interprocess::interprocess_sharable_mutex>(
+          "mtx");
       mutex = res2.first;
     }
   }
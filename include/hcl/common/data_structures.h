@@ -35,6 +35,7 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "typedefs.h"
@@ -220,4 +221,35 @@ class CalculateSize<bip::string> {
   really_long GetSize(bip::string value) { return strlen(value.c_str()) + 1; }
 };
 
+/**
+ * Describes the contiguous bytes that back a value so they can be exposed for
+ * an RDMA bulk transfer. Types without such a layout keep using the regular
+ * RPC argument path; other types can opt in by specializing this struct.
+ */
+template <typename T, typename Enable = void>
+struct RDMABuffer {
+  static constexpr bool eligible = false;
+  static constexpr bool fixed_size = false;
+  static void *data(T &value) { return nullptr; }
+  static size_t size(const T &value) { return 0; }
+  static void resize(T &value, size_t size) {}
+};
+template <typename T>
+struct RDMABuffer<
+    T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+  static constexpr bool eligible = true;
+  static constexpr bool fixed_size = true;
+  static void *data(T &value) { return &value; }
+  static size_t size(const T &) { return sizeof(T); }
+  static void resize(T &, size_t) {}
+};
+template <>
+struct RDMABuffer<std::string> {
+  static constexpr bool eligible = true;
+  static constexpr bool fixed_size = false;
+  static void *data(std::string &value) { return &value[0]; }
+  static size_t size(const std::string &value) { return value.size(); }
+  static void resize(std::string &value, size_t size) { value.resize(size); }
+};
+
 #endif  // INCLUDE_HCL_COMMON_DATA_STRUCTURES_H_
@@ -30,48 +30,80 @@
     thallium_req.respond(name());                              \
   }
 
+/**
+ * The RPC_CALL_WRAPPER macros take the RPC::Procedure of the operation, which
+ * containers resolve once when they are constructed.
+ */
 #ifdef HCL_ENABLE_RPCLIB
-#define RPC_CALL_WRAPPER_RPCLIB1(funcname, serverVar, ret)  \
+#define RPC_CALL_WRAPPER_RPCLIB1(procedure, serverVar, ret) \
   case RPCLIB: {                                            \
     return rpc                                              \
         ->call<RPCLIB_MSGPACK::object_handle>(              \
-            serverVar, func_prefix + std::string(funcname)) \
+            serverVar, procedure)                           \
         .template as<ret>();                                \
     break;                                                  \
   }
-#define RPC_CALL_WRAPPER_RPCLIB(funcname, serverVar, ret, args...) \
-  case RPCLIB: {                                                   \
-    return rpc                                                     \
-        ->call<RPCLIB_MSGPACK::object_handle>(                     \
-            serverVar, func_prefix + std::string(funcname), args)  \
-        .template as<ret>();                                       \
-    break;                                                         \
-  }
-#else
-#define RPC_CALL_WRAPPER_RPCLIB1(funcname, serverVar, ret)
-#define RPC_CALL_WRAPPER_RPCLIB(funcname, serverVar, ret, args...)
-#endif
-#ifdef HCL_ENABLE_RPCLIB
-#define RPC_CALL_WRAPPER_RPCLIB1_CB(funcname, serverVar, ret)       \
+#define RPC_CALL_WRAPPER_RPCLIB(procedure, serverVar, ret, args...) \
   case RPCLIB: {                                                    \
     return rpc                                                      \
         ->call<RPCLIB_MSGPACK::object_handle>(                      \
-            serverVar, funcname, std::forward<CB_Args>(cb_args)...) \
+            serverVar, procedure, args)                             \
         .template as<ret>();                                        \
     break;                                                          \
   }
-#define RPC_CALL_WRAPPER_RPCLIB_CB(funcname, serverVar, ret, ...) \
+#else
+#define RPC_CALL_WRAPPER_RPCLIB1(procedure, serverVar, ret)
+#define RPC_CALL_WRAPPER_RPCLIB(procedure, serverVar, ret, args...)
+#endif
+/**
+ * The _CB wrappers call an operation that runs a server side callback. They
+ * must be expanded where a parameter pack cb_args holds the callback's
+ * arguments, which are sent after the operation's own.
+ */
+#ifdef HCL_ENABLE_RPCLIB
+#define RPC_CALL_WRAPPER_RPCLIB1_CB(procedure, serverVar, ret) \
+  case RPCLIB: {                                               \
+    return rpc                                                 \
+        ->call<RPCLIB_MSGPACK::object_handle>(                 \
+            serverVar, procedure, cb_args...)                  \
+        .template as<ret>();                                   \
+    break;                                                     \
+  }
+#define RPC_CALL_WRAPPER_RPCLIB_CB(procedure, serverVar, ret, args...) \
+  case RPCLIB: {                                                       \
+    return rpc                                                         \
+        ->call<RPCLIB_MSGPACK::object_handle>(                         \
+            serverVar, procedure, args, cb_args...)                    \
+        .template as<ret>();                                           \
+    break;                                                             \
+  }
+#else
+#define RPC_CALL_WRAPPER_RPCLIB1_CB(procedure, serverVar, ret)
+#define RPC_CALL_WRAPPER_RPCLIB_CB(procedure, serverVar, ret, args...)
+#endif
+
+#ifdef HCL_ENABLE_RPCLIB
+#define RPC_CALL_WRAPPER_RPCLIB1_ASYNC(procedure, serverVar, ret) \
   case RPCLIB: {                                                  \
-    return rpc                                                    \
-        ->call<RPCLIB_MSGPACK::object_handle>(                    \
-            serverVar, funcname, __VA_ARGS__,                     \
-            std::forward<CB_Args>(cb_args)...)                    \
-        .template as<ret>();                                      \
+    return std::async(                                            \
+        std::launch::deferred,                                    \
+        [handle = rpc->async_call<RPCLIB_MSGPACK::object_handle>( \
+             serverVar, procedure)]() mutable                     \
+        -> ret { return handle.get().template as<ret>(); });      \
     break;                                                        \
   }
+#define RPC_CALL_WRAPPER_RPCLIB_ASYNC(procedure, serverVar, ret, args...) \
+  case RPCLIB: {                                                          \
+    return std::async(                                                    \
+        std::launch::deferred,                                            \
+        [handle = rpc->async_call<RPCLIB_MSGPACK::object_handle>(         \
+             serverVar, procedure, args)]() mutable                       \
+        -> ret { return handle.get().template as<ret>(); });              \
+    break;                                                                \
+  }
 #else
-#define RPC_CALL_WRAPPER_RPCLIB1_CB(funcname, serverVar, ret)
-#define RPC_CALL_WRAPPER_RPCLIB_CB(funcname, serverVar, ret, args...)
+#define RPC_CALL_WRAPPER_RPCLIB1_ASYNC(procedure, serverVar, ret)
+#define RPC_CALL_WRAPPER_RPCLIB_ASYNC(procedure, serverVar, ret, args...)
 #endif
 
 #ifdef HCL_ENABLE_THALLIUM_TCP
@@ -85,57 +117,103 @@
 #define RPC_CALL_WRAPPER_THALLIUM_ROCE()
 #endif
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
-#define RPC_CALL_WRAPPER_THALLIUM1(funcname, serverVar, ret)  \
+#define RPC_CALL_WRAPPER_THALLIUM1(procedure, serverVar, ret) \
   {                                                           \
-    return rpc->call<ret>(serverVar, func_prefix + funcname); \
+    return rpc->call<ret>(serverVar, procedure);              \
     break;                                                    \
   }
-#define RPC_CALL_WRAPPER_THALLIUM(funcname, serverVar, ret, args...) \
-  {                                                                  \
-    return rpc->call<ret>(serverVar, func_prefix + funcname, args);  \
-    break;                                                           \
+#define RPC_CALL_WRAPPER_THALLIUM(procedure, serverVar, ret, args...) \
+  {                                                                   \
+    return rpc->call<ret>(serverVar, procedure, args);                \
+    break;                                                            \
+  }
+#define RPC_CALL_WRAPPER_THALLIUM1_CB(procedure, serverVar, ret) \
+  {                                                              \
+    return rpc->call<ret>(serverVar, procedure, cb_args...);     \
+    break;                                                       \
+  }
+#define RPC_CALL_WRAPPER_THALLIUM_CB(procedure, serverVar, ret, args...) \
+  {                                                                      \
+    return rpc->call<ret>(serverVar, procedure, args, cb_args...);       \
+    break;                                                               \
+  }
+#define RPC_CALL_WRAPPER_THALLIUM1_ASYNC(procedure, serverVar, ret) \
+  {                                                                 \
+    return rpc->async_call<ret>(serverVar, procedure);              \
+    break;                                                          \
+  }
+#define RPC_CALL_WRAPPER_THALLIUM_ASYNC(procedure, serverVar, ret, args...) \
+  {                                                                         \
+    return rpc->async_call<ret>(serverVar, procedure, args);                \
+    break;                                                                  \
   }
 #else
-#define RPC_CALL_WRAPPER_THALLIUM1(funcname, serverVar, ret)
-#define RPC_CALL_WRAPPER_THALLIUM(funcname, serverVar, ret, args...)
+#define RPC_CALL_WRAPPER_THALLIUM1(procedure, serverVar, ret)
+#define RPC_CALL_WRAPPER_THALLIUM(procedure, serverVar, ret, args...)
+#define RPC_CALL_WRAPPER_THALLIUM1_ASYNC(procedure, serverVar, ret)
+#define RPC_CALL_WRAPPER_THALLIUM_ASYNC(procedure, serverVar, ret, args...)
+#define RPC_CALL_WRAPPER_THALLIUM1_CB(procedure, serverVar, ret)
+#define RPC_CALL_WRAPPER_THALLIUM_CB(procedure, serverVar, ret, args...)
 #endif
 
-#define RPC_CALL_WRAPPER1(funcname, serverVar, ret)        \
-  [&]() -> ret {                                           \
-    switch (HCL_CONF->RPC_IMPLEMENTATION) {                \
-      RPC_CALL_WRAPPER_RPCLIB1(funcname, serverVar, ret)   \
-      RPC_CALL_WRAPPER_THALLIUM_TCP()                      \
-      RPC_CALL_WRAPPER_THALLIUM_ROCE()                     \
-      RPC_CALL_WRAPPER_THALLIUM1(funcname, serverVar, ret) \
-    }                                                      \
+#define RPC_CALL_WRAPPER1(procedure, serverVar, ret)        \
+  [&]() -> ret {                                            \
+    switch (HCL_CONF->RPC_IMPLEMENTATION) {                 \
+      RPC_CALL_WRAPPER_RPCLIB1(procedure, serverVar, ret)   \
+      RPC_CALL_WRAPPER_THALLIUM_TCP()                       \
+      RPC_CALL_WRAPPER_THALLIUM_ROCE()                      \
+      RPC_CALL_WRAPPER_THALLIUM1(procedure, serverVar, ret) \
+    }                                                       \
+  }();
+#define RPC_CALL_WRAPPER(procedure, serverVar, ret, args...)     \
+  [&]() -> ret {                                                 \
+    switch (HCL_CONF->RPC_IMPLEMENTATION) {                      \
+      RPC_CALL_WRAPPER_RPCLIB(procedure, serverVar, ret, args)   \
+      RPC_CALL_WRAPPER_THALLIUM_TCP()                            \
+      RPC_CALL_WRAPPER_THALLIUM_ROCE()                           \
+      RPC_CALL_WRAPPER_THALLIUM(procedure, serverVar, ret, args) \
+    }                                                            \
+  }();
+/**
+ * Asynchronous variants of the wrappers above. They evaluate to a
+ * std::future<ret> while the request is in flight.
+ */
+#define RPC_CALL_WRAPPER1_ASYNC(procedure, serverVar, ret)        \
+  [&]() -> std::future<ret> {                                     \
+    switch (HCL_CONF->RPC_IMPLEMENTATION) {                       \
+      RPC_CALL_WRAPPER_RPCLIB1_ASYNC(procedure, serverVar, ret)   \
+      RPC_CALL_WRAPPER_THALLIUM_TCP()                             \
+      RPC_CALL_WRAPPER_THALLIUM_ROCE()                            \
+      RPC_CALL_WRAPPER_THALLIUM1_ASYNC(procedure, serverVar, ret) \
+    }                                                             \
   }();
-#define RPC_CALL_WRAPPER(funcname, serverVar, ret, args...)     \
-  [&]() -> ret {                                                \
-    switch (HCL_CONF->RPC_IMPLEMENTATION) {                     \
-      RPC_CALL_WRAPPER_RPCLIB(funcname, serverVar, ret, args)   \
-      RPC_CALL_WRAPPER_THALLIUM_TCP()                           \
-      RPC_CALL_WRAPPER_THALLIUM_ROCE()                          \
-      RPC_CALL_WRAPPER_THALLIUM(funcname, serverVar, ret, args) \
-    }                                                           \
+#define RPC_CALL_WRAPPER_ASYNC(procedure, serverVar, ret, args...)     \
+  [&]() -> std::future<ret> {                                          \
+    switch (HCL_CONF->RPC_IMPLEMENTATION) {                            \
+      RPC_CALL_WRAPPER_RPCLIB_ASYNC(procedure, serverVar, ret, args)   \
+      RPC_CALL_WRAPPER_THALLIUM_TCP()                                  \
+      RPC_CALL_WRAPPER_THALLIUM_ROCE()                                 \
+      RPC_CALL_WRAPPER_THALLIUM_ASYNC(procedure, serverVar, ret, args) \
+    }                                                                  \
   }();
-#define RPC_CALL_WRAPPER1_CB(funcname, serverVar, ret)     \
-  [&]() -> ret {                                           \
-    switch (HCL_CONF->RPC_IMPLEMENTATION) {                \
-      RPC_CALL_WRAPPER_RPCLIB1(funcname, serverVar, ret)   \
-      RPC_CALL_WRAPPER_THALLIUM_TCP()                      \
-      RPC_CALL_WRAPPER_THALLIUM_ROCE()                     \
-      RPC_CALL_WRAPPER_THALLIUM1(funcname, serverVar, ret) \
-    }                                                      \
+#define RPC_CALL_WRAPPER1_CB(procedure, serverVar, ret)        \
+  [&]() -> ret {                                               \
+    switch (HCL_CONF->RPC_IMPLEMENTATION) {                    \
+      RPC_CALL_WRAPPER_RPCLIB1_CB(procedure, serverVar, ret)   \
+      RPC_CALL_WRAPPER_THALLIUM_TCP()                          \
+      RPC_CALL_WRAPPER_THALLIUM_ROCE()                         \
+      RPC_CALL_WRAPPER_THALLIUM1_CB(procedure, serverVar, ret) \
+    }                                                          \
   }();
 
-#define RPC_CALL_WRAPPER_CB(funcname, serverVar, ret, ...)              \
-  [&]() -> ret {                                                        \
-    switch (HCL_CONF->RPC_IMPLEMENTATION) {                             \
-      RPC_CALL_WRAPPER_RPCLIB_CB(funcname, serverVar, ret, __VA_ARGS__) \
-      RPC_CALL_WRAPPER_THALLIUM_TCP()                                   \
-      RPC_CALL_WRAPPER_THALLIUM_ROCE()                                  \
-      RPC_CALL_WRAPPER_THALLIUM(funcname, serverVar, ret, __VA_ARGS__)  \
-    }                                                                   \
+#define RPC_CALL_WRAPPER_CB(procedure, serverVar, ret, args...)     \
+  [&]() -> ret {                                                    \
+    switch (HCL_CONF->RPC_IMPLEMENTATION) {                         \
+      RPC_CALL_WRAPPER_RPCLIB_CB(procedure, serverVar, ret, args)   \
+      RPC_CALL_WRAPPER_THALLIUM_TCP()                               \
+      RPC_CALL_WRAPPER_THALLIUM_ROCE()                              \
+      RPC_CALL_WRAPPER_THALLIUM_CB(procedure, serverVar, ret, args) \
+    }                                                               \
   }();
 
 #endif  // INCLUDE_HCL_COMMON_MACROS_H_
@@ -0,0 +1,254 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef INCLUDE_HCL_COMMON_PARTITIONER_H_
+#define INCLUDE_HCL_COMMON_PARTITIONER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Partitioners decide which server owns a key from the key's hash. Every
+ * policy is constructed with (num_servers, key_space) and maps a hash to a
+ * server id with operator(). key_space is the number of distinct positions
+ * the hash is reduced to before partitioning; 0 means the full 64 bit range.
+ * Only the range partitioner uses it. Clients and servers must construct
+ * the same policy with the same arguments. The ordered partitioner is the
+ * exception: it maps the key itself, not its hash, so that each server owns
+ * a contiguous range of keys.
+ */
+namespace hcl {
+
+/**
+ * Mixes the bits of a hash so that sequential hashes (std::hash of integers
+ * is the identity) spread over the whole 64 bit range. splitmix64 finalizer.
+ */
+inline uint64_t mix_hash(uint64_t hash) {
+  hash += 0x9e3779b97f4a7c15ULL;
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+  return hash ^ (hash >> 31);
+}
+
+/**
+ * hash % num_servers. The default; almost every key moves when a server is
+ * added.
+ */
+class ModuloPartitioner {
+ private:
+  uint16_t num_servers;
+
+ public:
+  explicit ModuloPartitioner(uint16_t num_servers_ = 1,
+                             uint64_t /*key_space*/ = 0)
+      : num_servers(num_servers_) {}
+
+  uint16_t operator()(uint64_t hash) const {
+    return static_cast<uint16_t>(hash % num_servers);
+  }
+};
+
+/**
+ * Jump consistent hash (Lamping and Veach). Needs no state besides the
+ * server count, balances evenly and moves only 1/(n+1) of the keys when the
+ * n+1th server is added. Servers can only be added or removed at the end.
+ */
+class JumpConsistentPartitioner {
+ private:
+  uint16_t num_servers;
+
+ public:
+  explicit JumpConsistentPartitioner(uint16_t num_servers_ = 1,
+                                     uint64_t /*key_space*/ = 0)
+      : num_servers(num_servers_) {}
+
+  uint16_t operator()(uint64_t hash) const {
+    int64_t bucket = -1, jump = 0;
+    while (jump < num_servers) {
+      bucket = jump;
+      hash = hash * 2862933555777941757ULL + 1;
+      jump = static_cast<int64_t>(
+          static_cast<double>(bucket + 1) *
+          (static_cast<double>(1LL << 31) /
+           static_cast<double>((hash >> 33) + 1)));
+    }
+    return static_cast<uint16_t>(bucket);
+  }
+};
+
+/**
+ * Consistent hashing ring. Every server owns VIRTUAL_NODES points on the
+ * ring and a key goes to the owner of the first point after its mixed hash.
+ * More virtual nodes give a better balance at the cost of a larger table.
+ */
+template <uint16_t VIRTUAL_NODES = 64>
+class RingPartitioner {
+ private:
+  std::vector<std::pair<uint64_t, uint16_t>> ring;
+
+ public:
+  explicit RingPartitioner(uint16_t num_servers = 1,
+                           uint64_t /*key_space*/ = 0) {
+    ring.reserve(static_cast<size_t>(num_servers) * VIRTUAL_NODES);
+    for (uint16_t server = 0; server < num_servers; ++server) {
+      for (uint16_t node = 0; node < VIRTUAL_NODES; ++node) {
+        uint64_t point =
+            mix_hash((static_cast<uint64_t>(server) << 32) | node);
+        ring.emplace_back(point, server);
+      }
+    }
+    std::sort(ring.begin(), ring.end());
+  }
+
+  uint16_t operator()(uint64_t hash) const {
+    auto iter = std::upper_bound(
+        ring.begin(), ring.end(), mix_hash(hash),
+        [](uint64_t point, const std::pair<uint64_t, uint16_t> &node) {
+          return point < node.first;
+        });
+    if (iter == ring.end()) iter = ring.begin();
+    return iter->second;
+  }
+};
+
+/**
+ * Explicit range table. Server i owns the positions below upper_bounds[i]
+ * and at or above upper_bounds[i - 1], where a position is hash % key_space.
+ * With a key_space of 0 the position is the mixed hash, as the identity
+ * std::hash of small integers would otherwise put them all on server 0.
+ * Built from a server count the space is split evenly with the remainder
+ * going to the first servers; a hot range can be split by passing a table.
+ */
+class RangePartitioner {
+ private:
+  uint64_t key_space;
+  std::vector<uint64_t> upper_bounds;
+
+ public:
+  explicit RangePartitioner(uint16_t num_servers = 1, uint64_t key_space_ = 0)
+      : key_space(key_space_), upper_bounds() {
+    if (num_servers == 0) num_servers = 1;
+    uint64_t local_size, rem;
+    if (key_space == 0) {
+      local_size = UINT64_MAX / num_servers;
+      rem = UINT64_MAX % num_servers;
+    } else {
+      local_size = key_space / num_servers;
+      rem = key_space % num_servers;
+    }
+    uint64_t bound = 0;
+    for (uint16_t server = 0; server < num_servers; ++server) {
+      bound += server < rem ? local_size + 1 : local_size;
+      upper_bounds.push_back(bound);
+    }
+  }
+
+  RangePartitioner(std::vector<uint64_t> upper_bounds_, uint64_t key_space_)
+      : key_space(key_space_), upper_bounds(std::move(upper_bounds_)) {}
+
+  uint16_t operator()(uint64_t hash) const {
+    uint64_t position = key_space == 0 ? mix_hash(hash) : hash % key_space;
+    auto iter =
+        std::upper_bound(upper_bounds.begin(), upper_bounds.end(), position);
+    if (iter == upper_bounds.end()) return upper_bounds.size() - 1;
+    return static_cast<uint16_t>(iter - upper_bounds.begin());
+  }
+};
+
+/**
+ * The top log2(n) bits of the hash, with n the server count rounded up to a
+ * power of two; positions past the last server go to it. The default of the
+ * concurrent skiplist.
+ */
+class HighBitsPartitioner {
+ private:
+  uint16_t num_servers;
+  uint32_t nbits;
+
+ public:
+  explicit HighBitsPartitioner(uint16_t num_servers_ = 1,
+                               uint64_t /*key_space*/ = 0)
+      : num_servers(num_servers_ == 0 ? 1 : num_servers_), nbits(0) {
+    while ((1u << nbits) < num_servers) ++nbits;
+  }
+
+  uint16_t operator()(uint64_t hash) const {
+    if (nbits == 0) return 0;
+    uint64_t id = hash >> (64 - nbits);
+    if (id >= num_servers) id = num_servers - 1;
+    return static_cast<uint16_t>(id);
+  }
+};
+
+/**
+ * Ordered partitioning by splitter keys. Server i owns the keys k with
+ * splitters[i - 1] <= k < splitters[i], so a range of keys lives on a run of
+ * consecutive servers and concatenating the servers in id order yields the
+ * keys in order. There must be at most num_servers - 1 splitters; built from
+ * a server count alone every key goes to server 0.
+ */
+template <typename KeyType, typename Compare = std::less<KeyType>>
+class OrderedPartitioner {
+ private:
+  std::vector<KeyType> splitters;
+  Compare compare;
+
+ public:
+  explicit OrderedPartitioner(uint16_t /*num_servers*/ = 1,
+                              uint64_t /*key_space*/ = 0)
+      : splitters(), compare() {}
+
+  explicit OrderedPartitioner(std::vector<KeyType> splitters_)
+      : splitters(std::move(splitters_)), compare() {
+    std::sort(splitters.begin(), splitters.end(), compare);
+  }
+
+  /**
+   * Picks the splitters at the quantiles of a sample of the keys, e.g. keys
+   * read from an existing container, so that the servers get even shares.
+   */
+  static OrderedPartitioner FromSample(std::vector<KeyType> sample,
+                                       uint16_t num_servers) {
+    std::vector<KeyType> splitters;
+    if (sample.empty()) return OrderedPartitioner(splitters);
+    std::sort(sample.begin(), sample.end(), Compare());
+    for (uint16_t server = 1; server < num_servers; ++server) {
+      splitters.push_back(sample[sample.size() * server / num_servers]);
+    }
+    return OrderedPartitioner(splitters);
+  }
+
+  uint16_t operator()(const KeyType &key) const {
+    auto iter =
+        std::upper_bound(splitters.begin(), splitters.end(), key, compare);
+    return static_cast<uint16_t>(iter - splitters.begin());
+  }
+};
+
+/**
+ * True for partitioners that map keys rather than hashes and preserve the key
+ * order across servers.
+ */
+template <typename Partitioner>
+struct is_ordered_partitioner : std::false_type {};
+
+template <typename KeyType, typename Compare>
+struct is_ordered_partitioner<OrderedPartitioner<KeyType, Compare>>
+    : std::true_type {};
+
+}  // namespace hcl
+
+#endif  // INCLUDE_HCL_COMMON_PARTITIONER_H_
@@ -36,6 +36,42 @@ void RPC::bind(CharStruct str, F func) {
 #endif
   }
 }
+inline RPC::Procedure RPC::define(CharStruct const &func_name) {
+  Procedure procedure;
+  procedure.name = func_name;
+  switch (HCL_CONF->RPC_IMPLEMENTATION) {
+#ifdef HCL_ENABLE_RPCLIB
+    case RPCLIB: {
+      break;
+    }
+#endif
+#ifdef HCL_ENABLE_THALLIUM_TCP
+    case THALLIUM_TCP:
+#endif
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+    case THALLIUM_ROCE:
+#endif
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+    {
+      procedure.thallium_procedure.emplace(
+          thallium_client->define(func_name.c_str()));
+      break;
+    }
+#endif
+  }
+  return procedure;
+}
+
+inline std::shared_ptr<RPC::Procedure> RPC::resolve(
+    CharStruct const &func_name) {
+  std::lock_guard<std::mutex> guard(procedure_mutex);
+  auto iter = procedures.find(func_name.string());
+  if (iter != procedures.end()) return iter->second;
+  auto procedure = std::make_shared<Procedure>(define(func_name));
+  procedures.emplace(func_name.string(), procedure);
+  return procedure;
+}
+
 template <typename Response, typename... Args>
 Response RPC::callWithTimeout(uint16_t server_index, int timeout_ms,
                               CharStruct const &func_name, Args... args) {
@@ -61,23 +97,18 @@ Response RPC::callWithTimeout(uint16_t server_index, int timeout_ms,
     }
 #endif
 #ifdef HCL_ENABLE_THALLIUM_TCP
-    case THALLIUM_TCP: {
-      tl::remote_procedure remote_procedure =
-          thallium_client->define(func_name.c_str());
-      // Setup args for RDMA bulk transfer
-      // std::vector<std::pair<void*,std::size_t>> segments(num_args);
-
-      return remote_procedure.on(thallium_endpoints[server_index])(
-          std::forward<Args>(args)...);
-      break;
-    }
+    case THALLIUM_TCP:
 #endif
 #ifdef HCL_ENABLE_THALLIUM_ROCE
-    case THALLIUM_ROCE: {
-      tl::remote_procedure remote_procedure =
-          thallium_client->define(func_name.c_str());
-      return remote_procedure.on(thallium_endpoints[server_index])(
-          std::forward<Args>(args)...);
+    case THALLIUM_ROCE:
+#endif
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+    {
+      // Setup args for RDMA bulk transfer
+      // std::vector<std::pair<void*,std::size_t>> segments(num_args);
+      return resolve(func_name)
+          ->thallium_procedure->on(thallium_endpoints[server_index])(
+              std::forward<Args>(args)...);
       break;
     }
 #endif
@@ -86,7 +117,14 @@ Response RPC::callWithTimeout(uint16_t server_index, int timeout_ms,
 template <typename Response, typename... Args>
 Response RPC::call(uint16_t server_index, CharStruct const &func_name,
                    Args... args) {
-  AutoTrace trace = AutoTrace("RPC::call", server_index, func_name);
+  return call<Response>(server_index, *resolve(func_name),
+                        std::forward<Args>(args)...);
+}
+
+template <typename Response, typename... Args>
+Response RPC::call(uint16_t server_index, Procedure const &procedure,
+                   Args... args) {
+  AutoTrace trace = AutoTrace("RPC::call", server_index, procedure.name);
   int16_t port = server_port + server_index;
 
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
@@ -100,25 +138,20 @@ Response RPC::call(uint16_t server_index, CharStruct const &func_name,
         client = rpclib_clients[server_index].get();
       }
       /*client.set_timeout(5000);*/
-      return client->call(func_name.c_str(), std::forward<Args>(args)...);
+      return client->call(procedure.name.c_str(), std::forward<Args>(args)...);
       break;
     }
 #endif
 #ifdef HCL_ENABLE_THALLIUM_TCP
-    case THALLIUM_TCP: {
-      tl::remote_procedure remote_procedure =
-          thallium_client->define(func_name.c_str());
-      return remote_procedure.on(thallium_endpoints[server_index])(
-          std::forward<Args>(args)...);
-      break;
-    }
+    case THALLIUM_TCP:
 #endif
 #ifdef HCL_ENABLE_THALLIUM_ROCE
-    case THALLIUM_ROCE: {
-      tl::remote_procedure remote_procedure =
-          thallium_client->define(func_name.c_str());
-      return remote_procedure.on(thallium_endpoints[server_index])(
-          std::forward<Args>(args)...);
+    case THALLIUM_ROCE:
+#endif
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+    {
+      return procedure.thallium_procedure->on(
+          thallium_endpoints[server_index])(std::forward<Args>(args)...);
       break;
     }
 #endif
@@ -139,20 +172,16 @@ Response RPC::call(CharStruct &server, uint16_t &port,
     }
 #endif
 #ifdef HCL_ENABLE_THALLIUM_TCP
-    case THALLIUM_TCP: {
-      tl::remote_procedure remote_procedure =
-          thallium_client->define(func_name.c_str());
-      auto end_point = get_endpoint(HCL_CONF->TCP_CONF, server, port);
-      return remote_procedure.on(end_point)(std::forward<Args>(args)...);
-      break;
-    }
+    case THALLIUM_TCP:
 #endif
 #ifdef HCL_ENABLE_THALLIUM_ROCE
-    case THALLIUM_ROCE: {
-      tl::remote_procedure remote_procedure =
-          thallium_client->define(func_name.c_str());
+    case THALLIUM_ROCE:
+#endif
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+    {
       auto end_point = get_endpoint(HCL_CONF->TCP_CONF, server, port);
-      return remote_procedure.on(end_point)(std::forward<Args>(args)...);
+      return resolve(func_name)->thallium_procedure->on(end_point)(
+          std::forward<Args>(args)...);
       break;
     }
 #endif
@@ -163,7 +192,15 @@ template <typename Response, typename... Args>
 std::future<Response> RPC::async_call(uint16_t server_index,
                                       CharStruct const &func_name,
                                       Args... args) {
-  AutoTrace trace = AutoTrace("RPC::call", server_index, func_name);
+  return async_call<Response>(server_index, *resolve(func_name),
+                              std::forward<Args>(args)...);
+}
+
+template <typename Response, typename... Args>
+std::future<Response> RPC::async_call(uint16_t server_index,
+                                      Procedure const &procedure,
+                                      Args... args) {
+  AutoTrace trace = AutoTrace("RPC::async_call", server_index, procedure.name);
   int16_t port = server_port + server_index;
 
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
@@ -177,19 +214,22 @@ std::future<Response> RPC::async_call(uint16_t server_index,
         client = rpclib_clients[server_index].get();
       }
       // client.set_timeout(5000);
-      return client->async_call(func_name.c_str(), std::forward<Args>(args)...);
+      return client->async_call(procedure.name.c_str(),
+                                std::forward<Args>(args)...);
       break;
     }
 #endif
 #ifdef HCL_ENABLE_THALLIUM_TCP
-    case THALLIUM_TCP: {
-      // TODO:NotImplemented error
-      break;
-    }
+    case THALLIUM_TCP:
 #endif
 #ifdef HCL_ENABLE_THALLIUM_ROCE
-    case THALLIUM_ROCE: {
-      // TODO:NotImplemented error
+    case THALLIUM_ROCE:
+#endif
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+    {
+      return thallium_future<Response>(
+          procedure.thallium_procedure->on(thallium_endpoints[server_index])
+              .async(std::forward<Args>(args)...));
       break;
     }
 #endif
@@ -212,14 +252,17 @@ std::future<Response> RPC::async_call(CharStruct &server, uint16_t &port,
     }
 #endif
 #ifdef HCL_ENABLE_THALLIUM_TCP
-    case THALLIUM_TCP: {
-      // TODO:NotImplemented error
-      break;
-    }
+    case THALLIUM_TCP:
 #endif
 #ifdef HCL_ENABLE_THALLIUM_ROCE
-    case THALLIUM_ROCE: {
-      // TODO:NotImplemented error
+    case THALLIUM_ROCE:
+#endif
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+    {
+      auto end_point = get_endpoint(HCL_CONF->TCP_CONF, server, port);
+      return thallium_future<Response>(
+          resolve(func_name)->thallium_procedure->on(end_point).async(
+              std::forward<Args>(args)...));
       break;
     }
 #endif
@@ -227,27 +270,70 @@ std::future<Response> RPC::async_call(CharStruct &server, uint16_t &port,
 }
 
 #ifdef HCL_ENABLE_THALLIUM_ROCE
-// These are still experimental for using RDMA bulk transfers
+/**
+ * Pulls the client's bulk into a new value sized to match it.
+ */
 template <typename MappedType>
 MappedType RPC::prep_rdma_server(tl::endpoint endpoint, tl::bulk &bulk_handle) {
-  // MappedType buffer;
-  std::string buffer;
-  buffer.resize(1000000, 'a');
-  std::vector<std::pair<void *, size_t>> segments(1);
-  segments[0].first = (void *)(&buffer[0]);
-  segments[0].second = 1000000 + 1;
-  tl::bulk local = thallium_server->expose(segments, tl::bulk_mode::write_only);
-  bulk_handle.on(endpoint) >> local;
+  MappedType buffer;
+  RDMABuffer<MappedType>::resize(buffer, bulk_handle.size());
+  pull_rdma(endpoint, bulk_handle, 0, buffer);
   return buffer;
 }
 
+/**
+ * Exposes the bytes of data in place. data must outlive the RPC that carries
+ * the returned handle.
+ */
+template <typename MappedType>
+tl::bulk RPC::prep_rdma_client(MappedType &data, tl::bulk_mode mode) {
+  std::vector<std::pair<void *, std::size_t>> segments(1);
+  segments[0].first = RDMABuffer<MappedType>::data(data);
+  segments[0].second = RDMABuffer<MappedType>::size(data);
+  return thallium_client->expose(segments, mode);
+}
+
+/**
+ * Exposes several values as the consecutive segments of one bulk handle.
+ */
+template <typename MappedType>
+tl::bulk RPC::prep_rdma_client_batch(std::vector<MappedType> &data,
+                                     tl::bulk_mode mode) {
+  std::vector<std::pair<void *, std::size_t>> segments;
+  segments.reserve(data.size());
+  for (auto &value : data) {
+    segments.emplace_back(RDMABuffer<MappedType>::data(value),
+                          RDMABuffer<MappedType>::size(value));
+  }
+  return thallium_client->expose(segments, mode);
+}
+
+/**
+ * Reads size(data) bytes at offset of the remote bulk into data.
+ */
+template <typename MappedType>
+size_t RPC::pull_rdma(tl::endpoint endpoint, tl::bulk &bulk_handle,
+                      size_t offset, MappedType &data) {
+  size_t size = RDMABuffer<MappedType>::size(data);
+  std::vector<std::pair<void *, std::size_t>> segments(1);
+  segments[0].first = RDMABuffer<MappedType>::data(data);
+  segments[0].second = size;
+  tl::bulk local = thallium_server->expose(segments, tl::bulk_mode::write_only);
+  return bulk_handle(offset, size).on(endpoint) >> local;
+}
+
+/**
+ * Writes the bytes of data to offset of the remote bulk.
+ */
 template <typename MappedType>
-tl::bulk RPC::prep_rdma_client(MappedType &data) {
-  MappedType my_buffer = data;
+size_t RPC::push_rdma(tl::endpoint endpoint, tl::bulk &bulk_handle,
+                      size_t offset, MappedType &data) {
+  size_t size = RDMABuffer<MappedType>::size(data);
   std::vector<std::pair<void *, std::size_t>> segments(1);
-  segments[0].first = (void *)&my_buffer[0];
-  segments[0].second = 1000000 + 1;
-  return thallium_client->expose(segments, tl::bulk_mode::read_only);
+  segments[0].first = RDMABuffer<MappedType>::data(data);
+  segments[0].second = size;
+  tl::bulk local = thallium_server->expose(segments, tl::bulk_mode::read_only);
+  return bulk_handle(offset, size).on(endpoint) << local;
 }
 #endif
 
@@ -67,7 +67,11 @@
 #include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -77,9 +81,23 @@ namespace tl = thallium;
 #endif
 
 class RPC {
+ public:
+  /**
+   * A remote function resolved once by name. Calls through a Procedure skip
+   * name construction and the backend registration lookup.
+   */
+  struct Procedure {
+    CharStruct name;
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+    std::optional<tl::remote_procedure> thallium_procedure;
+#endif
+  };
+
  private:
   uint16_t server_port;
   std::string name;
+  std::unordered_map<std::string, std::shared_ptr<Procedure>> procedures;
+  std::mutex procedure_mutex;
 #ifdef HCL_ENABLE_RPCLIB
   std::shared_ptr<rpc::server> rpclib_server;
   // We can't use a std::vector<rpc::client> for these since rpc::client is
@@ -114,6 +132,20 @@ class RPC {
     }
   }
 
+  /**
+   * Wraps an in-flight Thallium request into a std::future. The request is
+   * already on the wire when this returns; get() waits for the response and
+   * unpacks it as Response.
+   */
+  template <typename Response>
+  std::future<Response> thallium_future(tl::async_response &&request) {
+    auto response = std::make_shared<tl::async_response>(std::move(request));
+    return std::async(std::launch::deferred, [response]() -> Response {
+      Response result = response->wait();
+      return result;
+    });
+  }
+
   /*std::promise<void> thallium_exit_signal;
 
     void runThalliumServer(std::future<void> futureObj){
@@ -203,6 +235,18 @@ class RPC {
   template <typename F>
   void bind(CharStruct str, F func);
 
+  /**
+   * Defines func_name with the backend and returns a new handle to it. Nothing
+   * is cached; see resolve.
+   */
+  Procedure define(CharStruct const &func_name);
+
+  /**
+   * Returns the cached Procedure for func_name, defining it with the backend
+   * on first use.
+   */
+  std::shared_ptr<Procedure> resolve(CharStruct const &func_name);
+
   void run(size_t workers = RPC_THREADS) {
     AutoTrace trace = AutoTrace("RPC::run", workers);
     if (HCL_CONF->IS_SERVER) {
@@ -251,11 +295,29 @@ class RPC {
   }
 
 #ifdef HCL_ENABLE_THALLIUM_ROCE
+  /**
+   * RDMA bulk helpers. The client exposes the bytes of its values in place
+   * (see RDMABuffer) and passes the bulk handle as an RPC argument; the server
+   * then pulls from or pushes into that memory directly.
+   */
   template <typename MappedType>
   MappedType prep_rdma_server(tl::endpoint endpoint, tl::bulk &bulk_handle);
 
   template <typename MappedType>
-  tl::bulk prep_rdma_client(MappedType &data);
+  tl::bulk prep_rdma_client(MappedType &data,
+                            tl::bulk_mode mode = tl::bulk_mode::read_only);
+
+  template <typename MappedType>
+  tl::bulk prep_rdma_client_batch(std::vector<MappedType> &data,
+                                  tl::bulk_mode mode);
+
+  template <typename MappedType>
+  size_t pull_rdma(tl::endpoint endpoint, tl::bulk &bulk_handle, size_t offset,
+                   MappedType &data);
+
+  template <typename MappedType>
+  size_t push_rdma(tl::endpoint endpoint, tl::bulk &bulk_handle, size_t offset,
+                   MappedType &data);
 #endif
   /**
    * Response should be RPCLIB_MSGPACK::object_handle for rpclib and
@@ -264,6 +326,9 @@ class RPC {
   template <typename Response, typename... Args>
   Response call(uint16_t server_index, CharStruct const &func_name,
                 Args... args);
+  template <typename Response, typename... Args>
+  Response call(uint16_t server_index, Procedure const &procedure,
+                Args... args);
   /**
    * Response should be RPCLIB_MSGPACK::object_handle for rpclib and
    * tl::packed_response for thallium/mercury
@@ -274,14 +339,50 @@ class RPC {
   template <typename Response, typename... Args>
   Response callWithTimeout(uint16_t server_index, int timeout_ms,
                            CharStruct const &func_name, Args... args);
+  /**
+   * Issues the call without waiting for the response. Response should be
+   * RPCLIB_MSGPACK::object_handle for rpclib and the unpacked result type for
+   * thallium/mercury
+   */
   template <typename Response, typename... Args>
   std::future<Response> async_call(uint16_t server_index,
                                    CharStruct const &func_name, Args... args);
   template <typename Response, typename... Args>
+  std::future<Response> async_call(uint16_t server_index,
+                                   Procedure const &procedure, Args... args);
+  template <typename Response, typename... Args>
   std::future<Response> async_call(CharStruct &server, uint16_t &port,
                                    CharStruct const &func_name, Args... args);
 };
 
+/**
+ * Per-container cache of resolved procedures keyed by operation name, for the
+ * operations whose name is only known at call time.
+ */
+class ProcedureCache {
+ private:
+  std::unordered_map<std::string, std::shared_ptr<RPC::Procedure>> procedures;
+  std::shared_mutex mutex;
+
+ public:
+  template <typename Prefix>
+  RPC::Procedure const &get(RPC &rpc, Prefix const &prefix,
+                            const char *funcname) {
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      auto iter = procedures.find(funcname);
+      if (iter != procedures.end()) return *iter->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto iter = procedures.find(funcname);
+    if (iter == procedures.end()) {
+      CharStruct func_name(std::string(prefix.c_str()) + funcname);
+      iter = procedures.emplace(funcname, rpc.resolve(func_name)).first;
+    }
+    return *iter->second;
+  }
+};
+
 #include "rpc_lib.cpp"
 
 #endif  // INCLUDE_HCL_COMMUNICATION_RPC_LIB_H_
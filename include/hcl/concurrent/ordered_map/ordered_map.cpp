@@ -0,0 +1,90 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef INCLUDE_HCL_CONCURRENT_ORDERED_MAP_CPP_
+#define INCLUDE_HCL_CONCURRENT_ORDERED_MAP_CPP_
+template<typename KeyT,typename ValueT,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+bool concurrent_ordered_map<KeyT,ValueT,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::Put(KeyT &key,ValueT &value)
+{
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  if(isLocal(key)) return LocalPut(key,value);
+  AutoTrace trace = AutoTrace("hcl::concurrent_ordered_map::Put(remote)", key, value);
+  return RPC_CALL_WRAPPER(remote.put, key_int, bool, key, value);
+}
+
+template<typename KeyT,typename ValueT,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::pair<bool,ValueT> concurrent_ordered_map<KeyT,ValueT,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::Get(KeyT &key)
+{
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  if(isLocal(key)) return LocalGet(key);
+  AutoTrace trace = AutoTrace("hcl::concurrent_ordered_map::Get(remote)", key);
+  typedef std::pair<bool,ValueT> ret_type;
+  return RPC_CALL_WRAPPER(remote.get, key_int, ret_type, key);
+}
+
+template<typename KeyT,typename ValueT,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+bool concurrent_ordered_map<KeyT,ValueT,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::Erase(KeyT &key)
+{
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  if(isLocal(key)) return LocalErase(key);
+  AutoTrace trace = AutoTrace("hcl::concurrent_ordered_map::Erase(remote)", key);
+  return RPC_CALL_WRAPPER(remote.erase, key_int, bool, key);
+}
+
+template<typename KeyT,typename ValueT,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+bool concurrent_ordered_map<KeyT,ValueT,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::Update(KeyT &key,ValueT &value)
+{
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  if(isLocal(key)) return LocalUpdate(key,value);
+  AutoTrace trace = AutoTrace("hcl::concurrent_ordered_map::Update(remote)", key, value);
+  return RPC_CALL_WRAPPER(remote.update, key_int, bool, key, value);
+}
+
+/*The request of a local server is deferred until its result is read, so that it runs while the remote requests are in flight*/
+template<typename KeyT,typename ValueT,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::future<std::vector<typename concurrent_ordered_map<KeyT,ValueT,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::entry_type>>
+concurrent_ordered_map<KeyT,ValueT,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::AsyncRangeScan(uint16_t server,KeyT &lo,KeyT &hi,uint32_t limit)
+{
+  if(isLocalServer(server))
+    return std::async(std::launch::deferred,[this,lo,hi,limit]() mutable { return LocalRangeScan(lo,hi,limit); });
+  typedef std::vector<entry_type> ret_type;
+  return RPC_CALL_WRAPPER_ASYNC(remote.range_scan, server, ret_type, lo, hi, limit);
+}
+
+/*Up to limit pairs with keys in [lo, hi], in key order. With an ordered partitioner only the servers whose ranges meet [lo, hi] are asked, one after another, each for the pairs still missing; otherwise every server is asked for limit pairs and the results are merged*/
+template<typename KeyT,typename ValueT,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::vector<typename concurrent_ordered_map<KeyT,ValueT,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::entry_type>
+concurrent_ordered_map<KeyT,ValueT,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::RangeScan(KeyT &lo,KeyT &hi,uint32_t limit)
+{
+  AutoTrace trace = AutoTrace("hcl::concurrent_ordered_map::RangeScan(remote)", lo, hi, limit);
+  std::vector<entry_type> entries;
+  if(Comp()(hi,lo) || limit == 0) return entries;
+  if constexpr (is_ordered_partitioner<Partitioner>::value)
+  {
+    uint32_t last = serverLocation(hi);
+    for(uint32_t i=serverLocation(lo);i<=last && entries.size() < limit;i++)
+    {
+      std::vector<entry_type> part = AsyncRangeScan(i,lo,hi,limit-entries.size()).get();
+      entries.insert(entries.end(),std::make_move_iterator(part.begin()),std::make_move_iterator(part.end()));
+    }
+    return entries;
+  }
+  std::vector<std::future<std::vector<entry_type>>> futures;
+  for(uint32_t i=0;i<nservers;i++) futures.push_back(AsyncRangeScan(i,lo,hi,limit));
+  std::vector<std::vector<entry_type>> runs;
+  for(auto &future : futures) runs.push_back(future.get());
+  entries = merge_runs(runs,EntryComp());
+  if(entries.size() > limit) entries.resize(limit);
+  return entries;
+}
+
+#endif
@@ -0,0 +1,296 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef INCLUDE_HCL_CONCURRENT_ORDERED_MAP_H_
+#define INCLUDE_HCL_CONCURRENT_ORDERED_MAP_H_
+
+/**
+ * Include Headers
+ */
+
+#include <hcl/common/debug.h>
+#include <hcl/common/singleton.h>
+#include <hcl/communication/rpc_factory.h>
+#include <hcl/communication/rpc_lib.h>
+/** MPI Headers**/
+#include <mpi.h>
+/** RPC Lib Headers**/
+#ifdef HCL_ENABLE_RPCLIB
+
+#include <rpc/client.h>
+#include <rpc/rpc_error.h>
+#include <rpc/server.h>
+
+#endif
+/** Thallium Headers **/
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+#include <thallium.hpp>
+#endif
+
+/** Boost Headers **/
+#include <boost/algorithm/string.hpp>
+/** Standard C++ Headers**/
+#include <hcl/common/container.h>
+#include <hcl/common/partitioner.h>
+
+#include <climits>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../base/containers/concurrent_skiplist/skip_list.h"
+
+/*This file contains the class that implements a distributed concurrent ordered map. Each server keeps its key/value pairs in a concurrent skiplist whose nodes hold a pair and are ordered by the key alone. Keys are partitioned across servers like those of concurrent_skiplist: by the upper log(n) bits of the hash by default, or in contiguous key ranges with Partitioner=OrderedPartitioner, in which case RangeScan asks only the servers owning the range. Lookups find the node without locks, as in the skiplist, and then read or replace the value under the lock of that node alone, so operations on different keys of a server do not contend. A client program should locate the server for its key and make RPC calls to it for performing map operations.*/
+
+namespace hcl {
+
+template <class KeyT,
+	 class ValueT,
+	 class HashFcn = std::hash<KeyT>,
+	 class Comp = std::less<KeyT>,
+	 class NodeAlloc = std::allocator<char>,
+	 int MAX_HEIGHT = 24,
+	 class Partitioner = HighBitsPartitioner>
+class concurrent_ordered_map : public container
+{
+  public:
+	typedef std::pair<KeyT,ValueT> entry_type;
+
+	/*Orders entries by key*/
+	struct EntryComp
+	{
+	    bool operator()(const entry_type &a,const entry_type &b) const
+	    {
+		return Comp()(a.first,b.first);
+	    }
+	};
+
+  private:
+	typedef ConcurrentSkipList<entry_type,EntryComp,NodeAlloc,MAX_HEIGHT> SkipListType;
+	typedef typename SkipListType::Accessor SkipListAccessor;
+	typedef typename SkipListType::Skipper SkipListSkipper;
+
+	uint32_t nservers;
+	uint32_t serverid;
+	Partitioner partitioner;
+	SkipListType *s;
+	SkipListAccessor *a;
+	/* Handles of the remote operations, resolved by the constructor */
+	struct {
+	    RPC::Procedure put, get, erase, update, range_scan;
+	} remote;
+
+	bool isLocalServer(uint16_t server)
+	{
+	   return is_server && server == serverid;
+	}
+
+	std::future<std::vector<entry_type>> AsyncRangeScan(uint16_t server,KeyT &lo,KeyT &hi,uint32_t limit);
+  public:
+
+	/*Ordered partitioners see the key itself, the others its hash*/
+	uint64_t serverLocation(KeyT &k)
+	{
+	    if constexpr (is_ordered_partitioner<Partitioner>::value) return partitioner(k);
+	    else return partitioner(HashFcn()(k));
+	}
+
+	bool isLocal(KeyT &k)
+	{
+	   if(is_server && serverLocation(k)==serverid) return true;
+	   else return false;
+	}
+
+	void initialize_maps(uint32_t np,uint32_t rank)
+	{
+	    initialize_maps(np,rank,Partitioner(np));
+	}
+
+	/*Clients and servers must pass the same partitioner*/
+	void initialize_maps(uint32_t np,uint32_t rank,Partitioner p)
+	{
+	    nservers = np;
+	    serverid = rank;
+	    partitioner = p;
+
+	    s = nullptr; a = nullptr;
+	    if(is_server)
+	    {
+		s = new SkipListType(2);
+		a = new SkipListAccessor(s);
+	    }
+	}
+	~concurrent_ordered_map()
+	{
+	   if(a != nullptr) delete a;
+	   if(s != nullptr) delete s;
+	}
+
+	void construct_shared_memory() override
+	{
+
+	}
+	void open_shared_memory() override
+	{
+
+	}
+	void bind_functions() override
+	{
+	  switch (HCL_CONF->RPC_IMPLEMENTATION) {
+#ifdef HCL_ENABLE_RPCLIB
+	  case RPCLIB: {
+	    std::function<bool(KeyT &,ValueT &)> putFunc(
+	    std::bind(&concurrent_ordered_map::LocalPut, this,std::placeholders::_1,std::placeholders::_2));
+	    std::function<std::pair<bool,ValueT>(KeyT &)> getFunc(
+	    std::bind(&concurrent_ordered_map::LocalGet, this,std::placeholders::_1));
+	    std::function<bool(KeyT &)> eraseFunc(
+	    std::bind(&concurrent_ordered_map::LocalErase, this,std::placeholders::_1));
+	    std::function<bool(KeyT &,ValueT &)> updateFunc(
+	    std::bind(&concurrent_ordered_map::LocalUpdate, this,std::placeholders::_1,std::placeholders::_2));
+	    std::function<std::vector<entry_type>(KeyT &,KeyT &,uint32_t)> rangeScanFunc(
+	    std::bind(&concurrent_ordered_map::LocalRangeScan, this,
+		      std::placeholders::_1,std::placeholders::_2,std::placeholders::_3));
+
+	    rpc->bind(func_prefix + "_Put", putFunc);
+	    rpc->bind(func_prefix + "_Get", getFunc);
+	    rpc->bind(func_prefix + "_Erase", eraseFunc);
+	    rpc->bind(func_prefix + "_Update", updateFunc);
+	    rpc->bind(func_prefix + "_RangeScan", rangeScanFunc);
+	    break;
+	  }
+#endif
+#ifdef HCL_ENABLE_THALLIUM_TCP
+	  case THALLIUM_TCP:
+#endif
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+	  case THALLIUM_ROCE:
+#endif
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+	  {
+	    std::function<void(const tl::request &,KeyT &,ValueT &)> putFunc(
+	    std::bind(&concurrent_ordered_map::ThalliumLocalPut,
+		      this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+	    std::function<void(const tl::request &,KeyT &)> getFunc(
+	    std::bind(&concurrent_ordered_map::ThalliumLocalGet,
+		      this, std::placeholders::_1, std::placeholders::_2));
+	    std::function<void(const tl::request &,KeyT &)> eraseFunc(
+	    std::bind(&concurrent_ordered_map::ThalliumLocalErase,
+		      this, std::placeholders::_1, std::placeholders::_2));
+	    std::function<void(const tl::request &,KeyT &,ValueT &)> updateFunc(
+	    std::bind(&concurrent_ordered_map::ThalliumLocalUpdate,
+		      this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+	    std::function<void(const tl::request &,KeyT &,KeyT &,uint32_t)> rangeScanFunc(
+	    std::bind(&concurrent_ordered_map::ThalliumLocalRangeScan,
+		      this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+
+	    rpc->bind(func_prefix + "_Put", putFunc);
+	    rpc->bind(func_prefix + "_Get", getFunc);
+	    rpc->bind(func_prefix + "_Erase", eraseFunc);
+	    rpc->bind(func_prefix + "_Update", updateFunc);
+	    rpc->bind(func_prefix + "_RangeScan", rangeScanFunc);
+	    break;
+	  }
+#endif
+	  }
+	}
+
+	explicit concurrent_ordered_map(CharStruct name_ = "TEST_CONCURRENT_ORDERED_MAP",uint16_t port = HCL_CONF->RPC_PORT)
+	  : container(name_, port)
+	{
+	    a = nullptr;
+	    s = nullptr;
+	    AutoTrace trace = AutoTrace("hcl::concurrent_ordered_map");
+	    remote.put = resolve("_Put");
+	    remote.get = resolve("_Get");
+	    remote.erase = resolve("_Erase");
+	    remote.update = resolve("_Update");
+	    remote.range_scan = resolve("_RangeScan");
+	    if(is_server)
+	    {
+		bind_functions();
+	    }
+	}
+
+	SkipListType *data()
+	{
+	    return s;
+	}
+
+	/*Inserts k with v, or replaces the value of k. A key that is being erased is put again once it is gone*/
+	bool LocalPut(KeyT &k,ValueT &v)
+	{
+	    entry_type entry(k,v);
+	    while(true)
+	    {
+		if(a->add(entry)) return true;
+		if(a->apply(entry,[&v](entry_type &e) { e.second = v; })) return true;
+	    }
+	}
+	std::pair<bool,ValueT> LocalGet(KeyT &k)
+	{
+	    std::pair<bool,ValueT> result(false,ValueT());
+	    entry_type entry(k,ValueT());
+	    result.first = a->apply(entry,[&result](entry_type &e) { result.second = e.second; });
+	    return result;
+	}
+	bool LocalErase(KeyT &k)
+	{
+	    entry_type entry(k,ValueT());
+	    return a->remove(entry);
+	}
+	/*Replaces the value of k only if k is present*/
+	bool LocalUpdate(KeyT &k,ValueT &v)
+	{
+	    entry_type entry(k,ValueT());
+	    return a->apply(entry,[&v](entry_type &e) { e.second = v; });
+	}
+	/*Up to limit pairs of this server with keys in [lo, hi], in key order*/
+	std::vector<entry_type> LocalRangeScan(KeyT &lo,KeyT &hi,uint32_t limit)
+	{
+	    std::vector<entry_type> entries;
+	    entry_type from(lo,ValueT());
+	    auto g = a->guard();
+	    SkipListSkipper sk(*a);
+	    sk.to(from);
+	    for(;sk.good() && entries.size() < limit && !Comp()(hi,sk.data().first);++sk)
+	    {
+		sk.apply([&entries](entry_type &e) { entries.push_back(e); });
+	    }
+	    return entries;
+	}
+	size_t LocalSize()
+	{
+	    return a->size();
+	}
+
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+    THALLIUM_DEFINE(LocalPut, (k,v), KeyT& k, ValueT& v)
+    THALLIUM_DEFINE(LocalGet, (k), KeyT& k)
+    THALLIUM_DEFINE(LocalErase, (k), KeyT& k)
+    THALLIUM_DEFINE(LocalUpdate, (k,v), KeyT& k, ValueT& v)
+    THALLIUM_DEFINE(LocalRangeScan, (lo, hi, limit), KeyT& lo, KeyT& hi, uint32_t limit)
+#endif
+
+   bool Put(KeyT& k,ValueT& v);
+   std::pair<bool,ValueT> Get(KeyT& k);
+   bool Erase(KeyT& k);
+   bool Update(KeyT& k,ValueT& v);
+   std::vector<entry_type> RangeScan(KeyT& lo,KeyT& hi,uint32_t limit = UINT32_MAX);
+
+};
+#include "ordered_map.cpp"
+}
+
+#endif
@@ -13,21 +13,66 @@
 #ifndef INCLUDE_HCL_CONCURRENT_QUEUE_CPP_
 #define INCLUDE_HCL_CONCURRENT_QUEUE_CPP_
 
-template <typename ValueT>
-bool concurrent_queue<ValueT>::Push(uint64_t& s, ValueT &data) 
+template <typename ValueT,typename QueueType>
+bool concurrent_queue<ValueT,QueueType>::Push(uint64_t& s, ValueT &data) 
 {
   uint16_t key_int = static_cast<uint16_t>(s);
   AutoTrace trace = AutoTrace("hcl::concurrent_queue::Push(remote)", data);
-  return RPC_CALL_WRAPPER("_Push", key_int,bool,data);
+  return RPC_CALL_WRAPPER(remote.push, key_int,bool,data);
 }
 
-template <typename ValueT>
-std::pair<bool,ValueT> concurrent_queue<ValueT>::Pop(uint64_t &s) 
+template <typename ValueT,typename QueueType>
+std::pair<bool,ValueT> concurrent_queue<ValueT,QueueType>::Pop(uint64_t &s) 
 {
   uint16_t key_int = static_cast<uint16_t>(s);
   AutoTrace trace = AutoTrace("hcl::concurrent_queue::Pop(remote)");
   typedef std::pair<bool,ValueT> ret_type;
-  return RPC_CALL_WRAPPER1("_Pop", key_int,ret_type);
+  return RPC_CALL_WRAPPER1(remote.pop, key_int,ret_type);
+}
+
+template <typename ValueT,typename QueueType>
+bool concurrent_queue<ValueT,QueueType>::TryPush(uint64_t& s, ValueT &data) 
+{
+  uint16_t key_int = static_cast<uint16_t>(s);
+  AutoTrace trace = AutoTrace("hcl::concurrent_queue::TryPush(remote)", data);
+  return RPC_CALL_WRAPPER(remote.try_push, key_int,bool,data);
+}
+
+/*One RPC for the whole batch; returns how many of the values, from the front, were pushed*/
+template <typename ValueT,typename QueueType>
+uint32_t concurrent_queue<ValueT,QueueType>::PushBatch(uint64_t& s, std::vector<ValueT> &values) 
+{
+  uint16_t key_int = static_cast<uint16_t>(s);
+  AutoTrace trace = AutoTrace("hcl::concurrent_queue::PushBatch(remote)", values.size());
+  return RPC_CALL_WRAPPER(remote.push_batch, key_int,uint32_t,values);
+}
+
+template <typename ValueT,typename QueueType>
+std::vector<ValueT> concurrent_queue<ValueT,QueueType>::PopBatch(uint64_t& s, uint32_t max_n) 
+{
+  uint16_t key_int = static_cast<uint16_t>(s);
+  AutoTrace trace = AutoTrace("hcl::concurrent_queue::PopBatch(remote)", max_n);
+  typedef std::vector<ValueT> ret_type;
+  return RPC_CALL_WRAPPER(remote.pop_batch, key_int,ret_type,max_n);
+}
+
+template <typename ValueT,typename QueueType>
+bool concurrent_queue<ValueT,QueueType>::BlockingPush(uint64_t& s, ValueT &data, uint32_t timeout_ms) 
+{
+  uint16_t key_int = static_cast<uint16_t>(s);
+  AutoTrace trace = AutoTrace("hcl::concurrent_queue::BlockingPush(remote)", data, timeout_ms);
+  require_waiting_threads();
+  return RPC_CALL_WRAPPER(remote.blocking_push, key_int,bool,data,timeout_ms);
+}
+
+template <typename ValueT,typename QueueType>
+std::pair<bool,ValueT> concurrent_queue<ValueT,QueueType>::BlockingPop(uint64_t &s, uint32_t timeout_ms) 
+{
+  uint16_t key_int = static_cast<uint16_t>(s);
+  AutoTrace trace = AutoTrace("hcl::concurrent_queue::BlockingPop(remote)", timeout_ms);
+  require_waiting_threads();
+  typedef std::pair<bool,ValueT> ret_type;
+  return RPC_CALL_WRAPPER(remote.blocking_pop, key_int,ret_type,timeout_ms);
 }
 
 #endif  
@@ -42,27 +42,123 @@
 /** Standard C++ Headers**/
 #include <hcl/common/container.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 #include <float.h>
+#include "../../base/containers/concurrent_queue/ring_buffer.h"
 
-/*This file contains the class that implements a distributed queue, distributed across all servers. A client can choose any of the servers and make an RPC call to perform queue operations.*/
+/*This file contains the class that implements a distributed queue, distributed across all servers. A client can choose any of the servers and make an RPC call to perform queue operations. By default each server keeps a boost::lockfree::queue, which grows a node at a time and needs trivially copyable values. With QueueType=RingBuffer<ValueT> it keeps a bounded ring of HCL_CONF->QUEUE_CAPACITY cells instead: pushes to a full ring fail, batches take one CAS per run of cells, and any copyable value works. The Blocking operations wait on the server, up to a timeout, until the queue has room or values. With Thallium they wait on Argobots primitives, which yield the handler's execution stream to other requests; with rpclib each waiting handler holds a server thread, so BlockingPush and BlockingPop throw std::invalid_argument unless HCL_CONF->RPC_THREADS > 1.*/
 
 namespace hcl {
 
-template <class ValueT>
+template <class ValueT,class QueueType = boost::lockfree::queue<ValueT>>
 class concurrent_queue : public container 
 {
 
 public:
-	typedef boost::lockfree::queue<ValueT> 	queue_type;
+	typedef QueueType 	queue_type;
 private:
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+	/*The handlers run as Argobots threads, which must not block their execution stream*/
+	typedef tl::mutex wait_mutex_type;
+	typedef tl::condition_variable wait_cv_type;
+#else
+	typedef std::mutex wait_mutex_type;
+	typedef std::condition_variable wait_cv_type;
+#endif
 	queue_type *queue;
+	wait_mutex_type wait_mutex;
+	wait_cv_type not_empty;
+	wait_cv_type not_full;
+	std::atomic<uint32_t> pop_waiters;
+	std::atomic<uint32_t> push_waiters;
+	/* Handles of the remote operations, resolved by the constructor */
+	struct {
+	    RPC::Procedure push, pop, try_push, push_batch, pop_batch, blocking_push, blocking_pop;
+	} remote;
+
+	/*Wakes the threads waiting on cv, if any. A waiter registers before its last attempt under wait_mutex, so taking the mutex here cannot slip between that attempt and its wait*/
+	void notify(std::atomic<uint32_t> &waiters,wait_cv_type &cv)
+	{
+	    std::atomic_thread_fence(std::memory_order_seq_cst);
+	    if(waiters.load(std::memory_order_relaxed) == 0) return;
+	    {
+		std::lock_guard<wait_mutex_type> lock(wait_mutex);
+	    }
+	    cv.notify_all();
+	}
+
+	/*An rpclib handler that waits holds a server thread, so with a single one no push could reach a waiting pop*/
+	static void require_waiting_threads()
+	{
+#ifdef HCL_ENABLE_RPCLIB
+	    if(HCL_CONF->RPC_IMPLEMENTATION == RPCLIB && HCL_CONF->RPC_THREADS <= 1)
+		throw std::invalid_argument("hcl::concurrent_queue Blocking operations need RPC_THREADS > 1 with rpclib");
+#endif
+	}
+
+	/*Sleeps on cv until it is notified or deadline passes; false on timeout*/
+	static bool wait_until(wait_cv_type &cv,std::unique_lock<wait_mutex_type> &lock,std::chrono::system_clock::time_point deadline)
+	{
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+	    auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+	    struct timespec abstime;
+	    abstime.tv_sec = since_epoch / 1000000000;
+	    abstime.tv_nsec = since_epoch % 1000000000;
+	    return cv.wait_until(lock,&abstime);
+#else
+	    return cv.wait_until(lock,deadline) == std::cv_status::no_timeout;
+#endif
+	}
+
+	/*Retries attempt until it succeeds or timeout_ms pass, sleeping on cv in between*/
+	template <typename Fn>
+	bool wait_for(std::atomic<uint32_t> &waiters,wait_cv_type &cv,uint32_t timeout_ms,Fn attempt)
+	{
+	    if(attempt()) return true;
+	    auto deadline = std::chrono::system_clock::now()+std::chrono::milliseconds(timeout_ms);
+	    std::unique_lock<wait_mutex_type> lock(wait_mutex);
+	    waiters.fetch_add(1);
+	    bool done = attempt();
+	    while(!done && wait_until(cv,lock,deadline)) done = attempt();
+	    if(!done) done = attempt();
+	    waiters.fetch_sub(1);
+	    return done;
+	}
+
+	bool push_one(ValueT &v)
+	{
+	    if(!queue->push(v)) return false;
+	    notify(pop_waiters,not_empty);
+	    return true;
+	}
+
+	bool try_push_one(ValueT &v)
+	{
+	    bool b;
+	    if constexpr (is_ring_buffer<queue_type>::value) b = queue->push(v);
+	    else b = queue->bounded_push(v);
+	    if(b) notify(pop_waiters,not_empty);
+	    return b;
+	}
+
+	bool pop_one(ValueT &v)
+	{
+	    if(!queue->pop(v)) return false;
+	    notify(push_waiters,not_full);
+	    return true;
+	}
 
 
  public:
@@ -86,13 +182,33 @@ private:
 #ifdef HCL_ENABLE_RPCLIB
       case RPCLIB: {
         std::function<bool(ValueT &)> pushFunc(
-            std::bind(&concurrent_queue<ValueT>::LocalPush, this,
+            std::bind(&concurrent_queue::LocalPush, this,
                       std::placeholders::_1));
         std::function<std::pair<bool,ValueT>(void)> popFunc(
-            std::bind(&concurrent_queue<ValueT>::LocalPop, this));
+            std::bind(&concurrent_queue::LocalPop, this));
+        std::function<bool(ValueT &)> tryPushFunc(
+            std::bind(&concurrent_queue::LocalTryPush, this,
+                      std::placeholders::_1));
+        std::function<uint32_t(std::vector<ValueT> &)> pushBatchFunc(
+            std::bind(&concurrent_queue::LocalPushBatch, this,
+                      std::placeholders::_1));
+        std::function<std::vector<ValueT>(uint32_t)> popBatchFunc(
+            std::bind(&concurrent_queue::LocalPopBatch, this,
+                      std::placeholders::_1));
+        std::function<bool(ValueT &,uint32_t)> blockingPushFunc(
+            std::bind(&concurrent_queue::LocalBlockingPush, this,
+                      std::placeholders::_1,std::placeholders::_2));
+        std::function<std::pair<bool,ValueT>(uint32_t)> blockingPopFunc(
+            std::bind(&concurrent_queue::LocalBlockingPop, this,
+                      std::placeholders::_1));
 
         rpc->bind(func_prefix + "_Push", pushFunc);
         rpc->bind(func_prefix + "_Pop", popFunc);
+        rpc->bind(func_prefix + "_TryPush", tryPushFunc);
+        rpc->bind(func_prefix + "_PushBatch", pushBatchFunc);
+        rpc->bind(func_prefix + "_PopBatch", popBatchFunc);
+        rpc->bind(func_prefix + "_BlockingPush", blockingPushFunc);
+        rpc->bind(func_prefix + "_BlockingPop", blockingPopFunc);
         break;
       }
 #endif
@@ -106,14 +222,34 @@ private:
       {
 
         std::function<void(const tl::request &, ValueT &)> pushFunc(
-	   std::bind(&concurrent_queue<ValueT>::ThalliumLocalPush,
+	   std::bind(&concurrent_queue::ThalliumLocalPush,
            this, std::placeholders::_1,std::placeholders::_2));
         std::function<void(const tl::request &)> popFunc(
-            std::bind(&concurrent_queue<ValueT>::ThalliumLocalPop,
+            std::bind(&concurrent_queue::ThalliumLocalPop,
                       this, std::placeholders::_1));
+        std::function<void(const tl::request &, ValueT &)> tryPushFunc(
+            std::bind(&concurrent_queue::ThalliumLocalTryPush,
+                      this, std::placeholders::_1,std::placeholders::_2));
+        std::function<void(const tl::request &, std::vector<ValueT> &)> pushBatchFunc(
+            std::bind(&concurrent_queue::ThalliumLocalPushBatch,
+                      this, std::placeholders::_1,std::placeholders::_2));
+        std::function<void(const tl::request &, uint32_t)> popBatchFunc(
+            std::bind(&concurrent_queue::ThalliumLocalPopBatch,
+                      this, std::placeholders::_1,std::placeholders::_2));
+        std::function<void(const tl::request &, ValueT &, uint32_t)> blockingPushFunc(
+            std::bind(&concurrent_queue::ThalliumLocalBlockingPush,
+                      this, std::placeholders::_1,std::placeholders::_2,std::placeholders::_3));
+        std::function<void(const tl::request &, uint32_t)> blockingPopFunc(
+            std::bind(&concurrent_queue::ThalliumLocalBlockingPop,
+                      this, std::placeholders::_1,std::placeholders::_2));
 
         rpc->bind(func_prefix + "_Push", pushFunc);
         rpc->bind(func_prefix + "_Pop", popFunc);
+        rpc->bind(func_prefix + "_TryPush", tryPushFunc);
+        rpc->bind(func_prefix + "_PushBatch", pushBatchFunc);
+        rpc->bind(func_prefix + "_PopBatch", popBatchFunc);
+        rpc->bind(func_prefix + "_BlockingPush", blockingPushFunc);
+        rpc->bind(func_prefix + "_BlockingPop", blockingPopFunc);
         break;
       }
 #endif
@@ -121,13 +257,21 @@ private:
   }
 
   explicit concurrent_queue(CharStruct name_ = "TEST_CONCURRENT_QUEUE",uint16_t port = HCL_CONF->RPC_PORT)
-      : container(name_, port)
+      : container(name_, port), pop_waiters(0), push_waiters(0)
   {
     queue = nullptr;
     AutoTrace trace = AutoTrace("hcl::concurrent_queue");
+    remote.push = resolve("_Push");
+    remote.pop = resolve("_Pop");
+    remote.try_push = resolve("_TryPush");
+    remote.push_batch = resolve("_PushBatch");
+    remote.pop_batch = resolve("_PopBatch");
+    remote.blocking_push = resolve("_BlockingPush");
+    remote.blocking_pop = resolve("_BlockingPop");
     if (is_server) 
     {
-      queue = new queue_type (128);
+      if constexpr (is_ring_buffer<queue_type>::value) queue = new queue_type (HCL_CONF->QUEUE_CAPACITY);
+      else queue = new queue_type (128);
       bind_functions();
     } 
     else if (!is_server && server_on_node) 
@@ -140,14 +284,55 @@ private:
      return queue;
   }
 
+  /*A RingBuffer fails when full; the boost queue allocates a node instead*/
   bool LocalPush(ValueT &v)
   {
-     return queue->push(v);
+     return push_one(v);
   }
   std::pair<bool,ValueT> LocalPop()
   {
       ValueT v;
-      bool b = queue->pop(v);
+      bool b = pop_one(v);
+      if(b) return std::pair<bool,ValueT> (true,v);
+      else return std::pair<bool,ValueT> (false,ValueT());
+  }
+  /*Never allocates: false when the queue is full, or for the boost queue when its preallocated nodes are used up*/
+  bool LocalTryPush(ValueT &v)
+  {
+     return try_push_one(v);
+  }
+  /*Pushes a prefix of values and returns its length, short only when the queue filled up*/
+  uint32_t LocalPushBatch(std::vector<ValueT> &values)
+  {
+      uint32_t pushed = 0;
+      if constexpr (is_ring_buffer<queue_type>::value) pushed = queue->push_bulk(values.data(),values.size());
+      else while(pushed < values.size() && queue->push(values[pushed])) pushed++;
+      if(pushed > 0) notify(pop_waiters,not_empty);
+      return pushed;
+  }
+  /*Up to max_n values, in queue order*/
+  std::vector<ValueT> LocalPopBatch(uint32_t max_n)
+  {
+      std::vector<ValueT> values;
+      if constexpr (is_ring_buffer<queue_type>::value) queue->pop_bulk(values,max_n);
+      else
+      {
+	  ValueT v;
+	  while(values.size() < max_n && queue->pop(v)) values.push_back(v);
+      }
+      if(!values.empty()) notify(push_waiters,not_full);
+      return values;
+  }
+  /*Waits up to timeout_ms for room in a full queue*/
+  bool LocalBlockingPush(ValueT &v,uint32_t timeout_ms)
+  {
+      return wait_for(push_waiters,not_full,timeout_ms,[&]() { return try_push_one(v); });
+  }
+  /*Waits up to timeout_ms for a value*/
+  std::pair<bool,ValueT> LocalBlockingPop(uint32_t timeout_ms)
+  {
+      ValueT v;
+      bool b = wait_for(pop_waiters,not_empty,timeout_ms,[&]() { return pop_one(v); });
       if(b) return std::pair<bool,ValueT> (true,v);
       else return std::pair<bool,ValueT> (false,ValueT());
   }
@@ -155,10 +340,20 @@ private:
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
   THALLIUM_DEFINE(LocalPush, (v), ValueT& v)
   THALLIUM_DEFINE1(LocalPop)
+  THALLIUM_DEFINE(LocalTryPush, (v), ValueT& v)
+  THALLIUM_DEFINE(LocalPushBatch, (values), std::vector<ValueT>& values)
+  THALLIUM_DEFINE(LocalPopBatch, (max_n), uint32_t max_n)
+  THALLIUM_DEFINE(LocalBlockingPush, (v, timeout_ms), ValueT& v, uint32_t timeout_ms)
+  THALLIUM_DEFINE(LocalBlockingPop, (timeout_ms), uint32_t timeout_ms)
 #endif
 
    bool Push(uint64_t &s,ValueT& v);
    std::pair<bool,ValueT> Pop(uint64_t &s);
+   bool TryPush(uint64_t &s,ValueT& v);
+   uint32_t PushBatch(uint64_t &s,std::vector<ValueT>& values);
+   std::vector<ValueT> PopBatch(uint64_t &s,uint32_t max_n);
+   bool BlockingPush(uint64_t &s,ValueT& v,uint32_t timeout_ms);
+   std::pair<bool,ValueT> BlockingPop(uint64_t &s,uint32_t timeout_ms);
 
 };
 
@@ -12,28 +12,153 @@
 
 #ifndef INCLUDE_HCL_CONCURRENT_SKIPLIST_CPP_
 #define INCLUDE_HCL_CONCURRENT_SKIPLIST_CPP_
-template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT>
-bool concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT>::Insert(T &key)
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+bool concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::Insert(T &key)
 {
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   AutoTrace trace = AutoTrace("hcl::concurrent_skiplist::Insert(remote)", key);
-  return RPC_CALL_WRAPPER("_Insert", key_int,bool, key);
+  return RPC_CALL_WRAPPER(remote.insert, key_int,bool, key);
 }
 
-template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT>
-bool concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT>::Find(T &key)
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+bool concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::Find(T &key)
 {
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   AutoTrace trace = AutoTrace("hcl::concurrent_skiplist::Find(remote)", key);
-  return RPC_CALL_WRAPPER("_Find", key_int,bool, key);
+  return RPC_CALL_WRAPPER(remote.find, key_int,bool, key);
 }
 
-template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT>
-bool concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT>::Erase(T &key)
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+bool concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::Erase(T &key)
 {
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   AutoTrace trace = AutoTrace("hcl::concurrent_skiplist::Erase(remote)", key);
-  return RPC_CALL_WRAPPER("_Erase", key_int,bool, key);
+  return RPC_CALL_WRAPPER(remote.erase, key_int,bool, key);
+}
+
+/*The requests of one server. The request of a local server is deferred until its result is read, so that it runs while the remote requests are in flight*/
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::future<std::pair<bool,T>> concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::AsyncLowerBound(uint16_t server,T &key)
+{
+  if(isLocalServer(server))
+    return std::async(std::launch::deferred,[this,key]() mutable { return LocalLowerBound(key); });
+  typedef std::pair<bool,T> ret_type;
+  return RPC_CALL_WRAPPER_ASYNC(remote.lower_bound, server, ret_type, key);
+}
+
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::future<std::vector<T>> concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::AsyncRangeScan(uint16_t server,T &lo,T &hi,uint32_t limit)
+{
+  if(isLocalServer(server))
+    return std::async(std::launch::deferred,[this,lo,hi,limit]() mutable { return LocalRangeScan(lo,hi,limit); });
+  typedef std::vector<T> ret_type;
+  return RPC_CALL_WRAPPER_ASYNC(remote.range_scan, server, ret_type, lo, hi, limit);
+}
+
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::future<std::pair<bool,T>> concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::AsyncFirst(uint16_t server)
+{
+  if(isLocalServer(server))
+    return std::async(std::launch::deferred,[this]() { return LocalFirst(); });
+  typedef std::pair<bool,T> ret_type;
+  return RPC_CALL_WRAPPER1_ASYNC(remote.first, server, ret_type);
+}
+
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::future<std::pair<bool,T>> concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::AsyncLast(uint16_t server)
+{
+  if(isLocalServer(server))
+    return std::async(std::launch::deferred,[this]() { return LocalLast(); });
+  typedef std::pair<bool,T> ret_type;
+  return RPC_CALL_WRAPPER1_ASYNC(remote.last, server, ret_type);
+}
+
+/*The first key not less than key. With an ordered partitioner the servers are asked in key order from the server of key until one has such a key; otherwise every server is asked and the least answer wins*/
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::pair<bool,T> concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::LowerBound(T &key)
+{
+  AutoTrace trace = AutoTrace("hcl::concurrent_skiplist::LowerBound(remote)", key);
+  std::pair<bool,T> best(false,T());
+  if constexpr (is_ordered_partitioner<Partitioner>::value)
+  {
+    for(uint32_t i=serverLocation(key);i<nservers && !best.first;i++)
+      best = AsyncLowerBound(i,key).get();
+    return best;
+  }
+  std::vector<std::future<std::pair<bool,T>>> futures;
+  for(uint32_t i=0;i<nservers;i++) futures.push_back(AsyncLowerBound(i,key));
+  for(auto &future : futures)
+  {
+    auto found = future.get();
+    if(found.first && (!best.first || Comp()(found.second,best.second))) best = found;
+  }
+  return best;
+}
+
+/*Up to limit keys in [lo, hi], in order. With an ordered partitioner only the servers whose ranges meet [lo, hi] are asked, one after another, each for the keys still missing; otherwise every server is asked for limit keys and the results are merged*/
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::vector<T> concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::RangeScan(T &lo,T &hi,uint32_t limit)
+{
+  AutoTrace trace = AutoTrace("hcl::concurrent_skiplist::RangeScan(remote)", lo, hi, limit);
+  std::vector<T> keys;
+  if(Comp()(hi,lo) || limit == 0) return keys;
+  if constexpr (is_ordered_partitioner<Partitioner>::value)
+  {
+    uint32_t last = serverLocation(hi);
+    for(uint32_t i=serverLocation(lo);i<=last && keys.size() < limit;i++)
+    {
+      std::vector<T> part = AsyncRangeScan(i,lo,hi,limit-keys.size()).get();
+      keys.insert(keys.end(),std::make_move_iterator(part.begin()),std::make_move_iterator(part.end()));
+    }
+    return keys;
+  }
+  std::vector<std::future<std::vector<T>>> futures;
+  for(uint32_t i=0;i<nservers;i++) futures.push_back(AsyncRangeScan(i,lo,hi,limit));
+  std::vector<std::vector<T>> runs;
+  for(auto &future : futures) runs.push_back(future.get());
+  keys = merge_runs(runs,Comp());
+  if(keys.size() > limit) keys.resize(limit);
+  return keys;
+}
+
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::pair<bool,T> concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::First()
+{
+  AutoTrace trace = AutoTrace("hcl::concurrent_skiplist::First(remote)");
+  std::pair<bool,T> best(false,T());
+  if constexpr (is_ordered_partitioner<Partitioner>::value)
+  {
+    for(uint32_t i=0;i<nservers && !best.first;i++) best = AsyncFirst(i).get();
+    return best;
+  }
+  std::vector<std::future<std::pair<bool,T>>> futures;
+  for(uint32_t i=0;i<nservers;i++) futures.push_back(AsyncFirst(i));
+  for(auto &future : futures)
+  {
+    auto found = future.get();
+    if(found.first && (!best.first || Comp()(found.second,best.second))) best = found;
+  }
+  return best;
+}
+
+template<typename T,typename HashFcn,typename Comp,typename NodeAlloc,int MAX_HEIGHT,typename Partitioner>
+std::pair<bool,T> concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::Last()
+{
+  AutoTrace trace = AutoTrace("hcl::concurrent_skiplist::Last(remote)");
+  std::pair<bool,T> best(false,T());
+  if constexpr (is_ordered_partitioner<Partitioner>::value)
+  {
+    for(uint32_t i=nservers;i>0 && !best.first;i--) best = AsyncLast(i-1).get();
+    return best;
+  }
+  std::vector<std::future<std::pair<bool,T>>> futures;
+  for(uint32_t i=0;i<nservers;i++) futures.push_back(AsyncLast(i));
+  for(auto &future : futures)
+  {
+    auto found = future.get();
+    if(found.first && (!best.first || Comp()(best.second,found.second))) best = found;
+  }
+  return best;
 }
 
 #endif
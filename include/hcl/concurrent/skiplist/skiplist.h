@@ -40,8 +40,11 @@
 #include <boost/algorithm/string.hpp>
 /** Standard C++ Headers**/
 #include <hcl/common/container.h>
+#include <hcl/common/partitioner.h>
 
+#include <climits>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -51,7 +54,7 @@
 #include <float.h>
 #include "../../base/containers/concurrent_skiplist/skip_list.h"
 
-/*This file contains the class that implements a distributed concurrent set. The total size of the set is not fixed. Each server has a set. The total key space is partitioned across servers using the upper log(n) bits where 'n' is the number of servers. A client program should locate the server for its key and make RPC calls to it for performing set operations. The underlying set is implemented using a concurrent randomized skiplist. The skiplist can be accessed concurrently using multiple threads.*/
+/*This file contains the class that implements a distributed concurrent set. The total size of the set is not fixed. Each server has a set. By default the total key space is partitioned across servers using the upper log(n) bits of the hash where 'n' is the number of servers. With Partitioner=OrderedPartitioner each server owns a contiguous range of keys instead, so that LowerBound, RangeScan, First and Last ask only the servers that can hold the answer, in key order; with hash partitioning they ask every server and merge. A client program should locate the server for its key and make RPC calls to it for performing set operations. The underlying set is implemented using a concurrent randomized skiplist. The skiplist can be accessed concurrently using multiple threads; ordered reads on a server walk it with a Skipper under a Guard, so they do not lock.*/
 
 namespace hcl {
 
@@ -59,42 +62,43 @@ template <class T,
 	 class HashFcn = std::hash<T>,
 	 class Comp = std::less<T>,
 	 class NodeAlloc = std::allocator<char>,
-	 int MAX_HEIGHT = 24>
+	 int MAX_HEIGHT = 24,
+	 class Partitioner = HighBitsPartitioner>
 class concurrent_skiplist : public container
 {
 
   typedef ConcurrentSkipList<T,Comp,NodeAlloc,MAX_HEIGHT> SkipListType;
   typedef typename ConcurrentSkipList<T,Comp,NodeAlloc,MAX_HEIGHT>::Accessor SkipListAccessor;
+  typedef typename ConcurrentSkipList<T,Comp,NodeAlloc,MAX_HEIGHT>::Skipper SkipListSkipper;
 
   private:
         uint64_t totalSize;
 	uint32_t nservers;
 	uint32_t serverid;
-	uint64_t nbits;
+	Partitioner partitioner;
 	SkipListType *s;
 	SkipListAccessor *a;
+	/* Handles of the remote operations, resolved by the constructor */
+	struct {
+	    RPC::Procedure insert, find, erase, first, last, lower_bound, range_scan;
+	} remote;
 
-	uint64_t power_of_two(int n)
+	bool isLocalServer(uint16_t server)
 	{
-	    int c = 1;
-	    while(c < n)
-	    {
-		c = 2*c;
-	    }
-	    return c;
+	   return is_server && server == serverid;
 	}
+
+	std::future<std::pair<bool,T>> AsyncLowerBound(uint16_t server,T &k);
+	std::future<std::vector<T>> AsyncRangeScan(uint16_t server,T &lo,T &hi,uint32_t limit);
+	std::future<std::pair<bool,T>> AsyncFirst(uint16_t server);
+	std::future<std::pair<bool,T>> AsyncLast(uint16_t server);
   public:
 
+	/*Ordered partitioners see the key itself, the others its hash*/
 	uint64_t serverLocation(T &k)
 	{
-	    uint64_t id = -1;
-	    uint64_t hashval = HashFcn()(k);
-	    uint64_t mask = UINT64_MAX;
-	    mask = mask << (64-nbits);  
-	    id = hashval & mask;
-	    id = id >> (64-nbits);
-	    if(id >= nservers) id = nservers-1;
-	    return id;
+	    if constexpr (is_ordered_partitioner<Partitioner>::value) return partitioner(k);
+	    else return partitioner(HashFcn()(k));
 	}
 
 	bool isLocal(T &k)
@@ -104,11 +108,16 @@ class concurrent_skiplist : public container
 	}
 
 	void initialize_sets(uint32_t np,uint32_t rank)
+	{
+	    initialize_sets(np,rank,Partitioner(np));
+	}
+
+	/*Clients and servers must pass the same partitioner, e.g. an OrderedPartitioner with the same splitters*/
+	void initialize_sets(uint32_t np,uint32_t rank,Partitioner p)
 	{
 	    nservers = np;
 	    serverid = rank;
-	    uint64_t nservers_2 = power_of_two(nservers);
-	    nbits = log2(nservers_2);
+	    partitioner = p;
 
 	    s = nullptr; a = nullptr;
 	    if(is_server)
@@ -137,15 +146,28 @@ class concurrent_skiplist : public container
 #ifdef HCL_ENABLE_RPCLIB
           case RPCLIB: {
             std::function<bool(T &)> insertFunc(
-            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT>::LocalInsert, this,std::placeholders::_1));
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::LocalInsert, this,std::placeholders::_1));
             std::function<bool(T &)> findFunc(
-            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT>::LocalFind, this,std::placeholders::_1));
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::LocalFind, this,std::placeholders::_1));
             std::function<bool(T &)> eraseFunc(
-            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT>::LocalErase, this,std::placeholders::_1));
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::LocalErase, this,std::placeholders::_1));
+            std::function<std::pair<bool,T>(T &)> lowerBoundFunc(
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::LocalLowerBound, this,std::placeholders::_1));
+            std::function<std::vector<T>(T &,T &,uint32_t)> rangeScanFunc(
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::LocalRangeScan, this,
+                      std::placeholders::_1,std::placeholders::_2,std::placeholders::_3));
+            std::function<std::pair<bool,T>(void)> firstFunc(
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::LocalFirst, this));
+            std::function<std::pair<bool,T>(void)> lastFunc(
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::LocalLast, this));
             
 	    rpc->bind(func_prefix + "_Insert", insertFunc);
             rpc->bind(func_prefix + "_Find", findFunc);
             rpc->bind(func_prefix + "_Erase", eraseFunc);
+            rpc->bind(func_prefix + "_LowerBound", lowerBoundFunc);
+            rpc->bind(func_prefix + "_RangeScan", rangeScanFunc);
+            rpc->bind(func_prefix + "_First", firstFunc);
+            rpc->bind(func_prefix + "_Last", lastFunc);
            break;
           }
 #endif
@@ -159,18 +181,34 @@ class concurrent_skiplist : public container
          {
 
            std::function<void(const tl::request &, T &)> insertFunc(
-           std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT>::ThalliumLocalInsert,
+           std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::ThalliumLocalInsert,
            this, std::placeholders::_1, std::placeholders::_2));
             std::function<void(const tl::request &, T &)> findFunc(
-            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT>::ThalliumLocalFind,
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::ThalliumLocalFind,
                       this, std::placeholders::_1, std::placeholders::_2));
             std::function<void(const tl::request &,T &)> eraseFunc(
-            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT>::ThalliumLocalErase,
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::ThalliumLocalErase,
                       this, std::placeholders::_1, std::placeholders::_2));
+            std::function<void(const tl::request &,T &)> lowerBoundFunc(
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::ThalliumLocalLowerBound,
+                      this, std::placeholders::_1, std::placeholders::_2));
+            std::function<void(const tl::request &,T &,T &,uint32_t)> rangeScanFunc(
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::ThalliumLocalRangeScan,
+                      this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+            std::function<void(const tl::request &)> firstFunc(
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::ThalliumLocalFirst,
+                      this, std::placeholders::_1));
+            std::function<void(const tl::request &)> lastFunc(
+            std::bind(&concurrent_skiplist<T,HashFcn,Comp,NodeAlloc,MAX_HEIGHT,Partitioner>::ThalliumLocalLast,
+                      this, std::placeholders::_1));
             
 	    rpc->bind(func_prefix + "_Insert", insertFunc);
             rpc->bind(func_prefix + "_Find", findFunc);
             rpc->bind(func_prefix + "_Erase", eraseFunc);
+            rpc->bind(func_prefix + "_LowerBound", lowerBoundFunc);
+            rpc->bind(func_prefix + "_RangeScan", rangeScanFunc);
+            rpc->bind(func_prefix + "_First", firstFunc);
+            rpc->bind(func_prefix + "_Last", lastFunc);
             break;
         }
 #endif
@@ -183,6 +221,13 @@ class concurrent_skiplist : public container
     	a = nullptr;
     	s = nullptr;
     	AutoTrace trace = AutoTrace("hcl::concurrent_skiplist");
+    	remote.insert = resolve("_Insert");
+    	remote.find = resolve("_Find");
+    	remote.erase = resolve("_Erase");
+    	remote.first = resolve("_First");
+    	remote.last = resolve("_Last");
+    	remote.lower_bound = resolve("_LowerBound");
+    	remote.range_scan = resolve("_RangeScan");
     	if(is_server)
     	{
       	  bind_functions();
@@ -192,6 +237,11 @@ class concurrent_skiplist : public container
         }
      }
 
+     SkipListType *data()
+     {
+	return s;
+     }
+
      bool LocalInsert(T &k)
      {
 	  auto ret = a->insert(k);
@@ -205,17 +255,68 @@ class concurrent_skiplist : public container
      {
 	return a->remove(k);
      }
+     /*The first key of this server not less than k*/
+     std::pair<bool,T> LocalLowerBound(T &k)
+     {
+	auto g = a->guard();
+	SkipListSkipper sk(*a);
+	sk.to(k);
+	while(sk.good() && sk.removed()) ++sk;
+	if(!sk.good()) return std::make_pair(false,T());
+	return std::make_pair(true,sk.data());
+     }
+     /*Up to limit keys of this server in [lo, hi], in order*/
+     std::vector<T> LocalRangeScan(T &lo,T &hi,uint32_t limit)
+     {
+	std::vector<T> keys;
+	auto g = a->guard();
+	SkipListSkipper sk(*a);
+	sk.to(lo);
+	for(;sk.good() && keys.size() < limit && !Comp()(hi,sk.data());++sk)
+	{
+	    if(!sk.removed()) keys.push_back(sk.data());
+	}
+	return keys;
+     }
+     std::pair<bool,T> LocalFirst()
+     {
+	auto g = a->guard();
+	SkipListSkipper sk(*a);
+	while(sk.good() && sk.removed()) ++sk;
+	if(!sk.good()) return std::make_pair(false,T());
+	return std::make_pair(true,sk.data());
+     }
+     /*The last node may be removed while it is read, so a key that is no longer in the skiplist is read again*/
+     std::pair<bool,T> LocalLast()
+     {
+	auto g = a->guard();
+	const T *last;
+	while((last = a->last()) != nullptr)
+	{
+	    T k = *last;
+	    if(a->contains(k)) return std::make_pair(true,k);
+	}
+	return std::make_pair(false,T());
+     }
 
 
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
     THALLIUM_DEFINE(LocalInsert, (k), T& k)
     THALLIUM_DEFINE(LocalFind, (k), T& k)
     THALLIUM_DEFINE(LocalErase, (k), T& k)
+    THALLIUM_DEFINE(LocalLowerBound, (k), T& k)
+    THALLIUM_DEFINE(LocalRangeScan, (lo, hi, limit), T& lo, T& hi, uint32_t limit)
+    THALLIUM_DEFINE1(LocalFirst)
+    THALLIUM_DEFINE1(LocalLast)
 #endif
    
    bool Insert(T& k);
    bool Find(T& k);
    bool Erase(T& k);
+   std::pair<bool,T> LowerBound(T& k);
+   std::vector<T> RangeScan(T& lo,T& hi,uint32_t limit = UINT32_MAX);
+   std::pair<bool,T> First();
+   std::pair<bool,T> Last();
 
 };
 #include "skiplist.cpp"
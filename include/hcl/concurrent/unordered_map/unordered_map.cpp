@@ -13,44 +13,95 @@
 #ifndef INCLUDE_HCL_CONCURRENT_UNORDERED_MAP_CPP_
 #define INCLUDE_HCL_CONCURRENT_UNORDERED_MAP_CPP_
 
-template <typename KeyT, typename ValueT,typename HashFcn,typename EqualFcn>
-bool concurrent_unordered_map<KeyT, ValueT,HashFcn,EqualFcn>::Insert(KeyT &key, ValueT &data) 
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn, typename Partitioner, typename MapType>
+bool concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn,Partitioner,MapType>::Insert(KeyT &key, ValueT &data) 
 {
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  if (isLocal(key)) return LocalInsert(key, data);
   AutoTrace trace = AutoTrace("hcl::concurrent_unordered_map::Insert(remote)", key, data);
-  return RPC_CALL_WRAPPER("_Insert", key_int,bool, key, data);
+  return RPC_CALL_WRAPPER(remote.insert, key_int,bool, key, data);
 }
 
-template <typename KeyT, typename ValueT,typename HashFcn,typename EqualFcn>
-bool concurrent_unordered_map<KeyT, ValueT,HashFcn,EqualFcn>::Find(KeyT &key) 
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn, typename Partitioner, typename MapType>
+bool concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn,Partitioner,MapType>::Find(KeyT &key) 
 {
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  if (isLocal(key)) return LocalFind(key);
   AutoTrace trace = AutoTrace("hcl::concurrent_unordered_map::Find(remote)", key);
-  return RPC_CALL_WRAPPER("_Find", key_int,bool, key);
+  return RPC_CALL_WRAPPER(remote.find, key_int,bool, key);
 }
 
-template <typename KeyT, typename ValueT,typename HashFcn,typename EqualFcn>
-bool concurrent_unordered_map<KeyT, ValueT,HashFcn,EqualFcn>::Erase(KeyT &key) 
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn, typename Partitioner, typename MapType>
+bool concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn,Partitioner,MapType>::Erase(KeyT &key) 
 {
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  if (isLocal(key)) return LocalErase(key);
   AutoTrace trace = AutoTrace("hcl::concurrent_unordered_map::Erase(remote)", key);
-  return RPC_CALL_WRAPPER("_Erase", key_int,bool, key);
+  return RPC_CALL_WRAPPER(remote.erase, key_int,bool, key);
 }
 
-template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
-ValueT concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn>::Get(KeyT &key)
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn, typename Partitioner, typename MapType>
+ValueT concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn,Partitioner,MapType>::Get(KeyT &key)
 {
    uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+   if (isLocal(key)) return LocalGetValue(key);
    AutoTrace trace = AutoTrace("hcl::concurrent_unordered_map::Get(remote)",key);
-   return RPC_CALL_WRAPPER("_Get",key_int,ValueT,key);
+   return RPC_CALL_WRAPPER(remote.get,key_int,ValueT,key);
 }
 
-template<typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
-bool concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn>::Update(KeyT &key,ValueT &data)
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn, typename Partitioner, typename MapType>
+bool concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn,Partitioner,MapType>::Update(KeyT &key,ValueT &data)
 {
    uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+   if (isLocal(key)) return LocalUpdate(key, data);
    AutoTrace trace = AutoTrace("hcl::concurrent_unordered_map::Update(remote)",key,data);
-   return RPC_CALL_WRAPPER("_Update",key_int,bool,key,data);
+   return RPC_CALL_WRAPPER(remote.update,key_int,bool,key,data);
+}
+
+
+/*Read, modify and write the value of key on its server in one call, with the registered update operation op_id*/
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn, typename Partitioner, typename MapType>
+std::pair<bool,ValueT> concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn,Partitioner,MapType>::UpdateField(KeyT &key,uint32_t op_id,ValueT &operand)
+{
+   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+   if (isLocal(key)) return LocalUpdateFieldOp(key, op_id, operand);
+   AutoTrace trace = AutoTrace("hcl::concurrent_unordered_map::UpdateField(remote)",key,op_id);
+   typedef std::pair<bool,ValueT> ret_type;
+   return RPC_CALL_WRAPPER(remote.update_field,key_int,ret_type,key,op_id,operand);
+}
+
+/*Apply op_id to many keys; the keys of each server are sent in one RPC. Results are aligned with keys*/
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn, typename Partitioner, typename MapType>
+std::vector<std::pair<bool,ValueT>> concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn,Partitioner,MapType>::UpdateFieldBatch(std::vector<KeyT> &keys,uint32_t op_id,std::vector<ValueT> &operands)
+{
+   typedef std::vector<std::pair<bool,ValueT>> ret_type;
+   ret_type results(keys.size(),std::pair<bool,ValueT>(false,ValueT()));
+   if(keys.size() != operands.size()) return results;
+   std::vector<std::vector<KeyT>> server_keys(nservers);
+   std::vector<std::vector<ValueT>> server_operands(nservers);
+   std::vector<std::vector<std::size_t>> server_positions(nservers);
+   for(std::size_t i=0;i<keys.size();i++)
+   {
+      uint64_t server = serverLocation(keys[i]);
+      server_keys[server].push_back(keys[i]);
+      server_operands[server].push_back(operands[i]);
+      server_positions[server].push_back(i);
+   }
+   for(uint16_t key_int=0;key_int<nservers;key_int++)
+   {
+      if(server_keys[key_int].empty()) continue;
+      ret_type values;
+      if(my_table != nullptr && key_int == serverid)
+        values = LocalUpdateFieldOpBatch(server_keys[key_int],op_id,server_operands[key_int]);
+      else
+      {
+        AutoTrace trace = AutoTrace("hcl::concurrent_unordered_map::UpdateFieldBatch(remote)",key_int,op_id);
+        values = RPC_CALL_WRAPPER(remote.update_field_batch,key_int,ret_type,server_keys[key_int],op_id,server_operands[key_int]);
+      }
+      for(std::size_t i=0;i<values.size();i++)
+        results[server_positions[key_int][i]] = std::move(values[i]);
+   }
+   return results;
 }
 
 #endif  
@@ -40,6 +40,7 @@
 #include <boost/algorithm/string.hpp>
 /** Standard C++ Headers**/
 #include <hcl/common/container.h>
+#include <hcl/common/partitioner.h>
 
 #include <functional>
 #include <iostream>
@@ -50,19 +51,24 @@
 #include <vector>
 #include <float.h>
 #include "../../base/containers/concurrent_unordered_map/block_map.h"
+#include "../../base/containers/concurrent_unordered_map/flat_block_map.h"
+#include "../../base/containers/concurrent_unordered_map/shared_block_map.h"
+#include "../../base/containers/concurrent_unordered_map/update_ops.h"
 
-/*This file contains the class that implements a distributed concurrent unordered map of fixed size. The total size of the map can be configured by the user. The map is partitioned and distributed across servers. A client program can use the HCL container to locate the server containing a key and make an RPC call for remote map operations. The unordered map on each server is concurrent, which means it can be accessed by multiple threads simultaneously.*/
+/*This file contains the class that implements a distributed concurrent unordered map. The total size of the map can be configured by the user. The map is partitioned and distributed across servers by position in a table of the total size; the table of each server starts with its share of the positions and grows on its own once it holds more than HCL_CONF->MAX_LOAD_FACTOR entries per bucket, so keys never change servers. A client program can use the HCL container to locate the server containing a key and make an RPC call for remote map operations. The unordered map on each server is concurrent, which means it can be accessed by multiple threads simultaneously; only writers lock buckets, and readers check a version of the bucket instead. Each server takes nodes from a memory_pool that caches them per thread and grows in chunks starting at HCL_CONF->NODE_CHUNK_SIZE nodes. With MapType=FlatBlockMap the maps use open addressing in cache line sized buckets. With MapType=SharedBlockMap the map of each server lives in its segment and the clients on the server's node use it directly, without RPC.*/
 
 namespace hcl {
 
 template <class KeyT, 
 	  class ValueT,
 	  class HashFcn=std::hash<KeyT>,
-	  class EqualFcn=std::equal_to<KeyT>>
+	  class EqualFcn=std::equal_to<KeyT>,
+	  class Partitioner=RangePartitioner,
+	  class MapType=BlockMap<KeyT,ValueT,HashFcn,EqualFcn>>
 class concurrent_unordered_map : public container 
 {
   public :
-      typedef BlockMap<KeyT,ValueT,HashFcn,EqualFcn> map_type;
+      typedef MapType map_type;
       typedef memory_pool<KeyT,ValueT,HashFcn,EqualFcn> pool_type;
 
  private:
@@ -73,36 +79,30 @@ class concurrent_unordered_map : public container
         uint32_t nservers;
         uint32_t serverid;
         KeyT emptyKey;
+        Partitioner partitioner;
         pool_type *pl;
         map_type *my_table;
+        update_registry<ValueT> updates;
+        /* Handles of the remote operations, resolved by the constructor */
+        struct {
+            RPC::Procedure insert, find, erase, get, update, update_field, update_field_batch;
+        } remote;
 
 
 
  public:
+   /*True when k can be served from my_table: on the server, or on a client of the server's node when the map is in the segment.*/
    bool isLocal(KeyT &k)
    {
-       uint64_t hashval = HashFcn()(k);
-       uint64_t pos = hashval % totalSize;
-       if(is_server && pos >= min_range && pos < max_range) return true;
+       if(my_table != nullptr && serverLocation(k) == serverid) return true;
        else return false;
    }
 
+   /*The default RangePartitioner splits the positions hash%totalSize evenly
+     in server order, matching the table sizes below.*/
    uint64_t serverLocation(KeyT &k)
    {
-      uint64_t localSize = totalSize/num_servers;
-      uint64_t rem = totalSize%num_servers;
-      uint64_t hashval = HashFcn()(k);
-      uint64_t v = hashval % totalSize;
-      uint64_t offset = rem*(localSize+1);
-      uint64_t id = -1;
-      if(v >= 0 && v < totalSize)
-      {
-         if(v < offset)
-           id = v/(localSize+1);
-         else id = rem+((v-offset)/localSize);
-      }
-
-      return id;
+      return partitioner(HashFcn()(k));
    }
 
     void initialize_tables(uint64_t n,uint32_t np,uint32_t rank,KeyT maxKey)
@@ -111,6 +111,7 @@ class concurrent_unordered_map : public container
         nservers = np;
         serverid = rank;
         emptyKey = maxKey;
+        partitioner = Partitioner(nservers,totalSize);
         my_table = nullptr;
         pl = nullptr;
         assert (totalSize > 0 && totalSize < UINT64_MAX);
@@ -128,27 +129,47 @@ class concurrent_unordered_map : public container
 
         max_range = min_range + maxSize;
 
-        if(is_server)
+        if constexpr (is_shared_block_map<map_type>::value)
         {
-          pl = new pool_type(100);
-          my_table = new map_type(maxSize,pl,emptyKey);
+          /*Clients must initialize after the server of their node.*/
+          if(is_server) construct_shared_memory();
+          else if(server_on_node) open_shared_memory();
+        }
+        else if(is_server)
+        {
+          pl = new pool_type(HCL_CONF->NODE_CHUNK_SIZE);
+          my_table = new map_type(maxSize,pl,emptyKey,HCL_CONF->MAX_LOAD_FACTOR);
         }
 
    }
 
   ~concurrent_unordered_map() 
   {
-    if(my_table != nullptr) delete my_table;
-    if(pl != nullptr) delete pl;  
+    if constexpr (is_shared_block_map<map_type>::value)
+    {
+      if(is_server && my_table != nullptr) segment.destroy<map_type>(name.c_str());
+    }
+    else
+    {
+      if(my_table != nullptr) delete my_table;
+      if(pl != nullptr) delete pl;
+    }
   }
 
   void construct_shared_memory() override 
   {
-
+    if constexpr (is_shared_block_map<map_type>::value)
+    {
+      my_table = segment.construct<map_type>(name.c_str())(maxSize,emptyKey,segment.get_segment_manager());
+    }
   }
   void open_shared_memory() override 
   {
-
+    if constexpr (is_shared_block_map<map_type>::value)
+    {
+      my_table = segment.find<map_type>(name.c_str()).first;
+      assert (my_table != nullptr);
+    }
   }
   void bind_functions() override 
   {
@@ -156,26 +177,34 @@ class concurrent_unordered_map : public container
 #ifdef HCL_ENABLE_RPCLIB
       case RPCLIB: {
         std::function<bool(KeyT &, ValueT &)> insertFunc(
-            std::bind(&concurrent_unordered_map<KeyT, ValueT,HashFcn,EqualFcn>::LocalInsert, this,
+            std::bind(&concurrent_unordered_map::LocalInsert, this,
                       std::placeholders::_1, std::placeholders::_2));
         std::function<bool(KeyT &)> findFunc(
-            std::bind(&concurrent_unordered_map<KeyT, ValueT,HashFcn,EqualFcn>::LocalFind, this,
+            std::bind(&concurrent_unordered_map::LocalFind, this,
                       std::placeholders::_1));
         std::function<bool(KeyT &)> eraseFunc(
-            std::bind(&concurrent_unordered_map<KeyT, ValueT,HashFcn,EqualFcn>::LocalErase, this,
+            std::bind(&concurrent_unordered_map::LocalErase, this,
                       std::placeholders::_1));
 	std::function<ValueT(KeyT&)> getFunc(
-	   std::bind(&concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn>::LocalGetValue, this,
+	   std::bind(&concurrent_unordered_map::LocalGetValue, this,
 		   std::placeholders::_1));
 	std::function<bool(KeyT&,ValueT&)>updateFunc(
-	   std::bind(&concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn>::LocalUpdate, this,
+	   std::bind(&concurrent_unordered_map::LocalUpdate, this,
 		 std::placeholders::_1,std::placeholders::_2));
+	std::function<std::pair<bool,ValueT>(KeyT&,uint32_t,ValueT&)> updateFieldFunc(
+	   std::bind(&concurrent_unordered_map::LocalUpdateFieldOp, this,
+		 std::placeholders::_1,std::placeholders::_2,std::placeholders::_3));
+	std::function<std::vector<std::pair<bool,ValueT>>(std::vector<KeyT>&,uint32_t,std::vector<ValueT>&)> updateFieldBatchFunc(
+	   std::bind(&concurrent_unordered_map::LocalUpdateFieldOpBatch, this,
+		 std::placeholders::_1,std::placeholders::_2,std::placeholders::_3));
 
         rpc->bind(func_prefix + "_Insert", insertFunc);
         rpc->bind(func_prefix + "_Find", findFunc);
         rpc->bind(func_prefix + "_Erase", eraseFunc);
 	rpc->bind(func_prefix + "_Get", getFunc);
 	rpc->bind(func_prefix + "_Update", updateFunc);
+	rpc->bind(func_prefix + "_UpdateField", updateFieldFunc);
+	rpc->bind(func_prefix + "_UpdateFieldBatch", updateFieldBatchFunc);
         break;
       }
 #endif
@@ -189,26 +218,34 @@ class concurrent_unordered_map : public container
       {
 
         std::function<void(const tl::request &, KeyT &, ValueT &)> insertFunc(
-	   std::bind(&concurrent_unordered_map<KeyT, ValueT,HashFcn,EqualFcn>::ThalliumLocalInsert,
+	   std::bind(&concurrent_unordered_map::ThalliumLocalInsert,
            this, std::placeholders::_1, std::placeholders::_2,std::placeholders::_3));
         std::function<void(const tl::request &, KeyT &)> findFunc(
-            std::bind(&concurrent_unordered_map<KeyT, ValueT,HashFcn,EqualFcn>::ThalliumLocalFind,
+            std::bind(&concurrent_unordered_map::ThalliumLocalFind,
                       this, std::placeholders::_1, std::placeholders::_2));
         std::function<void(const tl::request &, KeyT &)> eraseFunc(
-            std::bind(&concurrent_unordered_map<KeyT, ValueT,HashFcn,EqualFcn>::ThalliumLocalErase,
+            std::bind(&concurrent_unordered_map::ThalliumLocalErase,
                       this, std::placeholders::_1, std::placeholders::_2));
 	std::function<void(const tl::request &, KeyT &)> getFunc(
-	    std::bind(&concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn>::ThalliumLocalGetValue,
+	    std::bind(&concurrent_unordered_map::ThalliumLocalGetValue,
 		      this, std::placeholders::_1, std::placeholders::_2));
 	std::function<void(const tl::request &, KeyT &, ValueT &)> updateFunc(
-	   std::bind(&concurrent_unordered_map<KeyT,ValueT,HashFcn,EqualFcn>::ThalliumLocalUpdate,
+	   std::bind(&concurrent_unordered_map::ThalliumLocalUpdate,
 		     this,std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+	std::function<void(const tl::request &, KeyT &, uint32_t, ValueT &)> updateFieldFunc(
+	   std::bind(&concurrent_unordered_map::ThalliumLocalUpdateFieldOp,
+		     this,std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+	std::function<void(const tl::request &, std::vector<KeyT> &, uint32_t, std::vector<ValueT> &)> updateFieldBatchFunc(
+	   std::bind(&concurrent_unordered_map::ThalliumLocalUpdateFieldOpBatch,
+		     this,std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
 
         rpc->bind(func_prefix + "_Insert", insertFunc);
         rpc->bind(func_prefix + "_Find", findFunc);
         rpc->bind(func_prefix + "_Erase", eraseFunc);
 	rpc->bind(func_prefix + "_Get", getFunc);
 	rpc->bind(func_prefix + "_Update", updateFunc);
+	rpc->bind(func_prefix + "_UpdateField", updateFieldFunc);
+	rpc->bind(func_prefix + "_UpdateFieldBatch", updateFieldBatchFunc);
         break;
       }
 #endif
@@ -221,6 +258,13 @@ class concurrent_unordered_map : public container
     my_table = nullptr;
     pl = nullptr;
     AutoTrace trace = AutoTrace("hcl::map");
+    remote.insert = resolve("_Insert");
+    remote.find = resolve("_Find");
+    remote.erase = resolve("_Erase");
+    remote.get = resolve("_Get");
+    remote.update = resolve("_Update");
+    remote.update_field = resolve("_UpdateField");
+    remote.update_field_batch = resolve("_UpdateFieldBatch");
     if (is_server) {
       bind_functions();
     } else if (!is_server && server_on_node) {
@@ -232,6 +276,12 @@ class concurrent_unordered_map : public container
      return my_table;
   }
 
+  /*The node pool of the map on a server, with the statistics of its reclaimer; nullptr elsewhere*/
+  pool_type *pool()
+  {
+     return pl;
+  }
+
   bool LocalInsert(KeyT &k,ValueT &v)
   {
    uint32_t r = my_table->insert(k,v);
@@ -269,6 +319,40 @@ class concurrent_unordered_map : public container
      return my_table->update_field(k,f,std::forward<Args>(args_)...);
   }
 
+  /*Registers a user update operation under op_id >= UPDATE_USER. Every process that may apply it, the servers and the clients on their nodes, must register it under the same id before it is used.*/
+  bool RegisterUpdate(uint32_t op_id,typename update_registry<ValueT>::op_type op)
+  {
+     return updates.add(op_id,std::move(op));
+  }
+
+  /*Applies the update operation op_id with operand to the value of k under its bucket lock. Returns whether k was found with the updated value; an unknown op_id updates nothing.*/
+  std::pair<bool,ValueT> LocalUpdateFieldOp(KeyT &k,uint32_t op_id,ValueT &operand)
+  {
+     std::pair<bool,ValueT> result(false,ValueT());
+     auto op = updates.get(op_id);
+     if(!op) return result;
+     result.first = my_table->modify(k,[&](ValueT *v) {
+        op(v,operand);
+        result.second = *v;
+     });
+     return result;
+  }
+
+  std::vector<std::pair<bool,ValueT>> LocalUpdateFieldOpBatch(std::vector<KeyT> &keys,uint32_t op_id,std::vector<ValueT> &operands)
+  {
+     std::vector<std::pair<bool,ValueT>> results(keys.size(),std::pair<bool,ValueT>(false,ValueT()));
+     auto op = updates.get(op_id);
+     if(!op || keys.size() != operands.size()) return results;
+     for(std::size_t i=0;i<keys.size();i++)
+     {
+        results[i].first = my_table->modify(keys[i],[&](ValueT *v) {
+           op(v,operands[i]);
+           results[i].second = *v;
+        });
+     }
+     return results;
+  }
+
   uint64_t allocated()
   {
      return my_table->allocated_nodes();
@@ -285,6 +369,8 @@ class concurrent_unordered_map : public container
   THALLIUM_DEFINE(LocalErase, (k), KeyT& k)
   THALLIUM_DEFINE(LocalGetValue, (k), KeyT & k)
   THALLIUM_DEFINE(LocalUpdate, (k,v), KeyT& k, ValueT& v)
+  THALLIUM_DEFINE(LocalUpdateFieldOp, (k,op_id,operand), KeyT& k, uint32_t op_id, ValueT& operand)
+  THALLIUM_DEFINE(LocalUpdateFieldOpBatch, (keys,op_id,operands), std::vector<KeyT>& keys, uint32_t op_id, std::vector<ValueT>& operands)
 #endif
 
    bool Insert(KeyT& k,ValueT& v);
@@ -292,6 +378,8 @@ class concurrent_unordered_map : public container
    bool Erase(KeyT& k);
    ValueT Get(KeyT& k);
    bool Update(KeyT& k,ValueT& v);
+   std::pair<bool,ValueT> UpdateField(KeyT& k,uint32_t op_id,ValueT& operand);
+   std::vector<std::pair<bool,ValueT>> UpdateFieldBatch(std::vector<KeyT>& keys,uint32_t op_id,std::vector<ValueT>& operands);
 
 
 };
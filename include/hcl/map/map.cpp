@@ -20,12 +20,12 @@
  * @return bool, true if Put was successful else false.
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-bool map<KeyType, MappedType, Compare, Allocator, SharedType>::LocalPut(
+          typename Allocator, typename SharedType, typename Partitioner>
+bool
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::LocalPut(
     KeyType &key, MappedType &data) {
   AutoTrace trace = AutoTrace("hcl::map::Put(local)", key, data);
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   auto value = GetData<Allocator, MappedType, SharedType>(data);
   mymap->insert_or_assign(key, value);
   return true;
@@ -38,16 +38,18 @@ bool map<KeyType, MappedType, Compare, Allocator, SharedType>::LocalPut(
  * @return bool, true if Put was successful else false.
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-bool map<KeyType, MappedType, Compare, Allocator, SharedType>::Put(
+          typename Allocator, typename SharedType, typename Partitioner>
+bool map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::Put(
     KeyType &key, MappedType &data) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
+  uint16_t key_int = KeyServer(key);
   if (is_local(key_int)) {
     return LocalPut(key, data);
   } else {
     AutoTrace trace = AutoTrace("hcl::map::Put(remote)", key, data);
-    return RPC_CALL_WRAPPER("_Put", key_int, bool, key, data);
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+    if (use_rdma(data)) return PutBulk(key_int, key, data);
+#endif
+    return RPC_CALL_WRAPPER(remote.put, key_int, bool, key, data);
   }
 }
 
@@ -58,12 +60,12 @@ bool map<KeyType, MappedType, Compare, Allocator, SharedType>::Put(
  * data was found and is present in value part else bool is set to false
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-std::pair<bool, MappedType> map<KeyType, MappedType, Compare, Allocator,
-                                SharedType>::LocalGet(KeyType &key) {
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<bool, MappedType>
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::LocalGet(
+    KeyType &key) {
   AutoTrace trace = AutoTrace("hcl::map::Get(local)", key);
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   typename MyMap::iterator iterator = mymap->find(key);
   if (iterator != mymap->end()) {
     return std::pair<bool, MappedType>(true, iterator->second);
@@ -79,102 +81,275 @@ std::pair<bool, MappedType> map<KeyType, MappedType, Compare, Allocator,
  * data was found and is present in value part else bool is set to false
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::pair<bool, MappedType>
-map<KeyType, MappedType, Compare, Allocator, SharedType>::Get(KeyType &key) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::Get(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
   if (is_local(key_int)) {
     return LocalGet(key);
   } else {
     AutoTrace trace = AutoTrace("hcl::map::Get(remote)", key);
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+    if (may_use_rdma<MappedType>()) return GetBulk(key_int, key);
+#endif
     typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Get", key_int, ret_type, key);
+    return RPC_CALL_WRAPPER(remote.get, key_int, ret_type, key);
   }
 }
 
+/**
+ * Erase the key from the local map.
+ * @param key, key to erase
+ * @return return a pair of bool and Value. If bool is true then the key was
+ * found and its value is in the value part else bool is set to false
+ */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::pair<bool, MappedType> map<KeyType, MappedType, Compare, Allocator,
-                                SharedType>::LocalErase(KeyType &key) {
+                                SharedType, Partitioner>::LocalErase(
+    KeyType &key) {
   AutoTrace trace = AutoTrace("hcl::map::Erase(local)", key);
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
-  size_t s = mymap->erase(key);
-  return std::pair<bool, MappedType>(s > 0, MappedType());
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  typename MyMap::iterator iterator = mymap->find(key);
+  if (iterator == mymap->end()) {
+    return std::pair<bool, MappedType>(false, MappedType());
+  }
+  std::pair<bool, MappedType> erased(true, iterator->second);
+  mymap->erase(iterator);
+  return erased;
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::pair<bool, MappedType>
-map<KeyType, MappedType, Compare, Allocator, SharedType>::Erase(KeyType &key) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::Erase(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
   if (is_local(key_int)) {
     return LocalErase(key);
   } else {
     AutoTrace trace = AutoTrace("hcl::map::Erase(remote)", key);
     typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
+    return RPC_CALL_WRAPPER(remote.erase, key_int, ret_type, key);
   }
 }
 
 /**
- * Get the data into the map. Uses key to decide the server to hash it to,
- * @param key, key to get
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * Put the data into the map without waiting for the result.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @return a future holding true if Put was successful else false.
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-std::vector<std::pair<KeyType, MappedType>>
-map<KeyType, MappedType, Compare, Allocator, SharedType>::Contains(
-    KeyType &key_start, KeyType &key_end) {
-  AutoTrace trace = AutoTrace("hcl::map::Contains", key_start, key_end);
-  auto final_values = std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = ContainsInServer(key_start, key_end);
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
+          typename Allocator, typename SharedType, typename Partitioner>
+std::future<bool>
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::AsyncPut(
+    KeyType &key, MappedType &data) {
+  uint16_t key_int = KeyServer(key);
+  if (is_local(key_int)) {
+    /* LocalPut moves out of its value; the caller's data stays intact as on
+     * the remote path */
+    MappedType value = data;
+    return ready_future(LocalPut(key, value));
+  } else {
+    AutoTrace trace = AutoTrace("hcl::map::AsyncPut(remote)", key, data);
+    return RPC_CALL_WRAPPER_ASYNC(remote.put, key_int, bool, key, data);
+  }
+}
+
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::future<std::pair<bool, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::AsyncGet(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
+  if (is_local(key_int)) {
+    return ready_future(LocalGet(key));
+  } else {
+    AutoTrace trace = AutoTrace("hcl::map::AsyncGet(remote)", key);
+    typedef std::pair<bool, MappedType> ret_type;
+    return RPC_CALL_WRAPPER_ASYNC(remote.get, key_int, ret_type, key);
+  }
+}
+
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::future<std::pair<bool, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::AsyncErase(KeyType &key) {
+  uint16_t key_int = KeyServer(key);
+  if (is_local(key_int)) {
+    return ready_future(LocalErase(key));
+  } else {
+    AutoTrace trace = AutoTrace("hcl::map::AsyncErase(remote)", key);
+    typedef std::pair<bool, MappedType> ret_type;
+    return RPC_CALL_WRAPPER_ASYNC(remote.erase, key_int, ret_type, key);
+  }
+}
+
+/**
+ * Issues the Contains requests of the servers that may hold keys in
+ * [key_start, key_end] at once: all servers, or with an ordered partitioner
+ * only those whose ranges intersect it. The part of this client's own
+ * server is read from shared memory once every remote request is in flight.
+ * @return one future per server asked, in server id order
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::ScatterContains(KeyType &key_start, KeyType &key_end) {
+  typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
+  std::vector<std::future<ret_type>> futures;
+  uint16_t first_server = 0, last_server = num_servers - 1;
+  if (is_ordered_partitioner<Partitioner>::value) {
+    first_server = KeyServer(key_start);
+    last_server = KeyServer(key_end);
+  }
+  int local = -1;
+  for (uint16_t i = first_server; i <= last_server; ++i) {
+    if (is_local(i)) {
+      local = futures.size();
+      futures.emplace_back();
+      continue;
+    }
+    auto future = RPC_CALL_WRAPPER_ASYNC(remote.contains, i, ret_type,
+                                         key_start, key_end);
+    futures.push_back(std::move(future));
+  }
+  if (local >= 0)
+    futures[local] = ready_future(LocalContainsInServer(key_start, key_end));
+  return futures;
+}
+
+/**
+ * Issues the GetAllData requests of all servers at once, in the same way as
+ * ScatterContains.
+ * @return one future per server, indexed by server id
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::ScatterGetAllData() {
+  typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
+  std::vector<std::future<ret_type>> futures;
+  int local = -1;
   for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server) {
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server =
-          RPC_CALL_WRAPPER("_Contains", i, ret_type, key_start, key_end);
-      final_values.insert(final_values.end(), server.begin(), server.end());
+    if (i == my_server && is_local()) {
+      local = i;
+      futures.emplace_back();
+      continue;
     }
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+    if (may_use_rdma<MappedType>()) {
+      futures.push_back(std::async(std::launch::deferred,
+                                   [this, i]() { return GetAllDataBulk(i); }));
+      continue;
+    }
+#endif
+    auto future = RPC_CALL_WRAPPER1_ASYNC(remote.get_all_data, i, ret_type);
+    futures.push_back(std::move(future));
   }
-  return final_values;
+  if (local >= 0) futures[local] = ready_future(LocalGetAllDataInServer());
+  return futures;
 }
 
+/**
+ * Waits for the per-server results, each sorted by key, and returns them as
+ * one sorted vector. Ordered partitions are concatenated in server order;
+ * hash partitions are combined with a k-way merge.
+ */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
-map<KeyType, MappedType, Compare, Allocator, SharedType>::GetAllData() {
-  AutoTrace trace = AutoTrace("hcl::map::GetAllData");
-  auto final_values = std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = GetAllDataInServer();
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server) {
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server = RPC_CALL_WRAPPER1("_GetAllData", i, ret_type);
-      final_values.insert(final_values.end(), server.begin(), server.end());
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::Gather(
+    std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+        futures) {
+  typedef std::pair<KeyType, MappedType> value_type;
+  std::vector<std::vector<value_type>> runs;
+  for (auto &future : futures) runs.push_back(future.get());
+  if (is_ordered_partitioner<Partitioner>::value) {
+    std::vector<value_type> final_values;
+    for (auto &run : runs) {
+      final_values.insert(final_values.end(),
+                          std::make_move_iterator(run.begin()),
+                          std::make_move_iterator(run.end()));
     }
+    return final_values;
   }
-  return final_values;
+  return merge_runs(runs, [](const value_type &a, const value_type &b) {
+    return Compare()(a.first, b.first);
+  });
 }
 
+/**
+ * Get the data in [key_start, key_end] from every server that may hold it.
+ * The servers are asked concurrently and the result is in key order.
+ * @param key_start, the first key of the range
+ * @param key_end, the last key of the range
+ * @return the key value pairs in the range, sorted by key
+ */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
-map<KeyType, MappedType, Compare, Allocator, SharedType>::LocalContainsInServer(
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::Contains(
     KeyType &key_start, KeyType &key_end) {
+  AutoTrace trace = AutoTrace("hcl::map::Contains", key_start, key_end);
+  return Gather(ScatterContains(key_start, key_end));
+}
+
+/**
+ * Get the data in [key_start, key_end] one server at a time, without
+ * collecting it in one vector. The servers are asked concurrently.
+ * @param callback, called with the sorted data of each server in server id
+ * order; with an ordered partitioner the calls are in key order
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+void map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::
+    Contains(KeyType &key_start, KeyType &key_end,
+             std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+                 callback) {
+  AutoTrace trace = AutoTrace("hcl::map::Contains", key_start, key_end);
+  for (auto &future : ScatterContains(key_start, key_end)) {
+    auto server = future.get();
+    callback(server);
+  }
+}
+
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::GetAllData() {
+  AutoTrace trace = AutoTrace("hcl::map::GetAllData");
+  return Gather(ScatterGetAllData());
+}
+
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+void map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::
+    GetAllData(
+        std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+            callback) {
+  AutoTrace trace = AutoTrace("hcl::map::GetAllData");
+  for (auto &future : ScatterGetAllData()) {
+    auto server = future.get();
+    callback(server);
+  }
+}
+
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::LocalContainsInServer(KeyType &key_start, KeyType &key_end) {
   AutoTrace trace = AutoTrace("hcl::map::ContainsInServer", key_start, key_end);
   auto final_values = std::vector<std::pair<KeyType, MappedType>>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
     typename MyMap::iterator lower_bound;
     size_t size = mymap->size();
     if (size == 0) {
@@ -205,30 +380,29 @@ map<KeyType, MappedType, Compare, Allocator, SharedType>::LocalContainsInServer(
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
-map<KeyType, MappedType, Compare, Allocator, SharedType>::ContainsInServer(
-    KeyType &key_start, KeyType &key_end) {
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::ContainsInServer(KeyType &key_start, KeyType &key_end) {
   if (is_local()) {
     return LocalContainsInServer(key_start, key_end);
   } else {
     typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server;
-    return RPC_CALL_WRAPPER("_Contains", my_server_i, ret_type, key_start,
+    return RPC_CALL_WRAPPER(remote.contains, my_server_i, ret_type, key_start,
                             key_end);
   }
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
 map<KeyType, MappedType, Compare, Allocator,
-    SharedType>::LocalGetAllDataInServer() {
+    SharedType, Partitioner>::LocalGetAllDataInServer() {
   AutoTrace trace = AutoTrace("hcl::map::GetAllDataInServer", NULL);
   auto final_values = std::vector<std::pair<KeyType, MappedType>>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
     typename MyMap::iterator lower_bound;
     lower_bound = mymap->begin();
     while (lower_bound != mymap->end()) {
@@ -242,16 +416,524 @@ map<KeyType, MappedType, Compare, Allocator,
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
-map<KeyType, MappedType, Compare, Allocator, SharedType>::GetAllDataInServer() {
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::GetAllDataInServer() {
   if (is_local()) {
     return LocalGetAllDataInServer();
   } else {
     typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server;
-    return RPC_CALL_WRAPPER1("_GetAllData", my_server_i, ret_type);
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+    if (may_use_rdma<MappedType>()) return GetAllDataBulk(my_server_i);
+#endif
+    return RPC_CALL_WRAPPER1(remote.get_all_data, my_server_i, ret_type);
   }
 }
 
+/**
+ * Read one page of the local map, in key order, starting after position.
+ * The mutex is held only while the page is copied; entries put or erased
+ * between pages are seen if they sort after the position.
+ * @param position, (entries with the last key already read, the last key);
+ * (0, any) starts at the first key
+ * @param max_items, the most entries to return
+ * @param max_bytes, the most key and value bytes to return; the first entry
+ * is always returned so that the scan advances
+ * @return the position of the next page, SCAN_END once the map is read, and
+ * the entries of this page
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<std::pair<uint64_t, KeyType>,
+          std::vector<std::pair<KeyType, MappedType>>>
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::LocalScan(std::pair<uint64_t, KeyType> &position,
+                            uint32_t max_items, uint64_t max_bytes) {
+  AutoTrace trace = AutoTrace("hcl::map::Scan(local)", max_items);
+  std::vector<std::pair<KeyType, MappedType>> page;
+  uint64_t read = position.first, bytes = 0;
+  KeyType last = position.second;
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  typename MyMap::iterator iterator = mymap->begin();
+  if (read > 0) {
+    iterator = mymap->lower_bound(last);
+    for (uint64_t i = 0; i < read && iterator != mymap->end() &&
+                         !Compare()(last, iterator->first);
+         ++i)
+      ++iterator;
+  }
+  for (; iterator != mymap->end(); ++iterator) {
+    uint64_t size = CalculateSize<KeyType>().GetSize(iterator->first) +
+                    CalculateSize<MappedType>().GetSize(iterator->second);
+    if (!page.empty() &&
+        (page.size() >= max_items || bytes + size > max_bytes)) {
+      return std::make_pair(std::make_pair(read, last), page);
+    }
+    if (read > 0 && !Compare()(last, iterator->first)) {
+      ++read;
+    } else {
+      read = 1;
+      last = iterator->first;
+    }
+    page.emplace_back(iterator->first, iterator->second);
+    bytes += size;
+  }
+  return std::make_pair(std::make_pair(SCAN_END, last), page);
+}
+
+/**
+ * Start a scan of the whole map. Pages are read with NextBatch.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+typename map<KeyType, MappedType, Compare, Allocator, SharedType,
+             Partitioner>::Cursor
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::OpenScan() {
+  return Cursor();
+}
+
+/**
+ * Read the next page of a scan. Servers are read one after another in id
+ * order, each in key order; with an ordered partitioner the whole scan is in
+ * key order.
+ * @param cursor, the scan, advanced past the returned entries
+ * @param max_items, the most entries to return; 0 returns one at a time
+ * @param max_bytes, the most key and value bytes to return
+ * @return the entries of the page; empty once the scan is done
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::NextBatch(Cursor &cursor, uint32_t max_items,
+                            uint64_t max_bytes) {
+  typedef std::pair<std::pair<uint64_t, KeyType>,
+                    std::vector<std::pair<KeyType, MappedType>>>
+      ret_type;
+  while (!cursor.done) {
+    ret_type result;
+    if (is_local(cursor.server)) {
+      result = LocalScan(cursor.position, max_items, max_bytes);
+    } else {
+      AutoTrace trace = AutoTrace("hcl::map::Scan(remote)", cursor.server);
+      result = RPC_CALL_WRAPPER(remote.scan, cursor.server, ret_type,
+                                cursor.position, max_items, max_bytes);
+    }
+    cursor.position = result.first;
+    if (cursor.position.first == SCAN_END) {
+      cursor.position = std::pair<uint64_t, KeyType>();
+      cursor.done = ++cursor.server >= num_servers;
+    }
+    if (!result.second.empty()) return result.second;
+  }
+  return std::vector<std::pair<KeyType, MappedType>>();
+}
+
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+void map<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::CloseScan(Cursor &cursor) {
+  cursor.done = true;
+}
+
+/**
+ * Registers function as the callback named callback in this process and, on a
+ * server, binds the operations that run it. Every process that may run a
+ * callback locally (servers and clients on their node) must bind it, with the
+ * same Ret and CB_Args, which the callers must name in turn.
+ * @param callback, the name of the callback
+ * @param function, a callable of type Callback<Ret, CB_Args...>
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args, typename Function>
+void map<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::BindCallback(const std::string &callback,
+                                    Function function) {
+  add_callback(callback, Callback<Ret, CB_Args...>(function));
+  if (!is_server) return;
+  std::function<Ret(KeyType &, MappedType &, CB_Args &...)> putFunc(
+      [this, callback](KeyType &key, MappedType &data, CB_Args &... cb_args) {
+        return LocalPutCallback<Ret, CB_Args...>(callback, key, data,
+                                                 cb_args...);
+      });
+  std::function<Ret(KeyType &, CB_Args &...)> getFunc(
+      [this, callback](KeyType &key, CB_Args &... cb_args) {
+        return LocalGetCallback<Ret, CB_Args...>(callback, key, cb_args...);
+      });
+  std::function<Ret(KeyType &, CB_Args &...)> eraseFunc(
+      [this, callback](KeyType &key, CB_Args &... cb_args) {
+        return LocalEraseCallback<Ret, CB_Args...>(callback, key, cb_args...);
+      });
+  bind_handler("_PutCB_" + callback, putFunc);
+  bind_handler("_GetCB_" + callback, getFunc);
+  bind_handler("_EraseCB_" + callback, eraseFunc);
+}
+
+/**
+ * Puts the data into the local map, then runs the callback. The callback
+ * runs after the map is unlocked, so it may use other containers.
+ * @param callback, the name the callback was bound with
+ * @param key, the key for put
+ * @param data, the value for put
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret map<KeyType, MappedType, Compare, Allocator, SharedType,
+        Partitioner>::LocalPutCallback(const std::string &callback,
+                                       KeyType &key, MappedType &data,
+                                       CB_Args &... cb_args) {
+  auto function = find_callback<Callback<Ret, CB_Args...>>(callback);
+  /* LocalPut moves out of data, so the callback gets a copy taken first */
+  std::pair<bool, MappedType> result(false, data);
+  result.first = LocalPut(key, data);
+  return (*function)(key, result, cb_args...);
+}
+
+/**
+ * Gets the data from the local map and runs the callback on it.
+ * @param callback, the name the callback was bound with
+ * @param key, key to get
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret map<KeyType, MappedType, Compare, Allocator, SharedType,
+        Partitioner>::LocalGetCallback(const std::string &callback,
+                                       KeyType &key, CB_Args &... cb_args) {
+  auto function = find_callback<Callback<Ret, CB_Args...>>(callback);
+  std::pair<bool, MappedType> result = LocalGet(key);
+  return (*function)(key, result, cb_args...);
+}
+
+/**
+ * Erases the key from the local map and runs the callback on the
+ * erased value.
+ * @param callback, the name the callback was bound with
+ * @param key, key to erase
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret map<KeyType, MappedType, Compare, Allocator, SharedType,
+        Partitioner>::LocalEraseCallback(const std::string &callback,
+                                         KeyType &key, CB_Args &... cb_args) {
+  auto function = find_callback<Callback<Ret, CB_Args...>>(callback);
+  std::pair<bool, MappedType> result = LocalErase(key);
+  return (*function)(key, result, cb_args...);
+}
+
+/**
+ * Put the data into the map and run a callback on the key's server
+ * in the same RPC.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @param callback, the name the callback was bound with
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::Put(
+    KeyType &key, MappedType &data, const std::string &callback,
+    CB_Args... cb_args) {
+  uint16_t key_int = KeyServer(key);
+  if (is_local(key_int)) {
+    return LocalPutCallback<Ret, CB_Args...>(callback, key, data, cb_args...);
+  } else {
+    std::string funcname = "_PutCB_" + callback;
+    return RPC_CALL_WRAPPER_CB(procedure(funcname.c_str()), key_int, Ret, key,
+                               data);
+  }
+}
+
+/**
+ * Get the data in the map and run a callback on it on the key's
+ * server, so that only what the callback derives from it is sent back.
+ * @param key, key to get
+ * @param callback, the name the callback was bound with
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::Get(
+    KeyType &key, const std::string &callback, CB_Args... cb_args) {
+  uint16_t key_int = KeyServer(key);
+  if (is_local(key_int)) {
+    return LocalGetCallback<Ret, CB_Args...>(callback, key, cb_args...);
+  } else {
+    std::string funcname = "_GetCB_" + callback;
+    return RPC_CALL_WRAPPER_CB(procedure(funcname.c_str()), key_int, Ret,
+                               key);
+  }
+}
+
+/**
+ * Erase the key from the map and run a callback on the erased value
+ * on the key's server in the same RPC.
+ * @param key, key to erase
+ * @param callback, the name the callback was bound with
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret map<KeyType, MappedType, Compare, Allocator, SharedType,
+        Partitioner>::Erase(KeyType &key, const std::string &callback,
+                            CB_Args... cb_args) {
+  uint16_t key_int = KeyServer(key);
+  if (is_local(key_int)) {
+    return LocalEraseCallback<Ret, CB_Args...>(callback, key, cb_args...);
+  } else {
+    std::string funcname = "_EraseCB_" + callback;
+    return RPC_CALL_WRAPPER_CB(procedure(funcname.c_str()), key_int, Ret,
+                               key);
+  }
+}
+
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+/**
+ * Put a value the client exposed as an RDMA bulk. Fixed size values are pulled
+ * straight into their node in the segment while the mutex is held; other
+ * values are pulled into a buffer that LocalPut then moves into the map.
+ * @param endpoint, the client that owns the bulk
+ * @param key, the key for put
+ * @param bulk_handle, the client's exposure of the value
+ * @return bool, true if Put was successful else false.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+bool map<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::LocalPutBulk(tl::endpoint endpoint, KeyType &key,
+                                    tl::bulk &bulk_handle) {
+  if constexpr (RDMABuffer<MappedType>::fixed_size &&
+                std::is_same<Allocator, nullptr_t>::value) {
+    if (bulk_handle.size() != sizeof(MappedType)) return false;
+    bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+    auto iter = mymap->try_emplace(key);
+    rpc->pull_rdma(endpoint, bulk_handle, 0, iter.first->second);
+    return true;
+  } else {
+    MappedType data = rpc->prep_rdma_server<MappedType>(endpoint, bulk_handle);
+    return LocalPut(key, data);
+  }
+}
+
+/**
+ * Get the data in the local map if it is below the RDMA threshold,
+ * otherwise only its size so that the client can fetch it with GetBulk.
+ * @param key, key to get
+ * @return a pair of (found, size) and the value when it was small enough.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<std::pair<bool, size_t>, MappedType>
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::LocalGetOrSize(KeyType &key) {
+  typedef std::pair<std::pair<bool, size_t>, MappedType> ret_type;
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  typename MyMap::iterator iterator = mymap->find(key);
+  if (iterator == mymap->end()) {
+    return ret_type(std::pair<bool, size_t>(false, 0), MappedType());
+  }
+  size_t size = RDMABuffer<MappedType>::size(iterator->second);
+  if (size < HCL_CONF->RDMA_THRESHOLD) {
+    return ret_type(std::pair<bool, size_t>(true, size), iterator->second);
+  }
+  return ret_type(std::pair<bool, size_t>(true, size), MappedType());
+}
+
+/**
+ * Push a value from its node in the segment into the client's bulk. Nothing is
+ * written when the bulk is too small; the size tells the client to retry.
+ * @param endpoint, the client that owns the bulk
+ * @param key, key to get
+ * @param bulk_handle, the client's buffer for the value
+ * @return a pair of (found, size of the value).
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<bool, size_t> map<KeyType, MappedType, Compare, Allocator, SharedType,
+                            Partitioner>::LocalGetBulk(
+    tl::endpoint endpoint, KeyType &key, tl::bulk &bulk_handle) {
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  typename MyMap::iterator iterator = mymap->find(key);
+  if (iterator == mymap->end()) {
+    return std::pair<bool, size_t>(false, 0);
+  }
+  size_t size = RDMABuffer<MappedType>::size(iterator->second);
+  if (size > 0 && size <= bulk_handle.size()) {
+    rpc->push_rdma(endpoint, bulk_handle, 0, iterator->second);
+  }
+  return std::pair<bool, size_t>(true, size);
+}
+
+/**
+ * Split the local map into values below the RDMA threshold, which
+ * are returned inline, and the keys and sizes of the values above it.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<std::vector<std::pair<KeyType, MappedType>>,
+          std::vector<std::pair<KeyType, size_t>>>
+map<KeyType, MappedType, Compare, Allocator,
+    SharedType, Partitioner>::LocalGetAllDataSplit() {
+  std::pair<std::vector<std::pair<KeyType, MappedType>>,
+            std::vector<std::pair<KeyType, size_t>>>
+      final_values;
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  for (auto &entry : *mymap) {
+    size_t size = RDMABuffer<MappedType>::size(entry.second);
+    if (size > 0 && size >= HCL_CONF->RDMA_THRESHOLD) {
+      final_values.second.emplace_back(entry.first, size);
+    } else {
+      final_values.first.emplace_back(entry.first, entry.second);
+    }
+  }
+  return final_values;
+}
+
+/**
+ * Push several values into consecutive segments of the client's bulk. A value
+ * is only pushed if its size still matches the one the client allocated for.
+ * @param endpoint, the client that owns the bulk
+ * @param keys, keys to get
+ * @param sizes, the size of each key's segment in the bulk
+ * @param bulk_handle, the client's buffers for the values
+ * @return the current size of each value, 0 if it no longer exists.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<size_t> map<KeyType, MappedType, Compare, Allocator, SharedType,
+                        Partitioner>::LocalGetBulkBatch(
+    tl::endpoint endpoint, std::vector<KeyType> &keys,
+    std::vector<size_t> &sizes, tl::bulk &bulk_handle) {
+  std::vector<size_t> final_sizes(keys.size(), 0);
+  size_t offset = 0;
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    typename MyMap::iterator iterator = mymap->find(keys[i]);
+    if (iterator != mymap->end()) {
+      final_sizes[i] = RDMABuffer<MappedType>::size(iterator->second);
+      if (final_sizes[i] == sizes[i]) {
+        rpc->push_rdma(endpoint, bulk_handle, offset, iterator->second);
+      }
+    }
+    offset += sizes[i];
+  }
+  return final_sizes;
+}
+
+/**
+ * Put a value on a remote server by exposing it in place as an RDMA bulk.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+bool
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::PutBulk(
+    uint16_t key_int, KeyType &key, MappedType &data) {
+  tl::bulk bulk_handle = rpc->prep_rdma_client(data);
+  return rpc->call<bool>(key_int, remote.put_bulk, key, bulk_handle);
+}
+
+/**
+ * Get a value from a remote server by RDMA bulk. Variable sized values are
+ * first looked up with GetOrSize, which returns small values inline.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<bool, MappedType>
+map<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::GetBulk(
+    uint16_t key_int, KeyType &key) {
+  typedef std::pair<bool, size_t> size_type;
+  size_t size = sizeof(MappedType);
+  if (!RDMABuffer<MappedType>::fixed_size) {
+    typedef std::pair<size_type, MappedType> ret_type;
+    ret_type result =
+        rpc->call<ret_type>(key_int, remote.get_or_size, key);
+    if (!result.first.first || result.first.second < HCL_CONF->RDMA_THRESHOLD)
+      return std::pair<bool, MappedType>(result.first.first,
+                                         std::move(result.second));
+    size = result.first.second;
+  }
+  MappedType value;
+  while (true) {
+    RDMABuffer<MappedType>::resize(value, size);
+    tl::bulk bulk_handle =
+        rpc->prep_rdma_client(value, tl::bulk_mode::write_only);
+    size_type result =
+        rpc->call<size_type>(key_int, remote.get_bulk, key, bulk_handle);
+    if (!result.first) return std::pair<bool, MappedType>(false, MappedType());
+    if (result.second <= size) {
+      RDMABuffer<MappedType>::resize(value, result.second);
+      return std::pair<bool, MappedType>(true, std::move(value));
+    }
+    /* The value grew since it was sized; retry with the new size. */
+    size = result.second;
+  }
+}
+
+/**
+ * Get all data of a remote server. Small values come back inline and the
+ * large ones are pushed by the server into a single multi-segment bulk; the
+ * two parts are merged back into key order.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType,
+    Partitioner>::GetAllDataBulk(uint16_t server) {
+  typedef std::pair<std::vector<std::pair<KeyType, MappedType>>,
+                    std::vector<std::pair<KeyType, size_t>>>
+      split_type;
+  split_type split =
+      rpc->call<split_type>(server, remote.get_all_data_split);
+  std::vector<std::pair<KeyType, MappedType>> final_values =
+      std::move(split.first);
+  if (split.second.empty()) return final_values;
+  std::vector<KeyType> keys;
+  std::vector<size_t> sizes;
+  std::vector<MappedType> values(split.second.size());
+  for (std::size_t i = 0; i < split.second.size(); ++i) {
+    keys.push_back(split.second[i].first);
+    sizes.push_back(split.second[i].second);
+    RDMABuffer<MappedType>::resize(values[i], sizes[i]);
+  }
+  tl::bulk bulk_handle =
+      rpc->prep_rdma_client_batch(values, tl::bulk_mode::write_only);
+  std::vector<size_t> final_sizes = rpc->call<std::vector<size_t>>(
+      server, remote.get_bulk_batch, keys, sizes, bulk_handle);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    if (final_sizes[i] == sizes[i]) {
+      final_values.emplace_back(keys[i], std::move(values[i]));
+    } else if (final_sizes[i] != 0) {
+      /* The value changed size in between; fetch it on its own. */
+      auto value = GetBulk(server, keys[i]);
+      if (value.first)
+        final_values.emplace_back(keys[i], std::move(value.second));
+    }
+  }
+  std::sort(final_values.begin(), final_values.end(),
+            [](const std::pair<KeyType, MappedType> &lhs,
+               const std::pair<KeyType, MappedType> &rhs) {
+              return Compare()(lhs.first, rhs.first);
+            });
+  return final_values;
+}
+#endif
+
 #endif  // INCLUDE_HCL_MAP_MAP_CPP_
@@ -41,13 +41,18 @@
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/containers/map.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
 /** Standard C++ Headers**/
 #include <hcl/common/container.h>
+#include <hcl/common/partitioner.h>
 
+#include <algorithm>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <string>
@@ -61,10 +66,11 @@ namespace hcl {
  * achieve the data structure.
  *
  * @tparam MappedType, the value of the Map
+ * @tparam Partitioner, policy choosing the server of a key from its hash
  */
 template <typename KeyType, typename MappedType,
           typename Compare = std::less<KeyType>, class Allocator = nullptr_t,
-          class SharedType = nullptr_t>
+          class SharedType = nullptr_t, class Partitioner = ModuloPartitioner>
 class map : public container {
  private:
   /** Class Typedefs for ease of use **/
@@ -77,8 +83,33 @@ class map : public container {
   /** Class attributes**/
   MyMap *mymap;
   std::hash<KeyType> keyHash;
+  Partitioner keyPartitioner;
+  /* Handles of the remote operations, resolved by the constructor */
+  struct {
+    RPC::Procedure put, get, erase, contains, get_all_data, scan,
+        get_all_data_split, put_bulk, get_or_size, get_bulk, get_bulk_batch;
+  } remote;
+
+  /** The server that owns key; ordered partitioners see the key itself. */
+  inline uint16_t KeyServer(KeyType &key) {
+    if constexpr (is_ordered_partitioner<Partitioner>::value) {
+      return keyPartitioner(key);
+    } else {
+      return keyPartitioner(keyHash(key));
+    }
+  }
+
+  std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+  ScatterContains(KeyType &key_start, KeyType &key_end);
+  std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+  ScatterGetAllData();
+  std::vector<std::pair<KeyType, MappedType>> Gather(
+      std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+          futures);
 
  public:
+  typedef ScanCursor<std::pair<uint64_t, KeyType>> Cursor;
+
   ~map() { this->container::~container(); }
 
   void construct_shared_memory() override {
@@ -97,29 +128,32 @@ class map : public container {
 #ifdef HCL_ENABLE_RPCLIB
       case RPCLIB: {
         std::function<bool(KeyType &, MappedType &)> putFunc(
-            std::bind(&map<KeyType, MappedType, Compare>::LocalPut, this,
-                      std::placeholders::_1, std::placeholders::_2));
+            std::bind(&map::LocalPut, this, std::placeholders::_1,
+                      std::placeholders::_2));
         std::function<std::pair<bool, MappedType>(KeyType &)> getFunc(
-            std::bind(&map<KeyType, MappedType, Compare>::LocalGet, this,
-                      std::placeholders::_1));
+            std::bind(&map::LocalGet, this, std::placeholders::_1));
         std::function<std::pair<bool, MappedType>(KeyType &)> eraseFunc(
-            std::bind(&map<KeyType, MappedType, Compare>::LocalErase, this,
-                      std::placeholders::_1));
+            std::bind(&map::LocalErase, this, std::placeholders::_1));
         std::function<std::vector<std::pair<KeyType, MappedType>>(void)>
             getAllDataInServerFunc(std::bind(
-                &map<KeyType, MappedType, Compare>::LocalGetAllDataInServer,
-                this));
+                &map::LocalGetAllDataInServer, this));
         std::function<std::vector<std::pair<KeyType, MappedType>>(KeyType &,
                                                                   KeyType &)>
-            containsInServerFunc(std::bind(
-                &map<KeyType, MappedType, Compare>::LocalContainsInServer, this,
-                std::placeholders::_1, std::placeholders::_2));
+            containsInServerFunc(std::bind(&map::LocalContainsInServer, this,
+                                           std::placeholders::_1,
+                                           std::placeholders::_2));
+        std::function<std::pair<std::pair<uint64_t, KeyType>,
+                                std::vector<std::pair<KeyType, MappedType>>>(
+            std::pair<uint64_t, KeyType> &, uint32_t, uint64_t)>
+            scanFunc(std::bind(&map::LocalScan, this, std::placeholders::_1,
+                               std::placeholders::_2, std::placeholders::_3));
 
         rpc->bind(func_prefix + "_Put", putFunc);
         rpc->bind(func_prefix + "_Get", getFunc);
         rpc->bind(func_prefix + "_Erase", eraseFunc);
         rpc->bind(func_prefix + "_GetAllData", getAllDataInServerFunc);
         rpc->bind(func_prefix + "_Contains", containsInServerFunc);
+        rpc->bind(func_prefix + "_Scan", scanFunc);
         break;
       }
 #endif
@@ -134,31 +168,63 @@ class map : public container {
 
         std::function<void(const tl::request &, KeyType &, MappedType &)>
             putFunc(
-                std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalPut,
-                          this, std::placeholders::_1, std::placeholders::_2,
-                          std::placeholders::_3));
+                std::bind(&map::ThalliumLocalPut, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
         std::function<void(const tl::request &, KeyType &)> getFunc(
-            std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalGet,
-                      this, std::placeholders::_1, std::placeholders::_2));
+            std::bind(&map::ThalliumLocalGet, this, std::placeholders::_1,
+                      std::placeholders::_2));
         std::function<void(const tl::request &, KeyType &)> eraseFunc(
-            std::bind(&map<KeyType, MappedType, Compare>::ThalliumLocalErase,
-                      this, std::placeholders::_1, std::placeholders::_2));
+            std::bind(&map::ThalliumLocalErase, this, std::placeholders::_1,
+                      std::placeholders::_2));
         std::function<void(const tl::request &)> getAllDataInServerFunc(
-            std::bind(&map<KeyType, MappedType,
-                           Compare>::ThalliumLocalGetAllDataInServer,
-                      this, std::placeholders::_1));
+            std::bind(&map::ThalliumLocalGetAllDataInServer, this,
+                      std::placeholders::_1));
         std::function<void(const tl::request &, KeyType &, KeyType &)>
             containsInServerFunc(
-                std::bind(&map<KeyType, MappedType,
-                               Compare>::ThalliumLocalContainsInServer,
-                          this, std::placeholders::_1, std::placeholders::_2,
+                std::bind(&map::ThalliumLocalContainsInServer, this,
+                          std::placeholders::_1, std::placeholders::_2,
                           std::placeholders::_3));
+        std::function<void(const tl::request &, std::pair<uint64_t, KeyType> &,
+                           uint32_t, uint64_t)>
+            scanFunc(std::bind(&map::ThalliumLocalScan, this,
+                               std::placeholders::_1, std::placeholders::_2,
+                               std::placeholders::_3, std::placeholders::_4));
 
         rpc->bind(func_prefix + "_Put", putFunc);
         rpc->bind(func_prefix + "_Get", getFunc);
         rpc->bind(func_prefix + "_Erase", eraseFunc);
         rpc->bind(func_prefix + "_GetAllData", getAllDataInServerFunc);
         rpc->bind(func_prefix + "_Contains", containsInServerFunc);
+        rpc->bind(func_prefix + "_Scan", scanFunc);
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+        std::function<void(const tl::request &, KeyType &, tl::bulk &)>
+            putBulkFunc(std::bind(&map::ThalliumLocalPutBulk, this,
+                                  std::placeholders::_1, std::placeholders::_2,
+                                  std::placeholders::_3));
+        std::function<void(const tl::request &, KeyType &)> getOrSizeFunc(
+            std::bind(&map::ThalliumLocalGetOrSize, this, std::placeholders::_1,
+                      std::placeholders::_2));
+        std::function<void(const tl::request &, KeyType &, tl::bulk &)>
+            getBulkFunc(std::bind(&map::ThalliumLocalGetBulk, this,
+                                  std::placeholders::_1, std::placeholders::_2,
+                                  std::placeholders::_3));
+        std::function<void(const tl::request &)> getAllDataSplitFunc(
+            std::bind(&map::ThalliumLocalGetAllDataSplit, this,
+                      std::placeholders::_1));
+        std::function<void(const tl::request &, std::vector<KeyType> &,
+                           std::vector<size_t> &, tl::bulk &)>
+            getBulkBatchFunc(std::bind(&map::ThalliumLocalGetBulkBatch, this,
+                                       std::placeholders::_1,
+                                       std::placeholders::_2,
+                                       std::placeholders::_3,
+                                       std::placeholders::_4));
+
+        rpc->bind(func_prefix + "_PutBulk", putBulkFunc);
+        rpc->bind(func_prefix + "_GetOrSize", getOrSizeFunc);
+        rpc->bind(func_prefix + "_GetBulk", getBulkFunc);
+        rpc->bind(func_prefix + "_GetAllDataSplit", getAllDataSplitFunc);
+        rpc->bind(func_prefix + "_GetBulkBatch", getBulkBatchFunc);
+#endif
         break;
       }
 #endif
@@ -166,9 +232,21 @@ class map : public container {
   }
 
   explicit map(CharStruct name_ = "TEST_MAP",
-               uint16_t port = HCL_CONF->RPC_PORT)
-      : container(name_, port), mymap() {
+               uint16_t port = HCL_CONF->RPC_PORT,
+               Partitioner partitioner = Partitioner(HCL_CONF->NUM_SERVERS))
+      : container(name_, port), mymap(), keyPartitioner(partitioner) {
     AutoTrace trace = AutoTrace("hcl::map");
+    remote.put = resolve("_Put");
+    remote.get = resolve("_Get");
+    remote.erase = resolve("_Erase");
+    remote.contains = resolve("_Contains");
+    remote.get_all_data = resolve("_GetAllData");
+    remote.scan = resolve("_Scan");
+    remote.get_all_data_split = resolve("_GetAllDataSplit");
+    remote.put_bulk = resolve("_PutBulk");
+    remote.get_or_size = resolve("_GetOrSize");
+    remote.get_bulk = resolve("_GetBulk");
+    remote.get_bulk_batch = resolve("_GetBulkBatch");
     if (is_server) {
       construct_shared_memory();
       bind_functions();
@@ -192,9 +270,38 @@ class map : public container {
 
   std::vector<std::pair<KeyType, MappedType>> LocalGetAllDataInServer();
 
+  std::pair<std::pair<uint64_t, KeyType>,
+            std::vector<std::pair<KeyType, MappedType>>>
+  LocalScan(std::pair<uint64_t, KeyType> &position, uint32_t max_items,
+            uint64_t max_bytes);
+
   std::vector<std::pair<KeyType, MappedType>> LocalContainsInServer(
       KeyType &key_start, KeyType &key_end);
 
+  /**
+   * A server side callback. It runs after Put, Get or Erase on key with the
+   * operation's result, i.e. (true, value) for Put and what Get or Erase
+   * return, and what it returns is all that goes back to the client.
+   */
+  template <typename Ret, typename... CB_Args>
+  using Callback = std::function<Ret(KeyType &, std::pair<bool, MappedType> &,
+                                     CB_Args &...)>;
+
+  template <typename Ret, typename... CB_Args, typename Function>
+  void BindCallback(const std::string &callback, Function function);
+
+  template <typename Ret, typename... CB_Args>
+  Ret LocalPutCallback(const std::string &callback, KeyType &key,
+                       MappedType &data, CB_Args &... cb_args);
+
+  template <typename Ret, typename... CB_Args>
+  Ret LocalGetCallback(const std::string &callback, KeyType &key,
+                       CB_Args &... cb_args);
+
+  template <typename Ret, typename... CB_Args>
+  Ret LocalEraseCallback(const std::string &callback, KeyType &key,
+                         CB_Args &... cb_args);
+
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
   THALLIUM_DEFINE(LocalPut, (key, data), KeyType &key, MappedType &data)
   THALLIUM_DEFINE(LocalGet, (key), KeyType &key)
@@ -202,6 +309,53 @@ class map : public container {
   THALLIUM_DEFINE(LocalContainsInServer, (key_start, key_end),
                   KeyType &key_start, KeyType &key_end)
   THALLIUM_DEFINE1(LocalGetAllDataInServer)
+  THALLIUM_DEFINE(LocalScan, (position, max_items, max_bytes),
+                  std::pair<uint64_t, KeyType> &position, uint32_t max_items,
+                  uint64_t max_bytes)
+#endif
+
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+  bool LocalPutBulk(tl::endpoint endpoint, KeyType &key, tl::bulk &bulk_handle);
+
+  std::pair<std::pair<bool, size_t>, MappedType> LocalGetOrSize(KeyType &key);
+
+  std::pair<bool, size_t> LocalGetBulk(tl::endpoint endpoint, KeyType &key,
+                                       tl::bulk &bulk_handle);
+
+  std::pair<std::vector<std::pair<KeyType, MappedType>>,
+            std::vector<std::pair<KeyType, size_t>>>
+  LocalGetAllDataSplit();
+
+  std::vector<size_t> LocalGetBulkBatch(tl::endpoint endpoint,
+                                        std::vector<KeyType> &keys,
+                                        std::vector<size_t> &sizes,
+                                        tl::bulk &bulk_handle);
+
+  void ThalliumLocalPutBulk(const tl::request &thallium_req, KeyType &key,
+                            tl::bulk &bulk_handle) {
+    thallium_req.respond(
+        LocalPutBulk(thallium_req.get_endpoint(), key, bulk_handle));
+  }
+  void ThalliumLocalGetBulk(const tl::request &thallium_req, KeyType &key,
+                            tl::bulk &bulk_handle) {
+    thallium_req.respond(
+        LocalGetBulk(thallium_req.get_endpoint(), key, bulk_handle));
+  }
+  void ThalliumLocalGetBulkBatch(const tl::request &thallium_req,
+                                 std::vector<KeyType> &keys,
+                                 std::vector<size_t> &sizes,
+                                 tl::bulk &bulk_handle) {
+    thallium_req.respond(LocalGetBulkBatch(thallium_req.get_endpoint(), keys,
+                                           sizes, bulk_handle));
+  }
+  THALLIUM_DEFINE(LocalGetOrSize, (key), KeyType &key)
+  THALLIUM_DEFINE1(LocalGetAllDataSplit)
+
+  bool PutBulk(uint16_t key_int, KeyType &key, MappedType &data);
+
+  std::pair<bool, MappedType> GetBulk(uint16_t key_int, KeyType &key);
+
+  std::vector<std::pair<KeyType, MappedType>> GetAllDataBulk(uint16_t server);
 #endif
 
   bool Put(KeyType &key, MappedType &data);
@@ -210,15 +364,47 @@ class map : public container {
 
   std::pair<bool, MappedType> Erase(KeyType &key);
 
+  template <typename Ret, typename... CB_Args>
+  Ret Put(KeyType &key, MappedType &data, const std::string &callback,
+          CB_Args... cb_args);
+
+  template <typename Ret, typename... CB_Args>
+  Ret Get(KeyType &key, const std::string &callback, CB_Args... cb_args);
+
+  template <typename Ret, typename... CB_Args>
+  Ret Erase(KeyType &key, const std::string &callback, CB_Args... cb_args);
+
   std::vector<std::pair<KeyType, MappedType>> Contains(KeyType &key_start,
                                                        KeyType &key_end);
 
   std::vector<std::pair<KeyType, MappedType>> GetAllData();
 
+  void Contains(
+      KeyType &key_start, KeyType &key_end,
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          callback);
+
+  void GetAllData(
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          callback);
+
   std::vector<std::pair<KeyType, MappedType>> ContainsInServer(
       KeyType &key_start, KeyType &key_end);
 
   std::vector<std::pair<KeyType, MappedType>> GetAllDataInServer();
+
+  std::future<bool> AsyncPut(KeyType &key, MappedType &data);
+
+  std::future<std::pair<bool, MappedType>> AsyncGet(KeyType &key);
+
+  std::future<std::pair<bool, MappedType>> AsyncErase(KeyType &key);
+
+  Cursor OpenScan();
+
+  std::vector<std::pair<KeyType, MappedType>> NextBatch(
+      Cursor &cursor, uint32_t max_items, uint64_t max_bytes = UINT64_MAX);
+
+  void CloseScan(Cursor &cursor);
 };
 
 #include "map.cpp"
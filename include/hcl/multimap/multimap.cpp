@@ -15,17 +15,24 @@
 
 /* Constructor to deallocate the shared memory*/
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-multimap<KeyType, MappedType, Compare, Allocator, SharedType>::~multimap() {
+          typename Allocator, typename SharedType, typename Partitioner>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::~multimap() {
   this->container::~container();
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-multimap<KeyType, MappedType, Compare, Allocator, SharedType>::multimap(
-    CharStruct name_, uint16_t port)
-    : container(name_, port), mymap() {
+          typename Allocator, typename SharedType, typename Partitioner>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::
+    multimap(CharStruct name_, uint16_t port, Partitioner partitioner)
+    : container(name_, port), keyPartitioner(partitioner), mymap() {
   AutoTrace trace = AutoTrace("hcl::multimap");
+  remote.put = resolve("_Put");
+  remote.get = resolve("_Get");
+  remote.erase = resolve("_Erase");
+  remote.contains = resolve("_Contains");
+  remote.get_all_data = resolve("_GetAllData");
+  remote.scan = resolve("_Scan");
   if (is_server) {
     construct_shared_memory();
     bind_functions();
@@ -41,12 +48,11 @@ multimap<KeyType, MappedType, Compare, Allocator, SharedType>::multimap(
  * @return bool, true if Put was successful else false.
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-bool multimap<KeyType, MappedType, Compare, Allocator, SharedType>::LocalPut(
-    KeyType &key, MappedType &data) {
+          typename Allocator, typename SharedType, typename Partitioner>
+bool multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+              Partitioner>::LocalPut(KeyType &key, MappedType &data) {
   AutoTrace trace = AutoTrace("hcl::multimap::Put(local)", key, data);
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   typename MyMap::iterator iterator = mymap->find(key);
   if (iterator != mymap->end()) {
     mymap->erase(iterator);
@@ -64,16 +70,16 @@ bool multimap<KeyType, MappedType, Compare, Allocator, SharedType>::LocalPut(
  * @return bool, true if Put was successful else false.
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-bool multimap<KeyType, MappedType, Compare, Allocator, SharedType>::Put(
+          typename Allocator, typename SharedType, typename Partitioner>
+bool
+multimap<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::Put(
     KeyType &key, MappedType &data) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
+  uint16_t key_int = KeyServer(key);
   if (is_local(key_int)) {
     return LocalPut(key, data);
   } else {
     AutoTrace trace = AutoTrace("hcl::multimap::Put(remote)", key, data);
-    return RPC_CALL_WRAPPER("_Put", key_int, bool, key, data);
+    return RPC_CALL_WRAPPER(remote.put, key_int, bool, key, data);
   }
 }
 
@@ -84,12 +90,12 @@ bool multimap<KeyType, MappedType, Compare, Allocator, SharedType>::Put(
  * found and is present in value part else bool is set to false
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::pair<bool, MappedType> multimap<KeyType, MappedType, Compare, Allocator,
-                                     SharedType>::LocalGet(KeyType &key) {
+                                     SharedType, Partitioner>::LocalGet(
+    KeyType &key) {
   AutoTrace trace = AutoTrace("hcl::multimap::Get(local)", key);
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   typename MyMap::iterator iterator = mymap->find(key);
   if (iterator != mymap->end()) {
     return std::pair<bool, MappedType>(true, iterator->second);
@@ -106,105 +112,202 @@ std::pair<bool, MappedType> multimap<KeyType, MappedType, Compare, Allocator,
  * found and is present in value part else bool is set to false
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-std::pair<bool, MappedType> multimap<KeyType, MappedType, Compare, Allocator,
-                                     SharedType>::Get(KeyType &key) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<bool, MappedType>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType, Partitioner>::Get(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
   if (is_local(key_int)) {
     return LocalGet(key);
   } else {
     AutoTrace trace = AutoTrace("hcl::multimap::Get(remote)", key);
     typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Get", key_int, ret_type, key);
+    return RPC_CALL_WRAPPER(remote.get, key_int, ret_type, key);
   }
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::pair<bool, MappedType> multimap<KeyType, MappedType, Compare, Allocator,
-                                     SharedType>::LocalErase(KeyType &key) {
+                                     SharedType, Partitioner>::LocalErase(
+    KeyType &key) {
   AutoTrace trace = AutoTrace("hcl::multimap::Erase(local)", key);
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   size_t s = mymap->erase(key);
   return std::pair<bool, MappedType>(s > 0, MappedType());
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::pair<bool, MappedType> multimap<KeyType, MappedType, Compare, Allocator,
-                                     SharedType>::Erase(KeyType &key) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+                                     SharedType, Partitioner>::Erase(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
   if (is_local(key_int)) {
     return LocalErase(key);
   } else {
     AutoTrace trace = AutoTrace("hcl::multimap::Erase(remote)", key);
     typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
+    return RPC_CALL_WRAPPER(remote.erase, key_int, ret_type, key);
   }
 }
 
 /**
- * Get the data in the multimap. Uses key to decide the server to hash it
- * to,
+ * Issues the Contains requests for key at once to every server, or with an
+ * ordered partitioner only to the server owning key; the entries matching
+ * key must then sort next to it, as LocalContainsInServer already assumes.
+ * The part of this client's own server is read from shared memory once every
+ * remote request is in flight.
+ * @return one future per server asked, in server id order
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::ScatterContains(KeyType &key) {
+  typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
+  std::vector<std::future<ret_type>> futures;
+  uint16_t first_server = 0, last_server = num_servers - 1;
+  if (is_ordered_partitioner<Partitioner>::value) {
+    first_server = last_server = KeyServer(key);
+  }
+  int local = -1;
+  for (uint16_t i = first_server; i <= last_server; ++i) {
+    if (is_local(i)) {
+      local = futures.size();
+      futures.emplace_back();
+      continue;
+    }
+    auto future = RPC_CALL_WRAPPER_ASYNC(remote.contains, i, ret_type, key);
+    futures.push_back(std::move(future));
+  }
+  if (local >= 0) futures[local] = ready_future(LocalContainsInServer(key));
+  return futures;
+}
+
+/**
+ * Issues the GetAllData requests of all servers at once, in the same way as
+ * ScatterContains.
+ * @return one future per server, indexed by server id
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::ScatterGetAllData() {
+  typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
+  std::vector<std::future<ret_type>> futures;
+  int local = -1;
+  for (int i = 0; i < num_servers; ++i) {
+    if (i == my_server && is_local()) {
+      local = i;
+      futures.emplace_back();
+      continue;
+    }
+    auto future = RPC_CALL_WRAPPER1_ASYNC(remote.get_all_data, i, ret_type);
+    futures.push_back(std::move(future));
+  }
+  if (local >= 0) futures[local] = ready_future(LocalGetAllDataInServer());
+  return futures;
+}
+
+/**
+ * Waits for the per-server results, each sorted by key, and returns them as
+ * one sorted vector. Ordered partitions are concatenated in server order;
+ * hash partitions are combined with a k-way merge.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::Gather(std::vector<std::future<
+                                  std::vector<std::pair<KeyType, MappedType>>>>
+                                  futures) {
+  typedef std::pair<KeyType, MappedType> value_type;
+  std::vector<std::vector<value_type>> runs;
+  for (auto &future : futures) runs.push_back(future.get());
+  if (is_ordered_partitioner<Partitioner>::value) {
+    std::vector<value_type> final_values;
+    for (auto &run : runs) {
+      final_values.insert(final_values.end(),
+                          std::make_move_iterator(run.begin()),
+                          std::make_move_iterator(run.end()));
+    }
+    return final_values;
+  }
+  return merge_runs(runs, [](const value_type &a, const value_type &b) {
+    return Compare()(a.first, b.first);
+  });
+}
+
+/**
+ * Get the data in the multimap matching key. The servers are asked
+ * concurrently and the result is in key order.
  * @param key, key to get
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * @return the matching key value pairs, sorted by key
  */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
-multimap<KeyType, MappedType, Compare, Allocator, SharedType>::Contains(
-    KeyType &key) {
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::Contains(KeyType &key) {
   AutoTrace trace = AutoTrace("hcl::multimap::Contains", key);
-  std::vector<std::pair<KeyType, MappedType>> final_values =
-      std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = ContainsInServer(key);
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server) {
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server = RPC_CALL_WRAPPER("_Contains", i, ret_type, key);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
+  return Gather(ScatterContains(key));
+}
+
+/**
+ * Get the data in the multimap matching key one server at a time, without
+ * collecting it in one vector. The servers are asked concurrently.
+ * @param callback, called with the sorted data of each server in server id
+ * order
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+void multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+              Partitioner>::
+    Contains(KeyType &key,
+             std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+                 callback) {
+  AutoTrace trace = AutoTrace("hcl::multimap::Contains", key);
+  for (auto &future : ScatterContains(key)) {
+    auto server = future.get();
+    callback(server);
   }
-  return final_values;
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
-multimap<KeyType, MappedType, Compare, Allocator, SharedType>::GetAllData() {
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::GetAllData() {
   AutoTrace trace = AutoTrace("hcl::multimap::GetAllData");
-  std::vector<std::pair<KeyType, MappedType>> final_values =
-      std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = GetAllDataInServer();
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server) {
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server = RPC_CALL_WRAPPER1("_GetAllData", i, ret_type);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
+  return Gather(ScatterGetAllData());
+}
+
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+void multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+              Partitioner>::
+    GetAllData(
+        std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+            callback) {
+  AutoTrace trace = AutoTrace("hcl::multimap::GetAllData");
+  for (auto &future : ScatterGetAllData()) {
+    auto server = future.get();
+    callback(server);
   }
-  return final_values;
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
 multimap<KeyType, MappedType, Compare, Allocator,
-         SharedType>::LocalContainsInServer(KeyType &key) {
+         SharedType, Partitioner>::LocalContainsInServer(KeyType &key) {
   AutoTrace trace = AutoTrace("hcl::multimap::ContainsInServer", key);
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
     typename MyMap::iterator lower_bound;
     size_t size = mymap->size();
     if (size == 0) {
@@ -235,30 +338,29 @@ multimap<KeyType, MappedType, Compare, Allocator,
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
-multimap<KeyType, MappedType, Compare, Allocator, SharedType>::ContainsInServer(
-    KeyType &key) {
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::ContainsInServer(KeyType &key) {
   if (is_local()) {
     return LocalContainsInServer(key);
   } else {
     typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server;
-    return RPC_CALL_WRAPPER("_Contains", my_server_i, ret_type, key);
+    return RPC_CALL_WRAPPER(remote.contains, my_server_i, ret_type, key);
   }
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
 multimap<KeyType, MappedType, Compare, Allocator,
-         SharedType>::LocalGetAllDataInServer() {
+         SharedType, Partitioner>::LocalGetAllDataInServer() {
   AutoTrace trace = AutoTrace("hcl::multimap::GetAllDataInServer");
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
     typename MyMap::iterator lower_bound;
     lower_bound = mymap->begin();
     while (lower_bound != mymap->end()) {
@@ -272,71 +374,190 @@ multimap<KeyType, MappedType, Compare, Allocator,
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
-std::vector<std::pair<KeyType, MappedType>> multimap<
-    KeyType, MappedType, Compare, Allocator, SharedType>::GetAllDataInServer() {
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::GetAllDataInServer() {
   if (is_local()) {
     return LocalGetAllDataInServer();
   } else {
     typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server;
-    return RPC_CALL_WRAPPER1("_GetAllData", my_server_i, ret_type);
+    return RPC_CALL_WRAPPER1(remote.get_all_data, my_server_i, ret_type);
   }
 }
 
+/**
+ * Read one page of the local multimap, in key order, starting after position.
+ * The mutex is held only while the page is copied; entries put or erased
+ * between pages are seen if they sort after the position.
+ * @param position, (entries with the last key already read, the last key);
+ * (0, any) starts at the first key. Counting the entries read with the last
+ * key lets a page end between duplicates of a key.
+ * @param max_items, the most entries to return
+ * @param max_bytes, the most key and value bytes to return; the first entry
+ * is always returned so that the scan advances
+ * @return the position of the next page, SCAN_END once the multimap is read,
+ * and the entries of this page
+ */
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<std::pair<uint64_t, KeyType>,
+          std::vector<std::pair<KeyType, MappedType>>>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::LocalScan(std::pair<uint64_t, KeyType> &position,
+                                 uint32_t max_items, uint64_t max_bytes) {
+  AutoTrace trace = AutoTrace("hcl::multimap::Scan(local)", max_items);
+  std::vector<std::pair<KeyType, MappedType>> page;
+  uint64_t read = position.first, bytes = 0;
+  KeyType last = position.second;
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  typename MyMap::iterator iterator = mymap->begin();
+  if (read > 0) {
+    iterator = mymap->lower_bound(last);
+    for (uint64_t i = 0; i < read && iterator != mymap->end() &&
+                         !Compare()(last, iterator->first);
+         ++i)
+      ++iterator;
+  }
+  for (; iterator != mymap->end(); ++iterator) {
+    uint64_t size = CalculateSize<KeyType>().GetSize(iterator->first) +
+                    CalculateSize<MappedType>().GetSize(iterator->second);
+    if (!page.empty() &&
+        (page.size() >= max_items || bytes + size > max_bytes)) {
+      return std::make_pair(std::make_pair(read, last), page);
+    }
+    if (read > 0 && !Compare()(last, iterator->first)) {
+      ++read;
+    } else {
+      read = 1;
+      last = iterator->first;
+    }
+    page.emplace_back(iterator->first, iterator->second);
+    bytes += size;
+  }
+  return std::make_pair(std::make_pair(SCAN_END, last), page);
+}
+
+/**
+ * Start a scan of the whole multimap. Pages are read with NextBatch.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+typename multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+                  Partitioner>::Cursor
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::OpenScan() {
+  return Cursor();
+}
+
+/**
+ * Read the next page of a scan. Servers are read one after another in id
+ * order, each in key order; with an ordered partitioner the whole scan is in
+ * key order.
+ * @param cursor, the scan, advanced past the returned entries
+ * @param max_items, the most entries to return; 0 returns one at a time
+ * @param max_bytes, the most key and value bytes to return
+ * @return the entries of the page; empty once the scan is done
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+         Partitioner>::NextBatch(Cursor &cursor, uint32_t max_items,
+                                 uint64_t max_bytes) {
+  typedef std::pair<std::pair<uint64_t, KeyType>,
+                    std::vector<std::pair<KeyType, MappedType>>>
+      ret_type;
+  while (!cursor.done) {
+    ret_type result;
+    if (is_local(cursor.server)) {
+      result = LocalScan(cursor.position, max_items, max_bytes);
+    } else {
+      AutoTrace trace =
+          AutoTrace("hcl::multimap::Scan(remote)", cursor.server);
+      result = RPC_CALL_WRAPPER(remote.scan, cursor.server, ret_type,
+                                cursor.position, max_items, max_bytes);
+    }
+    cursor.position = result.first;
+    if (cursor.position.first == SCAN_END) {
+      cursor.position = std::pair<uint64_t, KeyType>();
+      cursor.done = ++cursor.server >= num_servers;
+    }
+    if (!result.second.empty()) return result.second;
+  }
+  return std::vector<std::pair<KeyType, MappedType>>();
+}
+
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
+void multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+              Partitioner>::CloseScan(Cursor &cursor) {
+  cursor.done = true;
+}
+
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType, typename Partitioner>
 void multimap<KeyType, MappedType, Compare, Allocator,
-              SharedType>::construct_shared_memory() {
+              SharedType, Partitioner>::construct_shared_memory() {
   ShmemAllocator alloc_inst(segment.get_segment_manager());
   /* Construct Multimap in the shared memory space. */
   mymap = segment.construct<MyMap>(name.c_str())(Compare(), alloc_inst);
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 void multimap<KeyType, MappedType, Compare, Allocator,
-              SharedType>::open_shared_memory() {
+              SharedType, Partitioner>::open_shared_memory() {
   std::pair<MyMap *, boost::interprocess::managed_mapped_file::size_type> res;
   res = segment.find<MyMap>(name.c_str());
   mymap = res.first;
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 void multimap<KeyType, MappedType, Compare, Allocator,
-              SharedType>::bind_functions() {
+              SharedType, Partitioner>::bind_functions() {
   /* Create a RPC server and map the methods to it. */
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_ENABLE_RPCLIB
     case RPCLIB: {
       std::function<bool(KeyType &, MappedType &)> putFunc(
           std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
-                              SharedType>::LocalPut,
-                    this, std::placeholders::_1, std::placeholders::_2));
+                              SharedType, Partitioner>::LocalPut, this,
+                    std::placeholders::_1, std::placeholders::_2));
       std::function<std::pair<bool, MappedType>(KeyType &)> getFunc(
           std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
-                              SharedType>::LocalGet,
-                    this, std::placeholders::_1));
+                              SharedType, Partitioner>::LocalGet, this,
+                    std::placeholders::_1));
       std::function<std::pair<bool, MappedType>(KeyType &)> eraseFunc(
           std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
-                              SharedType>::LocalErase,
-                    this, std::placeholders::_1));
+                              SharedType, Partitioner>::LocalErase, this,
+                    std::placeholders::_1));
       std::function<std::vector<std::pair<KeyType, MappedType>>(void)>
           getAllDataInServerFunc(
               std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
-                                  SharedType>::LocalGetAllDataInServer,
-                        this));
+                                  SharedType,
+                                  Partitioner>::LocalGetAllDataInServer, this));
       std::function<std::vector<std::pair<KeyType, MappedType>>(KeyType &)>
           containsInServerFunc(std::bind(
-              &multimap<KeyType, MappedType, Compare>::LocalContainsInServer,
+              &multimap<KeyType, MappedType, Compare, Allocator, SharedType,
+                        Partitioner>::LocalContainsInServer,
               this, std::placeholders::_1));
+      std::function<std::pair<std::pair<uint64_t, KeyType>,
+                              std::vector<std::pair<KeyType, MappedType>>>(
+          std::pair<uint64_t, KeyType> &, uint32_t, uint64_t)>
+          scanFunc(std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
+                                       SharedType, Partitioner>::LocalScan,
+                             this, std::placeholders::_1, std::placeholders::_2,
+                             std::placeholders::_3));
 
       rpc->bind(func_prefix + "_Put", putFunc);
       rpc->bind(func_prefix + "_Get", getFunc);
       rpc->bind(func_prefix + "_Erase", eraseFunc);
       rpc->bind(func_prefix + "_GetAllData", getAllDataInServerFunc);
       rpc->bind(func_prefix + "_Contains", containsInServerFunc);
+      rpc->bind(func_prefix + "_Scan", scanFunc);
       break;
     }
 #endif
@@ -351,31 +572,41 @@ void multimap<KeyType, MappedType, Compare, Allocator,
 
       std::function<void(const tl::request &, KeyType &, MappedType &)> putFunc(
           std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
-                              SharedType>::ThalliumLocalPut,
-                    this, std::placeholders::_1, std::placeholders::_2,
+                              SharedType, Partitioner>::ThalliumLocalPut, this,
+                    std::placeholders::_1, std::placeholders::_2,
                     std::placeholders::_3));
       std::function<void(const tl::request &, KeyType &)> getFunc(
           std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
-                              SharedType>::ThalliumLocalGet,
-                    this, std::placeholders::_1, std::placeholders::_2));
+                              SharedType, Partitioner>::ThalliumLocalGet, this,
+                    std::placeholders::_1, std::placeholders::_2));
       std::function<void(const tl::request &, KeyType &)> eraseFunc(
           std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
-                              SharedType>::ThalliumLocalErase,
+                              SharedType, Partitioner>::ThalliumLocalErase,
                     this, std::placeholders::_1, std::placeholders::_2));
       std::function<void(const tl::request &)> getAllDataInServerFunc(
           std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
-                              SharedType>::ThalliumLocalGetAllDataInServer,
+                              SharedType,
+                              Partitioner>::ThalliumLocalGetAllDataInServer,
                     this, std::placeholders::_1));
       std::function<void(const tl::request &, KeyType &)> containsInServerFunc(
-          std::bind(&multimap<KeyType, MappedType,
-                              Compare>::ThalliumLocalContainsInServer,
+          std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
+                              SharedType,
+                              Partitioner>::ThalliumLocalContainsInServer,
                     this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, std::pair<uint64_t, KeyType> &,
+                         uint32_t, uint64_t)>
+          scanFunc(std::bind(&multimap<KeyType, MappedType, Compare, Allocator,
+                                       SharedType,
+                                       Partitioner>::ThalliumLocalScan,
+                             this, std::placeholders::_1, std::placeholders::_2,
+                             std::placeholders::_3, std::placeholders::_4));
 
       rpc->bind(func_prefix + "_Put", putFunc);
       rpc->bind(func_prefix + "_Get", getFunc);
       rpc->bind(func_prefix + "_Erase", eraseFunc);
       rpc->bind(func_prefix + "_GetAllData", getAllDataInServerFunc);
       rpc->bind(func_prefix + "_Contains", containsInServerFunc);
+      rpc->bind(func_prefix + "_Scan", scanFunc);
       break;
     }
 #endif
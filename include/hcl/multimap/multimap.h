@@ -38,13 +38,17 @@
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/containers/map.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
 /** Standard C++ Headers**/
 #include <hcl/common/container.h>
+#include <hcl/common/partitioner.h>
 
 #include <functional>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
@@ -56,10 +60,11 @@ namespace hcl {
  * achieve the data structure.
  *
  * @tparam MappedType, the value of the MultiMap
+ * @tparam Partitioner, policy choosing the server of a key from its hash
  */
 template <typename KeyType, typename MappedType,
           typename Compare = std::less<KeyType>, class Allocator = nullptr_t,
-          class SharedType = nullptr_t>
+          class SharedType = nullptr_t, class Partitioner = ModuloPartitioner>
 class multimap : public container {
  private:
   /** Class Typedefs for ease of use **/
@@ -72,9 +77,33 @@ class multimap : public container {
       MyMap;
   /** Class attributes**/
   std::hash<KeyType> keyHash;
+  Partitioner keyPartitioner;
   MyMap *mymap;
+  /* Handles of the remote operations, resolved by the constructor */
+  struct {
+    RPC::Procedure put, get, erase, contains, get_all_data, scan;
+  } remote;
+
+  /** The server that owns key; ordered partitioners see the key itself. */
+  inline uint16_t KeyServer(KeyType &key) {
+    if constexpr (is_ordered_partitioner<Partitioner>::value) {
+      return keyPartitioner(key);
+    } else {
+      return keyPartitioner(keyHash(key));
+    }
+  }
+
+  std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+  ScatterContains(KeyType &key);
+  std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+  ScatterGetAllData();
+  std::vector<std::pair<KeyType, MappedType>> Gather(
+      std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+          futures);
 
  public:
+  typedef ScanCursor<std::pair<uint64_t, KeyType>> Cursor;
+
   /* Constructor to deallocate the shared memory*/
   ~multimap();
 
@@ -91,7 +120,9 @@ class multimap : public container {
       nullptr;
   }
   explicit multimap(CharStruct name_ = "TEST_MULTIMAP",
-                    uint16_t port = HCL_CONF->RPC_PORT);
+                    uint16_t port = HCL_CONF->RPC_PORT,
+                    Partitioner partitioner =
+                        Partitioner(HCL_CONF->NUM_SERVERS));
 
   bool LocalPut(KeyType &key, MappedType &data);
   std::pair<bool, MappedType> LocalGet(KeyType &key);
@@ -99,6 +130,10 @@ class multimap : public container {
   std::vector<std::pair<KeyType, MappedType>> LocalContainsInServer(
       KeyType &key);
   std::vector<std::pair<KeyType, MappedType>> LocalGetAllDataInServer();
+  std::pair<std::pair<uint64_t, KeyType>,
+            std::vector<std::pair<KeyType, MappedType>>>
+  LocalScan(std::pair<uint64_t, KeyType> &position, uint32_t max_items,
+            uint64_t max_bytes);
 
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
   THALLIUM_DEFINE(LocalPut, (key, data), KeyType &key, MappedType &data)
@@ -106,6 +141,9 @@ class multimap : public container {
   THALLIUM_DEFINE(LocalErase, (key), KeyType &key)
   THALLIUM_DEFINE(LocalContainsInServer, (key), KeyType &key)
   THALLIUM_DEFINE1(LocalGetAllDataInServer)
+  THALLIUM_DEFINE(LocalScan, (position, max_items, max_bytes),
+                  std::pair<uint64_t, KeyType> &position, uint32_t max_items,
+                  uint64_t max_bytes)
 #endif
 
   bool Put(KeyType &key, MappedType &data);
@@ -116,8 +154,22 @@ class multimap : public container {
 
   std::vector<std::pair<KeyType, MappedType>> GetAllData();
 
+  void Contains(
+      KeyType &key,
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          callback);
+
+  void GetAllData(
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          callback);
+
   std::vector<std::pair<KeyType, MappedType>> ContainsInServer(KeyType &key);
   std::vector<std::pair<KeyType, MappedType>> GetAllDataInServer();
+
+  Cursor OpenScan();
+  std::vector<std::pair<KeyType, MappedType>> NextBatch(
+      Cursor &cursor, uint32_t max_items, uint64_t max_bytes = UINT64_MAX);
+  void CloseScan(Cursor &cursor);
 };
 
 #include "multimap.cpp"
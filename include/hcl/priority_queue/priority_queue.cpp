@@ -24,8 +24,16 @@ template <typename MappedType, typename Compare, typename Allocator,
           typename SharedType>
 priority_queue<MappedType, Compare, Allocator, SharedType>::priority_queue(
     CharStruct name_, uint16_t port)
-    : container(name_, port), queue() {
+    : container(name_, port), queue(), tops() {
   AutoTrace trace = AutoTrace("hcl::priority_queue");
+  remote.push = resolve("_Push");
+  remote.pop = resolve("_Pop");
+  remote.top = resolve("_Top");
+  remote.size = resolve("_Size");
+  remote.pop_if = resolve("_PopIf");
+  remote.pop_batch = resolve("_PopBatch");
+  remote.top_k = resolve("_TopK");
+  tops.assign(num_servers, top_type(false, MappedType()));
   if (is_server) {
     construct_shared_memory();
     bind_functions();
@@ -45,7 +53,7 @@ template <typename MappedType, typename Compare, typename Allocator,
 bool priority_queue<MappedType, Compare, Allocator, SharedType>::LocalPush(
     MappedType &data) {
   AutoTrace trace = AutoTrace("hcl::priority_queue::Push(local)", data);
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   auto value = GetData<Allocator, MappedType, SharedType>(data);
   queue->push(value);
   return true;
@@ -62,13 +70,16 @@ template <typename MappedType, typename Compare, typename Allocator,
           typename SharedType>
 bool priority_queue<MappedType, Compare, Allocator, SharedType>::Push(
     MappedType &data, uint16_t &key_int) {
+  bool pushed;
   if (is_local(key_int)) {
-    return LocalPush(data);
+    pushed = LocalPush(data);
   } else {
     AutoTrace trace =
         AutoTrace("hcl::priority_queue::Push(remote)", data, key_int);
-    return RPC_CALL_WRAPPER("_Push", key_int, bool, data);
+    pushed = RPC_CALL_WRAPPER(remote.push, key_int, bool, data);
   }
+  if (pushed) cache_push(key_int, data);
+  return pushed;
 }
 
 /**
@@ -82,7 +93,7 @@ template <typename MappedType, typename Compare, typename Allocator,
 std::pair<bool, MappedType>
 priority_queue<MappedType, Compare, Allocator, SharedType>::LocalPop() {
   AutoTrace trace = AutoTrace("hcl::priority_queue::Pop(local)");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   if (queue->size() > 0) {
     MappedType value = queue->top();
     queue->pop();
@@ -107,7 +118,42 @@ std::pair<bool, MappedType> priority_queue<MappedType, Compare, Allocator,
   } else {
     AutoTrace trace = AutoTrace("hcl::priority_queue::Pop(remote)", key_int);
     typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER1("_Pop", key_int, ret_type);
+    return RPC_CALL_WRAPPER1(remote.pop, key_int, ret_type);
+  }
+}
+
+/**
+ * Push the data into the priority queue without waiting for the result.
+ * @param data, the value for put
+ * @param key_int, key_int to know which server
+ * @return a future holding true if Push was successful else false.
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::future<bool>
+priority_queue<MappedType, Compare, Allocator, SharedType>::AsyncPush(
+    MappedType &data, uint16_t &key_int) {
+  if (is_local(key_int)) {
+    return ready_future(LocalPush(data));
+  } else {
+    AutoTrace trace =
+        AutoTrace("hcl::priority_queue::AsyncPush(remote)", data, key_int);
+    return RPC_CALL_WRAPPER_ASYNC(remote.push, key_int, bool, data);
+  }
+}
+
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::future<std::pair<bool, MappedType>>
+priority_queue<MappedType, Compare, Allocator, SharedType>::AsyncPop(
+    uint16_t &key_int) {
+  if (is_local(key_int)) {
+    return ready_future(LocalPop());
+  } else {
+    AutoTrace trace =
+        AutoTrace("hcl::priority_queue::AsyncPop(remote)", key_int);
+    typedef std::pair<bool, MappedType> ret_type;
+    return RPC_CALL_WRAPPER1_ASYNC(remote.pop, key_int, ret_type);
   }
 }
 
@@ -122,7 +168,7 @@ template <typename MappedType, typename Compare, typename Allocator,
 std::pair<bool, MappedType>
 priority_queue<MappedType, Compare, Allocator, SharedType>::LocalTop() {
   AutoTrace trace = AutoTrace("hcl::priority_queue::Top(local)");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   if (queue->size() > 0) {
     MappedType value = queue->top();
     return std::pair<bool, MappedType>(true, value);
@@ -147,7 +193,7 @@ std::pair<bool, MappedType> priority_queue<MappedType, Compare, Allocator,
   } else {
     AutoTrace trace = AutoTrace("hcl::priority_queue::Top(remote)", key_int);
     typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER1("_Top", key_int, ret_type);
+    return RPC_CALL_WRAPPER1(remote.top, key_int, ret_type);
   }
 }
 
@@ -160,7 +206,7 @@ template <typename MappedType, typename Compare, typename Allocator,
           typename SharedType>
 size_t priority_queue<MappedType, Compare, Allocator, SharedType>::LocalSize() {
   AutoTrace trace = AutoTrace("hcl::priority_queue::Size(local)");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   size_t value = queue->size();
   return value;
 }
@@ -179,8 +225,301 @@ size_t priority_queue<MappedType, Compare, Allocator, SharedType>::Size(
     return LocalSize();
   } else {
     AutoTrace trace = AutoTrace("hcl::priority_queue::Top(remote)", key_int);
-    return RPC_CALL_WRAPPER1("_Size", key_int, size_t);
+    return RPC_CALL_WRAPPER1(remote.size, key_int, size_t);
+  }
+}
+
+/**
+ * Pops the top of the local priority queue unless bounded and bound is
+ * popped before it.
+ * @param bound, the value the top may not come after
+ * @param bounded, whether to compare the top with bound
+ * @return the popped value, if any, and the top left behind
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::pair<std::pair<bool, MappedType>, std::pair<bool, MappedType>>
+priority_queue<MappedType, Compare, Allocator, SharedType>::LocalPopIf(
+    MappedType &bound, bool bounded) {
+  AutoTrace trace =
+      AutoTrace("hcl::priority_queue::PopIf(local)", bound, bounded);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  top_type popped(false, MappedType());
+  if (queue->size() > 0 && !(bounded && before(bound, queue->top()))) {
+    popped = top_type(true, queue->top());
+    queue->pop();
+  }
+  top_type top(false, MappedType());
+  if (queue->size() > 0) top = top_type(true, queue->top());
+  return std::pair<top_type, top_type>(popped, top);
+}
+
+/**
+ * Copy the first values of the local priority queue without popping them.
+ * @param k, the number of values
+ * @return up to k values in pop order
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::vector<MappedType>
+priority_queue<MappedType, Compare, Allocator, SharedType>::LocalTopK(
+    uint32_t k) {
+  AutoTrace trace = AutoTrace("hcl::priority_queue::TopK(local)", k);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  std::vector<MappedType> values;
+  while (values.size() < k && queue->size() > 0) {
+    values.push_back(queue->top());
+    queue->pop();
+  }
+  /* The heap only exposes its top, so the values are popped and put back */
+  for (auto &value : values) queue->push(value);
+  return values;
+}
+
+/**
+ * Pop the first values of the local priority queue.
+ * @param k, the number of values
+ * @return up to k values in pop order
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::vector<MappedType>
+priority_queue<MappedType, Compare, Allocator, SharedType>::LocalPopBatch(
+    uint32_t k) {
+  AutoTrace trace = AutoTrace("hcl::priority_queue::PopBatch(local)", k);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  std::vector<MappedType> values;
+  while (values.size() < k && queue->size() > 0) {
+    values.push_back(queue->top());
+    queue->pop();
+  }
+  return values;
+}
+
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::future<std::pair<bool, MappedType>>
+priority_queue<MappedType, Compare, Allocator, SharedType>::AsyncTop(
+    uint16_t &key_int) {
+  if (is_local(key_int)) {
+    return ready_future(LocalTop());
+  } else {
+    AutoTrace trace =
+        AutoTrace("hcl::priority_queue::AsyncTop(remote)", key_int);
+    typedef std::pair<bool, MappedType> ret_type;
+    return RPC_CALL_WRAPPER1_ASYNC(remote.top, key_int, ret_type);
+  }
+}
+
+/**
+ * Pop the top of the priority queue of server key_int unless bounded and
+ * bound is popped before it.
+ * @param key_int, key_int to know which server
+ * @param bound, the value the top may not come after
+ * @param bounded, whether to compare the top with bound
+ * @return the popped value, if any, and the top left behind
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::pair<std::pair<bool, MappedType>, std::pair<bool, MappedType>>
+priority_queue<MappedType, Compare, Allocator, SharedType>::PopIf(
+    uint16_t &key_int, MappedType &bound, bool bounded) {
+  std::pair<top_type, top_type> result;
+  if (is_local(key_int)) {
+    result = LocalPopIf(bound, bounded);
+  } else {
+    AutoTrace trace = AutoTrace("hcl::priority_queue::PopIf(remote)",
+                                key_int, bound, bounded);
+    typedef std::pair<top_type, top_type> ret_type;
+    result = RPC_CALL_WRAPPER(remote.pop_if, key_int, ret_type, bound, bounded);
+  }
+  cache_top(key_int, result.second);
+  return result;
+}
+
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::future<std::vector<MappedType>>
+priority_queue<MappedType, Compare, Allocator, SharedType>::AsyncTopK(
+    uint16_t &key_int, uint32_t k) {
+  if (is_local(key_int)) {
+    return ready_future(LocalTopK(k));
+  } else {
+    AutoTrace trace =
+        AutoTrace("hcl::priority_queue::AsyncTopK(remote)", key_int, k);
+    typedef std::vector<MappedType> ret_type;
+    return RPC_CALL_WRAPPER_ASYNC(remote.top_k, key_int, ret_type, k);
+  }
+}
+
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::future<std::vector<MappedType>>
+priority_queue<MappedType, Compare, Allocator, SharedType>::AsyncPopBatch(
+    uint16_t &key_int, uint32_t k) {
+  if (is_local(key_int)) {
+    return ready_future(LocalPopBatch(k));
+  } else {
+    AutoTrace trace =
+        AutoTrace("hcl::priority_queue::AsyncPopBatch(remote)", key_int, k);
+    typedef std::vector<MappedType> ret_type;
+    return RPC_CALL_WRAPPER_ASYNC(remote.pop_batch, key_int, ret_type, k);
+  }
+}
+
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+uint16_t
+priority_queue<MappedType, Compare, Allocator, SharedType>::random_server() {
+  static thread_local std::minstd_rand generator(std::random_device{}());
+  return static_cast<uint16_t>(generator() % num_servers);
+}
+
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+void priority_queue<MappedType, Compare, Allocator, SharedType>::cache_top(
+    uint16_t server, const top_type &top) {
+  std::lock_guard<std::mutex> lock(tops_mutex);
+  tops[server] = top;
+}
+
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+void priority_queue<MappedType, Compare, Allocator, SharedType>::cache_push(
+    uint16_t server, const MappedType &data) {
+  std::lock_guard<std::mutex> lock(tops_mutex);
+  top_type pushed(true, data);
+  if (before_top(pushed, tops[server])) tops[server] = pushed;
+}
+
+/* Asks every server for its top in one parallel round */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+void priority_queue<MappedType, Compare, Allocator,
+                    SharedType>::refresh_tops() {
+  std::vector<std::future<top_type>> futures;
+  for (uint16_t server = 0; server < num_servers; server++) {
+    futures.push_back(AsyncTop(server));
+  }
+  for (uint16_t server = 0; server < num_servers; server++) {
+    cache_top(server, futures[server].get());
+  }
+}
+
+/**
+ * Push the data into the priority queue of a random server, which spreads
+ * the values evenly for Pop(), PopBatch() and RelaxedPop().
+ * @param data, the value for put
+ * @return bool, true if Push was successful else false.
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+bool priority_queue<MappedType, Compare, Allocator, SharedType>::Push(
+    MappedType &data) {
+  uint16_t key_int = random_server();
+  return Push(data, key_int);
+}
+
+/**
+ * Pop the first value of all servers: the tops of all servers are fetched in
+ * one parallel round, and the server with the first one pops its top unless
+ * that now comes after the top of another server. The cache only holds what
+ * this client saw, which misses the pushes of other clients, so the tops are
+ * fetched again before every attempt.
+ * @return return a pair of bool and Value. If bool is false every server was
+ * empty
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::pair<bool, MappedType>
+priority_queue<MappedType, Compare, Allocator, SharedType>::Pop() {
+  AutoTrace trace = AutoTrace("hcl::priority_queue::Pop(global)");
+  while (true) {
+    refresh_tops();
+    uint16_t best = 0;
+    top_type bound(false, MappedType());
+    {
+      std::lock_guard<std::mutex> lock(tops_mutex);
+      for (uint16_t server = 1; server < num_servers; server++) {
+        if (before_top(tops[server], tops[best])) best = server;
+      }
+      if (!tops[best].first) return top_type(false, MappedType());
+      for (uint16_t server = 0; server < num_servers; server++) {
+        if (server != best && before_top(tops[server], bound)) {
+          bound = tops[server];
+        }
+      }
+    }
+    std::pair<top_type, top_type> result =
+        PopIf(best, bound.second, bound.first);
+    if (result.first.first) return result.first;
+  }
+}
+
+/**
+ * Pop the first k values of all servers: every server sends its first k
+ * values, which are merged to find how many of the first k each server
+ * holds, and then every server pops that many. A value that a concurrent
+ * Pop takes in between is replaced by the next one of its server.
+ * @param k, the number of values
+ * @return up to k values in pop order
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::vector<MappedType>
+priority_queue<MappedType, Compare, Allocator, SharedType>::PopBatch(
+    uint32_t k) {
+  AutoTrace trace = AutoTrace("hcl::priority_queue::PopBatch(global)", k);
+  typedef std::pair<MappedType, uint16_t> tagged;
+  std::vector<std::future<std::vector<MappedType>>> futures;
+  for (uint16_t server = 0; server < num_servers; server++) {
+    futures.push_back(AsyncTopK(server, k));
+  }
+  std::vector<std::vector<tagged>> runs(num_servers);
+  for (uint16_t server = 0; server < num_servers; server++) {
+    for (auto &value : futures[server].get()) {
+      runs[server].emplace_back(value, server);
+    }
+  }
+  std::vector<tagged> first = merge_runs(runs, [](const tagged &a,
+                                                  const tagged &b) {
+    return before(a.first, b.first);
+  });
+  if (first.size() > k) first.resize(k);
+  std::vector<uint32_t> counts(num_servers, 0);
+  for (auto &value : first) counts[value.second]++;
+
+  std::vector<std::vector<MappedType>> popped;
+  futures.clear();
+  for (uint16_t server = 0; server < num_servers; server++) {
+    if (counts[server] > 0) {
+      futures.push_back(AsyncPopBatch(server, counts[server]));
+    }
+  }
+  for (auto &future : futures) popped.push_back(future.get());
+  return merge_runs(popped, before);
+}
+
+/**
+ * Pop the top of the better of two random servers by their cached tops,
+ * like a MultiQueue: one RPC, and the value is near the front of the queue.
+ * @return return a pair of bool and Value. If bool is false every server was
+ * empty
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+std::pair<bool, MappedType>
+priority_queue<MappedType, Compare, Allocator, SharedType>::RelaxedPop() {
+  AutoTrace trace = AutoTrace("hcl::priority_queue::Pop(relaxed)");
+  uint16_t first = random_server(), second = random_server();
+  {
+    std::lock_guard<std::mutex> lock(tops_mutex);
+    if (before_top(tops[second], tops[first])) first = second;
   }
+  MappedType bound = MappedType();
+  std::pair<top_type, top_type> result = PopIf(first, bound, false);
+  if (result.first.first) return result.first;
+  return Pop();
 }
 
 template <typename MappedType, typename Compare, typename Allocator,
@@ -218,10 +557,23 @@ void priority_queue<MappedType, Compare, Allocator,
           &hcl::priority_queue<MappedType, Compare>::LocalSize, this));
       std::function<std::pair<bool, MappedType>(void)> topFunc(
           std::bind(&hcl::priority_queue<MappedType, Compare>::LocalTop, this));
+      std::function<std::pair<top_type, top_type>(MappedType &, bool)>
+          popIfFunc(std::bind(
+              &hcl::priority_queue<MappedType, Compare>::LocalPopIf, this,
+              std::placeholders::_1, std::placeholders::_2));
+      std::function<std::vector<MappedType>(uint32_t)> topKFunc(std::bind(
+          &hcl::priority_queue<MappedType, Compare>::LocalTopK, this,
+          std::placeholders::_1));
+      std::function<std::vector<MappedType>(uint32_t)> popBatchFunc(std::bind(
+          &hcl::priority_queue<MappedType, Compare>::LocalPopBatch, this,
+          std::placeholders::_1));
       rpc->bind(func_prefix + "_Push", pushFunc);
       rpc->bind(func_prefix + "_Pop", popFunc);
       rpc->bind(func_prefix + "_Top", topFunc);
       rpc->bind(func_prefix + "_Size", sizeFunc);
+      rpc->bind(func_prefix + "_PopIf", popIfFunc);
+      rpc->bind(func_prefix + "_TopK", topKFunc);
+      rpc->bind(func_prefix + "_PopBatch", popBatchFunc);
       break;
     }
 #endif
@@ -245,10 +597,25 @@ void priority_queue<MappedType, Compare, Allocator,
       std::function<void(const tl::request &)> topFunc(
           std::bind(&hcl::priority_queue<MappedType, Compare>::ThalliumLocalTop,
                     this, std::placeholders::_1));
+      std::function<void(const tl::request &, MappedType &, bool)> popIfFunc(
+          std::bind(
+              &hcl::priority_queue<MappedType, Compare>::ThalliumLocalPopIf,
+              this, std::placeholders::_1, std::placeholders::_2,
+              std::placeholders::_3));
+      std::function<void(const tl::request &, uint32_t)> topKFunc(std::bind(
+          &hcl::priority_queue<MappedType, Compare>::ThalliumLocalTopK, this,
+          std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, uint32_t)> popBatchFunc(
+          std::bind(
+              &hcl::priority_queue<MappedType, Compare>::ThalliumLocalPopBatch,
+              this, std::placeholders::_1, std::placeholders::_2));
       rpc->bind(func_prefix + "_Push", pushFunc);
       rpc->bind(func_prefix + "_Pop", popFunc);
       rpc->bind(func_prefix + "_Top", topFunc);
       rpc->bind(func_prefix + "_Size", sizeFunc);
+      rpc->bind(func_prefix + "_PopIf", popIfFunc);
+      rpc->bind(func_prefix + "_TopK", topKFunc);
+      rpc->bind(func_prefix + "_PopBatch", popBatchFunc);
       break;
     }
 #endif
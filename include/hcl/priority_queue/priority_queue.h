@@ -38,15 +38,19 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
 /** Standard C++ Headers**/
 #include <hcl/common/container.h>
 
 #include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <queue>
+#include <random>
 #include <string>
 #include <utility>
 #include <vector>
@@ -61,6 +65,15 @@ namespace hcl {
  * This is a Distributed priority_queue Class. It uses shared memory + RPC + MPI
  * to achieve the data structure.
  *
+ * Push, Pop and Top with a key_int work on the heap of one server. Pop() and
+ * PopBatch() are ordered across all servers: they ask every server for its
+ * first values in one parallel round and then pop from the servers that hold
+ * the first ones overall. Every client keeps the last top it saw of each
+ * server; RelaxedPop() compares the cached tops of two random servers and pops
+ * from the better one with a single RPC, as a MultiQueue does, so the value is
+ * near but not always at the front of the queue. It falls back to Pop() when
+ * both servers turn out to be empty.
+ *
  * @tparam MappedType, the value of the priority_queue
  */
 template <typename MappedType, typename Compare = std::less<MappedType>,
@@ -74,8 +87,29 @@ class priority_queue : public container {
                               std::vector<MappedType, ShmemAllocator>, Compare>
       Queue;
 
+  typedef std::pair<bool, MappedType> top_type;
+
   /** Class attributes**/
   Queue *queue;
+  /* The last top this client saw of each server */
+  std::vector<top_type> tops;
+  std::mutex tops_mutex;
+  /* Handles of the remote operations, resolved by the constructor */
+  struct {
+    RPC::Procedure push, pop, top, size, pop_if, pop_batch, top_k;
+  } remote;
+
+  /* Whether a is popped before b */
+  static bool before(const MappedType &a, const MappedType &b) {
+    return Compare()(b, a);
+  }
+  static bool before_top(const top_type &a, const top_type &b) {
+    return a.first && (!b.first || before(a.second, b.second));
+  }
+  uint16_t random_server();
+  void cache_top(uint16_t server, const top_type &top);
+  void cache_push(uint16_t server, const MappedType &data);
+  void refresh_tops();
 
  public:
   ~priority_queue();
@@ -98,18 +132,39 @@ class priority_queue : public container {
   std::pair<bool, MappedType> LocalPop();
   std::pair<bool, MappedType> LocalTop();
   size_t LocalSize();
+  std::pair<top_type, top_type> LocalPopIf(MappedType &bound, bool bounded);
+  std::vector<MappedType> LocalTopK(uint32_t k);
+  std::vector<MappedType> LocalPopBatch(uint32_t k);
 
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
   THALLIUM_DEFINE(LocalPush, (data), MappedType &data)
   THALLIUM_DEFINE1(LocalPop)
   THALLIUM_DEFINE1(LocalTop)
   THALLIUM_DEFINE1(LocalSize)
+  THALLIUM_DEFINE(LocalPopIf, (bound, bounded), MappedType &bound,
+                  bool bounded)
+  THALLIUM_DEFINE(LocalTopK, (k), uint32_t k)
+  THALLIUM_DEFINE(LocalPopBatch, (k), uint32_t k)
 #endif
 
   bool Push(MappedType &data, uint16_t &key_int);
   std::pair<bool, MappedType> Pop(uint16_t &key_int);
   std::pair<bool, MappedType> Top(uint16_t &key_int);
   size_t Size(uint16_t &key_int);
+  std::future<bool> AsyncPush(MappedType &data, uint16_t &key_int);
+  std::future<std::pair<bool, MappedType>> AsyncPop(uint16_t &key_int);
+  std::future<std::pair<bool, MappedType>> AsyncTop(uint16_t &key_int);
+  std::pair<top_type, top_type> PopIf(uint16_t &key_int, MappedType &bound,
+                                      bool bounded);
+  std::future<std::vector<MappedType>> AsyncTopK(uint16_t &key_int,
+                                                 uint32_t k);
+  std::future<std::vector<MappedType>> AsyncPopBatch(uint16_t &key_int,
+                                                     uint32_t k);
+
+  bool Push(MappedType &data);
+  std::pair<bool, MappedType> Pop();
+  std::vector<MappedType> PopBatch(uint32_t k);
+  std::pair<bool, MappedType> RelaxedPop();
 };
 
 #include "priority_queue.cpp"
@@ -18,6 +18,10 @@ template <typename MappedType, typename Allocator, typename SharedType>
 queue<MappedType, Allocator, SharedType>::queue(CharStruct name_, uint16_t port)
     : container(name_, port), my_queue() {
   AutoTrace trace = AutoTrace("hcl::queue(local)");
+  remote.push = resolve("_Push");
+  remote.pop = resolve("_Pop");
+  remote.size = resolve("_Size");
+  remote.wait_for_element = resolve("_WaitForElement");
   if (is_server) {
     construct_shared_memory();
     bind_functions();
@@ -35,7 +39,7 @@ queue<MappedType, Allocator, SharedType>::queue(CharStruct name_, uint16_t port)
 template <typename MappedType, typename Allocator, typename SharedType>
 bool queue<MappedType, Allocator, SharedType>::LocalPush(MappedType &data) {
   AutoTrace trace = AutoTrace("hcl::queue::Push(local)", data);
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   auto value = GetData<Allocator, MappedType, SharedType>(data);
   my_queue->push_back(std::move(value));
   return true;
@@ -54,7 +58,7 @@ bool queue<MappedType, Allocator, SharedType>::Push(MappedType &data,
     return LocalPush(data);
   } else {
     AutoTrace trace = AutoTrace("hcl::queue::Push(remote)", data, key_int);
-    return RPC_CALL_WRAPPER("_Push", key_int, bool, data);
+    return RPC_CALL_WRAPPER(remote.push, key_int, bool, data);
   }
 }
 
@@ -68,7 +72,7 @@ template <typename MappedType, typename Allocator, typename SharedType>
 std::pair<bool, MappedType>
 queue<MappedType, Allocator, SharedType>::LocalPop() {
   AutoTrace trace = AutoTrace("hcl::queue::Pop(local)");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   if (my_queue->size() > 0) {
     MappedType value = my_queue->front();
     my_queue->pop_front();
@@ -92,7 +96,37 @@ std::pair<bool, MappedType> queue<MappedType, Allocator, SharedType>::Pop(
   } else {
     AutoTrace trace = AutoTrace("hcl::queue::Pop(remote)", key_int);
     typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER1("_Pop", key_int, ret_type);
+    return RPC_CALL_WRAPPER1(remote.pop, key_int, ret_type);
+  }
+}
+
+/**
+ * Push the data into the queue without waiting for the result.
+ * @param data, the value for put
+ * @param key_int, key_int to know which server
+ * @return a future holding true if Push was successful else false.
+ */
+template <typename MappedType, typename Allocator, typename SharedType>
+std::future<bool> queue<MappedType, Allocator, SharedType>::AsyncPush(
+    MappedType &data, uint16_t &key_int) {
+  if (is_local(key_int)) {
+    return ready_future(LocalPush(data));
+  } else {
+    AutoTrace trace =
+        AutoTrace("hcl::queue::AsyncPush(remote)", data, key_int);
+    return RPC_CALL_WRAPPER_ASYNC(remote.push, key_int, bool, data);
+  }
+}
+
+template <typename MappedType, typename Allocator, typename SharedType>
+std::future<std::pair<bool, MappedType>>
+queue<MappedType, Allocator, SharedType>::AsyncPop(uint16_t &key_int) {
+  if (is_local(key_int)) {
+    return ready_future(LocalPop());
+  } else {
+    AutoTrace trace = AutoTrace("hcl::queue::AsyncPop(remote)", key_int);
+    typedef std::pair<bool, MappedType> ret_type;
+    return RPC_CALL_WRAPPER1_ASYNC(remote.pop, key_int, ret_type);
   }
 }
 
@@ -115,7 +149,7 @@ bool queue<MappedType, Allocator, SharedType>::WaitForElement(
     return LocalWaitForElement();
   } else {
     AutoTrace trace = AutoTrace("hcl::queue::WaitForElement(remote)", key_int);
-    return RPC_CALL_WRAPPER1("_WaitForElement", key_int, bool);
+    return RPC_CALL_WRAPPER1(remote.wait_for_element, key_int, bool);
   }
 }
 
@@ -127,7 +161,7 @@ bool queue<MappedType, Allocator, SharedType>::WaitForElement(
 template <typename MappedType, typename Allocator, typename SharedType>
 size_t queue<MappedType, Allocator, SharedType>::LocalSize() {
   AutoTrace trace = AutoTrace("hcl::queue::Size(local)");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   size_t value = my_queue->size();
   return value;
 }
@@ -143,7 +177,7 @@ size_t queue<MappedType, Allocator, SharedType>::Size(uint16_t &key_int) {
     return LocalSize();
   } else {
     AutoTrace trace = AutoTrace("hcl::queue::Size(remote)", key_int);
-    return RPC_CALL_WRAPPER1("_Size", key_int, size_t);
+    return RPC_CALL_WRAPPER1(remote.size, key_int, size_t);
   }
 }
 
@@ -38,8 +38,9 @@
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/containers/deque.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
 /** Standard C++ Headers**/
 #include <hcl/common/container.h>
 
@@ -71,6 +72,10 @@ class queue : public container {
 
   /** Class attributes**/
   Queue *my_queue;
+  /* Handles of the remote operations, resolved by the constructor */
+  struct {
+    RPC::Procedure push, pop, size, wait_for_element;
+  } remote;
 
  public:
   ~queue();
@@ -105,6 +110,8 @@ class queue : public container {
   std::pair<bool, MappedType> Pop(uint16_t &key_int);
   bool WaitForElement(uint16_t &key_int);
   size_t Size(uint16_t &key_int);
+  std::future<bool> AsyncPush(MappedType &data, uint16_t &key_int);
+  std::future<std::pair<bool, MappedType>> AsyncPop(uint16_t &key_int);
 };
 
 #include "queue.cpp"
@@ -22,18 +22,49 @@
 
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
 namespace bip = boost::interprocess;
 
 namespace hcl {
+/**
+ * A counter on one server that hands out increasing ids starting at 1. The
+ * counter lives in the server's segment and is advanced with an atomic add,
+ * so the server's handlers and the clients on its node never take a lock.
+ * GetNextSequenceRange reserves n consecutive ids with one call; see
+ * sequence_lease for handing them out one at a time.
+ *
+ * Every server keeps a counter of its own and clients ask the server of
+ * their node, so without sharding the servers hand out the same ids. A
+ * sharded sequence makes the ids unique across servers: server s hands out
+ * its c-th id as (c - 1) * num_servers + s + 1, so the servers own disjoint,
+ * interleaved streams and ids scale with the number of servers with no
+ * coordination between them. The ids of one server increase, but ids of
+ * different servers are only roughly ordered: ids handed out at the same
+ * time by two servers differ by about num_servers times the difference of
+ * their counters. A range of n ids then has a stride of num_servers.
+ * Servers and clients must construct the sequence with the same mode.
+ */
 class global_sequence : public container {
  private:
   uint64_t *value;
+  bool sharded;
+  /* Handles of the remote operations, resolved by the constructor */
+  struct {
+    RPC::Procedure get_next_sequence, get_next_sequence_range;
+  } remote;
+
+  /* The id of the count-th id this server hands out */
+  uint64_t to_id(uint64_t count) {
+    if (!sharded) return count;
+    return (count - 1) * num_servers + my_server + 1;
+  }
 
  public:
   ~global_sequence() { this->container::~container(); }
@@ -54,7 +85,11 @@ class global_sequence : public container {
       case RPCLIB: {
         std::function<uint64_t(void)> getNextSequence(
             std::bind(&hcl::global_sequence::LocalGetNextSequence, this));
+        std::function<uint64_t(uint64_t)> getNextSequenceRange(
+            std::bind(&hcl::global_sequence::LocalGetNextSequenceRange, this,
+                      std::placeholders::_1));
         rpc->bind(func_prefix + "_GetNextSequence", getNextSequence);
+        rpc->bind(func_prefix + "_GetNextSequenceRange", getNextSequenceRange);
         break;
       }
 #endif
@@ -69,7 +104,12 @@ class global_sequence : public container {
         std::function<void(const tl::request &)> getNextSequence(
             std::bind(&hcl::global_sequence::ThalliumLocalGetNextSequence, this,
                       std::placeholders::_1));
+        std::function<void(const tl::request &, uint64_t)>
+            getNextSequenceRange(std::bind(
+                &hcl::global_sequence::ThalliumLocalGetNextSequenceRange, this,
+                std::placeholders::_1, std::placeholders::_2));
         rpc->bind(func_prefix + "_GetNextSequence", getNextSequence);
+        rpc->bind(func_prefix + "_GetNextSequenceRange", getNextSequenceRange);
         break;
       }
 #endif
@@ -77,9 +117,11 @@ class global_sequence : public container {
   }
 
   global_sequence(CharStruct name_ = "TEST_GLOBAL_SEQUENCE",
-                  uint16_t port = HCL_CONF->RPC_PORT)
-      : container(name_, port) {
+                  uint16_t port = HCL_CONF->RPC_PORT, bool sharded_ = false)
+      : container(name_, port), sharded(sharded_) {
     AutoTrace trace = AutoTrace("hcl::global_sequence");
+    remote.get_next_sequence = resolve("_GetNextSequence");
+    remote.get_next_sequence_range = resolve("_GetNextSequenceRange");
     if (is_server) {
       construct_shared_memory();
       bind_functions();
@@ -98,28 +140,120 @@ class global_sequence : public container {
       return LocalGetNextSequence();
     } else {
       auto my_server_i = my_server;
-      return RPC_CALL_WRAPPER1("_GetNextSequence", my_server_i, uint64_t);
+      return RPC_CALL_WRAPPER1(remote.get_next_sequence, my_server_i, uint64_t);
     }
   }
   uint64_t GetNextSequenceServer(uint16_t &server) {
     if (is_local(server)) {
       return LocalGetNextSequence();
     } else {
-      return RPC_CALL_WRAPPER1("_GetNextSequence", server, uint64_t);
+      return RPC_CALL_WRAPPER1(remote.get_next_sequence, server, uint64_t);
+    }
+  }
+
+  /**
+   * The difference between consecutive ids of a range: 1, or num_servers
+   * when sharded.
+   */
+  uint64_t Stride() { return sharded ? num_servers : 1; }
+  /**
+   * Reserves the n ids first + i * Stride() for i < n and returns first.
+   */
+  uint64_t GetNextSequenceRange(uint64_t n) {
+    if (is_local()) {
+      return LocalGetNextSequenceRange(n);
+    } else {
+      auto my_server_i = my_server;
+      return RPC_CALL_WRAPPER(remote.get_next_sequence_range, my_server_i,
+                              uint64_t, n);
+    }
+  }
+  uint64_t GetNextSequenceRangeServer(uint16_t &server, uint64_t n) {
+    if (is_local(server)) {
+      return LocalGetNextSequenceRange(n);
+    } else {
+      return RPC_CALL_WRAPPER(remote.get_next_sequence_range, server,
+                              uint64_t, n);
+    }
+  }
+  /**
+   * GetNextSequenceRange without waiting for the reply. A local reservation
+   * is made when the result is read.
+   */
+  std::future<uint64_t> AsyncGetNextSequenceRange(uint64_t n) {
+    if (is_local()) {
+      return std::async(std::launch::deferred,
+                        [this, n]() { return LocalGetNextSequenceRange(n); });
+    } else {
+      auto my_server_i = my_server;
+      return RPC_CALL_WRAPPER_ASYNC(remote.get_next_sequence_range, my_server_i,
+                                    uint64_t, n);
     }
   }
 
   uint64_t LocalGetNextSequence() {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
-    return ++*value;
+    return to_id(__atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST));
+  }
+  uint64_t LocalGetNextSequenceRange(uint64_t n) {
+    return to_id(__atomic_fetch_add(value, n, __ATOMIC_SEQ_CST) + 1);
   }
 
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
   THALLIUM_DEFINE1(LocalGetNextSequence)
+  THALLIUM_DEFINE(LocalGetNextSequenceRange, (n), uint64_t n)
 #endif
 };
 
+/**
+ * Hands out ids of a global_sequence from blocks of block_size ids, so that
+ * only one call in block_size reaches the server. Once watermark or fewer
+ * ids are left in the current block the next block is requested without
+ * waiting, and by the time the current one runs out its reply has usually
+ * arrived. The ids of one lease increase; those of different leases
+ * interleave but never repeat. Ids left in the blocks of a lease when it is
+ * destroyed are never handed out. A lease may be shared by threads.
+ */
+class sequence_lease {
+ private:
+  global_sequence *sequence;
+  uint64_t block_size;
+  uint64_t watermark;
+  uint64_t stride;
+  std::mutex lock;
+  uint64_t next;
+  uint64_t left;
+  std::future<uint64_t> pending;
+
+ public:
+  explicit sequence_lease(global_sequence *sequence_,
+                          uint64_t block_size_ = 1024,
+                          uint64_t watermark_ = 256)
+      : sequence(sequence_),
+        block_size(block_size_ == 0 ? 1 : block_size_),
+        watermark(watermark_),
+        stride(sequence_->Stride()),
+        lock(),
+        next(0),
+        left(0),
+        pending() {}
+
+  uint64_t GetNextSequence() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (left == 0) {
+      next = pending.valid() ? pending.get()
+                             : sequence->GetNextSequenceRange(block_size);
+      left = block_size;
+    }
+    uint64_t id = next;
+    next += stride;
+    --left;
+    if (left <= watermark && !pending.valid()) {
+      pending = sequence->AsyncGetNextSequenceRange(block_size);
+    }
+    return id;
+  }
+};
+
 }  // namespace hcl
 
 #endif  // INCLUDE_HCL_SEQUENCER_GLOBAL_SEQUENCE_H_
@@ -15,17 +15,27 @@
 
 /* Constructor to deallocate the shared memory*/
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-set<KeyType, Hash, Compare, Allocator, SharedType>::~set() {
+          typename SharedType, typename Partitioner>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::~set() {
   this->container::~container();
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-set<KeyType, Hash, Compare, Allocator, SharedType>::set(CharStruct name_,
-                                                        uint16_t port)
-    : container(name_, port), myset() {
+          typename SharedType, typename Partitioner>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::set(
+    CharStruct name_, uint16_t port, Partitioner partitioner)
+    : container(name_, port), keyPartitioner(partitioner), myset() {
   AutoTrace trace = AutoTrace("hcl::set");
+  remote.put = resolve("_Put");
+  remote.get = resolve("_Get");
+  remote.erase = resolve("_Erase");
+  remote.contains = resolve("_Contains");
+  remote.get_all_data = resolve("_GetAllData");
+  remote.scan = resolve("_Scan");
+  remote.size = resolve("_Size");
+  remote.seek_first = resolve("_SeekFirst");
+  remote.seek_first_n = resolve("_SeekFirstN");
+  remote.pop_first = resolve("_PopFirst");
   if (is_server) {
     construct_shared_memory();
     bind_functions();
@@ -41,12 +51,11 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::set(CharStruct name_,
  * @return bool, true if Put was successful else false.
  */
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-bool set<KeyType, Hash, Compare, Allocator, SharedType>::LocalPut(
+          typename SharedType, typename Partitioner>
+bool set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::LocalPut(
     KeyType &key) {
   AutoTrace trace = AutoTrace("hcl::set::Put(local)", key);
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   auto value = GetData<Allocator, KeyType, SharedType>(key);
   myset->insert(value);
 
@@ -60,15 +69,15 @@ bool set<KeyType, Hash, Compare, Allocator, SharedType>::LocalPut(
  * @return bool, true if Put was successful else false.
  */
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-bool set<KeyType, Hash, Compare, Allocator, SharedType>::Put(KeyType &key) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
+          typename SharedType, typename Partitioner>
+bool set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::Put(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
   if (is_local(key_int)) {
     return LocalPut(key);
   } else {
     AutoTrace trace = AutoTrace("hcl::set::Put(remote)", key);
-    return RPC_CALL_WRAPPER("_Put", key_int, bool, key);
+    return RPC_CALL_WRAPPER(remote.put, key_int, bool, key);
   }
 }
 
@@ -79,12 +88,11 @@ bool set<KeyType, Hash, Compare, Allocator, SharedType>::Put(KeyType &key) {
  * data was found and is present in value part else bool is set to false
  */
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-bool set<KeyType, Hash, Compare, Allocator, SharedType>::LocalGet(
+          typename SharedType, typename Partitioner>
+bool set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::LocalGet(
     KeyType &key) {
   AutoTrace trace = AutoTrace("hcl::set::Get(local)", key);
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   typename MySet::iterator iterator = myset->find(key);
   if (iterator != myset->end()) {
     return true;
@@ -100,101 +108,240 @@ bool set<KeyType, Hash, Compare, Allocator, SharedType>::LocalGet(
  * data was found and is present in value part else bool is set to false
  */
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-bool set<KeyType, Hash, Compare, Allocator, SharedType>::Get(KeyType &key) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+          typename SharedType, typename Partitioner>
+bool set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::Get(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
   if (is_local(key_int)) {
     return LocalGet(key);
   } else {
     AutoTrace trace = AutoTrace("hcl::set::Get(remote)", key);
     typedef bool ret_type;
-    return RPC_CALL_WRAPPER("_Get", key_int, ret_type, key);
+    return RPC_CALL_WRAPPER(remote.get, key_int, ret_type, key);
   }
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-bool set<KeyType, Hash, Compare, Allocator, SharedType>::LocalErase(
+          typename SharedType, typename Partitioner>
+bool
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::LocalErase(
     KeyType &key) {
   AutoTrace trace = AutoTrace("hcl::set::Erase(local)", key);
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   size_t s = myset->erase(key);
 
   return s > 0;
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-bool set<KeyType, Hash, Compare, Allocator, SharedType>::Erase(KeyType &key) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+          typename SharedType, typename Partitioner>
+bool set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::Erase(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
   if (is_local(key_int)) {
     return LocalErase(key);
   } else {
     AutoTrace trace = AutoTrace("hcl::set::Erase(remote)", key);
     typedef bool ret_type;
-    return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
+    return RPC_CALL_WRAPPER(remote.erase, key_int, ret_type, key);
   }
 }
 
 /**
- * Get the data into the set. Uses key to decide the server to hash it to,
- * @param key, key to get
- * @return return a pair of bool and Value. If bool is true then data was
- * found and is present in value part else bool is set to false
+ * Put the data into the set without waiting for the result.
+ * @param key, the key for put
+ * @return a future holding true if Put was successful else false.
  */
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::vector<KeyType>
-set<KeyType, Hash, Compare, Allocator, SharedType>::Contains(KeyType &key_start,
-                                                             KeyType &key_end) {
-  AutoTrace trace = AutoTrace("hcl::set::Contains", key_start, key_end);
-  std::vector<KeyType> final_values = std::vector<KeyType>();
-  auto current_server = ContainsInServer(key_start, key_end);
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
+          typename SharedType, typename Partitioner>
+std::future<bool>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::AsyncPut(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
+  if (is_local(key_int)) {
+    return ready_future(LocalPut(key));
+  } else {
+    AutoTrace trace = AutoTrace("hcl::set::AsyncPut(remote)", key);
+    return RPC_CALL_WRAPPER_ASYNC(remote.put, key_int, bool, key);
+  }
+}
+
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::future<bool>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::AsyncGet(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
+  if (is_local(key_int)) {
+    return ready_future(LocalGet(key));
+  } else {
+    AutoTrace trace = AutoTrace("hcl::set::AsyncGet(remote)", key);
+    return RPC_CALL_WRAPPER_ASYNC(remote.get, key_int, bool, key);
+  }
+}
+
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::future<bool>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::AsyncErase(
+    KeyType &key) {
+  uint16_t key_int = KeyServer(key);
+  if (is_local(key_int)) {
+    return ready_future(LocalErase(key));
+  } else {
+    AutoTrace trace = AutoTrace("hcl::set::AsyncErase(remote)", key);
+    return RPC_CALL_WRAPPER_ASYNC(remote.erase, key_int, bool, key);
+  }
+}
+
+/**
+ * Issues the Contains requests of the servers that may hold keys in
+ * [key_start, key_end] at once: all servers, or with an ordered partitioner
+ * only those whose ranges intersect it. The part of this client's own
+ * server is read from shared memory once every remote request is in flight.
+ * @return one future per server asked, in server id order
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::vector<std::future<std::vector<KeyType>>>
+set<KeyType, Hash, Compare, Allocator, SharedType,
+    Partitioner>::ScatterContains(KeyType &key_start, KeyType &key_end) {
+  typedef std::vector<KeyType> ret_type;
+  std::vector<std::future<ret_type>> futures;
+  uint16_t first_server = 0, last_server = num_servers - 1;
+  if (is_ordered_partitioner<Partitioner>::value) {
+    first_server = KeyServer(key_start);
+    last_server = KeyServer(key_end);
+  }
+  int local = -1;
+  for (uint16_t i = first_server; i <= last_server; ++i) {
+    if (is_local(i)) {
+      local = futures.size();
+      futures.emplace_back();
+      continue;
+    }
+    auto future = RPC_CALL_WRAPPER_ASYNC(remote.contains, i, ret_type,
+                                         key_start, key_end);
+    futures.push_back(std::move(future));
+  }
+  if (local >= 0)
+    futures[local] = ready_future(LocalContainsInServer(key_start, key_end));
+  return futures;
+}
+
+/**
+ * Issues the GetAllData requests of all servers at once, in the same way as
+ * ScatterContains.
+ * @return one future per server, indexed by server id
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::vector<std::future<std::vector<KeyType>>>
+set<KeyType, Hash, Compare, Allocator, SharedType,
+    Partitioner>::ScatterGetAllData() {
+  typedef std::vector<KeyType> ret_type;
+  std::vector<std::future<ret_type>> futures;
+  int local = -1;
   for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server) {
-      typedef std::vector<KeyType> ret_type;
-      auto server =
-          RPC_CALL_WRAPPER("_Contains", i, ret_type, key_start, key_end);
-      final_values.insert(final_values.end(), server.begin(), server.end());
+    if (i == my_server && is_local()) {
+      local = i;
+      futures.emplace_back();
+      continue;
     }
+    auto future = RPC_CALL_WRAPPER1_ASYNC(remote.get_all_data, i, ret_type);
+    futures.push_back(std::move(future));
   }
-  return final_values;
+  if (local >= 0) futures[local] = ready_future(LocalGetAllDataInServer());
+  return futures;
 }
 
+/**
+ * Waits for the per-server results, each sorted, and returns them as one
+ * sorted vector. Ordered partitions are concatenated in server order; hash
+ * partitions are combined with a k-way merge.
+ */
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
+          typename SharedType, typename Partitioner>
 std::vector<KeyType>
-set<KeyType, Hash, Compare, Allocator, SharedType>::GetAllData() {
-  AutoTrace trace = AutoTrace("hcl::set::GetAllData");
-  std::vector<KeyType> final_values = std::vector<KeyType>();
-  auto current_server = GetAllDataInServer();
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server) {
-      typedef std::vector<KeyType> ret_type;
-      auto server = RPC_CALL_WRAPPER1("_GetAllData", i, ret_type);
-      final_values.insert(final_values.end(), server.begin(), server.end());
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::Gather(
+    std::vector<std::future<std::vector<KeyType>>> futures) {
+  std::vector<std::vector<KeyType>> runs;
+  for (auto &future : futures) runs.push_back(future.get());
+  if (is_ordered_partitioner<Partitioner>::value) {
+    std::vector<KeyType> final_values;
+    for (auto &run : runs) {
+      final_values.insert(final_values.end(),
+                          std::make_move_iterator(run.begin()),
+                          std::make_move_iterator(run.end()));
     }
+    return final_values;
+  }
+  return merge_runs(runs, Compare());
+}
+
+/**
+ * Get the keys in [key_start, key_end] from every server that may hold
+ * them. The servers are asked concurrently and the result is sorted.
+ * @param key_start, the first key of the range
+ * @param key_end, the last key of the range
+ * @return the keys in the range, sorted
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::vector<KeyType>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::Contains(
+    KeyType &key_start, KeyType &key_end) {
+  AutoTrace trace = AutoTrace("hcl::set::Contains", key_start, key_end);
+  return Gather(ScatterContains(key_start, key_end));
+}
+
+/**
+ * Get the keys in [key_start, key_end] one server at a time, without
+ * collecting them in one vector. The servers are asked concurrently.
+ * @param callback, called with the sorted keys of each server in server id
+ * order; with an ordered partitioner the calls are in key order
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+void set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::Contains(
+    KeyType &key_start, KeyType &key_end,
+    std::function<void(std::vector<KeyType> &)> callback) {
+  AutoTrace trace = AutoTrace("hcl::set::Contains", key_start, key_end);
+  for (auto &future : ScatterContains(key_start, key_end)) {
+    auto server = future.get();
+    callback(server);
+  }
+}
+
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::vector<KeyType>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::GetAllData() {
+  AutoTrace trace = AutoTrace("hcl::set::GetAllData");
+  return Gather(ScatterGetAllData());
+}
+
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+void set<KeyType, Hash, Compare, Allocator, SharedType,
+         Partitioner>::GetAllData(std::function<void(std::vector<KeyType> &)>
+                                      callback) {
+  AutoTrace trace = AutoTrace("hcl::set::GetAllData");
+  for (auto &future : ScatterGetAllData()) {
+    auto server = future.get();
+    callback(server);
   }
-  return final_values;
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::vector<KeyType> set<KeyType, Hash, Compare, Allocator,
-                         SharedType>::LocalContainsInServer(KeyType &key_start,
-                                                            KeyType &key_end) {
+          typename SharedType, typename Partitioner>
+std::vector<KeyType> set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::LocalContainsInServer(KeyType &key_start,
+                                                             KeyType &key_end) {
   AutoTrace trace = AutoTrace("hcl::set::ContainsInServer", key_start, key_end);
   std::vector<KeyType> final_values = std::vector<KeyType>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
     typename MySet::iterator lower_bound;
     size_t size = myset->size();
     if (size == 0) {
@@ -223,29 +370,28 @@ std::vector<KeyType> set<KeyType, Hash, Compare, Allocator,
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::vector<KeyType> set<KeyType, Hash, Compare, Allocator,
-                         SharedType>::ContainsInServer(KeyType &key_start,
-                                                       KeyType &key_end) {
+          typename SharedType, typename Partitioner>
+std::vector<KeyType> set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::ContainsInServer(KeyType &key_start,
+                                                        KeyType &key_end) {
   if (is_local()) {
     return LocalContainsInServer(key_start, key_end);
   } else {
     typedef std::vector<KeyType> ret_type;
     auto my_server_i = my_server;
-    return RPC_CALL_WRAPPER("_Contains", my_server_i, ret_type, key_start,
+    return RPC_CALL_WRAPPER(remote.contains, my_server_i, ret_type, key_start,
                             key_end);
   }
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::vector<KeyType>
-set<KeyType, Hash, Compare, Allocator, SharedType>::LocalGetAllDataInServer() {
+          typename SharedType, typename Partitioner>
+std::vector<KeyType> set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::LocalGetAllDataInServer() {
   AutoTrace trace = AutoTrace("hcl::set::GetAllDataInServer", NULL);
   std::vector<KeyType> final_values = std::vector<KeyType>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
     typename MySet::iterator lower_bound;
     lower_bound = myset->begin();
     while (lower_bound != myset->end()) {
@@ -257,24 +403,115 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::LocalGetAllDataInServer() {
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::vector<KeyType>
-set<KeyType, Hash, Compare, Allocator, SharedType>::GetAllDataInServer() {
+          typename SharedType, typename Partitioner>
+std::vector<KeyType> set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::GetAllDataInServer() {
   if (is_local()) {
     return LocalGetAllDataInServer();
   } else {
     typedef std::vector<KeyType> ret_type;
     auto my_server_i = my_server;
-    return RPC_CALL_WRAPPER1("_GetAllData", my_server_i, ret_type);
+    return RPC_CALL_WRAPPER1(remote.get_all_data, my_server_i, ret_type);
   }
 }
 
+/**
+ * Read one page of the local set, in key order, starting after position.
+ * The mutex is held only while the page is copied; keys put or erased
+ * between pages are seen if they sort after the position.
+ * @param position, (whether a key was read, the last key read); (0, any)
+ * starts at the first key
+ * @param max_items, the most keys to return
+ * @param max_bytes, the most key bytes to return; the first key is always
+ * returned so that the scan advances
+ * @return the position of the next page, SCAN_END once the set is read, and
+ * the keys of this page
+ */
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::pair<bool, KeyType>
-set<KeyType, Hash, Compare, Allocator, SharedType>::LocalSeekFirst() {
+          typename SharedType, typename Partitioner>
+std::pair<std::pair<uint64_t, KeyType>, std::vector<KeyType>>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::LocalScan(
+    std::pair<uint64_t, KeyType> &position, uint32_t max_items,
+    uint64_t max_bytes) {
+  AutoTrace trace = AutoTrace("hcl::set::Scan(local)", max_items);
+  std::vector<KeyType> page;
+  uint64_t read = position.first, bytes = 0;
+  KeyType last = position.second;
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
+  typename MySet::iterator iterator =
+      read > 0 ? myset->upper_bound(last) : myset->begin();
+  for (; iterator != myset->end(); ++iterator) {
+    uint64_t size = CalculateSize<KeyType>().GetSize(*iterator);
+    if (!page.empty() &&
+        (page.size() >= max_items || bytes + size > max_bytes)) {
+      return std::make_pair(std::make_pair(read, last), page);
+    }
+    read = 1;
+    last = *iterator;
+    page.push_back(*iterator);
+    bytes += size;
+  }
+  return std::make_pair(std::make_pair(SCAN_END, last), page);
+}
+
+/**
+ * Start a scan of the whole set. Pages are read with NextBatch.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+typename set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::Cursor
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::OpenScan() {
+  return Cursor();
+}
+
+/**
+ * Read the next page of a scan. Servers are read one after another in id
+ * order, each in key order; with an ordered partitioner the whole scan is in
+ * key order.
+ * @param cursor, the scan, advanced past the returned keys
+ * @param max_items, the most keys to return; 0 returns one at a time
+ * @param max_bytes, the most key bytes to return
+ * @return the keys of the page; empty once the scan is done
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::vector<KeyType>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::NextBatch(
+    Cursor &cursor, uint32_t max_items, uint64_t max_bytes) {
+  typedef std::pair<std::pair<uint64_t, KeyType>, std::vector<KeyType>>
+      ret_type;
+  while (!cursor.done) {
+    ret_type result;
+    if (is_local(cursor.server)) {
+      result = LocalScan(cursor.position, max_items, max_bytes);
+    } else {
+      AutoTrace trace = AutoTrace("hcl::set::Scan(remote)", cursor.server);
+      result = RPC_CALL_WRAPPER(remote.scan, cursor.server, ret_type,
+                                cursor.position, max_items, max_bytes);
+    }
+    cursor.position = result.first;
+    if (cursor.position.first == SCAN_END) {
+      cursor.position = std::pair<uint64_t, KeyType>();
+      cursor.done = ++cursor.server >= num_servers;
+    }
+    if (!result.second.empty()) return result.second;
+  }
+  return std::vector<KeyType>();
+}
+
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+void set<KeyType, Hash, Compare, Allocator, SharedType,
+         Partitioner>::CloseScan(Cursor &cursor) {
+  cursor.done = true;
+}
+
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::pair<bool, KeyType> set<KeyType, Hash, Compare, Allocator, SharedType,
+                             Partitioner>::LocalSeekFirst() {
   AutoTrace trace = AutoTrace("hcl::set::SeekFirst(local)");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   if (myset->size() > 0) {
     auto iterator = myset->begin();  // We want First (smallest) value in set
     KeyType value = *iterator;
@@ -284,25 +521,27 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::LocalSeekFirst() {
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::pair<bool, KeyType> set<KeyType, Hash, Compare, Allocator,
-                             SharedType>::SeekFirst(uint16_t &key_int) {
+          typename SharedType, typename Partitioner>
+std::pair<bool, KeyType>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::SeekFirst(
+    uint16_t &key_int) {
   if (is_local(key_int)) {
     return LocalSeekFirst();
   } else {
     AutoTrace trace = AutoTrace("hcl::set::SeekFirst(remote)", key_int);
     typedef std::pair<bool, KeyType> ret_type;
-    return RPC_CALL_WRAPPER1("_SeekFirst", key_int, ret_type);
+    return RPC_CALL_WRAPPER1(remote.seek_first, key_int, ret_type);
   }
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::pair<bool, std::vector<KeyType>>
-set<KeyType, Hash, Compare, Allocator, SharedType>::LocalSeekFirstN(
+          typename SharedType, typename Partitioner>
+std::pair<bool, std::vector<KeyType>> set<KeyType, Hash, Compare, Allocator,
+                                          SharedType,
+                                          Partitioner>::LocalSeekFirstN(
     uint32_t n) {
   AutoTrace trace = AutoTrace("hcl::set::LocalSeekFirstN(local)");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   auto keys = std::vector<KeyType>();
   auto iterator = myset->begin();
   int i = 0;
@@ -315,25 +554,25 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::LocalSeekFirstN(
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
+          typename SharedType, typename Partitioner>
 std::pair<bool, std::vector<KeyType>>
-set<KeyType, Hash, Compare, Allocator, SharedType>::SeekFirstN(
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::SeekFirstN(
     uint16_t &key_int, uint32_t n) {
   if (is_local(key_int)) {
     return LocalSeekFirstN(n);
   } else {
     AutoTrace trace = AutoTrace("hcl::set::SeekFirstN(remote)", key_int, n);
-    typedef std::pair<bool, KeyType> ret_type;
-    return RPC_CALL_WRAPPER("_SeekFirstN", key_int, ret_type, n);
+    typedef std::pair<bool, std::vector<KeyType>> ret_type;
+    return RPC_CALL_WRAPPER(remote.seek_first_n, key_int, ret_type, n);
   }
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::pair<bool, KeyType>
-set<KeyType, Hash, Compare, Allocator, SharedType>::LocalPopFirst() {
+          typename SharedType, typename Partitioner>
+std::pair<bool, KeyType> set<KeyType, Hash, Compare, Allocator, SharedType,
+                             Partitioner>::LocalPopFirst() {
   AutoTrace trace = AutoTrace("hcl::set::PopFirst(local)");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   if (myset->size() > 0) {
     auto iterator = myset->begin();  // We want First (smallest) value in set
     KeyType value = *iterator;
@@ -344,93 +583,191 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::LocalPopFirst() {
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-std::pair<bool, KeyType> set<KeyType, Hash, Compare, Allocator,
-                             SharedType>::PopFirst(uint16_t &key_int) {
+          typename SharedType, typename Partitioner>
+std::pair<bool, KeyType>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::PopFirst(
+    uint16_t &key_int) {
   if (is_local(key_int)) {
     return LocalPopFirst();
   } else {
     AutoTrace trace = AutoTrace("hcl::set::PopFirst(remote)", key_int);
     typedef std::pair<bool, KeyType> ret_type;
-    return RPC_CALL_WRAPPER1("_PopFirst", key_int, ret_type);
+    return RPC_CALL_WRAPPER1(remote.pop_first, key_int, ret_type);
+  }
+}
+
+/**
+ * Get the smallest key in the whole set. With an ordered partitioner the
+ * servers are asked in id order until one is not empty; otherwise every
+ * server is asked and the smallest of their first keys is returned.
+ * @return a pair of bool and key; bool is false if the set is empty.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::pair<bool, KeyType>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::SeekFirst() {
+  AutoTrace trace = AutoTrace("hcl::set::SeekFirst");
+  auto first = std::pair<bool, KeyType>(false, KeyType());
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    auto server = SeekFirst(i);
+    if (!server.first) continue;
+    if (is_ordered_partitioner<Partitioner>::value) return server;
+    if (!first.first || Compare()(server.second, first.second)) first = server;
+  }
+  return first;
+}
+
+/**
+ * Get the smallest n keys of the whole set in order. With an ordered
+ * partitioner the servers are read in id order until n keys are found;
+ * otherwise the first n keys of every server are merged.
+ * @param n, the number of keys to get
+ * @return a pair of bool and keys; bool is false if the set is empty.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+std::pair<bool, std::vector<KeyType>>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::SeekFirstN(
+    uint32_t n) {
+  AutoTrace trace = AutoTrace("hcl::set::SeekFirstN", n);
+  auto keys = std::vector<KeyType>();
+  for (uint16_t i = 0; i < num_servers && keys.size() < n; ++i) {
+    uint32_t remaining = is_ordered_partitioner<Partitioner>::value
+                             ? static_cast<uint32_t>(n - keys.size())
+                             : n;
+    auto server = SeekFirstN(i, remaining);
+    if (!server.first) continue;
+    if (is_ordered_partitioner<Partitioner>::value) {
+      keys.insert(keys.end(), server.second.begin(), server.second.end());
+    } else {
+      auto merged = std::vector<KeyType>();
+      std::merge(keys.begin(), keys.end(), server.second.begin(),
+                 server.second.end(), std::back_inserter(merged), Compare());
+      if (merged.size() > n) merged.resize(n);
+      keys.swap(merged);
+    }
   }
+  return std::pair<bool, std::vector<KeyType>>(!keys.empty(), keys);
 }
 
+/**
+ * Remove and return the smallest key of the whole set. Without an ordered
+ * partitioner the server holding the smallest first key is found first, so
+ * a concurrent PopFirst may make this return that server's next key.
+ * @return a pair of bool and key; bool is false if the set is empty.
+ */
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-size_t set<KeyType, Hash, Compare, Allocator, SharedType>::LocalSize() {
+          typename SharedType, typename Partitioner>
+std::pair<bool, KeyType>
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::PopFirst() {
+  AutoTrace trace = AutoTrace("hcl::set::PopFirst");
+  if (is_ordered_partitioner<Partitioner>::value) {
+    for (uint16_t i = 0; i < num_servers; ++i) {
+      auto server = PopFirst(i);
+      if (server.first) return server;
+    }
+    return std::pair<bool, KeyType>(false, KeyType());
+  }
+  auto first = std::pair<bool, KeyType>(false, KeyType());
+  uint16_t first_server = 0;
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    auto server = SeekFirst(i);
+    if (!server.first) continue;
+    if (!first.first || Compare()(server.second, first.second)) {
+      first = server;
+      first_server = i;
+    }
+  }
+  if (!first.first) return first;
+  return PopFirst(first_server);
+}
+
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType, typename Partitioner>
+size_t
+set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::LocalSize() {
   AutoTrace trace = AutoTrace("hcl::set::Size(local)");
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(*mutex);
   return myset->size();
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-size_t set<KeyType, Hash, Compare, Allocator, SharedType>::Size(
+          typename SharedType, typename Partitioner>
+size_t set<KeyType, Hash, Compare, Allocator, SharedType, Partitioner>::Size(
     uint16_t &key_int) {
   if (is_local(key_int)) {
     return LocalSize();
   } else {
     AutoTrace trace = AutoTrace("hcl::set::Size(remote)", key_int);
     typedef size_t ret_type;
-    return RPC_CALL_WRAPPER1("_Size", key_int, ret_type);
+    return RPC_CALL_WRAPPER1(remote.size, key_int, ret_type);
   }
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
+          typename SharedType, typename Partitioner>
 void set<KeyType, Hash, Compare, Allocator,
-         SharedType>::construct_shared_memory() {
+         SharedType, Partitioner>::construct_shared_memory() {
   ShmemAllocator alloc_inst(segment.get_segment_manager());
   /* Construct set in the shared memory space. */
   myset = segment.construct<MySet>(name.c_str())(Compare(), alloc_inst);
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-void set<KeyType, Hash, Compare, Allocator, SharedType>::open_shared_memory() {
+          typename SharedType, typename Partitioner>
+void set<KeyType, Hash, Compare, Allocator, SharedType,
+         Partitioner>::open_shared_memory() {
   std::pair<MySet *, boost::interprocess::managed_mapped_file::size_type> res;
   res = segment.find<MySet>(name.c_str());
   myset = res.first;
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
-          typename SharedType>
-void set<KeyType, Hash, Compare, Allocator, SharedType>::bind_functions() {
+          typename SharedType, typename Partitioner>
+void set<KeyType, Hash, Compare, Allocator, SharedType,
+         Partitioner>::bind_functions() {
   /* Create a RPC server and map the methods to it. */
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_ENABLE_RPCLIB
     case RPCLIB: {
       std::function<bool(KeyType &)> putFunc(std::bind(
-          &set<KeyType, Hash, Compare, Allocator, SharedType>::LocalPut, this,
-          std::placeholders::_1));
+          &set<KeyType, Hash, Compare, Allocator, SharedType,
+               Partitioner>::LocalPut, this, std::placeholders::_1));
       std::function<bool(KeyType &)> getFunc(std::bind(
-          &set<KeyType, Hash, Compare, Allocator, SharedType>::LocalGet, this,
-          std::placeholders::_1));
+          &set<KeyType, Hash, Compare, Allocator, SharedType,
+               Partitioner>::LocalGet, this, std::placeholders::_1));
       std::function<bool(KeyType &)> eraseFunc(std::bind(
-          &set<KeyType, Hash, Compare, Allocator, SharedType>::LocalErase, this,
-          std::placeholders::_1));
+          &set<KeyType, Hash, Compare, Allocator, SharedType,
+               Partitioner>::LocalErase, this, std::placeholders::_1));
       std::function<std::vector<KeyType>(void)> getAllDataInServerFunc(
-          std::bind(&set<KeyType, Hash, Compare, Allocator,
-                         SharedType>::LocalGetAllDataInServer,
-                    this));
+          std::bind(&set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::LocalGetAllDataInServer, this));
       std::function<std::vector<KeyType>(KeyType &, KeyType &)>
           containsInServerFunc(
-              std::bind(&set<KeyType, Hash, Compare, Allocator,
-                             SharedType>::LocalContainsInServer,
-                        this, std::placeholders::_1, std::placeholders::_2));
+              std::bind(&set<KeyType, Hash, Compare, Allocator, SharedType,
+                             Partitioner>::LocalContainsInServer, this,
+                        std::placeholders::_1, std::placeholders::_2));
       std::function<std::pair<bool, KeyType>(void)> seekFirstFunc(std::bind(
-          &set<KeyType, Hash, Compare, Allocator, SharedType>::LocalSeekFirst,
-          this));
+          &set<KeyType, Hash, Compare, Allocator, SharedType,
+               Partitioner>::LocalSeekFirst, this));
       std::function<std::pair<bool, KeyType>(void)> popFirstFunc(std::bind(
-          &set<KeyType, Hash, Compare, Allocator, SharedType>::LocalPopFirst,
-          this));
+          &set<KeyType, Hash, Compare, Allocator, SharedType,
+               Partitioner>::LocalPopFirst, this));
       std::function<size_t(void)> sizeFunc(std::bind(
-          &set<KeyType, Hash, Compare, Allocator, SharedType>::LocalSize,
-          this));
+          &set<KeyType, Hash, Compare, Allocator, SharedType,
+               Partitioner>::LocalSize, this));
       std::function<std::pair<bool, std::vector<KeyType>>(uint32_t)>
           localSeekFirstNFunc(std::bind(&set<KeyType, Hash, Compare, Allocator,
-                                             SharedType>::LocalSeekFirstN,
+                                             SharedType,
+                                             Partitioner>::LocalSeekFirstN,
                                         this, std::placeholders::_1));
+      std::function<std::pair<std::pair<uint64_t, KeyType>,
+                              std::vector<KeyType>>(
+          std::pair<uint64_t, KeyType> &, uint32_t, uint64_t)>
+          scanFunc(std::bind(&set<KeyType, Hash, Compare, Allocator,
+                                  SharedType, Partitioner>::LocalScan,
+                             this, std::placeholders::_1,
+                             std::placeholders::_2, std::placeholders::_3));
       rpc->bind(func_prefix + "_Put", putFunc);
       rpc->bind(func_prefix + "_Get", getFunc);
       rpc->bind(func_prefix + "_Erase", eraseFunc);
@@ -440,6 +777,7 @@ void set<KeyType, Hash, Compare, Allocator, SharedType>::bind_functions() {
       rpc->bind(func_prefix + "_SeekFirst", seekFirstFunc);
       rpc->bind(func_prefix + "_PopFirst", popFirstFunc);
       rpc->bind(func_prefix + "_SeekFirstN", localSeekFirstNFunc);
+      rpc->bind(func_prefix + "_Scan", scanFunc);
       rpc->bind(func_prefix + "_Size", sizeFunc);
       break;
     }
@@ -454,41 +792,50 @@ void set<KeyType, Hash, Compare, Allocator, SharedType>::bind_functions() {
     {
 
       std::function<void(const tl::request &, KeyType &)> putFunc(std::bind(
-          &set<KeyType, Hash, Compare, Allocator, SharedType>::ThalliumLocalPut,
-          this, std::placeholders::_1, std::placeholders::_2));
+          &set<KeyType, Hash, Compare, Allocator, SharedType,
+               Partitioner>::ThalliumLocalPut, this, std::placeholders::_1,
+          std::placeholders::_2));
       std::function<void(const tl::request &, KeyType &)> getFunc(std::bind(
-          &set<KeyType, Hash, Compare, Allocator, SharedType>::ThalliumLocalGet,
-          this, std::placeholders::_1, std::placeholders::_2));
+          &set<KeyType, Hash, Compare, Allocator, SharedType,
+               Partitioner>::ThalliumLocalGet, this, std::placeholders::_1,
+          std::placeholders::_2));
       std::function<void(const tl::request &, KeyType &)> eraseFunc(
-          std::bind(&set<KeyType, Hash, Compare, Allocator,
-                         SharedType>::ThalliumLocalErase,
-                    this, std::placeholders::_1, std::placeholders::_2));
+          std::bind(&set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::ThalliumLocalErase, this,
+                    std::placeholders::_1, std::placeholders::_2));
       std::function<void(const tl::request &)> getAllDataInServerFunc(
-          std::bind(&set<KeyType, Hash, Compare, Allocator,
-                         SharedType>::ThalliumLocalGetAllDataInServer,
-                    this, std::placeholders::_1));
+          std::bind(&set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::ThalliumLocalGetAllDataInServer, this,
+                    std::placeholders::_1));
       std::function<void(const tl::request &, KeyType &, KeyType &)>
           containsInServerFunc(
-              std::bind(&set<KeyType, Hash, Compare, Allocator,
-                             SharedType>::ThalliumLocalContainsInServer,
-                        this, std::placeholders::_1, std::placeholders::_2,
+              std::bind(&set<KeyType, Hash, Compare, Allocator, SharedType,
+                             Partitioner>::ThalliumLocalContainsInServer, this,
+                        std::placeholders::_1, std::placeholders::_2,
                         std::placeholders::_3));
       std::function<void(const tl::request &)> seekFirstFunc(
-          std::bind(&set<KeyType, Hash, Compare, Allocator,
-                         SharedType>::ThalliumLocalSeekFirst,
-                    this, std::placeholders::_1));
+          std::bind(&set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::ThalliumLocalSeekFirst, this,
+                    std::placeholders::_1));
       std::function<void(const tl::request &)> popFirstFunc(
-          std::bind(&set<KeyType, Hash, Compare, Allocator,
-                         SharedType>::ThalliumLocalPopFirst,
-                    this, std::placeholders::_1));
+          std::bind(&set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::ThalliumLocalPopFirst, this,
+                    std::placeholders::_1));
       std::function<void(const tl::request &)> sizeFunc(
-          std::bind(&set<KeyType, Hash, Compare, Allocator,
-                         SharedType>::ThalliumLocalSize,
-                    this, std::placeholders::_1));
+          std::bind(&set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::ThalliumLocalSize, this,
+                    std::placeholders::_1));
       std::function<void(const tl::request &, uint32_t)> localSeekFirstNFunc(
-          std::bind(&set<KeyType, Hash, Compare, Allocator,
-                         SharedType>::ThalliumLocalSeekFirstN,
-                    this, std::placeholders::_1, std::placeholders::_2));
+          std::bind(&set<KeyType, Hash, Compare, Allocator, SharedType,
+                         Partitioner>::ThalliumLocalSeekFirstN, this,
+                    std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, std::pair<uint64_t, KeyType> &,
+                         uint32_t, uint64_t)>
+          scanFunc(std::bind(&set<KeyType, Hash, Compare, Allocator,
+                                  SharedType, Partitioner>::ThalliumLocalScan,
+                             this, std::placeholders::_1,
+                             std::placeholders::_2, std::placeholders::_3,
+                             std::placeholders::_4));
       rpc->bind(func_prefix + "_Put", putFunc);
       rpc->bind(func_prefix + "_Get", getFunc);
       rpc->bind(func_prefix + "_Erase", eraseFunc);
@@ -497,7 +844,8 @@ void set<KeyType, Hash, Compare, Allocator, SharedType>::bind_functions() {
 
       rpc->bind(func_prefix + "_SeekFirst", seekFirstFunc);
       rpc->bind(func_prefix + "_PopFirst", popFirstFunc);
-      // rpc->bind(func_prefix+"_SeekFirstN", localSeekFirstNFunc);
+      rpc->bind(func_prefix + "_SeekFirstN", localSeekFirstNFunc);
+      rpc->bind(func_prefix + "_Scan", scanFunc);
       rpc->bind(func_prefix + "_Size", sizeFunc);
       break;
     }
@@ -39,14 +39,19 @@
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/containers/set.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
 /** Standard C++ Headers**/
 #include <hcl/common/container.h>
+#include <hcl/common/partitioner.h>
 
+#include <algorithm>
 #include <boost/interprocess/managed_mapped_file.hpp>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <set>
 #include <string>
@@ -59,11 +64,12 @@ namespace hcl {
  * achieve the data structure.
  *
  * @tparam MappedType, the value of the Set
+ * @tparam Partitioner, policy choosing the server of a key from its hash
  */
 
 template <typename KeyType, typename Hash = std::hash<KeyType>,
           typename Compare = std::less<KeyType>, class Allocator = nullptr_t,
-          class SharedType = nullptr_t>
+          class SharedType = nullptr_t, class Partitioner = ModuloPartitioner>
 class set : public container {
  private:
   /** Class Typedefs for ease of use **/
@@ -73,9 +79,32 @@ class set : public container {
   typedef boost::interprocess::set<KeyType, Compare, ShmemAllocator> MySet;
   /** Class attributes**/
   Hash keyHash;
+  Partitioner keyPartitioner;
   MySet *myset;
+  /* Handles of the remote operations, resolved by the constructor */
+  struct {
+    RPC::Procedure put, get, erase, contains, get_all_data, scan, size,
+        seek_first, seek_first_n, pop_first;
+  } remote;
+
+  /** The server that owns key; ordered partitioners see the key itself. */
+  inline uint16_t KeyServer(KeyType &key) {
+    if constexpr (is_ordered_partitioner<Partitioner>::value) {
+      return keyPartitioner(key);
+    } else {
+      return keyPartitioner(keyHash(key));
+    }
+  }
+
+  std::vector<std::future<std::vector<KeyType>>> ScatterContains(
+      KeyType &key_start, KeyType &key_end);
+  std::vector<std::future<std::vector<KeyType>>> ScatterGetAllData();
+  std::vector<KeyType> Gather(
+      std::vector<std::future<std::vector<KeyType>>> futures);
 
  public:
+  typedef ScanCursor<std::pair<uint64_t, KeyType>> Cursor;
+
   ~set();
 
   void construct_shared_memory() override;
@@ -91,7 +120,8 @@ class set : public container {
       nullptr;
   }
   explicit set(CharStruct name_ = "TEST_SET",
-               uint16_t port = HCL_CONF->RPC_PORT);
+               uint16_t port = HCL_CONF->RPC_PORT,
+               Partitioner partitioner = Partitioner(HCL_CONF->NUM_SERVERS));
 
   bool LocalPut(KeyType &key);
   bool LocalGet(KeyType &key);
@@ -103,6 +133,9 @@ class set : public container {
   std::pair<bool, KeyType> LocalPopFirst();
   size_t LocalSize();
   std::pair<bool, std::vector<KeyType>> LocalSeekFirstN(uint32_t n);
+  std::pair<std::pair<uint64_t, KeyType>, std::vector<KeyType>> LocalScan(
+      std::pair<uint64_t, KeyType> &position, uint32_t max_items,
+      uint64_t max_bytes);
 
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
   THALLIUM_DEFINE(LocalPut, (key), KeyType &key)
@@ -111,6 +144,9 @@ class set : public container {
   THALLIUM_DEFINE(LocalContainsInServer, (key_start, key_end),
                   KeyType &key_start, KeyType &key_end)
   THALLIUM_DEFINE(LocalSeekFirstN, (n), uint32_t n)
+  THALLIUM_DEFINE(LocalScan, (position, max_items, max_bytes),
+                  std::pair<uint64_t, KeyType> &position, uint32_t max_items,
+                  uint64_t max_bytes)
 
   THALLIUM_DEFINE1(LocalSize)
   THALLIUM_DEFINE1(LocalSeekFirst)
@@ -126,6 +162,11 @@ class set : public container {
 
   std::vector<KeyType> GetAllData();
 
+  void Contains(KeyType &key_start, KeyType &key_end,
+                std::function<void(std::vector<KeyType> &)> callback);
+
+  void GetAllData(std::function<void(std::vector<KeyType> &)> callback);
+
   std::vector<KeyType> ContainsInServer(KeyType &key_start, KeyType &key_end);
   std::vector<KeyType> GetAllDataInServer();
   std::pair<bool, KeyType> SeekFirst(uint16_t &key_int);
@@ -133,6 +174,16 @@ class set : public container {
   std::pair<bool, std::vector<KeyType>> SeekFirstN(uint16_t &key_int,
                                                    uint32_t n);
   size_t Size(uint16_t &key_int);
+  std::pair<bool, KeyType> SeekFirst();
+  std::pair<bool, KeyType> PopFirst();
+  std::pair<bool, std::vector<KeyType>> SeekFirstN(uint32_t n);
+  std::future<bool> AsyncPut(KeyType &key);
+  std::future<bool> AsyncGet(KeyType &key);
+  std::future<bool> AsyncErase(KeyType &key);
+  Cursor OpenScan();
+  std::vector<KeyType> NextBatch(Cursor &cursor, uint32_t max_items,
+                                 uint64_t max_bytes = UINT64_MAX);
+  void CloseScan(Cursor &cursor);
 };
 
 #include "set.cpp"
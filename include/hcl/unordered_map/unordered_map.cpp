@@ -17,19 +17,37 @@
 
 /* Constructor to deallocate the shared memory*/
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 unordered_map<KeyType, MappedType, Hash, Allocator,
-              SharedType>::~unordered_map() {
+              SharedType, Partitioner>::~unordered_map() {
   this->container::~container();
 }
 
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
-unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::unordered_map(
-    CharStruct name_, uint16_t port)
-    : container(name_, port), myHashMap(), size_occupied(0) {
+          typename Allocator, typename SharedType, typename Partitioner>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType, Partitioner>::
+    unordered_map(CharStruct name_, uint16_t port, Partitioner partitioner)
+    : container(name_, port),
+      keyPartitioner(partitioner),
+      num_stripes(1),
+      myHashMap(),
+      stripeMutex(),
+      size_occupied(0) {
   // init my_server, num_servers, server_on_node, processor_name from RPC
   AutoTrace trace = AutoTrace("hcl::unordered_map");
+  remote.put = resolve("_Put");
+  remote.get = resolve("_Get");
+  remote.erase = resolve("_Erase");
+  remote.get_all_data = resolve("_GetAllData");
+  remote.put_batch = resolve("_PutBatch");
+  remote.get_batch = resolve("_GetBatch");
+  remote.erase_batch = resolve("_EraseBatch");
+  remote.scan = resolve("_Scan");
+  remote.get_all_data_split = resolve("_GetAllDataSplit");
+  remote.put_bulk = resolve("_PutBulk");
+  remote.get_or_size = resolve("_GetOrSize");
+  remote.get_bulk = resolve("_GetBulk");
+  remote.get_bulk_batch = resolve("_GetBulkBatch");
   if (is_server) {
     construct_shared_memory();
     bind_functions();
@@ -39,30 +57,22 @@ unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::unordered_map(
 }
 
 /**
- * Put the data into the local unordered map.
+ * Put the data into the local unordered map. Only the key's stripe is locked.
  * @param key, the key for put
  * @param data, the value for put
  * @return bool, true if Put was successful else false.
  */
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
-bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalPut(
-    KeyType &key, MappedType &data) {
-  if (is_server && !server_on_node) {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
-    auto value = GetData<Allocator, MappedType, SharedType>(data);
-    auto iter = myHashMap->insert_or_assign(key, value);
-    if (iter.second)
-      size_occupied += CalculateSize<KeyType>().GetSize(key) +
-                       CalculateSize<MappedType>().GetSize(data);
-  } else {
-    auto value = GetData<Allocator, MappedType, SharedType>(data);
-    auto iter = myHashMap->insert_or_assign(key, value);
-    if (iter.second)
-      size_occupied += CalculateSize<KeyType>().GetSize(key) +
-                       CalculateSize<MappedType>().GetSize(data);
-  }
+          typename Allocator, typename SharedType, typename Partitioner>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                   Partitioner>::LocalPut(KeyType &key, MappedType &data) {
+  uint16_t stripe = Stripe(key);
+  auto value = GetData<Allocator, MappedType, SharedType>(data);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(stripeMutex[stripe]);
+  auto iter = myHashMap[stripe].insert_or_assign(key, value);
+  if (iter.second)
+    size_occupied += CalculateSize<KeyType>().GetSize(key) +
+                     CalculateSize<MappedType>().GetSize(data);
   return true;
 }
 /**
@@ -73,43 +83,40 @@ bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalPut(
  * @return bool, true if Put was successful else false.
  */
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
-bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::Put(
-    KeyType key, MappedType data) {
-  uint16_t key_int = (uint16_t)keyHash(key) % num_servers;
+          typename Allocator, typename SharedType, typename Partitioner>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                   Partitioner>::Put(KeyType key, MappedType data) {
+  uint16_t key_int = keyPartitioner(keyHash(key));
   if (is_local(key_int)) {
     return LocalPut(key, data);
   } else {
-    return RPC_CALL_WRAPPER("_Put", key_int, bool, key, data);
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+    if (use_rdma(data)) return PutBulk(key_int, key, data);
+#endif
+    return RPC_CALL_WRAPPER(remote.put, key_int, bool, key, data);
   }
 }
 
 /**
- * Get the data in the local unordered map.
+ * Get the data in the local unordered map. The key's stripe is shared with
+ * other readers.
  * @param key, key to get
  * @return return a pair of bool and Value. If bool is true then data was
  * found and is present in value part else bool is set to false
  */
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::pair<bool, MappedType> unordered_map<KeyType, MappedType, Hash, Allocator,
-                                          SharedType>::LocalGet(KeyType &key) {
-  if (is_server && !server_on_node) {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
-    typename MyHashMap::iterator iterator = myHashMap->find(key);
-    if (iterator != myHashMap->end()) {
-      return std::pair<bool, MappedType>(true, iterator->second);
-    } else {
-      return std::pair<bool, MappedType>(false, MappedType());
-    }
+                                          SharedType, Partitioner>::LocalGet(
+    KeyType &key) {
+  uint16_t stripe = Stripe(key);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(
+      stripeMutex[stripe]);
+  typename MyHashMap::iterator iterator = myHashMap[stripe].find(key);
+  if (iterator != myHashMap[stripe].end()) {
+    return std::pair<bool, MappedType>(true, iterator->second);
   } else {
-    typename MyHashMap::iterator iterator = myHashMap->find(key);
-    if (iterator != myHashMap->end()) {
-      return std::pair<bool, MappedType>(true, iterator->second);
-    } else {
-      return std::pair<bool, MappedType>(false, MappedType());
-    }
+    return std::pair<bool, MappedType>(false, MappedType());
   }
 }
 
@@ -121,96 +128,194 @@ std::pair<bool, MappedType> unordered_map<KeyType, MappedType, Hash, Allocator,
  * found and is present in value part else bool is set to false
  */
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::pair<bool, MappedType> unordered_map<KeyType, MappedType, Hash, Allocator,
-                                          SharedType>::Get(KeyType &key) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
+                                          SharedType, Partitioner>::Get(
+    KeyType &key) {
+  uint16_t key_int = keyPartitioner(keyHash(key));
   if (is_local(key_int)) {
     return LocalGet(key);
   } else {
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+    if (may_use_rdma<MappedType>()) return GetBulk(key_int, key);
+#endif
     typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Get", key_int, ret_type, key);
+    return RPC_CALL_WRAPPER(remote.get, key_int, ret_type, key);
   }
 }
 
+/**
+ * Erase the key from the local unordered map.
+ * @param key, key to erase
+ * @return return a pair of bool and Value. If bool is true then the key was
+ * found and its value is in the value part else bool is set to false
+ */
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
-std::pair<bool, MappedType>
-unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalErase(
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<bool, MappedType> unordered_map<KeyType, MappedType, Hash, Allocator,
+                                          SharedType, Partitioner>::LocalErase(
     KeyType &key) {
-  if (is_server && !server_on_node) {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
-    typename MyHashMap::iterator iterator = myHashMap->find(key);
-    if (iterator != myHashMap->end()) {
-      size_occupied -= CalculateSize<KeyType>().GetSize(key) +
-                       CalculateSize<MappedType>().GetSize(iterator->second);
-      myHashMap->erase(iterator);
-      return std::pair<bool, MappedType>(true, MappedType());
-    } else
-      return std::pair<bool, MappedType>(false, MappedType());
-  } else {
-    typename MyHashMap::iterator iterator = myHashMap->find(key);
-    if (iterator != myHashMap->end()) {
-      size_occupied -= CalculateSize<KeyType>().GetSize(key) +
-                       CalculateSize<MappedType>().GetSize(iterator->second);
-      myHashMap->erase(iterator);
-      return std::pair<bool, MappedType>(true, MappedType());
-    } else
-      return std::pair<bool, MappedType>(false, MappedType());
-  }
+  uint16_t stripe = Stripe(key);
+  bip::scoped_lock<bip::interprocess_sharable_mutex> lock(stripeMutex[stripe]);
+  typename MyHashMap::iterator iterator = myHashMap[stripe].find(key);
+  if (iterator != myHashMap[stripe].end()) {
+    size_occupied -= CalculateSize<KeyType>().GetSize(key) +
+                     CalculateSize<MappedType>().GetSize(iterator->second);
+    std::pair<bool, MappedType> erased(true, iterator->second);
+    myHashMap[stripe].erase(iterator);
+    return erased;
+  } else
+    return std::pair<bool, MappedType>(false, MappedType());
 }
 
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::pair<bool, MappedType> unordered_map<KeyType, MappedType, Hash, Allocator,
-                                          SharedType>::Erase(KeyType &key) {
-  size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
+                                          SharedType, Partitioner>::Erase(
+    KeyType &key) {
+  uint16_t key_int = keyPartitioner(keyHash(key));
   if (is_local(key_int)) {
     return LocalErase(key);
   } else {
     typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
+    return RPC_CALL_WRAPPER(remote.erase, key_int, ret_type, key);
     // return rpc->call(key_int, func_prefix+"_Erase",
     //                  key).template as<std::pair<bool, MappedType>>();
   }
 }
 
+/**
+ * Put the data into the unordered map without waiting for the result.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @return a future holding true if Put was successful else false.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::future<bool> unordered_map<KeyType, MappedType, Hash, Allocator,
+                                SharedType, Partitioner>::AsyncPut(
+    KeyType &key, MappedType &data) {
+  uint16_t key_int = keyPartitioner(keyHash(key));
+  if (is_local(key_int)) {
+    /* LocalPut moves out of its value; the caller's data stays intact as on
+     * the remote path */
+    MappedType value = data;
+    return ready_future(LocalPut(key, value));
+  } else {
+    return RPC_CALL_WRAPPER_ASYNC(remote.put, key_int, bool, key, data);
+  }
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::future<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::AsyncGet(KeyType &key) {
+  uint16_t key_int = keyPartitioner(keyHash(key));
+  if (is_local(key_int)) {
+    return ready_future(LocalGet(key));
+  } else {
+    typedef std::pair<bool, MappedType> ret_type;
+    return RPC_CALL_WRAPPER_ASYNC(remote.get, key_int, ret_type, key);
+  }
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::future<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::AsyncErase(KeyType &key) {
+  uint16_t key_int = keyPartitioner(keyHash(key));
+  if (is_local(key_int)) {
+    return ready_future(LocalErase(key));
+  } else {
+    typedef std::pair<bool, MappedType> ret_type;
+    return RPC_CALL_WRAPPER_ASYNC(remote.erase, key_int, ret_type, key);
+  }
+}
+
+/**
+ * Issues the GetAllData requests of all servers at once. The part of this
+ * client's own server is read from shared memory once every remote request is
+ * in flight.
+ * @return one future per server, indexed by server id
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::ScatterGetAllData() {
+  typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
+  std::vector<std::future<ret_type>> futures;
+  int local = -1;
+  for (int i = 0; i < num_servers; ++i) {
+    if (i == my_server && is_local()) {
+      local = i;
+      futures.emplace_back();
+      continue;
+    }
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+    if (may_use_rdma<MappedType>()) {
+      futures.push_back(std::async(std::launch::deferred,
+                                   [this, i]() { return GetAllDataBulk(i); }));
+      continue;
+    }
+#endif
+    auto future = RPC_CALL_WRAPPER1_ASYNC(remote.get_all_data, i, ret_type);
+    futures.push_back(std::move(future));
+  }
+  if (local >= 0) futures[local] = ready_future(LocalGetAllDataInServer());
+  return futures;
+}
+
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
-unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::GetAllData() {
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::GetAllData() {
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = GetAllDataInServer();
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server) {
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server = RPC_CALL_WRAPPER1("_GetAllData", i, ret_type);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
+  for (auto &future : ScatterGetAllData()) {
+    auto server = future.get();
+    final_values.insert(final_values.end(),
+                        std::make_move_iterator(server.begin()),
+                        std::make_move_iterator(server.end()));
   }
   return final_values;
 }
 
+/**
+ * Get all the data of the map one server at a time, without collecting it
+ * in one vector. All servers are asked at once.
+ * @param callback, called with the data of each server in server id order
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+void unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                   Partitioner>::
+    GetAllData(
+        std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+            callback) {
+  for (auto &future : ScatterGetAllData()) {
+    auto server = future.get();
+    callback(server);
+  }
+}
+
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
 std::vector<std::pair<KeyType, MappedType>>
 unordered_map<KeyType, MappedType, Hash, Allocator,
-              SharedType>::LocalGetAllDataInServer() {
+              SharedType, Partitioner>::LocalGetAllDataInServer() {
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
-  {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+  for (uint16_t stripe = 0; stripe < num_stripes; ++stripe) {
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(
+        stripeMutex[stripe]);
     typename MyHashMap::iterator lower_bound;
-    if (myHashMap->size() > 0) {
-      lower_bound = myHashMap->begin();
-      while (lower_bound != myHashMap->end()) {
+    if (myHashMap[stripe].size() > 0) {
+      lower_bound = myHashMap[stripe].begin();
+      while (lower_bound != myHashMap[stripe].end()) {
         final_values.push_back(std::pair<KeyType, MappedType>(
             lower_bound->first, lower_bound->second));
         lower_bound++;
@@ -221,56 +326,808 @@ unordered_map<KeyType, MappedType, Hash, Allocator,
 }
 
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
-std::vector<std::pair<KeyType, MappedType>> unordered_map<
-    KeyType, MappedType, Hash, Allocator, SharedType>::GetAllDataInServer() {
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::GetAllDataInServer() {
   if (is_local()) {
     return LocalGetAllDataInServer();
   } else {
     typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server;
-    return RPC_CALL_WRAPPER1("_GetAllData", my_server_i, ret_type);
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+    if (may_use_rdma<MappedType>()) return GetAllDataBulk(my_server_i);
+#endif
+    return RPC_CALL_WRAPPER1(remote.get_all_data, my_server_i, ret_type);
   }
 }
 
+/**
+ * Put a batch of data into the local unordered map. The lock of each stripe
+ * is acquired once for the keys of the batch in that stripe.
+ * @param keys, the keys for put
+ * @param data, the values for put, aligned with keys
+ * @return bool, true if all Puts were successful else false.
+ */
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                   Partitioner>::LocalPutBatch(std::vector<KeyType> &keys,
+                                               std::vector<MappedType> &data) {
+  if (keys.size() != data.size()) return false;
+  auto positions = StripePositions(keys);
+  for (uint16_t stripe = 0; stripe < num_stripes; ++stripe) {
+    if (positions[stripe].empty()) continue;
+    bip::scoped_lock<bip::interprocess_sharable_mutex> lock(
+        stripeMutex[stripe]);
+    for (auto i : positions[stripe]) {
+      auto size = CalculateSize<KeyType>().GetSize(keys[i]) +
+                  CalculateSize<MappedType>().GetSize(data[i]);
+      auto value = GetData<Allocator, MappedType, SharedType>(data[i]);
+      auto iter = myHashMap[stripe].insert_or_assign(keys[i], value);
+      if (iter.second) size_occupied += size;
+    }
+  }
+  return true;
+}
+
+/**
+ * Get a batch of data from the local unordered map. The lock of each stripe
+ * is shared once for the keys of the batch in that stripe.
+ * @param keys, keys to get
+ * @return a vector aligned with keys of pairs of bool and Value. If bool is
+ * true then data was found and is present in value part else bool is set to
+ * false
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::LocalGetBatch(std::vector<KeyType> &keys) {
+  std::vector<std::pair<bool, MappedType>> values(
+      keys.size(), std::pair<bool, MappedType>(false, MappedType()));
+  auto positions = StripePositions(keys);
+  for (uint16_t stripe = 0; stripe < num_stripes; ++stripe) {
+    if (positions[stripe].empty()) continue;
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(
+        stripeMutex[stripe]);
+    for (auto i : positions[stripe]) {
+      typename MyHashMap::iterator iterator = myHashMap[stripe].find(keys[i]);
+      if (iterator != myHashMap[stripe].end()) {
+        values[i] = std::pair<bool, MappedType>(true, iterator->second);
+      }
+    }
+  }
+  return values;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::LocalEraseBatch(std::vector<KeyType> &keys) {
+  std::vector<std::pair<bool, MappedType>> values(
+      keys.size(), std::pair<bool, MappedType>(false, MappedType()));
+  auto positions = StripePositions(keys);
+  for (uint16_t stripe = 0; stripe < num_stripes; ++stripe) {
+    if (positions[stripe].empty()) continue;
+    bip::scoped_lock<bip::interprocess_sharable_mutex> lock(
+        stripeMutex[stripe]);
+    for (auto i : positions[stripe]) {
+      typename MyHashMap::iterator iterator = myHashMap[stripe].find(keys[i]);
+      if (iterator != myHashMap[stripe].end()) {
+        size_occupied -= CalculateSize<KeyType>().GetSize(keys[i]) +
+                         CalculateSize<MappedType>().GetSize(iterator->second);
+        myHashMap[stripe].erase(iterator);
+        values[i].first = true;
+      }
+    }
+  }
+  return values;
+}
+
+/**
+ * Put a batch of data into the unordered map. Keys are grouped by the server
+ * they hash to and each group is sent in a single RPC.
+ * @param keys, the keys for put
+ * @param data, the values for put, aligned with keys
+ * @return bool, true if all Puts were successful else false.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                   Partitioner>::PutBatch(std::vector<KeyType> &keys,
+                                          std::vector<MappedType> &data) {
+  if (keys.size() != data.size()) return false;
+  std::vector<std::vector<KeyType>> server_keys(num_servers);
+  std::vector<std::vector<MappedType>> server_data(num_servers);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    uint16_t key_int = keyPartitioner(keyHash(keys[i]));
+    server_keys[key_int].push_back(keys[i]);
+    server_data[key_int].push_back(data[i]);
+  }
+  bool success = true;
+  for (uint16_t key_int = 0; key_int < num_servers; ++key_int) {
+    if (server_keys[key_int].empty()) continue;
+    bool result;
+    if (is_local(key_int)) {
+      result = LocalPutBatch(server_keys[key_int], server_data[key_int]);
+    } else {
+      result = RPC_CALL_WRAPPER(remote.put_batch, key_int, bool,
+                                server_keys[key_int], server_data[key_int]);
+    }
+    success = success && result;
+  }
+  return success;
+}
+
+/**
+ * Get a batch of data from the unordered map. Keys are grouped by the server
+ * they hash to and each group is sent in a single RPC.
+ * @param keys, keys to get
+ * @return a vector aligned with keys of pairs of bool and Value. If bool is
+ * true then data was found and is present in value part else bool is set to
+ * false
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::GetBatch(std::vector<KeyType> &keys) {
+  std::vector<std::vector<KeyType>> server_keys(num_servers);
+  std::vector<std::vector<std::size_t>> server_positions(num_servers);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    uint16_t key_int = keyPartitioner(keyHash(keys[i]));
+    server_keys[key_int].push_back(keys[i]);
+    server_positions[key_int].push_back(i);
+  }
+  std::vector<std::pair<bool, MappedType>> final_values(keys.size());
+  for (uint16_t key_int = 0; key_int < num_servers; ++key_int) {
+    if (server_keys[key_int].empty()) continue;
+    typedef std::vector<std::pair<bool, MappedType>> ret_type;
+    ret_type values;
+    if (is_local(key_int)) {
+      values = LocalGetBatch(server_keys[key_int]);
+    } else {
+      values = RPC_CALL_WRAPPER(remote.get_batch, key_int, ret_type,
+                                server_keys[key_int]);
+    }
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      final_values[server_positions[key_int][i]] = std::move(values[i]);
+    }
+  }
+  return final_values;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::EraseBatch(std::vector<KeyType> &keys) {
+  std::vector<std::vector<KeyType>> server_keys(num_servers);
+  std::vector<std::vector<std::size_t>> server_positions(num_servers);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    uint16_t key_int = keyPartitioner(keyHash(keys[i]));
+    server_keys[key_int].push_back(keys[i]);
+    server_positions[key_int].push_back(i);
+  }
+  std::vector<std::pair<bool, MappedType>> final_values(keys.size());
+  for (uint16_t key_int = 0; key_int < num_servers; ++key_int) {
+    if (server_keys[key_int].empty()) continue;
+    typedef std::vector<std::pair<bool, MappedType>> ret_type;
+    ret_type values;
+    if (is_local(key_int)) {
+      values = LocalEraseBatch(server_keys[key_int]);
+    } else {
+      values = RPC_CALL_WRAPPER(remote.erase_batch, key_int, ret_type,
+                                server_keys[key_int]);
+    }
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      final_values[server_positions[key_int][i]] = std::move(values[i]);
+    }
+  }
+  return final_values;
+}
+
+/**
+ * Read one page of the local map, starting at position. Stripes are read in
+ * order and each is shared only while its part of the page is copied. A
+ * rehash between pages may make a scan see an entry twice or miss one.
+ * @param position, (stripe in the top 16 bits and bucket in the low 48 bits,
+ * entries of that bucket already read)
+ * @param max_items, the most entries to return
+ * @param max_bytes, the most key and value bytes to return; the first entry
+ * is always returned so that the scan advances
+ * @return the position of the next page, SCAN_END once the map is read, and
+ * the entries of this page
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<std::pair<uint64_t, uint64_t>,
+          std::vector<std::pair<KeyType, MappedType>>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::LocalScan(std::pair<uint64_t, uint64_t> &position,
+                                      uint32_t max_items, uint64_t max_bytes) {
+  AutoTrace trace = AutoTrace("hcl::unordered_map::Scan(local)", max_items);
+  std::vector<std::pair<KeyType, MappedType>> page;
+  const uint64_t bucket_bits = 48, bucket_mask = (1ULL << bucket_bits) - 1;
+  uint64_t stripe = position.first >> bucket_bits;
+  uint64_t bucket = position.first & bucket_mask, offset = position.second;
+  uint64_t bytes = 0;
+  for (; stripe < num_stripes; ++stripe, bucket = 0, offset = 0) {
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(
+        stripeMutex[stripe]);
+    MyHashMap &stripe_map = myHashMap[stripe];
+    for (; bucket < stripe_map.bucket_count(); ++bucket, offset = 0) {
+      auto iterator = stripe_map.begin(bucket);
+      for (uint64_t i = 0; i < offset && iterator != stripe_map.end(bucket);
+           ++i)
+        ++iterator;
+      for (; iterator != stripe_map.end(bucket); ++iterator, ++offset) {
+        uint64_t size = CalculateSize<KeyType>().GetSize(iterator->first) +
+                        CalculateSize<MappedType>().GetSize(iterator->second);
+        if (!page.empty() &&
+            (page.size() >= max_items || bytes + size > max_bytes)) {
+          return std::make_pair(
+              std::make_pair((stripe << bucket_bits) | bucket, offset), page);
+        }
+        page.emplace_back(iterator->first, iterator->second);
+        bytes += size;
+      }
+    }
+  }
+  return std::make_pair(std::make_pair(SCAN_END, (uint64_t)0), page);
+}
+
+/**
+ * Start a scan of the whole map. Pages are read with NextBatch.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+typename unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                       Partitioner>::Cursor
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::OpenScan() {
+  return Cursor();
+}
+
+/**
+ * Read the next page of a scan. Servers are read one after another; each
+ * request returns at most one server's entries.
+ * @param cursor, the scan, advanced past the returned entries
+ * @param max_items, the most entries to return; 0 returns one at a time
+ * @param max_bytes, the most key and value bytes to return
+ * @return the entries of the page; empty once the scan is done
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::NextBatch(Cursor &cursor, uint32_t max_items,
+                                      uint64_t max_bytes) {
+  typedef std::pair<std::pair<uint64_t, uint64_t>,
+                    std::vector<std::pair<KeyType, MappedType>>>
+      ret_type;
+  while (!cursor.done) {
+    ret_type result;
+    if (is_local(cursor.server)) {
+      result = LocalScan(cursor.position, max_items, max_bytes);
+    } else {
+      AutoTrace trace =
+          AutoTrace("hcl::unordered_map::Scan(remote)", cursor.server);
+      result = RPC_CALL_WRAPPER(remote.scan, cursor.server, ret_type,
+                                cursor.position, max_items, max_bytes);
+    }
+    cursor.position = result.first;
+    if (cursor.position.first == SCAN_END) {
+      cursor.position = std::pair<uint64_t, uint64_t>();
+      cursor.done = ++cursor.server >= num_servers;
+    }
+    if (!result.second.empty()) return result.second;
+  }
+  return std::vector<std::pair<KeyType, MappedType>>();
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+void unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                   Partitioner>::CloseScan(Cursor &cursor) {
+  cursor.done = true;
+}
+
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+/**
+ * Put a value the client exposed as an RDMA bulk. Fixed size values are pulled
+ * straight into their node in the segment while its stripe is locked; other
+ * values are pulled into a buffer that LocalPut then moves into the map.
+ * @param endpoint, the client that owns the bulk
+ * @param key, the key for put
+ * @param bulk_handle, the client's exposure of the value
+ * @return bool, true if Put was successful else false.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+bool unordered_map<KeyType, MappedType, Hash, Allocator,
+                   SharedType, Partitioner>::LocalPutBulk(tl::endpoint endpoint,
+                                             KeyType &key,
+                                             tl::bulk &bulk_handle) {
+  if constexpr (RDMABuffer<MappedType>::fixed_size &&
+                std::is_same<Allocator, nullptr_t>::value) {
+    if (bulk_handle.size() != sizeof(MappedType)) return false;
+    uint16_t stripe = Stripe(key);
+    bip::scoped_lock<bip::interprocess_sharable_mutex> lock(
+        stripeMutex[stripe]);
+    auto iter = myHashMap[stripe].try_emplace(key);
+    if (iter.second)
+      size_occupied += CalculateSize<KeyType>().GetSize(key) +
+                       CalculateSize<MappedType>().GetSize(iter.first->second);
+    rpc->pull_rdma(endpoint, bulk_handle, 0, iter.first->second);
+    return true;
+  } else {
+    MappedType data = rpc->prep_rdma_server<MappedType>(endpoint, bulk_handle);
+    return LocalPut(key, data);
+  }
+}
+
+/**
+ * Get the data in the local unordered map if it is below the RDMA threshold,
+ * otherwise only its size so that the client can fetch it with GetBulk.
+ * @param key, key to get
+ * @return a pair of (found, size) and the value when it was small enough.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<std::pair<bool, size_t>, MappedType>
+unordered_map<KeyType, MappedType, Hash, Allocator,
+              SharedType, Partitioner>::LocalGetOrSize(KeyType &key) {
+  typedef std::pair<std::pair<bool, size_t>, MappedType> ret_type;
+  uint16_t stripe = Stripe(key);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(
+      stripeMutex[stripe]);
+  typename MyHashMap::iterator iterator = myHashMap[stripe].find(key);
+  if (iterator == myHashMap[stripe].end()) {
+    return ret_type(std::pair<bool, size_t>(false, 0), MappedType());
+  }
+  size_t size = RDMABuffer<MappedType>::size(iterator->second);
+  if (size < HCL_CONF->RDMA_THRESHOLD) {
+    return ret_type(std::pair<bool, size_t>(true, size), iterator->second);
+  }
+  return ret_type(std::pair<bool, size_t>(true, size), MappedType());
+}
+
+/**
+ * Push a value from its node in the segment into the client's bulk. Nothing is
+ * written when the bulk is too small; the size tells the client to retry.
+ * @param endpoint, the client that owns the bulk
+ * @param key, key to get
+ * @param bulk_handle, the client's buffer for the value
+ * @return a pair of (found, size of the value).
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<bool, size_t> unordered_map<KeyType, MappedType, Hash, Allocator,
+                                      SharedType, Partitioner>::LocalGetBulk(
+    tl::endpoint endpoint, KeyType &key, tl::bulk &bulk_handle) {
+  uint16_t stripe = Stripe(key);
+  bip::sharable_lock<bip::interprocess_sharable_mutex> lock(
+      stripeMutex[stripe]);
+  typename MyHashMap::iterator iterator = myHashMap[stripe].find(key);
+  if (iterator == myHashMap[stripe].end()) {
+    return std::pair<bool, size_t>(false, 0);
+  }
+  size_t size = RDMABuffer<MappedType>::size(iterator->second);
+  if (size > 0 && size <= bulk_handle.size()) {
+    rpc->push_rdma(endpoint, bulk_handle, 0, iterator->second);
+  }
+  return std::pair<bool, size_t>(true, size);
+}
+
+/**
+ * Split the local unordered map into values below the RDMA threshold, which
+ * are returned inline, and the keys and sizes of the values above it.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<std::vector<std::pair<KeyType, MappedType>>,
+          std::vector<std::pair<KeyType, size_t>>>
+unordered_map<KeyType, MappedType, Hash, Allocator,
+              SharedType, Partitioner>::LocalGetAllDataSplit() {
+  std::pair<std::vector<std::pair<KeyType, MappedType>>,
+            std::vector<std::pair<KeyType, size_t>>>
+      final_values;
+  for (uint16_t stripe = 0; stripe < num_stripes; ++stripe) {
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(
+        stripeMutex[stripe]);
+    for (auto &entry : myHashMap[stripe]) {
+      size_t size = RDMABuffer<MappedType>::size(entry.second);
+      if (size > 0 && size >= HCL_CONF->RDMA_THRESHOLD) {
+        final_values.second.emplace_back(entry.first, size);
+      } else {
+        final_values.first.emplace_back(entry.first, entry.second);
+      }
+    }
+  }
+  return final_values;
+}
+
+/**
+ * Push several values into consecutive segments of the client's bulk. A value
+ * is only pushed if its size still matches the one the client allocated for.
+ * @param endpoint, the client that owns the bulk
+ * @param keys, keys to get
+ * @param sizes, the size of each key's segment in the bulk
+ * @param bulk_handle, the client's buffers for the values
+ * @return the current size of each value, 0 if it no longer exists.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<size_t>
+unordered_map<KeyType, MappedType, Hash, Allocator,
+              SharedType, Partitioner>::LocalGetBulkBatch(tl::endpoint endpoint,
+                                             std::vector<KeyType> &keys,
+                                             std::vector<size_t> &sizes,
+                                             tl::bulk &bulk_handle) {
+  std::vector<size_t> final_sizes(keys.size(), 0);
+  std::vector<size_t> offsets(keys.size(), 0);
+  for (std::size_t i = 1; i < keys.size(); ++i) {
+    offsets[i] = offsets[i - 1] + sizes[i - 1];
+  }
+  auto positions = StripePositions(keys);
+  for (uint16_t stripe = 0; stripe < num_stripes; ++stripe) {
+    if (positions[stripe].empty()) continue;
+    bip::sharable_lock<bip::interprocess_sharable_mutex> lock(
+        stripeMutex[stripe]);
+    for (auto i : positions[stripe]) {
+      typename MyHashMap::iterator iterator = myHashMap[stripe].find(keys[i]);
+      if (iterator != myHashMap[stripe].end()) {
+        final_sizes[i] = RDMABuffer<MappedType>::size(iterator->second);
+        if (final_sizes[i] == sizes[i]) {
+          rpc->push_rdma(endpoint, bulk_handle, offsets[i], iterator->second);
+        }
+      }
+    }
+  }
+  return final_sizes;
+}
+
+/**
+ * Put a value on a remote server by exposing it in place as an RDMA bulk.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                   Partitioner>::PutBulk(uint16_t key_int, KeyType &key,
+                                         MappedType &data) {
+  tl::bulk bulk_handle = rpc->prep_rdma_client(data);
+  return rpc->call<bool>(key_int, remote.put_bulk, key, bulk_handle);
+}
+
+/**
+ * Get a value from a remote server by RDMA bulk. Variable sized values are
+ * first looked up with GetOrSize, which returns small values inline.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::pair<bool, MappedType> unordered_map<KeyType, MappedType, Hash, Allocator,
+                                          SharedType, Partitioner>::GetBulk(
+    uint16_t key_int, KeyType &key) {
+  typedef std::pair<bool, size_t> size_type;
+  size_t size = sizeof(MappedType);
+  if (!RDMABuffer<MappedType>::fixed_size) {
+    typedef std::pair<size_type, MappedType> ret_type;
+    ret_type result =
+        rpc->call<ret_type>(key_int, remote.get_or_size, key);
+    if (!result.first.first || result.first.second < HCL_CONF->RDMA_THRESHOLD)
+      return std::pair<bool, MappedType>(result.first.first,
+                                         std::move(result.second));
+    size = result.first.second;
+  }
+  MappedType value;
+  while (true) {
+    RDMABuffer<MappedType>::resize(value, size);
+    tl::bulk bulk_handle =
+        rpc->prep_rdma_client(value, tl::bulk_mode::write_only);
+    size_type result =
+        rpc->call<size_type>(key_int, remote.get_bulk, key, bulk_handle);
+    if (!result.first) return std::pair<bool, MappedType>(false, MappedType());
+    if (result.second <= size) {
+      RDMABuffer<MappedType>::resize(value, result.second);
+      return std::pair<bool, MappedType>(true, std::move(value));
+    }
+    /* The value grew since it was sized; retry with the new size. */
+    size = result.second;
+  }
+}
+
+/**
+ * Get all data of a remote server. Small values come back inline and the
+ * large ones are pushed by the server into a single multi-segment bulk.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+std::vector<std::pair<KeyType, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+              Partitioner>::GetAllDataBulk(uint16_t server) {
+  typedef std::pair<std::vector<std::pair<KeyType, MappedType>>,
+                    std::vector<std::pair<KeyType, size_t>>>
+      split_type;
+  split_type split =
+      rpc->call<split_type>(server, remote.get_all_data_split);
+  std::vector<std::pair<KeyType, MappedType>> final_values =
+      std::move(split.first);
+  if (split.second.empty()) return final_values;
+  std::vector<KeyType> keys;
+  std::vector<size_t> sizes;
+  std::vector<MappedType> values(split.second.size());
+  for (std::size_t i = 0; i < split.second.size(); ++i) {
+    keys.push_back(split.second[i].first);
+    sizes.push_back(split.second[i].second);
+    RDMABuffer<MappedType>::resize(values[i], sizes[i]);
+  }
+  tl::bulk bulk_handle =
+      rpc->prep_rdma_client_batch(values, tl::bulk_mode::write_only);
+  std::vector<size_t> final_sizes = rpc->call<std::vector<size_t>>(
+      server, remote.get_bulk_batch, keys, sizes, bulk_handle);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    if (final_sizes[i] == sizes[i]) {
+      final_values.emplace_back(keys[i], std::move(values[i]));
+    } else if (final_sizes[i] != 0) {
+      /* The value changed size in between; fetch it on its own. */
+      auto value = GetBulk(server, keys[i]);
+      if (value.first)
+        final_values.emplace_back(keys[i], std::move(value.second));
+    }
+  }
+  return final_values;
+}
+#endif
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
 void unordered_map<KeyType, MappedType, Hash, Allocator,
-                   SharedType>::open_shared_memory() {
+                   SharedType, Partitioner>::open_shared_memory() {
   std::pair<MyHashMap *, boost::interprocess::managed_mapped_file::size_type>
       res;
   res = segment.find<MyHashMap>(name.c_str());
   myHashMap = res.first;
+  num_stripes = static_cast<uint16_t>(res.second);
+  stripeMutex =
+      segment
+          .find<boost::interprocess::interprocess_sharable_mutex>(
+              (std::string(name.c_str()) + "_stripes").c_str())
+          .first;
+}
+
+/**
+ * Registers function as the callback named callback in this process and, on a
+ * server, binds the operations that run it. Every process that may run a
+ * callback locally (servers and clients on their node) must bind it, with the
+ * same Ret and CB_Args, which the callers must name in turn.
+ * @param callback, the name of the callback
+ * @param function, a callable of type Callback<Ret, CB_Args...>
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args, typename Function>
+void unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                   Partitioner>::BindCallback(const std::string &callback,
+                                              Function function) {
+  add_callback(callback, Callback<Ret, CB_Args...>(function));
+  if (!is_server) return;
+  std::function<Ret(KeyType &, MappedType &, CB_Args &...)> putFunc(
+      [this, callback](KeyType &key, MappedType &data, CB_Args &... cb_args) {
+        return LocalPutCallback<Ret, CB_Args...>(callback, key, data,
+                                                 cb_args...);
+      });
+  std::function<Ret(KeyType &, CB_Args &...)> getFunc(
+      [this, callback](KeyType &key, CB_Args &... cb_args) {
+        return LocalGetCallback<Ret, CB_Args...>(callback, key, cb_args...);
+      });
+  std::function<Ret(KeyType &, CB_Args &...)> eraseFunc(
+      [this, callback](KeyType &key, CB_Args &... cb_args) {
+        return LocalEraseCallback<Ret, CB_Args...>(callback, key, cb_args...);
+      });
+  bind_handler("_PutCB_" + callback, putFunc);
+  bind_handler("_GetCB_" + callback, getFunc);
+  bind_handler("_EraseCB_" + callback, eraseFunc);
+}
+
+/**
+ * Puts the data into the local unordered map, then runs the callback. The
+ * callback runs after the stripe is unlocked, so it may use other containers.
+ * @param callback, the name the callback was bound with
+ * @param key, the key for put
+ * @param data, the value for put
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                  Partitioner>::LocalPutCallback(const std::string &callback,
+                                                 KeyType &key,
+                                                 MappedType &data,
+                                                 CB_Args &... cb_args) {
+  auto function = find_callback<Callback<Ret, CB_Args...>>(callback);
+  /* LocalPut moves out of data, so the callback gets a copy taken first */
+  std::pair<bool, MappedType> result(false, data);
+  result.first = LocalPut(key, data);
+  return (*function)(key, result, cb_args...);
+}
+
+/**
+ * Gets the data from the local unordered map and runs the callback on it.
+ * @param callback, the name the callback was bound with
+ * @param key, key to get
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                  Partitioner>::LocalGetCallback(const std::string &callback,
+                                                 KeyType &key,
+                                                 CB_Args &... cb_args) {
+  auto function = find_callback<Callback<Ret, CB_Args...>>(callback);
+  std::pair<bool, MappedType> result = LocalGet(key);
+  return (*function)(key, result, cb_args...);
 }
 
+/**
+ * Erases the key from the local unordered map and runs the callback on the
+ * erased value.
+ * @param callback, the name the callback was bound with
+ * @param key, key to erase
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                  Partitioner>::LocalEraseCallback(const std::string &callback,
+                                                   KeyType &key,
+                                                   CB_Args &... cb_args) {
+  auto function = find_callback<Callback<Ret, CB_Args...>>(callback);
+  std::pair<bool, MappedType> result = LocalErase(key);
+  return (*function)(key, result, cb_args...);
+}
+
+/**
+ * Put the data into the unordered map and run a callback on the key's server
+ * in the same RPC.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @param callback, the name the callback was bound with
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
 template <typename KeyType, typename MappedType, typename Hash,
-          typename Allocator, typename SharedType>
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                  Partitioner>::Put(KeyType &key, MappedType &data,
+                                    const std::string &callback,
+                                    CB_Args... cb_args) {
+  uint16_t key_int = keyPartitioner(keyHash(key));
+  if (is_local(key_int)) {
+    return LocalPutCallback<Ret, CB_Args...>(callback, key, data, cb_args...);
+  } else {
+    std::string funcname = "_PutCB_" + callback;
+    return RPC_CALL_WRAPPER_CB(procedure(funcname.c_str()), key_int, Ret, key,
+                               data);
+  }
+}
+
+/**
+ * Get the data in the unordered map and run a callback on it on the key's
+ * server, so that only what the callback derives from it is sent back.
+ * @param key, key to get
+ * @param callback, the name the callback was bound with
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                  Partitioner>::Get(KeyType &key, const std::string &callback,
+                                    CB_Args... cb_args) {
+  uint16_t key_int = keyPartitioner(keyHash(key));
+  if (is_local(key_int)) {
+    return LocalGetCallback<Ret, CB_Args...>(callback, key, cb_args...);
+  } else {
+    std::string funcname = "_GetCB_" + callback;
+    return RPC_CALL_WRAPPER_CB(procedure(funcname.c_str()), key_int, Ret,
+                               key);
+  }
+}
+
+/**
+ * Erase the key from the unordered map and run a callback on the erased value
+ * on the key's server in the same RPC.
+ * @param key, key to erase
+ * @param callback, the name the callback was bound with
+ * @param cb_args, the arguments of the callback
+ * @return Ret, what the callback returned
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
+template <typename Ret, typename... CB_Args>
+Ret unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                  Partitioner>::Erase(KeyType &key, const std::string &callback,
+                                      CB_Args... cb_args) {
+  uint16_t key_int = keyPartitioner(keyHash(key));
+  if (is_local(key_int)) {
+    return LocalEraseCallback<Ret, CB_Args...>(callback, key, cb_args...);
+  } else {
+    std::string funcname = "_EraseCB_" + callback;
+    return RPC_CALL_WRAPPER_CB(procedure(funcname.c_str()), key_int, Ret,
+                               key);
+  }
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType, typename Partitioner>
 void unordered_map<KeyType, MappedType, Hash, Allocator,
-                   SharedType>::bind_functions() {
+                   SharedType, Partitioner>::bind_functions() {
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_ENABLE_RPCLIB
     case RPCLIB: {
       std::function<bool(KeyType &, MappedType &)> putFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::LocalPut,
-                    this, std::placeholders::_1, std::placeholders::_2));
+                                   SharedType, Partitioner>::LocalPut, this,
+                    std::placeholders::_1, std::placeholders::_2));
       std::function<std::pair<bool, MappedType>(KeyType &)> getFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::LocalGet,
-                    this, std::placeholders::_1));
+                                   SharedType, Partitioner>::LocalGet, this,
+                    std::placeholders::_1));
       std::function<std::pair<bool, MappedType>(KeyType &)> eraseFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::LocalErase,
-                    this, std::placeholders::_1));
+                                   SharedType, Partitioner>::LocalErase, this,
+                    std::placeholders::_1));
       std::function<std::vector<std::pair<KeyType, MappedType>>(void)>
           getAllDataInServerFunc(
               std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                       SharedType>::LocalGetAllDataInServer,
+                                       SharedType,
+                                       Partitioner>::LocalGetAllDataInServer,
                         this));
+      std::function<bool(std::vector<KeyType> &, std::vector<MappedType> &)>
+          putBatchFunc(std::bind(&unordered_map<KeyType, MappedType, Hash,
+                                                Allocator, SharedType,
+                                                Partitioner>::LocalPutBatch,
+                                 this, std::placeholders::_1,
+                                 std::placeholders::_2));
+      std::function<std::vector<std::pair<bool, MappedType>>(
+          std::vector<KeyType> &)>
+          getBatchFunc(std::bind(&unordered_map<KeyType, MappedType, Hash,
+                                                Allocator, SharedType,
+                                                Partitioner>::LocalGetBatch,
+                                 this, std::placeholders::_1));
+      std::function<std::vector<std::pair<bool, MappedType>>(
+          std::vector<KeyType> &)>
+          eraseBatchFunc(std::bind(&unordered_map<KeyType, MappedType, Hash,
+                                                  Allocator, SharedType,
+                                                  Partitioner>::LocalEraseBatch,
+                                   this, std::placeholders::_1));
+      std::function<std::pair<std::pair<uint64_t, uint64_t>,
+                              std::vector<std::pair<KeyType, MappedType>>>(
+          std::pair<uint64_t, uint64_t> &, uint32_t, uint64_t)>
+          scanFunc(std::bind(&unordered_map<KeyType, MappedType, Hash,
+                                            Allocator, SharedType,
+                                            Partitioner>::LocalScan,
+                             this, std::placeholders::_1, std::placeholders::_2,
+                             std::placeholders::_3));
       rpc->bind(func_prefix + "_Put", putFunc);
       rpc->bind(func_prefix + "_Get", getFunc);
       rpc->bind(func_prefix + "_Erase", eraseFunc);
       rpc->bind(func_prefix + "_GetAllData", getAllDataInServerFunc);
+      rpc->bind(func_prefix + "_PutBatch", putBatchFunc);
+      rpc->bind(func_prefix + "_GetBatch", getBatchFunc);
+      rpc->bind(func_prefix + "_EraseBatch", eraseBatchFunc);
+      rpc->bind(func_prefix + "_Scan", scanFunc);
       break;
     }
 #endif
@@ -285,32 +1142,93 @@ void unordered_map<KeyType, MappedType, Hash, Allocator,
 
       std::function<void(const tl::request &, KeyType &, MappedType &)> putFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::ThalliumLocalPut,
+                                   SharedType, Partitioner>::ThalliumLocalPut,
                     this, std::placeholders::_1, std::placeholders::_2,
                     std::placeholders::_3));
-      // std::function<void(const tl::request &, tl::bulk &, KeyType &)>
-      // putFunc(
-      //     std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-      //     SharedType>::ThalliumLocalPut, this,
-      //               std::placeholders::_1, std::placeholders::_2,
-      //               std::placeholders::_3));
       std::function<void(const tl::request &, KeyType &)> getFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::ThalliumLocalGet,
+                                   SharedType, Partitioner>::ThalliumLocalGet,
                     this, std::placeholders::_1, std::placeholders::_2));
       std::function<void(const tl::request &, KeyType &)> eraseFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::ThalliumLocalErase,
+                                   SharedType, Partitioner>::ThalliumLocalErase,
                     this, std::placeholders::_1, std::placeholders::_2));
       std::function<void(const tl::request &)> getAllDataInServerFunc(
-          std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::ThalliumLocalGetAllDataInServer,
-                    this, std::placeholders::_1));
+          std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                             Partitioner>::ThalliumLocalGetAllDataInServer,
+              this, std::placeholders::_1));
+
+      std::function<void(const tl::request &, std::vector<KeyType> &,
+                         std::vector<MappedType> &)>
+          putBatchFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                             Partitioner>::ThalliumLocalPutBatch, this,
+              std::placeholders::_1, std::placeholders::_2,
+              std::placeholders::_3));
+      std::function<void(const tl::request &, std::vector<KeyType> &)>
+          getBatchFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                             Partitioner>::ThalliumLocalGetBatch, this,
+              std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, std::vector<KeyType> &)>
+          eraseBatchFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                             Partitioner>::ThalliumLocalEraseBatch, this,
+              std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, std::pair<uint64_t, uint64_t> &,
+                         uint32_t, uint64_t)>
+          scanFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                             Partitioner>::ThalliumLocalScan, this,
+              std::placeholders::_1, std::placeholders::_2,
+              std::placeholders::_3, std::placeholders::_4));
 
       rpc->bind(func_prefix + "_Put", putFunc);
       rpc->bind(func_prefix + "_Get", getFunc);
       rpc->bind(func_prefix + "_Erase", eraseFunc);
       rpc->bind(func_prefix + "_GetAllData", getAllDataInServerFunc);
+      rpc->bind(func_prefix + "_PutBatch", putBatchFunc);
+      rpc->bind(func_prefix + "_GetBatch", getBatchFunc);
+      rpc->bind(func_prefix + "_EraseBatch", eraseBatchFunc);
+      rpc->bind(func_prefix + "_Scan", scanFunc);
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+      std::function<void(const tl::request &, KeyType &, tl::bulk &)>
+          putBulkFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                             Partitioner>::ThalliumLocalPutBulk, this,
+              std::placeholders::_1, std::placeholders::_2,
+              std::placeholders::_3));
+      std::function<void(const tl::request &, KeyType &)> getOrSizeFunc(
+          std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
+                                   SharedType,
+                                   Partitioner>::ThalliumLocalGetOrSize, this,
+                    std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, KeyType &, tl::bulk &)>
+          getBulkFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                             Partitioner>::ThalliumLocalGetBulk, this,
+              std::placeholders::_1, std::placeholders::_2,
+              std::placeholders::_3));
+      std::function<void(const tl::request &)> getAllDataSplitFunc(
+          std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
+                                   SharedType,
+                                   Partitioner>::ThalliumLocalGetAllDataSplit,
+                    this, std::placeholders::_1));
+      std::function<void(const tl::request &, std::vector<KeyType> &,
+                         std::vector<size_t> &, tl::bulk &)>
+          getBulkBatchFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator, SharedType,
+                             Partitioner>::ThalliumLocalGetBulkBatch, this,
+              std::placeholders::_1, std::placeholders::_2,
+              std::placeholders::_3, std::placeholders::_4));
+
+      rpc->bind(func_prefix + "_PutBulk", putBulkFunc);
+      rpc->bind(func_prefix + "_GetOrSize", getOrSizeFunc);
+      rpc->bind(func_prefix + "_GetBulk", getBulkFunc);
+      rpc->bind(func_prefix + "_GetAllDataSplit", getAllDataSplitFunc);
+      rpc->bind(func_prefix + "_GetBulkBatch", getBulkBatchFunc);
+#endif
       break;
     }
 #endif
@@ -23,8 +23,11 @@
 #include <hcl/communication/rpc_factory.h>
 #include <hcl/communication/rpc_lib.h>
 
+#include <atomic>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -46,12 +49,16 @@
 #endif
 /** Boost Headers **/
 #include <hcl/common/container.h>
+#include <hcl/common/partitioner.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/unordered/unordered_map.hpp>
 
 /** Namespaces Uses **/
@@ -64,10 +71,11 @@ namespace hcl {
  * achieve the data structure.
  *
  * @tparam MappedType, the value of the HashMap
+ * @tparam Partitioner, policy choosing the server of a key from its hash
  */
 template <typename KeyType, typename MappedType,
           typename Hash = std::hash<KeyType>, class Allocator = nullptr_t,
-          class SharedType = nullptr_t>
+          class SharedType = nullptr_t, class Partitioner = ModuloPartitioner>
 class unordered_map : public container {
  private:
   /** Class Typedefs for ease of use **/
@@ -81,14 +89,57 @@ class unordered_map : public container {
       MyHashMap;
   /** Class attributes**/
   Hash keyHash;
+  Partitioner keyPartitioner;
+  /* The local data is split into num_stripes maps, myHashMap[0..num_stripes),
+   * and stripe i is guarded by stripeMutex[i]. Both arrays live in the
+   * segment; clients on the node learn num_stripes from the server's. */
+  uint16_t num_stripes;
   MyHashMap *myHashMap;
+  boost::interprocess::interprocess_sharable_mutex *stripeMutex;
+  /* Handles of the remote operations, resolved by the constructor */
+  struct {
+    RPC::Procedure put, get, erase, get_all_data, put_batch, get_batch,
+        erase_batch, scan, get_all_data_split, put_bulk, get_or_size, get_bulk,
+        get_bulk_batch;
+  } remote;
+
+  /**
+   * The stripe of a key. The hash is mixed first because the partitioner
+   * already used its low bits to choose this server.
+   */
+  uint16_t Stripe(KeyType &key) {
+    if (num_stripes == 1) return 0;
+    return static_cast<uint16_t>(mix_hash(keyHash(key)) % num_stripes);
+  }
+
+  /**
+   * The positions in keys of the keys of each stripe, so that a batch takes
+   * each stripe's lock once.
+   */
+  std::vector<std::vector<std::size_t>> StripePositions(
+      std::vector<KeyType> &keys) {
+    std::vector<std::vector<std::size_t>> positions(num_stripes);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      positions[Stripe(keys[i])].push_back(i);
+    }
+    return positions;
+  }
+
+  std::vector<std::future<std::vector<std::pair<KeyType, MappedType>>>>
+  ScatterGetAllData();
 
  public:
-  really_long size_occupied;
+  typedef ScanCursor<std::pair<uint64_t, uint64_t>> Cursor;
+  std::atomic<really_long> size_occupied;
   ~unordered_map();
 
   explicit unordered_map(CharStruct name_ = std::string("TEST_UNORDERED_MAP"),
-                         uint16_t port = HCL_CONF->RPC_PORT);
+                         uint16_t port = HCL_CONF->RPC_PORT,
+                         Partitioner partitioner =
+                             Partitioner(HCL_CONF->NUM_SERVERS));
+  /**
+   * The local maps, one per stripe; see Stripe for the stripe of a key.
+   */
   MyHashMap *data() {
     if (server_on_node || is_server)
       return myHashMap;
@@ -98,9 +149,13 @@ class unordered_map : public container {
 
   void construct_shared_memory() override {
     /* Construct unordered_map in the shared memory space. */
-    myHashMap = segment.construct<MyHashMap>(name.c_str())(
+    num_stripes = HCL_CONF->LOCK_STRIPES > 0 ? HCL_CONF->LOCK_STRIPES : 1;
+    myHashMap = segment.construct<MyHashMap>(name.c_str())[num_stripes](
         128, Hash(), std::equal_to<KeyType>(),
         segment.get_allocator<ValueType>());
+    stripeMutex =
+        segment.construct<boost::interprocess::interprocess_sharable_mutex>(
+            (std::string(name.c_str()) + "_stripes").c_str())[num_stripes]();
   }
 
   void open_shared_memory() override;
@@ -111,37 +166,118 @@ class unordered_map : public container {
   std::pair<bool, MappedType> LocalGet(KeyType &key);
   std::pair<bool, MappedType> LocalErase(KeyType &key);
   std::vector<std::pair<KeyType, MappedType>> LocalGetAllDataInServer();
+  bool LocalPutBatch(std::vector<KeyType> &keys,
+                     std::vector<MappedType> &data);
+  std::vector<std::pair<bool, MappedType>> LocalGetBatch(
+      std::vector<KeyType> &keys);
+  std::vector<std::pair<bool, MappedType>> LocalEraseBatch(
+      std::vector<KeyType> &keys);
+  std::pair<std::pair<uint64_t, uint64_t>,
+            std::vector<std::pair<KeyType, MappedType>>>
+  LocalScan(std::pair<uint64_t, uint64_t> &position, uint32_t max_items,
+            uint64_t max_bytes);
+
+  /**
+   * A server side callback. It runs after Put, Get or Erase on key with the
+   * operation's result, i.e. (true, value) for Put and what Get or Erase
+   * return, and what it returns is all that goes back to the client.
+   */
+  template <typename Ret, typename... CB_Args>
+  using Callback = std::function<Ret(KeyType &, std::pair<bool, MappedType> &,
+                                     CB_Args &...)>;
+
+  template <typename Ret, typename... CB_Args, typename Function>
+  void BindCallback(const std::string &callback, Function function);
+  template <typename Ret, typename... CB_Args>
+  Ret LocalPutCallback(const std::string &callback, KeyType &key,
+                       MappedType &data, CB_Args &... cb_args);
+  template <typename Ret, typename... CB_Args>
+  Ret LocalGetCallback(const std::string &callback, KeyType &key,
+                       CB_Args &... cb_args);
+  template <typename Ret, typename... CB_Args>
+  Ret LocalEraseCallback(const std::string &callback, KeyType &key,
+                         CB_Args &... cb_args);
 
 #if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
   THALLIUM_DEFINE(LocalPut, (key, data), KeyType &key, MappedType &data)
 
-  // void ThalliumLocalPut(const tl::request &thallium_req, tl::bulk
-  // &bulk_handle, KeyType key) {
-  //     MappedType data =
-  //     rpc->prep_rdma_server<MappedType>(thallium_req.get_endpoint(),
-  //     bulk_handle); thallium_req.respond(LocalPut(key, data));
-  // }
-
-  // void ThalliumLocalGet(const tl::request &thallium_req, KeyType key) {
-  //     auto retpair = LocalGet(key);
-  //     if (!retpair.first) {
-  //         printf("error\n");
-  //     }
-  //     MappedType data = retpair.second;
-  //     tl::bulk bulk_handle = rpc->prep_rdma_client<MappedType>(data);
-  //     thallium_req.respond(bulk_handle);
-  // }
-
   THALLIUM_DEFINE(LocalGet, (key), KeyType &key)
   THALLIUM_DEFINE(LocalErase, (key), KeyType &key)
   THALLIUM_DEFINE1(LocalGetAllDataInServer)
+  THALLIUM_DEFINE(LocalPutBatch, (keys, data), std::vector<KeyType> &keys,
+                  std::vector<MappedType> &data)
+  THALLIUM_DEFINE(LocalGetBatch, (keys), std::vector<KeyType> &keys)
+  THALLIUM_DEFINE(LocalEraseBatch, (keys), std::vector<KeyType> &keys)
+  THALLIUM_DEFINE(LocalScan, (position, max_items, max_bytes),
+                  std::pair<uint64_t, uint64_t> &position, uint32_t max_items,
+                  uint64_t max_bytes)
+#endif
+
+#ifdef HCL_ENABLE_THALLIUM_ROCE
+  bool LocalPutBulk(tl::endpoint endpoint, KeyType &key, tl::bulk &bulk_handle);
+  std::pair<std::pair<bool, size_t>, MappedType> LocalGetOrSize(KeyType &key);
+  std::pair<bool, size_t> LocalGetBulk(tl::endpoint endpoint, KeyType &key,
+                                       tl::bulk &bulk_handle);
+  std::pair<std::vector<std::pair<KeyType, MappedType>>,
+            std::vector<std::pair<KeyType, size_t>>>
+  LocalGetAllDataSplit();
+  std::vector<size_t> LocalGetBulkBatch(tl::endpoint endpoint,
+                                        std::vector<KeyType> &keys,
+                                        std::vector<size_t> &sizes,
+                                        tl::bulk &bulk_handle);
+
+  void ThalliumLocalPutBulk(const tl::request &thallium_req, KeyType &key,
+                            tl::bulk &bulk_handle) {
+    thallium_req.respond(
+        LocalPutBulk(thallium_req.get_endpoint(), key, bulk_handle));
+  }
+  void ThalliumLocalGetBulk(const tl::request &thallium_req, KeyType &key,
+                            tl::bulk &bulk_handle) {
+    thallium_req.respond(
+        LocalGetBulk(thallium_req.get_endpoint(), key, bulk_handle));
+  }
+  void ThalliumLocalGetBulkBatch(const tl::request &thallium_req,
+                                 std::vector<KeyType> &keys,
+                                 std::vector<size_t> &sizes,
+                                 tl::bulk &bulk_handle) {
+    thallium_req.respond(LocalGetBulkBatch(thallium_req.get_endpoint(), keys,
+                                           sizes, bulk_handle));
+  }
+  THALLIUM_DEFINE(LocalGetOrSize, (key), KeyType &key)
+  THALLIUM_DEFINE1(LocalGetAllDataSplit)
+
+  bool PutBulk(uint16_t key_int, KeyType &key, MappedType &data);
+  std::pair<bool, MappedType> GetBulk(uint16_t key_int, KeyType &key);
+  std::vector<std::pair<KeyType, MappedType>> GetAllDataBulk(uint16_t server);
 #endif
 
   bool Put(KeyType key, MappedType data);
   std::pair<bool, MappedType> Get(KeyType &key);
   std::pair<bool, MappedType> Erase(KeyType &key);
+  template <typename Ret, typename... CB_Args>
+  Ret Put(KeyType &key, MappedType &data, const std::string &callback,
+          CB_Args... cb_args);
+  template <typename Ret, typename... CB_Args>
+  Ret Get(KeyType &key, const std::string &callback, CB_Args... cb_args);
+  template <typename Ret, typename... CB_Args>
+  Ret Erase(KeyType &key, const std::string &callback, CB_Args... cb_args);
   std::vector<std::pair<KeyType, MappedType>> GetAllData();
+  void GetAllData(
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          callback);
   std::vector<std::pair<KeyType, MappedType>> GetAllDataInServer();
+  bool PutBatch(std::vector<KeyType> &keys, std::vector<MappedType> &data);
+  std::vector<std::pair<bool, MappedType>> GetBatch(
+      std::vector<KeyType> &keys);
+  std::vector<std::pair<bool, MappedType>> EraseBatch(
+      std::vector<KeyType> &keys);
+  std::future<bool> AsyncPut(KeyType &key, MappedType &data);
+  std::future<std::pair<bool, MappedType>> AsyncGet(KeyType &key);
+  std::future<std::pair<bool, MappedType>> AsyncErase(KeyType &key);
+  Cursor OpenScan();
+  std::vector<std::pair<KeyType, MappedType>> NextBatch(
+      Cursor &cursor, uint32_t max_items, uint64_t max_bytes = UINT64_MAX);
+  void CloseScan(Cursor &cursor);
 };
 
 #include "unordered_map.cpp"
@@ -0,0 +1,192 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Runs lock free reads of the concurrent unordered map on the servers while
+ * other threads update, erase and insert the same keys. The int map is
+ * updated in place; the std::string map is not trivially copyable, so its
+ * values are replaced by copies. Every value read must be one the key was
+ * given, and keys that are never erased must always be found.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/concurrent/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+template <typename A>
+void serialize(A &ar, int &a) {
+  ar &a;
+}
+#endif
+
+typedef hcl::concurrent_unordered_map<int, int> int_map;
+typedef hcl::concurrent_unordered_map<int, std::string> string_map;
+
+/* Version n of the value of key. The string is longer than a small string
+ * buffer and made of one character, so a torn copy shows. */
+int int_value(int key, int n) { return key * 1000 + n % 1000; }
+bool int_valid(int key, const int &value) { return value / 1000 == key; }
+
+std::string string_value(int key, int n) {
+  return std::string(40 + key % 24, static_cast<char>('a' + n % 26));
+}
+bool string_valid(int key, const std::string &value) {
+  if (value.size() != static_cast<std::size_t>(40 + key % 24)) return false;
+  for (char c : value)
+    if (c != value[0]) return false;
+  return true;
+}
+
+void next_int(int *value) { *value = (*value / 1000) * 1000 + 1; }
+void next_string(std::string *value) {
+  std::fill(value->begin(), value->end(), (*value)[0] == 'z' ? 'a' : 'z');
+}
+
+/* Keys at even positions stay in the map; the writers update them and the
+ * erasers erase and insert again the keys at odd positions. */
+template <typename Map, typename Value, typename Make, typename Valid,
+          typename Next>
+void run(Map *map, std::vector<int> &keys, int num_threads, int num_request,
+         Make make, Valid valid, Next next, int my_rank) {
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    Value value = make(keys[i], 0);
+    map->LocalInsert(keys[i], value);
+  }
+  std::vector<std::thread> workers;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    workers.emplace_back([=, &keys]() {
+      int role = tid % 3;
+      for (int i = 0; i < num_request; i++) {
+        std::size_t pos = (tid * num_request + i) % keys.size();
+        int key = keys[pos];
+        if (role == 0) {
+          Value value;
+          bool found = map->LocalGet(key, &value);
+          if (found) check(valid(key, value), "torn value", my_rank);
+          if (pos % 2 == 0) check(found, "stable key lost", my_rank);
+        } else if (role == 1) {
+          if (i % 2 == 0) {
+            Value value = make(key, i);
+            map->LocalUpdate(key, value);
+          } else {
+            map->LocalUpdateField(key, next);
+          }
+        } else if (pos % 2 == 1) {
+          if (i % 2 == 0) {
+            map->LocalErase(key);
+          } else {
+            Value value = make(key, i);
+            map->LocalInsert(key, value);
+          }
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  for (std::size_t i = 0; i < keys.size(); i += 2) {
+    Value value;
+    check(map->LocalGet(keys[i], &value) && valid(keys[i], value),
+          "key lost", my_rank);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  if (provided < MPI_THREAD_MULTIPLE) {
+    printf("Didn't receive appropriate MPI threading specification\n");
+    exit(EXIT_FAILURE);
+  }
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  int num_threads = 12;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (argc > 6) num_threads = atoi(argv[6]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  /* A small table keeps many keys in each bucket */
+  uint64_t total_size = 64;
+  int_map *ints;
+  string_map *strings;
+  if (is_server) {
+    ints = new int_map("TEST_READ_INT");
+    ints->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    strings = new string_map("TEST_READ_STRING");
+    strings->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    ints = new int_map("TEST_READ_INT");
+    ints->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    strings = new string_map("TEST_READ_STRING");
+    strings->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  std::vector<int> keys;
+  for (int k = 0; keys.size() < 256; ++k) {
+    if (ints->serverLocation(k) == (uint64_t)my_server) keys.push_back(k);
+  }
+  if (is_server) {
+    run<int_map, int>(ints, keys, num_threads, num_request, int_value,
+                      int_valid, next_int, my_rank);
+    run<string_map, std::string>(strings, keys, num_threads, num_request,
+                                 string_value, string_valid, next_string,
+                                 my_rank);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    for (std::size_t i = 0; i < keys.size(); i += 2) {
+      check(string_valid(keys[i], strings->Get(keys[i])), "Get", my_rank);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (strings);
+  delete (ints);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
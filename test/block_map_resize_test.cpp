@@ -0,0 +1,167 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Fills concurrent unordered maps that start with 16 buckets per server far
+ * past their size, from threads on the servers and from the clients. One map
+ * keeps its table (MAX_LOAD_FACTOR 0) and one grows it while the threads run.
+ * Every key must be found in both afterwards, and rank 0 reports the
+ * throughput of each and the buckets the growing map ended with.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/concurrent/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+template <typename A>
+void serialize(A &ar, int &a) {
+  ar &a;
+}
+#endif
+
+typedef hcl::concurrent_unordered_map<int, int> hash_map;
+
+/* Each thread inserts, finds and erases keys of its own on the local table;
+ * the keys of a server are those its partition maps to it. */
+double fill(hash_map *map, std::vector<int> &keys, int num_threads) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    workers.emplace_back([map, &keys, tid, num_threads]() {
+      for (std::size_t i = tid; i < keys.size(); i += num_threads) {
+        int key = keys[i];
+        map->LocalInsert(key, key);
+        map->LocalFind(key);
+        if (i % 4 == 0) map->LocalErase(key);
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return 3.0 * keys.size() / seconds;
+}
+
+void check_keys(hash_map *map, std::vector<int> &keys, int my_rank) {
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    int key = keys[i];
+    int value = -1;
+    bool found = map->LocalGet(key, &value);
+    if (i % 4 == 0) {
+      check(!found, "erased key found", my_rank);
+    } else {
+      check(found && value == key, "key lost", my_rank);
+    }
+  }
+  uint64_t live = map->allocated() - map->removed();
+  check(map->data()->count_block_entries() == live, "entry count", my_rank);
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  uint64_t total_size = 16 * num_servers;
+  hash_map *fixed, *growing;
+  if (is_server) {
+    HCL_CONF->MAX_LOAD_FACTOR = 0;
+    fixed = new hash_map("TEST_RESIZE_FIXED");
+    fixed->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    HCL_CONF->MAX_LOAD_FACTOR = 2.0;
+    growing = new hash_map("TEST_RESIZE_GROWING");
+    growing->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    fixed = new hash_map("TEST_RESIZE_FIXED");
+    fixed->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    growing = new hash_map("TEST_RESIZE_GROWING");
+    growing->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (is_server) {
+    /* Keys of this server, 100 times the initial buckets per request */
+    std::vector<int> keys;
+    for (int k = 0; keys.size() < 16ul * num_request; ++k) {
+      if (growing->serverLocation(k) == (uint64_t)my_server) keys.push_back(k);
+    }
+    int num_threads = 4;
+    double fixed_ops = fill(fixed, keys, num_threads);
+    double growing_ops = fill(growing, keys, num_threads);
+    check_keys(fixed, keys, my_rank);
+    check_keys(growing, keys, my_rank);
+    check(growing->data()->bucket_count() > 16, "table did not grow", my_rank);
+    if (my_server == 0) {
+      printf("fixed table (ops/s) %f growing table (ops/s) %f buckets %lu\n",
+             fixed_ops, growing_ops,
+             (unsigned long)growing->data()->bucket_count());
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    /* Clients add keys past the servers' keys while the tables may grow */
+    int base = 1 << 24;
+    for (int i = 0; i < num_request; i++) {
+      int key = base + my_rank * num_request + i;
+      check(growing->Insert(key, key), "Insert", my_rank);
+    }
+    for (int i = 0; i < num_request; i++) {
+      int key = base + my_rank * num_request + i;
+      check(growing->Find(key) && growing->Get(key) == key, "Find", my_rank);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (growing);
+  delete (fixed);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
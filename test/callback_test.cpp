@@ -0,0 +1,178 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Runs server side callbacks with Put, Get and Erase on an unordered_map and
+ * a map. Each Put publishes its key to a queue on the key's server, each Get
+ * sends back a slice or the length of the value instead of the value, and
+ * each Erase sends back the length of the erased value. Rank 0 reports the
+ * latency of Get with and without a callback.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/map/map.h>
+#include <hcl/queue/queue.h>
+#include <hcl/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include "util.h"
+
+/* The callbacks are bound in every process, as clients on a server's node
+ * run them locally. */
+template <typename Map>
+void bind_callbacks(Map *map, hcl::queue<int> *published) {
+  map->template BindCallback<bool>(
+      "publish", [published](int &key, std::pair<bool, std::string> &result) {
+        uint16_t server = static_cast<uint16_t>(HCL_CONF->MY_SERVER);
+        return result.first && published->Push(key, server);
+      });
+  map->template BindCallback<size_t>(
+      "length", [](int &, std::pair<bool, std::string> &result) {
+        return result.first ? result.second.size() : 0;
+      });
+  map->template BindCallback<std::string, uint32_t, uint32_t>(
+      "slice", [](int &, std::pair<bool, std::string> &result,
+                  uint32_t &offset, uint32_t &length) {
+        if (!result.first || offset >= result.second.size())
+          return std::string();
+        return result.second.substr(offset, length);
+      });
+}
+
+template <typename Map>
+void run_callbacks(Map *map, int my_rank, int num_request,
+                   long size_of_request, Timer &get_timer,
+                   Timer &callback_timer) {
+  for (int i = 0; i < num_request; i++) {
+    int key = my_rank * num_request + i;
+    std::string value = std::to_string(key) + std::string(size_of_request, 'x');
+    check(map->template Put<bool>(key, value, "publish"), "Put with publish",
+          my_rank);
+  }
+  for (int i = 0; i < num_request; i++) {
+    int key = my_rank * num_request + i;
+    std::string prefix = std::to_string(key);
+    get_timer.resumeTime();
+    auto value = map->Get(key);
+    get_timer.pauseTime();
+    check(value.first && value.second.size() == prefix.size() + size_of_request,
+          "Get", my_rank);
+    uint32_t offset = 0, length = static_cast<uint32_t>(prefix.size());
+    callback_timer.resumeTime();
+    std::string slice =
+        map->template Get<std::string>(key, "slice", offset, length);
+    callback_timer.pauseTime();
+    check(slice == prefix, "Get with slice", my_rank);
+    check(map->template Get<size_t>(key, "length") == value.second.size(),
+          "Get with length", my_rank);
+  }
+  for (int i = 0; i < num_request; i += 2) {
+    int key = my_rank * num_request + i;
+    size_t expected = std::to_string(key).size() + size_of_request;
+    check(map->template Erase<size_t>(key, "length") == expected,
+          "Erase with length", my_rank);
+    check(map->template Get<size_t>(key, "length") == 0,
+          "Get with length after Erase", my_rank);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  if (provided < MPI_THREAD_MULTIPLE) {
+    printf("Didn't receive appropriate MPI threading specification\n");
+    exit(EXIT_FAILURE);
+  }
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  typedef hcl::unordered_map<int, std::string> hash_map;
+  typedef hcl::map<int, std::string> ordered_map;
+  hash_map *hmap;
+  ordered_map *omap;
+  hcl::queue<int> *published;
+  if (is_server) {
+    hmap = new hash_map("TEST_CALLBACK_UNORDERED_MAP");
+    omap = new ordered_map("TEST_CALLBACK_MAP");
+    published = new hcl::queue<int>("TEST_CALLBACK_QUEUE");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    hmap = new hash_map("TEST_CALLBACK_UNORDERED_MAP");
+    omap = new ordered_map("TEST_CALLBACK_MAP");
+    published = new hcl::queue<int>("TEST_CALLBACK_QUEUE");
+  }
+  bind_callbacks(hmap, published);
+  bind_callbacks(omap, published);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  int num_clients = comm_size - num_servers;
+  if (!is_server) {
+    Timer get_timer = Timer();
+    Timer callback_timer = Timer();
+    run_callbacks(hmap, my_rank, num_request, size_of_request, get_timer,
+                  callback_timer);
+    run_callbacks(omap, my_rank, num_request, size_of_request, get_timer,
+                  callback_timer);
+    if (my_rank == 0) {
+      printf("Get latency (ms): %f\n",
+             get_timer.getElapsedTime() / (2 * num_request));
+      printf("Get with slice latency (ms): %f\n",
+             callback_timer.getElapsedTime() / (2 * num_request));
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  /* Every Put published its key to the queue of the key's server. */
+  unsigned long published_keys = is_server ? published->LocalSize() : 0;
+  MPI_Allreduce(MPI_IN_PLACE, &published_keys, 1, MPI_UNSIGNED_LONG, MPI_SUM,
+                MPI_COMM_WORLD);
+  check(published_keys == 2ul * num_clients * num_request, "published keys",
+        my_rank);
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (published);
+  delete (omap);
+  delete (hmap);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,154 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Every rank waits until its global_clock is calibrated against server 0 and
+ * then checks the property of the intervals of GetGlobalTime: an interval
+ * taken by any rank before a barrier never starts after an interval taken by
+ * any rank after it ends. Each server reports the offsets and errors it
+ * measured to the other servers, and rank 0 the rates of GetTime and
+ * GetGlobalTime and the mean width of the intervals.
+ */
+
+#include <hcl/clock/global_clock.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+double rate(std::chrono::high_resolution_clock::time_point start, int calls) {
+  auto end = std::chrono::high_resolution_clock::now();
+  return calls / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int my_rank, comm_size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+  bool debug = false;
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1024 * 16;
+  bool server_on_node = true;
+  uint32_t sync_interval = 100;
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (argc > 6) sync_interval = atoi(argv[6]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+  HCL_CONF->CLOCK_SYNC_INTERVAL = sync_interval;
+
+  hcl::global_clock *clock;
+  if (is_server) clock = new hcl::global_clock("TEST_CLOCK_SKEW");
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) clock = new hcl::global_clock("TEST_CLOCK_SKEW");
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  /* The servers calibrate one interval after they start */
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(20 * sync_interval + 10000);
+  while (!clock->IsCalibrated()) {
+    clock->GetGlobalTime();
+    check(std::chrono::steady_clock::now() < deadline, "calibration",
+          my_rank);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  /* Each rank sends the start of its interval before and the end of its
+   * interval after the barrier */
+  uint64_t mine[2];
+  std::vector<uint64_t> all(2 * comm_size);
+  for (int round = 0; round < 10; round++) {
+    hcl::TimeInterval before = clock->GetGlobalTime();
+    MPI_Barrier(MPI_COMM_WORLD);
+    hcl::TimeInterval after = clock->GetGlobalTime();
+    check(before.first <= before.second && after.first <= after.second &&
+              before.first <= after.second,
+          "local intervals", my_rank);
+    mine[0] = before.first;
+    mine[1] = after.second;
+    MPI_Allgather(mine, 2, MPI_UINT64_T, all.data(), 2, MPI_UINT64_T,
+                  MPI_COMM_WORLD);
+    uint64_t latest_start = 0, earliest_end = UINT64_MAX;
+    for (int i = 0; i < comm_size; i++) {
+      latest_start = std::max(latest_start, all[2 * i]);
+      earliest_end = std::min(earliest_end, all[2 * i + 1]);
+    }
+    check(latest_start <= earliest_end,
+          "an interval before the barrier starts after one after it ends",
+          my_rank);
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < num_request; i++) clock->GetTime();
+  double time_rate = rate(start, num_request);
+  double width = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < num_request; i++) {
+    hcl::TimeInterval interval = clock->GetGlobalTime();
+    width += interval.second - interval.first;
+  }
+  double global_rate = rate(start, num_request);
+  width /= num_request;
+
+  for (int i = 0; i < comm_size; i++) {
+    if (i == my_rank && is_server) {
+      std::vector<std::pair<int64_t, uint64_t>> skew = clock->GetSkew();
+      for (int j = 0; j < num_servers; j++) {
+        printf("server %d to server %d offset (us) %ld error (us) %lu\n",
+               my_server, j, skew[j].first, skew[j].second);
+      }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+  double rates[2] = {time_rate, global_rate}, min_rates[2], max_width;
+  MPI_Reduce(rates, min_rates, 2, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&width, &max_width, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  if (my_rank == 0) {
+    printf(
+        "GetTime (timestamps/s) %f GetGlobalTime (timestamps/s) %f interval "
+        "width (us) %f\n",
+        min_rates[0], min_rates[1], max_width);
+  }
+  clock->Stop();
+  delete clock;
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,191 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Compares the chained BlockMap and the open addressing FlatBlockMap layouts
+ * of the concurrent unordered map on the servers. Threads from 1 up to
+ * argv[6] (default 64) run a read mostly mix (one insert or erase per
+ * nineteen lookups) on keys of their own; rank 0 reports the throughput of
+ * each layout. Every key is then checked in both, and the clients insert and
+ * read keys of the flat map through the usual client calls.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/concurrent/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+template <typename A>
+void serialize(A &ar, int &a) {
+  ar &a;
+}
+#endif
+
+typedef hcl::concurrent_unordered_map<int, int> chained_map;
+typedef hcl::concurrent_unordered_map<
+    int, int, std::hash<int>, std::equal_to<int>, hcl::RangePartitioner,
+    hcl::FlatBlockMap<int, int>>
+    flat_map;
+
+/* Thread tid works on keys[tid], a set of keys of this server; keys at odd
+ * positions are inserted and erased again, the others stay. */
+template <typename Map>
+double throughput(Map *map, std::vector<std::vector<int>> &keys,
+                  int num_threads, int num_request) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    workers.emplace_back([map, &keys, tid, num_request]() {
+      std::vector<int> &mine = keys[tid];
+      int value = 0;
+      for (int i = 0; i < num_request; i++) {
+        if (i % 20 == 0) {
+          /* Write w inserts an odd positioned key and write w + 1 erases it */
+          int w = i / 20;
+          int key = mine[(2 * (w / 2) + 1) % mine.size()];
+          if (w % 2 == 0)
+            map->LocalInsert(key, key);
+          else
+            map->LocalErase(key);
+        } else {
+          int key = mine[i % mine.size()];
+          map->LocalGet(key, &value);
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return static_cast<double>(num_threads) * num_request / seconds;
+}
+
+template <typename Map>
+void check_keys(Map *map, std::vector<std::vector<int>> &keys,
+                int num_threads, int my_rank) {
+  for (int tid = 0; tid < num_threads; ++tid) {
+    for (std::size_t i = 0; i < keys[tid].size(); i += 2) {
+      int key = keys[tid][i];
+      int value = -1;
+      check(map->LocalGet(key, &value) && value == key, "key lost", my_rank);
+    }
+  }
+  uint64_t live = map->allocated() - map->removed();
+  check(map->data()->count_block_entries() == live, "entry count", my_rank);
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  int max_threads = 64;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (argc > 6) max_threads = atoi(argv[6]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  uint64_t total_size = 8192;
+  chained_map *chained;
+  flat_map *flat;
+  if (is_server) {
+    chained = new chained_map("TEST_LAYOUT_CHAINED");
+    chained->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    flat = new flat_map("TEST_LAYOUT_FLAT");
+    flat->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    chained = new chained_map("TEST_LAYOUT_CHAINED");
+    chained->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    flat = new flat_map("TEST_LAYOUT_FLAT");
+    flat->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (is_server) {
+    /* 256 keys of this server per thread */
+    std::vector<std::vector<int>> keys(max_threads);
+    int k = 0;
+    for (int tid = 0; tid < max_threads; ++tid) {
+      while (keys[tid].size() < 256) {
+        if (flat->serverLocation(k) == (uint64_t)my_server)
+          keys[tid].push_back(k);
+        ++k;
+      }
+      for (std::size_t i = 0; i < keys[tid].size(); ++i) {
+        chained->LocalInsert(keys[tid][i], keys[tid][i]);
+        flat->LocalInsert(keys[tid][i], keys[tid][i]);
+      }
+    }
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      double chained_ops = throughput(chained, keys, threads, num_request);
+      double flat_ops = throughput(flat, keys, threads, num_request);
+      if (my_server == 0) {
+        printf("threads %d chained (ops/s) %f flat (ops/s) %f\n", threads,
+               chained_ops, flat_ops);
+      }
+    }
+    check_keys(chained, keys, max_threads, my_rank);
+    check_keys(flat, keys, max_threads, my_rank);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    int base = 1 << 24;
+    for (int i = 0; i < num_request; i++) {
+      int key = base + my_rank * num_request + i;
+      check(flat->Insert(key, key), "Insert", my_rank);
+    }
+    for (int i = 0; i < num_request; i++) {
+      int key = base + my_rank * num_request + i;
+      check(flat->Find(key) && flat->Get(key) == key, "Find", my_rank);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (flat);
+  delete (chained);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
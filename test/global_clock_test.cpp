@@ -13,7 +13,49 @@
 #include <hcl/clock/global_clock.h>
 #include <mpi.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+/* Four threads take num_request timestamps each; every thread must see its
+ * timestamps increase and no two threads may get the same one. */
+double check_hlc(hcl::global_clock *clock, int num_request, int my_rank) {
+  int num_threads = 4;
+  std::vector<std::vector<hcl::HLCTime>> times(num_threads);
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> workers;
+  for (int tid = 0; tid < num_threads; tid++) {
+    workers.emplace_back([&, tid]() {
+      for (int i = 0; i < num_request; i++) {
+        times[tid].push_back(clock->GetHLCTime());
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  std::vector<hcl::HLCTime> all;
+  for (auto &thread_times : times) {
+    for (size_t i = 1; i < thread_times.size(); i++) {
+      check(thread_times[i - 1] < thread_times[i], "HLC increases", my_rank);
+    }
+    all.insert(all.end(), thread_times.begin(), thread_times.end());
+  }
+  std::sort(all.begin(), all.end());
+  check(std::adjacent_find(all.begin(), all.end()) == all.end(),
+        "HLC timestamps are unique", my_rank);
+  uint64_t wall = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+  uint64_t physical = hcl::hlc_physical(clock->GetHLCTime());
+  check(physical + 1000000 > wall && physical < wall + 1000000,
+        "HLC follows the wall clock", my_rank);
+  return num_threads * num_request /
+         std::chrono::duration<double>(end - start).count();
+}
 
 int main(int argc, char **argv) {
   MPI_Init(&argc, &argv);
@@ -65,6 +107,37 @@ int main(int argc, char **argv) {
     MPI_Barrier(MPI_COMM_WORLD);
   }
 
+  double hlc_rate = check_hlc(clock, num_request, my_rank);
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < num_request; i++) clock->GetTime();
+  double time_rate =
+      num_request / std::chrono::duration<double>(
+                        std::chrono::high_resolution_clock::now() - start)
+                        .count();
+
+  /* A timestamp passed around the ranks grows at every hop */
+  hcl::HLCTime token = 0;
+  if (comm_size > 1) {
+    if (my_rank != 0) {
+      MPI_Recv(&token, 1, MPI_UINT64_T, my_rank - 1, 0, MPI_COMM_WORLD,
+               MPI_STATUS_IGNORE);
+    }
+    hcl::HLCTime mine = clock->UpdateHLC(token);
+    check(mine > token, "UpdateHLC passes the received timestamp", my_rank);
+    if (my_rank + 1 < comm_size) {
+      MPI_Send(&mine, 1, MPI_UINT64_T, my_rank + 1, 0, MPI_COMM_WORLD);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (my_rank == 0) {
+    hcl::HLCTime ahead =
+        clock->GetHLCTime() + (10000000ULL << HLC_LOGICAL_BITS);
+    check(clock->UpdateHLC(ahead) > ahead && clock->GetHLCTime() > ahead,
+          "HLC stays ahead of a received timestamp", my_rank);
+    printf("GetTime (timestamps/s) %f GetHLCTime (timestamps/s) %f\n",
+           time_rate, hlc_rate);
+  }
+  clock->Stop();
   delete clock;
   MPI_Finalize();
 }
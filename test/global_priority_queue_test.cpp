@@ -0,0 +1,177 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Every rank pushes num_request distinct values to random servers. Rank 0
+ * alone then pops a quarter of all values with Pop() and a quarter with
+ * PopBatch(32), and checks that they are the largest values in descending
+ * order. All ranks then drain the rest with four threads each calling
+ * RelaxedPop, and rank 0 checks that every value was popped exactly once
+ * and reports the rates of the three ways and how often a thread's
+ * RelaxedPop returned a larger value than its previous one.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/priority_queue/priority_queue.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+double rate(std::chrono::high_resolution_clock::time_point start, int values) {
+  auto end = std::chrono::high_resolution_clock::now();
+  return values / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  hcl::priority_queue<int> *queue;
+  if (is_server) {
+    queue = new hcl::priority_queue<int>("TEST_GLOBAL_PRIORITY_QUEUE");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    queue = new hcl::priority_queue<int>("TEST_GLOBAL_PRIORITY_QUEUE");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  /* Rank r pushes r, r + comm_size, r + 2 * comm_size, ... */
+  int total = comm_size * num_request;
+  for (int i = 0; i < num_request; i++) {
+    int value = my_rank + i * comm_size;
+    check(queue->Push(value), "Push", my_rank);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  double rates[3] = {0, 0, 0};
+  int expected = total - 1;
+  if (my_rank == 0) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < total / 4; i++, expected--) {
+      auto value = queue->Pop();
+      check(value.first && value.second == expected, "Pop order", my_rank);
+    }
+    rates[0] = rate(start, total / 4);
+    start = std::chrono::high_resolution_clock::now();
+    for (int popped = 0; popped < total / 4;) {
+      uint32_t k = std::min(32, total / 4 - popped);
+      std::vector<int> values = queue->PopBatch(k);
+      check(values.size() == k, "PopBatch size", my_rank);
+      for (int value : values) {
+        check(value == expected--, "PopBatch order", my_rank);
+      }
+      popped += k;
+    }
+    rates[1] = rate(start, total / 4);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  /* The values each thread popped, in the order it popped them */
+  int num_threads = 4;
+  std::vector<std::vector<int>> popped(num_threads);
+  std::atomic<bool> empty(false);
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> workers;
+  for (int tid = 0; tid < num_threads; tid++) {
+    workers.emplace_back([&, tid]() {
+      while (!empty) {
+        auto value = queue->RelaxedPop();
+        if (!value.first) {
+          empty = true;
+          break;
+        }
+        popped[tid].push_back(value.second);
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  std::vector<int> mine;
+  long stray = 0;
+  for (auto &values : popped) {
+    for (size_t i = 0; i < values.size(); i++) {
+      if (i > 0 && values[i] > values[i - 1]) stray++;
+    }
+    mine.insert(mine.end(), values.begin(), values.end());
+  }
+  int count = mine.size();
+  rates[2] = rate(start, std::max(count, 1));
+  check(!queue->Pop().first, "queue drained", my_rank);
+
+  std::vector<int> counts(comm_size), displs(comm_size);
+  MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0,
+             MPI_COMM_WORLD);
+  for (int i = 1; i < comm_size; i++) displs[i] = displs[i - 1] + counts[i - 1];
+  std::vector<int> all(total - (total / 4) * 2);
+  if (my_rank == 0) {
+    check(displs.back() + counts.back() == (int)all.size(), "RelaxedPop count",
+          my_rank);
+  }
+  MPI_Gatherv(mine.data(), count, MPI_INT, all.data(), counts.data(),
+              displs.data(), MPI_INT, 0, MPI_COMM_WORLD);
+  long all_stray = 0;
+  MPI_Reduce(&stray, &all_stray, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+  double relaxed_rate = 0;
+  MPI_Reduce(&rates[2], &relaxed_rate, 1, MPI_DOUBLE, MPI_SUM, 0,
+             MPI_COMM_WORLD);
+  if (my_rank == 0) {
+    std::sort(all.begin(), all.end());
+    for (size_t i = 0; i < all.size(); i++) {
+      check(all[i] == (int)i, "RelaxedPop pops every value once", my_rank);
+    }
+    printf(
+        "Pop (values/s) %f PopBatch(32) (values/s) %f RelaxedPop (values/s) "
+        "%f RelaxedPop out of order %ld of %zu\n",
+        rates[0], rates[1], relaxed_rate, all_stray, all.size());
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (queue);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,170 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Every rank takes num_request ids with GetNextSequence, num_request ids
+ * with one GetNextSequenceRange and num_request ids from a sequence_lease
+ * shared by four threads, from a plain and from a sharded global_sequence.
+ * Rank 0 gathers all of them and checks that no server handed out an id
+ * twice and, for the sharded sequence, that no two servers did. It reports
+ * the id rate of each way.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/sequencer/global_sequence.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util.h"
+
+double rate(std::chrono::high_resolution_clock::time_point start, int ids) {
+  auto end = std::chrono::high_resolution_clock::now();
+  return ids / std::chrono::duration<double>(end - start).count();
+}
+
+/* Fills ids with 3 * num_request ids of sequence and the rates of the three
+ * ways of taking them. */
+void take_ids(hcl::global_sequence *sequence, int num_request,
+              std::vector<uint64_t> &ids, double *rates) {
+  int num_threads = 4;
+  ids.resize(3 * num_request);
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < num_request; i++) ids[i] = sequence->GetNextSequence();
+  rates[0] = rate(start, num_request);
+
+  start = std::chrono::high_resolution_clock::now();
+  uint64_t first = sequence->GetNextSequenceRange(num_request);
+  for (int i = 0; i < num_request; i++) {
+    ids[num_request + i] = first + i * sequence->Stride();
+  }
+  rates[1] = rate(start, num_request);
+
+  start = std::chrono::high_resolution_clock::now();
+  {
+    hcl::sequence_lease lease(sequence, 64, 16);
+    std::vector<std::thread> workers;
+    for (int tid = 0; tid < num_threads; tid++) {
+      workers.emplace_back([&, tid]() {
+        for (int i = tid; i < num_request; i += num_threads) {
+          ids[2 * num_request + i] = lease.GetNextSequence();
+        }
+      });
+    }
+    for (auto &worker : workers) worker.join();
+  }
+  rates[2] = rate(start, num_request);
+}
+
+/* Gathers ids tagged with the server they came from, unless global, and
+ * checks on rank 0 that no tagged id repeats. */
+void check_unique(std::vector<uint64_t> &ids, uint64_t tag, int comm_size,
+                  int my_rank) {
+  std::vector<uint64_t> tagged;
+  for (uint64_t id : ids) {
+    tagged.push_back(tag);
+    tagged.push_back(id);
+  }
+  std::vector<uint64_t> all(my_rank == 0 ? tagged.size() * comm_size : 0);
+  MPI_Gather(tagged.data(), tagged.size(), MPI_UINT64_T, all.data(),
+             tagged.size(), MPI_UINT64_T, 0, MPI_COMM_WORLD);
+  if (my_rank != 0) return;
+  std::vector<std::pair<uint64_t, uint64_t>> pairs;
+  for (size_t i = 0; i < all.size(); i += 2) {
+    pairs.emplace_back(all[i], all[i + 1]);
+  }
+  std::sort(pairs.begin(), pairs.end());
+  check(std::adjacent_find(pairs.begin(), pairs.end()) == pairs.end() &&
+            pairs.front().second != 0,
+        "an id was handed out twice", my_rank);
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  hcl::global_sequence *sequence, *sharded;
+  if (is_server) {
+    sequence = new hcl::global_sequence();
+    sharded = new hcl::global_sequence("TEST_SHARDED_SEQUENCE",
+                                       HCL_CONF->RPC_PORT, true);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    sequence = new hcl::global_sequence();
+    sharded = new hcl::global_sequence("TEST_SHARDED_SEQUENCE",
+                                       HCL_CONF->RPC_PORT, true);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  std::vector<uint64_t> ids, sharded_ids;
+  double rates[6], min_rates[6];
+  take_ids(sequence, num_request, ids, rates);
+  take_ids(sharded, num_request, sharded_ids, rates + 3);
+  for (uint64_t id : sharded_ids) {
+    check((id - 1) % num_servers == (uint64_t)my_server,
+          "id of another server", my_rank);
+  }
+  check_unique(ids, my_server, comm_size, my_rank);
+  check_unique(sharded_ids, 0, comm_size, my_rank);
+  MPI_Reduce(rates, min_rates, 6, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+  if (my_rank == 0) {
+    printf(
+        "GetNextSequence (ids/s) %f GetNextSequenceRange (ids/s) %f "
+        "sequence_lease (ids/s) %f\n",
+        min_rates[0], min_rates[1], min_rates[2]);
+    printf(
+        "sharded GetNextSequence (ids/s) %f GetNextSequenceRange (ids/s) %f "
+        "sequence_lease (ids/s) %f\n",
+        min_rates[3], min_rates[4], min_rates[5]);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (sharded);
+  delete (sequence);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,143 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Measures how the server side operations scale with the number of threads
+ * calling them, as RPC handler threads do when RPC_THREADS > 1. Each thread
+ * runs a read mostly mix (one Put per nine Gets) on its own keys against an
+ * unordered_map with one lock stripe, one with a stripe per thread, and an
+ * ordered map whose Gets share the segment mutex.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/map/map.h>
+#include <hcl/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+template <typename Map>
+double throughput(Map *map, int num_threads, int num_request) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    workers.emplace_back([map, tid, num_request]() {
+      for (int i = 0; i < num_request; i++) {
+        int key = tid * num_request + i % 64;
+        if (i % 10 == 0) {
+          int value = i;
+          map->LocalPut(key, value);
+        } else {
+          map->LocalGet(key);
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return static_cast<double>(num_threads) * num_request / seconds;
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  int max_threads = 64;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (argc > 6) max_threads = atoi(argv[6]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  typedef hcl::unordered_map<int, int> hash_map;
+  typedef hcl::map<int, int> ordered_map;
+  hash_map *single, *striped;
+  ordered_map *omap;
+  if (is_server) {
+    HCL_CONF->LOCK_STRIPES = 1;
+    single = new hash_map("TEST_LOCK_SINGLE");
+    HCL_CONF->LOCK_STRIPES = max_threads;
+    striped = new hash_map("TEST_LOCK_STRIPED");
+    omap = new ordered_map("TEST_LOCK_MAP");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    single = new hash_map("TEST_LOCK_SINGLE");
+    striped = new hash_map("TEST_LOCK_STRIPED");
+    omap = new ordered_map("TEST_LOCK_MAP");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (is_server) {
+    int last_threads = 1;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      last_threads = threads;
+      double single_ops = throughput(single, threads, num_request);
+      double striped_ops = throughput(striped, threads, num_request);
+      double map_ops = throughput(omap, threads, num_request);
+      if (my_server == 0) {
+        printf(
+            "threads %d unordered_map 1 stripe (ops/s) %f %d stripes (ops/s) "
+            "%f map (ops/s) %f\n",
+            threads, single_ops, max_threads, striped_ops, map_ops);
+      }
+    }
+    for (int tid = 0; tid < last_threads; tid++) {
+      for (int i = 0; i < 64 && i < num_request; i += 10) {
+        int key = tid * num_request + i;
+        auto single_value = single->LocalGet(key);
+        auto striped_value = striped->LocalGet(key);
+        check(single_value.first && striped_value.first &&
+                  single_value.second == striped_value.second,
+              "lost key", my_rank);
+      }
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (omap);
+  delete (striped);
+  delete (single);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,173 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Measures the node pool of concurrent unordered maps under concurrent
+ * inserts and erases. Two maps start with chunks of 64 and 4096 nodes; on
+ * each, 1, 2, 4 and 8 threads on the servers insert and erase the same keys,
+ * split between them, round after round. Both maps must be empty afterwards
+ * and their chunks must have grown geometrically. Rank 0 reports the
+ * throughput of each run and the chunks and nodes each pool ended with.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/concurrent/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+template <typename A>
+void serialize(A &ar, int &a) {
+  ar &a;
+}
+#endif
+
+typedef hcl::concurrent_unordered_map<int, int> hash_map;
+
+/* Each thread inserts every num_threads-th key and erases them again, rounds
+ * times; the keys of a server are those its partition maps to it. */
+double churn(hash_map *map, std::vector<int> &keys, int num_threads,
+             int rounds) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    workers.emplace_back([map, &keys, tid, num_threads, rounds]() {
+      for (int round = 0; round < rounds; ++round) {
+        for (std::size_t i = tid; i < keys.size(); i += num_threads)
+          map->LocalInsert(keys[i], keys[i]);
+        for (std::size_t i = tid; i < keys.size(); i += num_threads)
+          map->LocalErase(keys[i]);
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return 2.0 * keys.size() * rounds / seconds;
+}
+
+/* A pool whose chunks double from first nodes holds at most
+ * first * (2^chunks - 1) nodes until they reach MAX_CHUNK_NODES. */
+bool grew_geometrically(hash_map *map, uint32_t first) {
+  uint64_t chunks = map->pool()->allocated_chunks();
+  uint64_t nodes = map->pool()->allocated_nodes();
+  if (nodes >= MAX_CHUNK_NODES) return true;
+  return chunks <= 1 + (uint64_t)std::log2((double)nodes / first + 1);
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  uint64_t total_size = 1024 * num_servers;
+  uint32_t small_chunk = 64, large_chunk = 4096;
+  hash_map *small, *large;
+  if (is_server) {
+    HCL_CONF->NODE_CHUNK_SIZE = small_chunk;
+    small = new hash_map("TEST_POOL_SMALL_CHUNKS");
+    small->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    HCL_CONF->NODE_CHUNK_SIZE = large_chunk;
+    large = new hash_map("TEST_POOL_LARGE_CHUNKS");
+    large->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    small = new hash_map("TEST_POOL_SMALL_CHUNKS");
+    small->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    large = new hash_map("TEST_POOL_LARGE_CHUNKS");
+    large->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (is_server) {
+    /* 8 requests of keys of this server per thread of the largest run */
+    std::vector<int> keys;
+    for (int k = 0; keys.size() < 64ul * num_request; ++k) {
+      if (small->serverLocation(k) == (uint64_t)my_server) keys.push_back(k);
+    }
+    int rounds = 10;
+    std::vector<int> threads = {1, 2, 4, 8};
+    std::vector<double> small_ops, large_ops;
+    for (int num_threads : threads) {
+      small_ops.push_back(churn(small, keys, num_threads, rounds));
+      large_ops.push_back(churn(large, keys, num_threads, rounds));
+    }
+    check(small->allocated() == small->removed(), "small not empty", my_rank);
+    check(large->allocated() == large->removed(), "large not empty", my_rank);
+    check(grew_geometrically(small, small_chunk), "small chunks", my_rank);
+    check(grew_geometrically(large, large_chunk), "large chunks", my_rank);
+    if (my_server == 0) {
+      for (std::size_t i = 0; i < threads.size(); ++i) {
+        printf("threads %d chunk %u (ops/s) %f chunk %u (ops/s) %f\n",
+               threads[i], small_chunk, small_ops[i], large_chunk,
+               large_ops[i]);
+      }
+      printf("chunk %u: chunks %lu nodes %lu, chunk %u: chunks %lu nodes %lu\n",
+             small_chunk, (unsigned long)small->pool()->allocated_chunks(),
+             (unsigned long)small->pool()->allocated_nodes(), large_chunk,
+             (unsigned long)large->pool()->allocated_chunks(),
+             (unsigned long)large->pool()->allocated_nodes());
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    int base = 1 << 24;
+    for (int i = 0; i < num_request; i++) {
+      int key = base + my_rank * num_request + i;
+      check(small->Insert(key, key), "Insert", my_rank);
+      check(small->Erase(key), "Erase", my_rank);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (large);
+  delete (small);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,189 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Every rank puts, reads, updates, scans and erases its own keys of a
+ * concurrent_ordered_map through the client API and checks the results.
+ * The servers then measure how the server side operations scale with the
+ * number of threads calling them, as RPC handler threads do, for the
+ * concurrent_ordered_map and for hcl::map, whose operations all take one
+ * mutex: each thread runs one Put per nine Gets on its own keys and a range
+ * scan of 16 keys every 50 operations.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/concurrent/ordered_map/ordered_map.h>
+#include <hcl/map/map.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util.h"
+
+typedef hcl::concurrent_ordered_map<int, int> skiplist_map;
+typedef hcl::map<int, int> tree_map;
+
+template <typename Map>
+void scan(Map *map, int &lo, int &hi);
+
+template <>
+void scan(skiplist_map *map, int &lo, int &hi) {
+  map->LocalRangeScan(lo, hi, 16);
+}
+
+template <>
+void scan(tree_map *map, int &lo, int &hi) {
+  map->LocalContainsInServer(lo, hi);
+}
+
+template <typename Map>
+double throughput(Map *map, int base, int num_threads, int num_request) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    workers.emplace_back([map, base, tid, num_request]() {
+      for (int i = 0; i < num_request; i++) {
+        int key = base + tid * num_request + i % 64;
+        if (i % 50 == 0) {
+          int hi = key + 16;
+          scan(map, key, hi);
+        } else if (i % 10 == 0) {
+          int value = i;
+          map->LocalPut(key, value);
+        } else {
+          map->LocalGet(key);
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return static_cast<double>(num_threads) * num_request / seconds;
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  int max_threads = 8;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (argc > 6) max_threads = atoi(argv[6]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  skiplist_map *smap;
+  tree_map *tmap;
+  if (is_server) {
+    smap = new skiplist_map("TEST_ORDERED_MAP");
+    smap->initialize_maps(num_servers, my_server);
+    tmap = new tree_map("TEST_ORDERED_MAP_TREE");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    smap = new skiplist_map("TEST_ORDERED_MAP");
+    smap->initialize_maps(num_servers, my_server);
+    tmap = new tree_map("TEST_ORDERED_MAP_TREE");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  /* Rank r owns the keys [r * num_request, (r + 1) * num_request) */
+  int lo = my_rank * num_request, hi = lo + num_request - 1;
+  for (int key = lo; key <= hi; key++) {
+    int value = key * 2;
+    check(smap->Put(key, value), "Put", my_rank);
+  }
+  for (int key = lo; key <= hi; key++) {
+    auto value = smap->Get(key);
+    check(value.first && value.second == key * 2, "Get", my_rank);
+  }
+  for (int key = lo; key <= hi; key += 2) {
+    int value = key * 3;
+    check(smap->Update(key, value), "Update", my_rank);
+  }
+  auto entries = smap->RangeScan(lo, hi);
+  check(entries.size() == (size_t)num_request, "RangeScan size", my_rank);
+  for (size_t i = 0; i < entries.size(); i++) {
+    int key = lo + (int)i;
+    int expected = (key - lo) % 2 == 0 ? key * 3 : key * 2;
+    check(entries[i].first == key && entries[i].second == expected,
+          "RangeScan", my_rank);
+  }
+  check(smap->RangeScan(lo, hi, 4).size() == std::min(4, num_request),
+        "RangeScan limit", my_rank);
+  for (int key = lo; key <= hi; key++) {
+    check(smap->Erase(key), "Erase", my_rank);
+  }
+  int value = 0;
+  check(!smap->Get(lo).first && !smap->Erase(lo) && !smap->Update(lo, value),
+        "erased key", my_rank);
+  check(smap->RangeScan(lo, hi).empty(), "RangeScan after Erase", my_rank);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (is_server) {
+    int base = comm_size * num_request;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      double skiplist_ops = throughput(smap, base, threads, num_request);
+      double tree_ops = throughput(tmap, base, threads, num_request);
+      if (my_server == 0) {
+        printf(
+            "threads %d concurrent_ordered_map (ops/s) %f map (ops/s) %f\n",
+            threads, skiplist_ops, tree_ops);
+      }
+    }
+    for (int key = base; key < base + max_threads * num_request; key++) {
+      auto skiplist_value = smap->LocalGet(key);
+      auto tree_value = tmap->LocalGet(key);
+      check(skiplist_value.first == tree_value.first &&
+                (!tree_value.first ||
+                 skiplist_value.second == tree_value.second),
+            "server side Put", my_rank);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (tmap);
+  delete (smap);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,193 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Compares narrow range queries on a hash partitioned map, which asks every
+ * server, with a map partitioned by splitter keys, which asks only the
+ * servers owning the range. Also checks the ordered set's global SeekFirst
+ * and SeekFirstN, and that paginated scans return every entry in order.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/common/partitioner.h>
+#include <hcl/map/map.h>
+#include <hcl/set/set.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "util.h"
+
+typedef hcl::map<int, int> hash_map;
+typedef hcl::map<int, int, std::less<int>, nullptr_t, nullptr_t,
+                 hcl::OrderedPartitioner<int>>
+    ordered_map;
+typedef hcl::set<int, std::hash<int>, std::less<int>, nullptr_t, nullptr_t,
+                 hcl::OrderedPartitioner<int>>
+    ordered_set;
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  if (provided < MPI_THREAD_MULTIPLE) {
+    printf("Didn't receive appropriate MPI threading specification\n");
+    exit(EXIT_FAILURE);
+  }
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  /*Keys 0..total are split evenly between the servers*/
+  int total = comm_size * num_request;
+  std::vector<int> sample;
+  for (int i = 0; i < total; i++) sample.push_back(i);
+  auto partitioner =
+      hcl::OrderedPartitioner<int>::FromSample(sample, num_servers);
+
+  hash_map *hmap;
+  ordered_map *omap;
+  ordered_set *oset;
+  if (is_server) {
+    hmap = new hash_map("TEST_HASH_MAP");
+    omap = new ordered_map("TEST_ORDERED_MAP", HCL_CONF->RPC_PORT, partitioner);
+    oset = new ordered_set("TEST_ORDERED_SET", HCL_CONF->RPC_PORT, partitioner);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    hmap = new hash_map("TEST_HASH_MAP");
+    omap = new ordered_map("TEST_ORDERED_MAP", HCL_CONF->RPC_PORT, partitioner);
+    oset = new ordered_set("TEST_ORDERED_SET", HCL_CONF->RPC_PORT, partitioner);
+  }
+
+  MPI_Comm client_comm;
+  MPI_Comm_split(MPI_COMM_WORLD, !is_server, my_rank, &client_comm);
+  int client_comm_size;
+  MPI_Comm_size(client_comm, &client_comm_size);
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    for (int i = 0; i < num_request; i++) {
+      int key = my_rank * num_request + i;
+      hmap->Put(key, key);
+      omap->Put(key, key);
+      oset->Put(key);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    int width = 8;
+    Timer hash_timer = Timer();
+    Timer ordered_timer = Timer();
+    for (int i = 0; i < num_request; i++) {
+      int key_start = my_rank * num_request + i;
+      int key_end = key_start + width - 1;
+      hash_timer.resumeTime();
+      auto hash_result = hmap->Contains(key_start, key_end);
+      hash_timer.pauseTime();
+      ordered_timer.resumeTime();
+      auto ordered_result = omap->Contains(key_start, key_end);
+      ordered_timer.pauseTime();
+      check(ordered_result.size() == hash_result.size(), "Contains size",
+            my_rank);
+      check(std::is_sorted(ordered_result.begin(), ordered_result.end()),
+            "Contains order", my_rank);
+    }
+    auto all = omap->GetAllData();
+    check(std::is_sorted(all.begin(), all.end()), "GetAllData order",
+          my_rank);
+    auto first = oset->SeekFirst();
+    check(first.first, "SeekFirst", my_rank);
+    auto first_n = oset->SeekFirstN(width);
+    check(first_n.first && first_n.second.size() == width &&
+              first_n.second.front() == first.second &&
+              std::is_sorted(first_n.second.begin(), first_n.second.end()),
+          "SeekFirstN", my_rank);
+
+    auto map_cursor = omap->OpenScan();
+    std::vector<std::pair<int, int>> scanned;
+    for (auto page = omap->NextBatch(map_cursor, width); !page.empty();
+         page = omap->NextBatch(map_cursor, width)) {
+      check(page.size() <= width, "map NextBatch page size", my_rank);
+      scanned.insert(scanned.end(), page.begin(), page.end());
+    }
+    omap->CloseScan(map_cursor);
+    check(scanned == all, "map scan", my_rank);
+    /* A zero item limit still advances, one entry per page */
+    map_cursor = omap->OpenScan();
+    scanned.clear();
+    for (auto page = omap->NextBatch(map_cursor, 0); !page.empty();
+         page = omap->NextBatch(map_cursor, 0)) {
+      check(page.size() == 1, "map NextBatch zero items", my_rank);
+      scanned.push_back(page.front());
+    }
+    omap->CloseScan(map_cursor);
+    check(scanned == all, "map scan with zero items", my_rank);
+    auto set_cursor = oset->OpenScan();
+    std::vector<int> scanned_keys;
+    uint64_t one_key = sizeof(int);
+    for (auto page = oset->NextBatch(set_cursor, width, one_key);
+         !page.empty(); page = oset->NextBatch(set_cursor, width, one_key)) {
+      check(page.size() == 1, "set NextBatch byte limit", my_rank);
+      scanned_keys.push_back(page.front());
+    }
+    oset->CloseScan(set_cursor);
+    check(scanned_keys.size() == all.size() &&
+              std::is_sorted(scanned_keys.begin(), scanned_keys.end()),
+          "set scan", my_rank);
+
+    double hash_ms = hash_timer.getElapsedTime() / num_request, hash_max;
+    double ordered_ms = ordered_timer.getElapsedTime() / num_request,
+           ordered_max;
+    MPI_Reduce(&hash_ms, &hash_max, 1, MPI_DOUBLE, MPI_MAX, 0, client_comm);
+    MPI_Reduce(&ordered_ms, &ordered_max, 1, MPI_DOUBLE, MPI_MAX, 0,
+               client_comm);
+    if (my_rank == 0) {
+      printf("hash partitioned Contains latency (ms): %f\n", hash_max);
+      printf("ordered partitioned Contains latency (ms): %f\n", ordered_max);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (oset);
+  delete (omap);
+  delete (hmap);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
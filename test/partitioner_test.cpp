@@ -0,0 +1,132 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Compares the key partitioners: the fraction of keys that change server
+ * when one server is added, the load imbalance (largest server / mean) and
+ * the cost of a lookup. Then runs a map placed by jump consistent hashing.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/common/partitioner.h>
+#include <hcl/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "util.h"
+
+template <typename Partitioner>
+void measure(const char *policy, std::vector<uint64_t> &hashes) {
+  for (uint16_t servers = 2; servers <= 16; servers *= 2) {
+    Partitioner before(servers, 0), after(servers + 1, 0);
+    std::vector<size_t> load(servers, 0);
+    size_t moved = 0;
+    std::vector<uint16_t> placed(hashes.size());
+    Timer lookup_timer = Timer();
+    lookup_timer.resumeTime();
+    for (size_t i = 0; i < hashes.size(); i++) placed[i] = before(hashes[i]);
+    lookup_timer.pauseTime();
+    for (size_t i = 0; i < hashes.size(); i++) {
+      load[placed[i]]++;
+      if (after(hashes[i]) != placed[i]) moved++;
+    }
+    double mean = static_cast<double>(hashes.size()) / servers;
+    double imbalance = *std::max_element(load.begin(), load.end()) / mean;
+    printf("%s servers %d->%d moved %f imbalance %f lookup (ns) %f\n", policy,
+           servers, servers + 1, static_cast<double>(moved) / hashes.size(),
+           imbalance, lookup_timer.getElapsedTime() * 1e6 / hashes.size());
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  if (provided < MPI_THREAD_MULTIPLE) {
+    printf("Didn't receive appropriate MPI threading specification\n");
+    exit(EXIT_FAILURE);
+  }
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  if (my_rank == 0) {
+    std::vector<uint64_t> hashes;
+    std::hash<std::string> string_hash;
+    for (int i = 0; i < num_request * 100; i++) {
+      hashes.push_back(string_hash("key_" + std::to_string(i)));
+    }
+    measure<hcl::ModuloPartitioner>("modulo", hashes);
+    measure<hcl::JumpConsistentPartitioner>("jump", hashes);
+    measure<hcl::RingPartitioner<>>("ring", hashes);
+    measure<hcl::RangePartitioner>("range", hashes);
+  }
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  typedef hcl::unordered_map<int, int, std::hash<int>, nullptr_t, nullptr_t,
+                             hcl::JumpConsistentPartitioner>
+      jump_map;
+  jump_map *map;
+  if (is_server) {
+    map = new jump_map();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    map = new jump_map();
+  }
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    for (int i = 0; i < num_request; i++) {
+      int key = my_rank * num_request + i;
+      map->Put(key, key);
+    }
+    for (int i = 0; i < num_request; i++) {
+      int key = my_rank * num_request + i;
+      auto result = map->Get(key);
+      check(result.first && result.second == key, "lost key", my_rank);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (map);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -20,39 +20,13 @@
 
 #include <chrono>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <queue>
 #include <utility>
+#include <vector>
 
-struct KeyType {
-  size_t a;
-  KeyType() : a(0) {}
-  KeyType(size_t a_) : a(a_) {}
-#ifdef HCL_ENABLE_RPCLIB
-  MSGPACK_DEFINE(a);
-#endif
-  /* equal operator for comparing two Matrix. */
-  bool operator==(const KeyType &o) const { return a == o.a; }
-  KeyType &operator=(const KeyType &other) {
-    a = other.a;
-    return *this;
-  }
-  bool operator<(const KeyType &o) const { return a < o.a; }
-  bool operator>(const KeyType &o) const { return a > o.a; }
-  bool Contains(const KeyType &o) const { return a == o.a; }
-};
-#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
-template <typename A>
-void serialize(A &ar, KeyType &a) {
-  ar &a.a;
-}
-#endif
-namespace std {
-template <>
-struct hash<KeyType> {
-  size_t operator()(const KeyType &k) const { return k.a; }
-};
-}  // namespace std
+#include "util.h"
 
 int main(int argc, char *argv[]) {
   int provided;
@@ -297,6 +271,30 @@ int main(int argc, char *argv[]) {
                remote_get_tp_result);
       }
     }
+    MPI_Barrier(client_comm);
+
+    /*Async priority_queue test, every client pops as many as it pushed*/
+    uint16_t async_server = (my_server + 1) % num_servers;
+    std::vector<std::future<bool>> push_futures;
+    for (int i = 0; i < num_request; i++) {
+      auto key = KeyType(i);
+      push_futures.push_back(priority_queue->AsyncPush(key, async_server));
+    }
+    for (auto &future : push_futures) check(future.get(), "AsyncPush", my_rank);
+    MPI_Barrier(client_comm);
+    auto top = priority_queue->AsyncTop(async_server).get();
+    check(top.first && top.second.a == static_cast<size_t>(num_request - 1),
+          "AsyncTop", my_rank);
+    MPI_Barrier(client_comm);
+    std::vector<std::future<std::pair<bool, KeyType>>> pop_futures;
+    for (int i = 0; i < num_request; i++) {
+      pop_futures.push_back(priority_queue->AsyncPop(async_server));
+    }
+    for (auto &future : pop_futures) {
+      auto result = future.get();
+      check(result.first && result.second.a < static_cast<size_t>(num_request),
+            "AsyncPop", my_rank);
+    }
   }
   MPI_Barrier(MPI_COMM_WORLD);
   delete (priority_queue);
@@ -0,0 +1,209 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Churns a concurrent unordered map and a concurrent skiplist on the servers:
+ * writer threads insert and erase keys of their own round after round while
+ * reader threads look keys up. Erased nodes are retired and reused once no
+ * reader can reach them. Readers that are preempted inside an operation hold
+ * back the epoch, so a last round runs without readers: it must reclaim all
+ * but a few batches of nodes per writer, and the map's pool must not grow.
+ * Rank 0 reports the throughput and the retired and reclaimed nodes of both.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/concurrent/skiplist/skiplist.h>
+#include <hcl/concurrent/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+template <typename A>
+void serialize(A &ar, int &a) {
+  ar &a;
+}
+#endif
+
+typedef hcl::concurrent_unordered_map<int, int> hash_map;
+typedef hcl::concurrent_skiplist<int> skiplist;
+
+/* Each writer inserts keys[tid] and erases them again, rounds times, while
+ * the readers look up keys of every writer until the writers are done. */
+template <typename Insert, typename Find, typename Erase>
+double churn(std::vector<std::vector<int>> &keys, int num_readers, int rounds,
+             Insert insert, Find find, Erase erase) {
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < num_readers; ++r) {
+    readers.emplace_back([&keys, &done, &find, r]() {
+      std::size_t i = r;
+      while (!done.load()) {
+        std::vector<int> &some = keys[i % keys.size()];
+        int key = some[(i / keys.size()) % some.size()];
+        find(key);
+        i += 7;
+      }
+    });
+  }
+  std::vector<std::thread> writers;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (std::size_t tid = 0; tid < keys.size(); ++tid) {
+    writers.emplace_back([&keys, &insert, &erase, tid, rounds]() {
+      for (int round = 0; round < rounds; ++round) {
+        for (int key : keys[tid]) insert(key);
+        for (int key : keys[tid]) erase(key);
+      }
+    });
+  }
+  for (auto &writer : writers) writer.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  done.store(true);
+  for (auto &reader : readers) reader.join();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  std::size_t ops = 0;
+  for (auto &mine : keys) ops += 2 * mine.size() * rounds;
+  return ops / seconds;
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  uint64_t total_size = 1024 * num_servers;
+  hash_map *map;
+  skiplist *set;
+  if (is_server) {
+    map = new hash_map("TEST_RECLAMATION_MAP");
+    map->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    set = new skiplist("TEST_RECLAMATION_SET");
+    set->initialize_sets(num_servers, my_server);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    map = new hash_map("TEST_RECLAMATION_MAP");
+    map->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+    set = new skiplist("TEST_RECLAMATION_SET");
+    set->initialize_sets(num_servers, my_server);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (is_server) {
+    /* num_request keys of this server per writer */
+    int num_writers = 4, num_readers = 4, rounds = 20;
+    std::vector<std::vector<int>> map_keys(num_writers), set_keys(num_writers);
+    int k = 0, j = 0;
+    for (int tid = 0; tid < num_writers; ++tid) {
+      while (map_keys[tid].size() < (std::size_t)num_request) {
+        if (map->serverLocation(k) == (uint64_t)my_server)
+          map_keys[tid].push_back(k);
+        ++k;
+      }
+      while (set_keys[tid].size() < (std::size_t)num_request) {
+        if (set->isLocal(j)) set_keys[tid].push_back(j);
+        ++j;
+      }
+    }
+
+    auto map_insert = [map](int key) { map->LocalInsert(key, key); };
+    auto map_find = [map, my_rank](int key) {
+      int value;
+      check(!map->LocalGet(key, &value) || value == key, "wrong value",
+            my_rank);
+    };
+    auto map_erase = [map](int key) { map->LocalErase(key); };
+    uint64_t bound = num_writers * 3 * EPOCH_BATCH;
+    double map_ops = churn(map_keys, num_readers, rounds, map_insert,
+                           map_find, map_erase);
+    churn(map_keys, 0, 1, map_insert, map_find, map_erase);
+    uint64_t chunks = map->pool()->allocated_chunks();
+    churn(map_keys, 0, 1, map_insert, map_find, map_erase);
+    uint64_t map_pending =
+        map->pool()->retired_nodes() - map->pool()->reclaimed_nodes();
+    check(map->allocated() == map->removed(), "map not empty", my_rank);
+    check(map->pool()->allocated_chunks() <= chunks, "map pool grew", my_rank);
+    check(map_pending <= bound, "map nodes not reclaimed", my_rank);
+
+    auto set_insert = [set](int key) { set->LocalInsert(key); };
+    auto set_find = [set](int key) { set->LocalFind(key); };
+    auto set_erase = [set](int key) { set->LocalErase(key); };
+    double set_ops = churn(set_keys, num_readers, rounds, set_insert,
+                           set_find, set_erase);
+    churn(set_keys, 0, 1, set_insert, set_find, set_erase);
+    uint64_t set_pending = set->data()->retired() - set->data()->reclaimed();
+    check(set->data()->size() == 0, "set not empty", my_rank);
+    check(set_pending <= bound, "set nodes not reclaimed", my_rank);
+
+    if (my_server == 0) {
+      printf("map (ops/s) %f retired %lu reclaimed %lu chunks %lu\n",
+             map_ops, (unsigned long)map->pool()->retired_nodes(),
+             (unsigned long)map->pool()->reclaimed_nodes(),
+             (unsigned long)map->pool()->allocated_chunks());
+      printf("set (ops/s) %f retired %lu reclaimed %lu\n", set_ops,
+             (unsigned long)set->data()->retired(),
+             (unsigned long)set->data()->reclaimed());
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    int base = 1 << 24;
+    for (int i = 0; i < num_request; i++) {
+      int key = base + my_rank * num_request + i;
+      check(map->Insert(key, key), "Insert", my_rank);
+      check(map->Erase(key), "Erase", my_rank);
+      check(set->Insert(key), "set Insert", my_rank);
+      check(set->Erase(key), "set Erase", my_rank);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (set);
+  delete (map);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,264 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Compares the server side throughput of a concurrent_queue on the boost
+ * lockfree queue and on a RingBuffer, popping one value or batches of 32, as
+ * 1 to max_threads threads each push and then pop num_request values. The
+ * servers then check that concurrent producers and consumers of a ring see
+ * every value exactly once, that a full ring refuses pushes, and that the
+ * Blocking operations wait for room or values. The clients time PushBatch
+ * and PopBatch through RPC.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/concurrent/queue/queue.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util.h"
+
+typedef hcl::concurrent_queue<int> boost_queue;
+typedef hcl::concurrent_queue<int, hcl::RingBuffer<int>> ring_queue;
+
+template <typename Queue>
+double throughput(Queue *queue, int num_threads, int num_request,
+                  uint32_t batch) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    workers.emplace_back([queue, tid, num_request, batch]() {
+      if (batch == 1) {
+        for (int i = 0; i < num_request; i++) {
+          int value = tid * num_request + i;
+          queue->LocalPush(value);
+        }
+        for (int i = 0; i < num_request; i++) queue->LocalPop();
+        return;
+      }
+      std::vector<int> values(batch);
+      for (int i = 0; i < num_request; i += batch) {
+        values.resize(std::min<int>(batch, num_request - i));
+        for (size_t j = 0; j < values.size(); j++) {
+          values[j] = tid * num_request + i + j;
+        }
+        queue->LocalPushBatch(values);
+      }
+      for (int i = 0; i < num_request; i += batch) {
+        queue->LocalPopBatch(std::min<int>(batch, num_request - i));
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return 2.0 * num_threads * num_request / seconds;
+}
+
+/* Producers push tid * num_request + i with TryPush or PushBatch while
+ * consumers pop; every value must come out once. */
+void check_mpmc(ring_queue *queue, int num_threads, int num_request,
+                int my_rank) {
+  int total = num_threads * num_request;
+  std::vector<std::atomic<int>> seen(total);
+  for (auto &count : seen) count = 0;
+  std::atomic<int> popped(0);
+  std::vector<std::thread> workers;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    workers.emplace_back([queue, tid, num_request]() {
+      std::vector<int> values;
+      for (int i = 0; i < num_request; i++) {
+        int value = tid * num_request + i;
+        if (tid % 2 == 0) {
+          while (!queue->LocalTryPush(value)) std::this_thread::yield();
+          continue;
+        }
+        values.push_back(value);
+        if (values.size() < 16 && i + 1 < num_request) continue;
+        size_t pushed = 0;
+        while (pushed < values.size()) {
+          std::vector<int> rest(values.begin() + pushed, values.end());
+          pushed += queue->LocalPushBatch(rest);
+          if (pushed < values.size()) std::this_thread::yield();
+        }
+        values.clear();
+      }
+    });
+    workers.emplace_back([queue, tid, total, &seen, &popped]() {
+      while (popped.load() < total) {
+        if (tid % 2 == 0) {
+          auto value = queue->LocalPop();
+          if (!value.first) {
+            std::this_thread::yield();
+            continue;
+          }
+          seen[value.second]++;
+          popped++;
+          continue;
+        }
+        auto values = queue->LocalPopBatch(16);
+        for (int value : values) seen[value]++;
+        popped += values.size();
+        if (values.empty()) std::this_thread::yield();
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  for (int value = 0; value < total; value++) {
+    check(seen[value] == 1, "every value popped once", my_rank);
+  }
+  check(popped == total && !queue->LocalPop().first, "queue drained",
+        my_rank);
+}
+
+void check_bounds(ring_queue *queue, int my_rank) {
+  int capacity = queue->data()->capacity();
+  for (int i = 0; i < capacity; i++) {
+    check(queue->LocalTryPush(i), "TryPush below capacity", my_rank);
+  }
+  int value = capacity;
+  check(!queue->LocalTryPush(value) && !queue->LocalPush(value),
+        "push to a full ring", my_rank);
+  std::vector<int> values(4, value);
+  check(queue->LocalPushBatch(values) == 0, "PushBatch to a full ring",
+        my_rank);
+  check(!queue->LocalBlockingPush(value, 10), "BlockingPush timeout",
+        my_rank);
+  std::thread popper([queue]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue->LocalPop();
+  });
+  check(queue->LocalBlockingPush(value, 10000), "BlockingPush wakes up",
+        my_rank);
+  popper.join();
+  auto rest = queue->LocalPopBatch(capacity + 1);
+  check(rest.size() == (size_t)capacity && rest.front() == 1 &&
+            rest.back() == capacity,
+        "PopBatch order", my_rank);
+  check(!queue->LocalBlockingPop(10).first, "BlockingPop timeout", my_rank);
+  std::thread pusher([queue]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int value = 7;
+    queue->LocalPush(value);
+  });
+  auto popped = queue->LocalBlockingPop(10000);
+  check(popped.first && popped.second == 7, "BlockingPop wakes up", my_rank);
+  pusher.join();
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  int max_threads = 8;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (argc > 6) max_threads = atoi(argv[6]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+  /* Room for every value the throughput runs push */
+  HCL_CONF->QUEUE_CAPACITY = max_threads * num_request;
+
+  boost_queue *bqueue;
+  ring_queue *rqueue, *small;
+  if (is_server) {
+    bqueue = new boost_queue("TEST_RING_QUEUE_BOOST");
+    rqueue = new ring_queue("TEST_RING_QUEUE");
+    HCL_CONF->QUEUE_CAPACITY = 64;
+    small = new ring_queue("TEST_RING_QUEUE_SMALL");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    bqueue = new boost_queue("TEST_RING_QUEUE_BOOST");
+    rqueue = new ring_queue("TEST_RING_QUEUE");
+    small = new ring_queue("TEST_RING_QUEUE_SMALL");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (is_server) {
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      double boost_ops = throughput(bqueue, threads, num_request, 1);
+      double ring_ops = throughput(rqueue, threads, num_request, 1);
+      double batch_ops = throughput(rqueue, threads, num_request, 32);
+      if (my_server == 0) {
+        printf(
+            "threads %d boost queue (ops/s) %f ring (ops/s) %f ring batches "
+            "of 32 (ops/s) %f\n",
+            threads, boost_ops, ring_ops, batch_ops);
+      }
+    }
+    check(rqueue->data()->empty(), "ring empty after the runs", my_rank);
+    check_mpmc(small, max_threads, num_request, my_rank);
+    check_bounds(small, my_rank);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  double remote_l = 0, remote = 0;
+  if (!is_server) {
+    uint64_t server = my_rank % num_servers;
+    std::vector<int> values(32);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_request; i += values.size()) {
+      for (size_t j = 0; j < values.size(); j++) values[j] = i + j;
+      rqueue->PushBatch(server, values);
+    }
+    for (int i = 0; i < num_request; i += values.size()) {
+      rqueue->PopBatch(server, values.size());
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    remote_l = 2.0 * num_request /
+               std::chrono::duration<double>(t2 - t1).count();
+  }
+  MPI_Allreduce(&remote_l, &remote, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  if (my_rank == 0) {
+    printf("remote batches of 32 (values/s) %f\n", remote);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (small);
+  delete (rqueue);
+  delete (bqueue);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
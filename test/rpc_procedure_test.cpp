@@ -0,0 +1,121 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Measures the cost of naming a remote function. Before the procedure
+ * registry every call defined prefix + name with the backend; now a container
+ * resolves each operation once and calls through the handle.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  if (provided < MPI_THREAD_MULTIPLE) {
+    printf("Didn't receive appropriate MPI threading specification\n");
+    exit(EXIT_FAILURE);
+  }
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  hcl::unordered_map<int, int> *map;
+  if (is_server) {
+    map = new hcl::unordered_map<int, int>();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    map = new hcl::unordered_map<int, int>();
+  }
+
+  MPI_Comm client_comm;
+  bool is_client = true;
+  if (comm_size > 1) {
+    MPI_Comm_split(MPI_COMM_WORLD, !is_server, my_rank, &client_comm);
+    is_client = !is_server;
+  } else {
+    client_comm = MPI_COMM_WORLD;
+  }
+
+  auto rpc =
+      hcl::Singleton<RPCFactory>::GetInstance()->GetRPC(HCL_CONF->RPC_PORT);
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (is_client) {
+    typedef std::pair<bool, int> ret_type;
+    CharStruct func_name("TEST_UNORDERED_MAP_Get");
+    uint16_t server = my_server;
+    int key = my_server + 1;
+    map->Put(key, key);
+
+    /*Define the name and call it on every request, as before the registry*/
+    Timer define_timer = Timer();
+    define_timer.resumeTime();
+    for (int i = 0; i < num_request; i++) {
+      RPC::Procedure procedure = rpc->define(func_name);
+      RPC_CALL_WRAPPER(procedure, server, ret_type, key);
+    }
+    define_timer.pauseTime();
+
+    /*Call the handle resolved once, as the containers do*/
+    RPC::Procedure procedure = *rpc->resolve(func_name);
+    Timer cached_timer = Timer();
+    cached_timer.resumeTime();
+    for (int i = 0; i < num_request; i++) {
+      RPC_CALL_WRAPPER(procedure, server, ret_type, key);
+    }
+    cached_timer.pauseTime();
+
+    double define_us = define_timer.getElapsedTime() * 1000 / num_request;
+    double cached_us = cached_timer.getElapsedTime() * 1000 / num_request;
+
+    if (my_rank == 0) {
+      printf("define and call per request (us): %f\n", define_us);
+      printf("resolved handle call per request (us): %f\n", cached_us);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (map);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
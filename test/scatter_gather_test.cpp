@@ -0,0 +1,221 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Checks the fan-out of GetAllData and Contains on hash partitioned
+ * containers: the merged results of map, set and multimap are sorted and
+ * complete, and the callback overloads see every server's part once, each
+ * sorted, in server id order.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/map/map.h>
+#include <hcl/multimap/multimap.h>
+#include <hcl/set/set.h>
+#include <hcl/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util.h"
+
+typedef std::pair<int, int> entry;
+typedef std::pair<KeyType, int> multi_entry;
+
+bool key_less(const multi_entry &a, const multi_entry &b) {
+  return a.first < b.first;
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  if (provided < MPI_THREAD_MULTIPLE) {
+    printf("Didn't receive appropriate MPI threading specification\n");
+    exit(EXIT_FAILURE);
+  }
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  hcl::map<int, int> *map;
+  hcl::set<int> *set;
+  hcl::multimap<KeyType, int> *multimap;
+  hcl::unordered_map<int, int> *unordered_map;
+  if (is_server) {
+    map = new hcl::map<int, int>("TEST_SCATTER_MAP");
+    set = new hcl::set<int>("TEST_SCATTER_SET");
+    multimap = new hcl::multimap<KeyType, int>("TEST_SCATTER_MULTIMAP");
+    unordered_map = new hcl::unordered_map<int, int>("TEST_SCATTER_UMAP");
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    map = new hcl::map<int, int>("TEST_SCATTER_MAP");
+    set = new hcl::set<int>("TEST_SCATTER_SET");
+    multimap = new hcl::multimap<KeyType, int>("TEST_SCATTER_MULTIMAP");
+    unordered_map = new hcl::unordered_map<int, int>("TEST_SCATTER_UMAP");
+  }
+
+  /*Every client puts num_request keys of its own*/
+  int num_clients = comm_size - num_servers;
+  size_t total = static_cast<size_t>(num_clients) * num_request;
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    for (int i = 0; i < num_request; i++) {
+      int key = my_rank * num_request + i;
+      map->Put(key, key);
+      set->Put(key);
+      unordered_map->Put(key, key);
+      KeyType multi_key(key);
+      int first = key, second = -key;
+      multimap->Put(multi_key, first);
+      multimap->Put(multi_key, second);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    /*The merged results are sorted across servers*/
+    auto all = map->GetAllData();
+    check(all.size() == total, "map GetAllData size", my_rank);
+    check(std::is_sorted(all.begin(), all.end()), "map GetAllData order",
+          my_rank);
+    auto all_keys = set->GetAllData();
+    check(all_keys.size() == total, "set GetAllData size", my_rank);
+    check(std::is_sorted(all_keys.begin(), all_keys.end()),
+          "set GetAllData order", my_rank);
+    auto all_multi = multimap->GetAllData();
+    check(all_multi.size() == 2 * total, "multimap GetAllData size", my_rank);
+    check(std::is_sorted(all_multi.begin(), all_multi.end(), key_less),
+          "multimap GetAllData order", my_rank);
+
+    int key_start = my_rank * num_request, key_end = key_start + 7;
+    auto range = map->Contains(key_start, key_end);
+    std::vector<entry> expected;
+    for (auto &e : all) {
+      if (e.first >= key_start && e.first <= key_end) expected.push_back(e);
+    }
+    check(range == expected, "map Contains", my_rank);
+    auto key_range = set->Contains(key_start, key_end);
+    check(key_range.size() == expected.size() &&
+              std::is_sorted(key_range.begin(), key_range.end()),
+          "set Contains", my_rank);
+
+    /*Callbacks get each server's sorted part once, in server id order*/
+    int calls = 0;
+    std::vector<entry> gathered;
+    map->GetAllData([&](std::vector<entry> &part) {
+      calls++;
+      check(std::is_sorted(part.begin(), part.end()),
+            "map GetAllData callback part order", my_rank);
+      gathered.insert(gathered.end(), part.begin(), part.end());
+    });
+    std::sort(gathered.begin(), gathered.end());
+    check(calls == num_servers && gathered == all, "map GetAllData callback",
+          my_rank);
+
+    std::vector<entry> gathered_range;
+    map->Contains(key_start, key_end, [&](std::vector<entry> &part) {
+      check(std::is_sorted(part.begin(), part.end()),
+            "map Contains callback part order", my_rank);
+      gathered_range.insert(gathered_range.end(), part.begin(), part.end());
+    });
+    std::sort(gathered_range.begin(), gathered_range.end());
+    check(gathered_range == expected, "map Contains callback", my_rank);
+
+    calls = 0;
+    std::vector<int> gathered_keys;
+    set->GetAllData([&](std::vector<int> &part) {
+      calls++;
+      check(std::is_sorted(part.begin(), part.end()),
+            "set GetAllData callback part order", my_rank);
+      gathered_keys.insert(gathered_keys.end(), part.begin(), part.end());
+    });
+    std::sort(gathered_keys.begin(), gathered_keys.end());
+    check(calls == num_servers && gathered_keys == all_keys,
+          "set GetAllData callback", my_rank);
+
+    size_t range_keys = 0;
+    set->Contains(key_start, key_end,
+                  [&](std::vector<int> &part) { range_keys += part.size(); });
+    check(range_keys == expected.size(), "set Contains callback", my_rank);
+
+    calls = 0;
+    size_t multi_count = 0;
+    multimap->GetAllData([&](std::vector<multi_entry> &part) {
+      calls++;
+      check(std::is_sorted(part.begin(), part.end(), key_less),
+            "multimap GetAllData callback part order", my_rank);
+      multi_count += part.size();
+    });
+    check(calls == num_servers && multi_count == all_multi.size(),
+          "multimap GetAllData callback", my_rank);
+
+    KeyType multi_key(key_start);
+    size_t matches = 0;
+    multimap->Contains(multi_key, [&](std::vector<multi_entry> &part) {
+      for (auto &e : part) {
+        if (e.first == multi_key) matches++;
+      }
+    });
+    check(matches == 2, "multimap Contains callback", my_rank);
+
+    calls = 0;
+    std::vector<entry> unordered_parts;
+    unordered_map->GetAllData([&](std::vector<entry> &part) {
+      calls++;
+      unordered_parts.insert(unordered_parts.end(), part.begin(), part.end());
+    });
+    auto unordered_all = unordered_map->GetAllData();
+    std::sort(unordered_parts.begin(), unordered_parts.end());
+    std::sort(unordered_all.begin(), unordered_all.end());
+    check(calls == num_servers && unordered_parts.size() == total &&
+              unordered_parts == unordered_all,
+          "unordered_map GetAllData callback", my_rank);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (unordered_map);
+  delete (multimap);
+  delete (set);
+  delete (map);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -20,41 +20,13 @@
 
 #include <chrono>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <set>
 #include <utility>
+#include <vector>
 
-struct KeyType {
-  size_t a;
-  KeyType() : a(0) {}
-  KeyType(size_t a_) : a(a_) {}
-#ifdef HCL_ENABLE_RPCLIB
-  MSGPACK_DEFINE(a);
-#endif
-  /* equal operator for comparing two Matrix. */
-  bool operator==(const KeyType &o) const { return a == o.a; }
-  KeyType &operator=(const KeyType &other) {
-    a = other.a;
-    return *this;
-  }
-  bool operator<(const KeyType &o) const { return a < o.a; }
-  bool operator<=(const KeyType &o) const { return a < o.a; }
-  bool operator>(const KeyType &o) const { return a > o.a; }
-  bool operator>=(const KeyType &o) const { return a >= o.a; }
-  bool Contains(const KeyType &o) const { return a == o.a; }
-};
-#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
-template <typename A>
-void serialize(A &ar, KeyType &a) {
-  ar &a.a;
-}
-#endif
-namespace std {
-template <>
-struct hash<KeyType> {
-  size_t operator()(const KeyType &k) const { return k.a; }
-};
-}  // namespace std
+#include "util.h"
 
 int main(int argc, char *argv[]) {
   int provided;
@@ -294,6 +266,22 @@ int main(int argc, char *argv[]) {
         printf("remote set throughput (get): %f\n", remote_get_tp_result);
       }
     }
+    MPI_Barrier(client_comm);
+
+    /*Async set test, every key put is found and erased*/
+    std::vector<KeyType> async_keys;
+    std::vector<std::future<bool>> put_futures, get_futures, erase_futures;
+    for (int i = 0; i < num_request; i++) {
+      async_keys.emplace_back(num_servers + 1 + my_rank * num_request + i);
+    }
+    for (auto &key : async_keys) put_futures.push_back(set->AsyncPut(key));
+    for (auto &future : put_futures) check(future.get(), "AsyncPut", my_rank);
+    for (auto &key : async_keys) get_futures.push_back(set->AsyncGet(key));
+    for (auto &future : get_futures) check(future.get(), "AsyncGet", my_rank);
+    for (auto &key : async_keys) erase_futures.push_back(set->AsyncErase(key));
+    for (auto &future : erase_futures) {
+      check(future.get(), "AsyncErase", my_rank);
+    }
   }
   MPI_Barrier(MPI_COMM_WORLD);
   delete (set);
@@ -0,0 +1,125 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Runs the concurrent unordered map with its tables in the servers' segments.
+ * Clients on a server's node insert, read, update and erase their keys
+ * through the segment; the others go through RPC. Every client checks its
+ * keys and rank 0 reports the latency of the operations.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/concurrent/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "util.h"
+
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+template <typename A>
+void serialize(A &ar, int &a) {
+  ar &a;
+}
+#endif
+
+typedef hcl::concurrent_unordered_map<
+    int, int, std::hash<int>, std::equal_to<int>, hcl::RangePartitioner,
+    hcl::SharedBlockMap<int, int>>
+    shared_map;
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  if (provided < MPI_THREAD_MULTIPLE) {
+    printf("Didn't receive appropriate MPI threading specification\n");
+    exit(EXIT_FAILURE);
+  }
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  uint64_t total_size = 8192;
+  shared_map *map;
+  if (is_server) {
+    map = new shared_map("TEST_SHARED_BLOCK_MAP");
+    map->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    map = new shared_map("TEST_SHARED_BLOCK_MAP");
+    map->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (!is_server) {
+    Timer insert_timer = Timer();
+    Timer get_timer = Timer();
+    for (int i = 0; i < num_request; i++) {
+      int key = my_rank * num_request + i;
+      insert_timer.resumeTime();
+      map->Insert(key, key);
+      insert_timer.pauseTime();
+    }
+    for (int i = 0; i < num_request; i++) {
+      int key = my_rank * num_request + i;
+      get_timer.resumeTime();
+      int value = map->Get(key);
+      get_timer.pauseTime();
+      check(map->Find(key) && value == key, "Get", my_rank);
+      int updated = key + 1;
+      check(map->Update(key, updated), "Update", my_rank);
+      check(map->Get(key) == updated, "Get after Update", my_rank);
+    }
+    for (int i = 0; i < num_request; i += 2) {
+      int key = my_rank * num_request + i;
+      check(map->Erase(key) && !map->Find(key), "Erase", my_rank);
+    }
+    if (my_rank == 0) {
+      printf("Insert latency (ms): %f\n",
+             insert_timer.getElapsedTime() / num_request);
+      printf("Get latency (ms): %f\n", get_timer.getElapsedTime() / num_request);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (map);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,150 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Fills a hash partitioned and an order partitioned concurrent skiplist with
+ * the even keys below 2 * comm_size * num_request, then checks First, Last,
+ * LowerBound and RangeScan of both against the expected keys from every rank.
+ * Rank 0 reports the RangeScan latency of each: the ordered skiplist asks
+ * only the servers owning the range, the hashed one asks all of them.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/common/partitioner.h>
+#include <hcl/concurrent/skiplist/skiplist.h>
+#include <mpi.h>
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util.h"
+
+typedef hcl::concurrent_skiplist<int> hash_skiplist;
+typedef hcl::concurrent_skiplist<int, std::hash<int>, std::less<int>,
+                                 std::allocator<char>, 24,
+                                 hcl::OrderedPartitioner<int>>
+    ordered_skiplist;
+
+/* Checks the ordered reads of set, which holds the even keys below max_key,
+ * and returns the time its range scans took. */
+template <typename Skiplist>
+double check_reads(Skiplist *set, int max_key, int num_request, int my_rank) {
+  auto first = set->First();
+  auto last = set->Last();
+  check(first.first && first.second == 0, "First", my_rank);
+  check(last.first && last.second == max_key - 2, "Last", my_rank);
+  uint32_t width = 8;
+  Timer timer = Timer();
+  for (int i = 0; i < num_request; i++) {
+    int lo = (my_rank * num_request + 7 * i) % max_key;
+    if (lo % 2 == 0) ++lo;
+    auto bound = set->LowerBound(lo);
+    check(lo + 1 < max_key ? bound.first && bound.second == lo + 1
+                           : !bound.first,
+          "LowerBound", my_rank);
+    int hi = lo + 4 * (int)width;
+    std::vector<int> expected;
+    for (int key = lo + 1; key <= hi && key < max_key; key += 2) {
+      if (expected.size() < width) expected.push_back(key);
+    }
+    timer.resumeTime();
+    auto keys = set->RangeScan(lo, hi, width);
+    timer.pauseTime();
+    check(keys == expected, "RangeScan", my_rank);
+  }
+  int none = max_key;
+  check(!set->LowerBound(none).first, "LowerBound past the end", my_rank);
+  return timer.getElapsedTime() / num_request;
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  /* The even keys below max_key are split evenly between the servers */
+  int max_key = 2 * comm_size * num_request;
+  std::vector<int> sample;
+  for (int key = 0; key < max_key; key += 2) sample.push_back(key);
+  auto partitioner =
+      hcl::OrderedPartitioner<int>::FromSample(sample, num_servers);
+
+  hash_skiplist *hset;
+  ordered_skiplist *oset;
+  if (is_server) {
+    hset = new hash_skiplist("TEST_HASH_SKIPLIST");
+    hset->initialize_sets(num_servers, my_server);
+    oset = new ordered_skiplist("TEST_ORDERED_SKIPLIST");
+    oset->initialize_sets(num_servers, my_server, partitioner);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    hset = new hash_skiplist("TEST_HASH_SKIPLIST");
+    hset->initialize_sets(num_servers, my_server);
+    oset = new ordered_skiplist("TEST_ORDERED_SKIPLIST");
+    oset->initialize_sets(num_servers, my_server, partitioner);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (is_server) {
+    for (int key : sample) {
+      if (hset->isLocal(key)) hset->LocalInsert(key);
+      if (oset->isLocal(key)) oset->LocalInsert(key);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  double hash_ms = check_reads(hset, max_key, num_request, my_rank);
+  double ordered_ms = check_reads(oset, max_key, num_request, my_rank);
+  double hash_max, ordered_max;
+  MPI_Reduce(&hash_ms, &hash_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&ordered_ms, &ordered_max, 1, MPI_DOUBLE, MPI_MAX, 0,
+             MPI_COMM_WORLD);
+  if (my_rank == 0) {
+    printf("hash partitioned RangeScan latency (ms): %f\n", hash_max);
+    printf("ordered partitioned RangeScan latency (ms): %f\n", ordered_max);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (oset);
+  delete (hset);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
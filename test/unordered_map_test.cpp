@@ -260,6 +260,104 @@ int main(int argc, char *argv[]) {
         printf("remote map throughput (get): %f\n", remote_get_tp_result);
       }
     }
+    MPI_Barrier(client_comm);
+
+    /*Batched map test, keys are spread across all servers*/
+    std::vector<KeyType> batch_keys;
+    std::vector<std::array<int, array_size>> batch_vals;
+    for (int i = 0; i < num_request; i++) {
+      batch_keys.push_back(KeyType(my_rank * num_request + i));
+      batch_vals.push_back(my_vals);
+    }
+    Timer batch_put_timer = Timer();
+    batch_put_timer.resumeTime();
+    map->PutBatch(batch_keys, batch_vals);
+    batch_put_timer.pauseTime();
+    double batch_put_throughput = num_request /
+                                  batch_put_timer.getElapsedTime() * 1000 *
+                                  size_of_elem * my_vals.size() / 1024 / 1024;
+
+    Timer batch_get_timer = Timer();
+    batch_get_timer.resumeTime();
+    auto batch_results = map->GetBatch(batch_keys);
+    batch_get_timer.pauseTime();
+    double batch_get_throughput = num_request /
+                                  batch_get_timer.getElapsedTime() * 1000 *
+                                  size_of_elem * my_vals.size() / 1024 / 1024;
+    for (auto &result : batch_results) {
+      if (!result.first) {
+        printf("rank %d: batched get missed a key\n", my_rank);
+        break;
+      }
+    }
+
+    double batch_put_tp_result, batch_get_tp_result;
+    if (client_comm_size > 1) {
+      MPI_Reduce(&batch_put_throughput, &batch_put_tp_result, 1, MPI_DOUBLE,
+                 MPI_SUM, 0, client_comm);
+      MPI_Reduce(&batch_get_throughput, &batch_get_tp_result, 1, MPI_DOUBLE,
+                 MPI_SUM, 0, client_comm);
+      batch_put_tp_result /= client_comm_size;
+      batch_get_tp_result /= client_comm_size;
+    } else {
+      batch_put_tp_result = batch_put_throughput;
+      batch_get_tp_result = batch_get_throughput;
+    }
+
+    if (my_rank == 0) {
+      printf("batch map throughput (put): %f\n", batch_put_tp_result);
+      printf("batch map throughput (get): %f\n", batch_get_tp_result);
+    }
+    MPI_Barrier(client_comm);
+
+    /*Async map test, all requests are in flight before waiting*/
+    Timer async_put_timer = Timer();
+    async_put_timer.resumeTime();
+    std::vector<std::future<bool>> put_futures;
+    for (auto &key : batch_keys) {
+      put_futures.push_back(map->AsyncPut(key, my_vals));
+    }
+    for (auto &future : put_futures) future.get();
+    async_put_timer.pauseTime();
+    double async_put_throughput = num_request /
+                                  async_put_timer.getElapsedTime() * 1000 *
+                                  size_of_elem * my_vals.size() / 1024 / 1024;
+
+    Timer async_get_timer = Timer();
+    async_get_timer.resumeTime();
+    std::vector<std::future<std::pair<bool, std::array<int, array_size>>>>
+        get_futures;
+    for (auto &key : batch_keys) {
+      get_futures.push_back(map->AsyncGet(key));
+    }
+    for (auto &future : get_futures) {
+      if (!future.get().first) {
+        printf("rank %d: async get missed a key\n", my_rank);
+      }
+    }
+    async_get_timer.pauseTime();
+    double async_get_throughput = num_request /
+                                  async_get_timer.getElapsedTime() * 1000 *
+                                  size_of_elem * my_vals.size() / 1024 / 1024;
+    map->EraseBatch(batch_keys);
+
+    double async_put_tp_result, async_get_tp_result;
+    if (client_comm_size > 1) {
+      MPI_Reduce(&async_put_throughput, &async_put_tp_result, 1, MPI_DOUBLE,
+                 MPI_SUM, 0, client_comm);
+      MPI_Reduce(&async_get_throughput, &async_get_tp_result, 1, MPI_DOUBLE,
+                 MPI_SUM, 0, client_comm);
+      async_put_tp_result /= client_comm_size;
+      async_get_tp_result /= client_comm_size;
+    } else {
+      async_put_tp_result = async_put_throughput;
+      async_get_tp_result = async_get_throughput;
+    }
+
+    if (my_rank == 0) {
+      printf("async map throughput (put): %f\n", async_put_tp_result);
+      printf("async map throughput (get): %f\n", async_get_tp_result);
+    }
   }
   MPI_Barrier(MPI_COMM_WORLD);
   delete (map);
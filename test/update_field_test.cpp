@@ -0,0 +1,195 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Applies the server side update operations of the concurrent unordered map,
+ * one key at a time and in batches. The clients count with the built in
+ * and a user registered operation on a BlockMap, reached through RPC, and on
+ * a SharedBlockMap, which the clients on a server's node update in the
+ * segment; they append to the values of a std::string map. Rank 0 reports
+ * the latency of UpdateField.
+ */
+
+#include <hcl/common/data_structures.h>
+#include <hcl/concurrent/unordered_map/unordered_map.h>
+#include <mpi.h>
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "util.h"
+
+#if defined(HCL_ENABLE_THALLIUM_TCP) || defined(HCL_ENABLE_THALLIUM_ROCE)
+template <typename A>
+void serialize(A &ar, int &a) {
+  ar &a;
+}
+#endif
+
+typedef hcl::concurrent_unordered_map<int, int> chained_map;
+typedef hcl::concurrent_unordered_map<
+    int, int, std::hash<int>, std::equal_to<int>, hcl::RangePartitioner,
+    hcl::SharedBlockMap<int, int>>
+    shared_map;
+typedef hcl::concurrent_unordered_map<int, std::string> string_map;
+
+/*A user operation; registered in every process under the same id*/
+const uint32_t UPDATE_DOUBLE_ADD = hcl::UPDATE_USER;
+
+template <typename Map>
+Map *create(const std::string &name, uint64_t total_size, int num_servers,
+            int my_server) {
+  Map *map = new Map(name);
+  map->initialize_tables(total_size, num_servers, my_server, INT32_MAX);
+  return map;
+}
+
+template <typename Map>
+void register_updates(Map *map, int my_rank) {
+  check(map->RegisterUpdate(UPDATE_DOUBLE_ADD,
+                            [](int *value, int &operand) {
+                              *value += 2 * operand;
+                            }),
+        "RegisterUpdate", my_rank);
+  check(!map->RegisterUpdate(hcl::UPDATE_INCREMENT,
+                             [](int *, int &) {}),
+        "RegisterUpdate of a built in id", my_rank);
+}
+
+template <typename Map>
+double count(Map *map, int num_request, int my_rank) {
+  for (int i = 0; i < num_request; i++) {
+    int key = my_rank * num_request + i;
+    map->Insert(key, key);
+  }
+  Timer update_timer = Timer();
+  int counter = my_rank * num_request + 1;
+  int one = 1;
+  for (int i = 0; i < num_request; i++) {
+    update_timer.resumeTime();
+    auto result = map->UpdateField(counter, hcl::UPDATE_INCREMENT, one);
+    update_timer.pauseTime();
+    check(result.first && result.second == counter + 1 + i, "UpdateField",
+          my_rank);
+  }
+  int low = -1;
+  auto min = map->UpdateField(counter, hcl::UPDATE_MIN, low);
+  check(min.first && min.second == low, "UPDATE_MIN", my_rank);
+  std::vector<int> keys, operands;
+  for (int i = 2; i < num_request; i += 2) {
+    keys.push_back(my_rank * num_request + i);
+    operands.push_back(i);
+  }
+  auto before = map->UpdateFieldBatch(keys, hcl::UPDATE_MAX, operands);
+  auto after = map->UpdateFieldBatch(keys, UPDATE_DOUBLE_ADD, operands);
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    check(before[i].first && before[i].second == keys[i] && after[i].first &&
+              after[i].second == keys[i] + 2 * operands[i],
+          "UpdateFieldBatch", my_rank);
+  }
+  int missing = my_rank * num_request;
+  map->Erase(missing);
+  check(!map->UpdateField(missing, hcl::UPDATE_INCREMENT, one).first,
+        "UpdateField of an erased key", my_rank);
+  check(!map->UpdateField(counter, hcl::UPDATE_USER + 1, one).first,
+        "UpdateField of an unknown id", my_rank);
+  check(map->Get(counter) == low, "value after an unknown id", my_rank);
+  return update_timer.getElapsedTime() / num_request;
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  if (provided < MPI_THREAD_MULTIPLE) {
+    printf("Didn't receive appropriate MPI threading specification\n");
+    exit(EXIT_FAILURE);
+  }
+  int comm_size = 0, my_rank = 0;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  int ranks_per_server = comm_size, num_request = 100;
+  long size_of_request = 1000;
+  bool debug = false;
+  bool server_on_node = false;
+  char *server_list_path = std::getenv("SERVER_LIST_PATH");
+
+  if (argc > 1) ranks_per_server = atoi(argv[1]);
+  if (argc > 2) num_request = atoi(argv[2]);
+  if (argc > 3) size_of_request = (long)atol(argv[3]);
+  if (argc > 4) server_on_node = (bool)atoi(argv[4]);
+  if (argc > 5) debug = (bool)atoi(argv[5]);
+  if (debug && my_rank == 0) {
+    printf("%d ready for attach\n", comm_size);
+    fflush(stdout);
+    getchar();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  bool is_server = (my_rank + 1) % ranks_per_server == 0;
+  int my_server = my_rank / ranks_per_server;
+  int num_servers = comm_size / ranks_per_server;
+
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->MY_SERVER = my_server;
+  HCL_CONF->NUM_SERVERS = num_servers;
+  HCL_CONF->SERVER_ON_NODE = server_on_node || is_server;
+  HCL_CONF->SERVER_LIST_PATH = std::string(server_list_path) + "server_list";
+
+  uint64_t total_size = 8192;
+  chained_map *chained;
+  shared_map *shared;
+  string_map *strings;
+  if (is_server) {
+    chained = create<chained_map>("TEST_UPDATE_CHAINED", total_size,
+                                  num_servers, my_server);
+    shared = create<shared_map>("TEST_UPDATE_SHARED", total_size, num_servers,
+                                my_server);
+    strings = create<string_map>("TEST_UPDATE_STRING", total_size,
+                                 num_servers, my_server);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!is_server) {
+    chained = create<chained_map>("TEST_UPDATE_CHAINED", total_size,
+                                  num_servers, my_server);
+    shared = create<shared_map>("TEST_UPDATE_SHARED", total_size, num_servers,
+                                my_server);
+    strings = create<string_map>("TEST_UPDATE_STRING", total_size,
+                                 num_servers, my_server);
+  }
+  register_updates(chained, my_rank);
+  register_updates(shared, my_rank);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (!is_server) {
+    double chained_latency = count(chained, num_request, my_rank);
+    double shared_latency = count(shared, num_request, my_rank);
+    for (int i = 0; i < num_request; i++) {
+      int key = my_rank * num_request + i;
+      std::string value = "a";
+      strings->Insert(key, value);
+      std::string tail = "bc";
+      auto result = strings->UpdateField(key, hcl::UPDATE_APPEND, tail);
+      check(result.first && result.second == "abc", "UPDATE_APPEND", my_rank);
+    }
+    if (my_rank == 0) {
+      printf("UpdateField latency (ms) chained %f shared %f\n",
+             chained_latency, shared_latency);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  delete (strings);
+  delete (shared);
+  delete (chained);
+  MPI_Finalize();
+  exit(EXIT_SUCCESS);
+}
@@ -13,12 +13,27 @@
 #ifndef HCL_UTIL_H
 #define HCL_UTIL_H
 
+#include <mpi.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <boost/interprocess/containers/string.hpp>
 
 namespace bip = boost::interprocess;
 
+/* MSGPACK_DEFINE comes with rpclib; the Thallium builds use serialize() */
+#ifndef MSGPACK_DEFINE
+#define MSGPACK_DEFINE(...)
+#endif
+
+/* Aborts every rank when a test condition does not hold */
+void check(bool condition, const char *what, int my_rank) {
+  if (!condition) {
+    printf("rank %d failed: %s\n", my_rank, what);
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+}
+
 struct KeyType {
   size_t a;
   KeyType() : a(0) {}
@@ -33,6 +48,9 @@ struct KeyType {
     return *this;
   }
   bool operator<(const KeyType &o) const { return a < o.a; }
+  bool operator<=(const KeyType &o) const { return a <= o.a; }
+  bool operator>(const KeyType &o) const { return a > o.a; }
+  bool operator>=(const KeyType &o) const { return a >= o.a; }
   bool Contains(const KeyType &o) const { return a == o.a; }
 
   template <typename A>
@@ -110,6 +128,17 @@ struct MappedType {
     // }
   }
 };
+
+/* Expose the string so 1 MB values move by RDMA bulk on THALLIUM_ROCE. */
+template <>
+struct RDMABuffer<MappedType> {
+  static constexpr bool eligible = true;
+  static constexpr bool fixed_size = false;
+  static void *data(MappedType &value) { return &value.a[0]; }
+  static size_t size(const MappedType &value) { return value.a.size(); }
+  static void resize(MappedType &value, size_t size) { value.a.resize(size); }
+};
+
 const int MAX = 26;
 std::string printRandomString(int n) {
   char alphabet[MAX] = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i',